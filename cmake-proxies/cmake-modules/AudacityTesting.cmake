@@ -40,11 +40,14 @@ if( ${_OPT}has_tests )
 
       add_executable( ${test_executable_name} ${ADD_UNIT_TEST_SOURCES} "${CMAKE_SOURCE_DIR}/tests/Catch2Main.cpp")
       target_link_libraries( ${test_executable_name} PRIVATE ${ADD_UNIT_TEST_LIBRARIES} Catch2::Catch2 )
+      # BENCHMARK must be enabled alike in every translation unit
+      target_compile_definitions( ${test_executable_name} PRIVATE CATCH_CONFIG_ENABLE_BENCHMARKING )
+      # Fakes and mocks shared by the tests of several libraries
+      target_include_directories( ${test_executable_name} PRIVATE "${CMAKE_SOURCE_DIR}/tests" )
 
       if (ADD_UNIT_TEST_MOCK_PREFS)
          target_compile_definitions( ${test_executable_name} PRIVATE MOCK_PREFS )
          target_sources( ${test_executable_name} PRIVATE "${CMAKE_SOURCE_DIR}/tests/MockedPrefs.cpp" "${CMAKE_SOURCE_DIR}/tests/MockedPrefs.h" )
-         target_include_directories( ${test_executable_name} PRIVATE "${CMAKE_SOURCE_DIR}/tests" )
          target_link_libraries( ${test_executable_name} PRIVATE lib-preferences-interface )
       endif()
 
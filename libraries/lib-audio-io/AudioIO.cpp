@@ -102,6 +102,7 @@ time warp info and AudioIOListener and whether the playback is looped.
 #include "Channel.h"
 #include "Meter.h"
 #include "Mix.h"
+#include "MultiChannelRingBuffer.h"
 #include "Resample.h"
 #include "RingBuffer.h"
 #include "Decibels.h"
@@ -840,6 +841,7 @@ int AudioIO::StartStream(const TransportSequences &sequences,
 
    mLostSamples = 0;
    mLostCaptureIntervals.clear();
+   ResetAudioThreadStatistics();
    mDetectDropouts =
       gPrefs->Read( WarningDialogKey(wxT("DropoutDetected")), true ) != 0;
    auto cleanup = finally ( [this] { ClearRecordingException(); } );
@@ -1225,18 +1227,12 @@ bool AudioIO::AllocateBuffers(
             // Adjust mPlaybackRingBufferSecs correspondingly
             mPlaybackRingBufferSecs = PlaybackPolicy::Duration { playbackBufferSize / mRate };
 
-            const size_t totalWidth = std::accumulate(
-               mPlaybackSequences.begin(), mPlaybackSequences.end(), 0,
-               [](size_t acc, const auto &pSequence){
-                  return acc + pSequence->NChannels(); });
-
-            // mPlaybackBuffers buffers correspond many-to-one with
-            // mPlaybackSequences
+            // mPlaybackBuffers correspond one-to-one with mPlaybackSequences
             // Except, always make at least one playback buffer, in case of
             // MIDI playback without any audio
             mPlaybackBuffers.resize(0);
             mPlaybackBuffers.resize(
-               std::max<size_t>(1, totalWidth));
+               std::max<size_t>(1, mPlaybackSequences.size()));
             // Number of scratch buffers depends on device playback channels
             if (mNumPlaybackChannels > 0) {
                mScratchBuffers.resize(mNumPlaybackChannels * 2 + 1);
@@ -1264,24 +1260,27 @@ bool AudioIO::AllocateBuffers(
             mPlaybackQueueMinimum = mPlaybackSamplesToCopy *
                ((mPlaybackQueueMinimum + mPlaybackSamplesToCopy - 1) / mPlaybackSamplesToCopy);
 
+            // Wake the audio thread as soon as it could refill a whole batch,
+            // but not later than at half of the minimum
+            mPlaybackLowWater = std::max(
+               mPlaybackQueueMinimum -
+                  std::min(mPlaybackQueueMinimum, mPlaybackSamplesToCopy),
+               mPlaybackQueueMinimum / 2);
+
             if (mPlaybackSequences.empty())
                // Make at least one playback buffer
-               mPlaybackBuffers[0] =
-                  std::make_unique<RingBuffer>(floatSample, playbackBufferSize);
+               mPlaybackBuffers[0] = std::make_unique<MultiChannelRingBuffer>(
+                  floatSample, 1, playbackBufferSize);
 
             mOldChannelGains.resize(mPlaybackSequences.size());
-            size_t iBuffer = 0;
             for (unsigned int i = 0; i < mPlaybackSequences.size(); i++) {
                const auto &pSequence = mPlaybackSequences[i];
                // Bug 1763 - We must fade in from zero to avoid a click on starting.
                mOldChannelGains[i][0] = 0.0;
                mOldChannelGains[i][1] = 0.0;
 
-               for (size_t jj = 0, nChannels = pSequence->NChannels();
-                  jj < nChannels; ++jj
-               )
-                  mPlaybackBuffers[iBuffer++] = std::make_unique<RingBuffer>(
-                     floatSample, playbackBufferSize);
+               mPlaybackBuffers[i] = std::make_unique<MultiChannelRingBuffer>(
+                  floatSample, pSequence->NChannels(), playbackBufferSize);
 
                // By the precondition of StartStream which is sole caller of
                // this function:
@@ -1799,11 +1798,16 @@ void AudioIO::AudioThread(std::atomic<bool> &finish)
    enum class State { eUndefined, eOnce, eLoopRunning, eDoNothing, eMonitoring } lastState = State::eUndefined;
    AudioIO *const gAudioIO = AudioIO::Get();
    while (!finish.load(std::memory_order_acquire)) {
-      using Clock = std::chrono::steady_clock;
+      using Clock = WakeClock;
       auto loopPassStart = Clock::now();
       auto &schedule = gAudioIO->mPlaybackSchedule;
       const auto interval = schedule.GetPolicy().SleepInterval(schedule);
 
+      // Clear any request before the exchange, so that the callback may
+      // request again if the exchange leaves the queue short
+      const bool wakeRequested = gAudioIO->mAudioThreadWakeRequested
+         .exchange(false, std::memory_order_acq_rel);
+
       // Set LoopActive outside the tests to avoid race condition
       gAudioIO->mAudioThreadSequenceBufferExchangeLoopActive
          .store(true, std::memory_order_relaxed);
@@ -1834,6 +1838,8 @@ void AudioIO::AudioThread(std::atomic<bool> &finish)
          // store really means that the one-time exchange was done.
 
          gAudioIO->SequenceBufferExchange();
+         if (wakeRequested)
+            gAudioIO->RecordAudioThreadFill();
       }
       else
       {
@@ -1856,12 +1862,79 @@ void AudioIO::AudioThread(std::atomic<bool> &finish)
       gAudioIO->mAudioThreadSequenceBufferExchangeLoopActive
          .store(false, std::memory_order_relaxed);
 
-      std::this_thread::sleep_until( loopPassStart + interval );
+      // The sleep interval remains as the fallback, when the callback does
+      // not run or a wake request is lost
+      const auto woken =
+         gAudioIO->WaitForAudioThreadWake(loopPassStart + interval);
+      if (lastState == State::eLoopRunning) {
+         auto &counter = woken
+            ? gAudioIO->mAudioThreadWakeups : gAudioIO->mAudioThreadTimeouts;
+         counter.fetch_add(1, std::memory_order_relaxed);
+      }
    }
 }
 
+void AudioIoCallback::RequestAudioThreadWake()
+{
+   if (mAudioThreadWakeRequested.load(std::memory_order_relaxed) ||
+       GetCommonlyReadyPlayback() >= mPlaybackLowWater)
+      return;
+   mAudioThreadWakeTime.store(
+      WakeClock::now().time_since_epoch().count(), std::memory_order_relaxed);
+   mAudioThreadWakeRequested.store(true, std::memory_order_release);
+   // Notify without taking the mutex, so that this thread never blocks.
+   // A notification that races ahead of the waiter is lost, which only
+   // delays the pass until the sleep interval elapses.
+   mAudioThreadWakeCondition.notify_one();
+}
+
+bool AudioIoCallback::WaitForAudioThreadWake(WakeClock::time_point deadline)
+{
+   std::unique_lock<std::mutex> lock{ mAudioThreadWakeMutex };
+   return mAudioThreadWakeCondition.wait_until(lock, deadline, [this]{
+      return mAudioThreadWakeRequested.load(std::memory_order_acquire); });
+}
+
+void AudioIoCallback::RecordAudioThreadFill()
+{
+   const auto latency = WakeClock::now().time_since_epoch().count() -
+      mAudioThreadWakeTime.load(std::memory_order_relaxed);
+   mAudioThreadFills.fetch_add(1, std::memory_order_relaxed);
+   mAudioThreadFillLatency.fetch_add(latency, std::memory_order_relaxed);
+   if (latency > mAudioThreadMaxFillLatency.load(std::memory_order_relaxed))
+      mAudioThreadMaxFillLatency.store(latency, std::memory_order_relaxed);
+}
+
+void AudioIoCallback::ResetAudioThreadStatistics()
+{
+   mAudioThreadWakeups.store(0, std::memory_order_relaxed);
+   mAudioThreadTimeouts.store(0, std::memory_order_relaxed);
+   mAudioThreadFills.store(0, std::memory_order_relaxed);
+   mAudioThreadFillLatency.store(0, std::memory_order_relaxed);
+   mAudioThreadMaxFillLatency.store(0, std::memory_order_relaxed);
+}
+
+auto AudioIoCallback::GetAudioThreadStatistics() const
+   -> AudioThreadStatistics
+{
+   using namespace std::chrono;
+   const auto fills = mAudioThreadFills.load(std::memory_order_relaxed);
+   const auto total = mAudioThreadFillLatency.load(std::memory_order_relaxed);
+   const WakeClock::duration mean{ fills ? total / WakeClock::rep(fills) : 0 };
+   const WakeClock::duration max{
+      mAudioThreadMaxFillLatency.load(std::memory_order_relaxed) };
+   return {
+      mAudioThreadWakeups.load(std::memory_order_relaxed),
+      mAudioThreadTimeouts.load(std::memory_order_relaxed),
+      duration_cast<microseconds>(mean),
+      duration_cast<microseconds>(max),
+   };
+}
+
+template<typename Buffer>
 size_t AudioIoCallback::MinValue(
-   const RingBuffers &buffers, size_t (RingBuffer::*pmf)() const)
+   const std::vector<std::unique_ptr<Buffer>> &buffers,
+   size_t (Buffer::*pmf)() const)
 {
    return std::accumulate(buffers.begin(), buffers.end(),
       std::numeric_limits<size_t>::max(),
@@ -1871,7 +1944,7 @@ size_t AudioIoCallback::MinValue(
 
 size_t AudioIO::GetCommonlyFreePlayback()
 {
-   auto commonlyAvail = MinValue(mPlaybackBuffers, &RingBuffer::AvailForPut);
+   auto commonlyAvail = MinValue(mPlaybackBuffers, &MultiChannelRingBuffer::AvailForPut);
    // MB: subtract a few samples because the code in SequenceBufferExchange has rounding
    // errors
    return commonlyAvail - std::min(size_t(10), commonlyAvail);
@@ -1879,12 +1952,12 @@ size_t AudioIO::GetCommonlyFreePlayback()
 
 size_t AudioIoCallback::GetCommonlyReadyPlayback()
 {
-   return MinValue(mPlaybackBuffers, &RingBuffer::AvailForGet);
+   return MinValue(mPlaybackBuffers, &MultiChannelRingBuffer::AvailForGet);
 }
 
 size_t AudioIoCallback::GetCommonlyWrittenForPlayback()
 {
-   return MinValue(mPlaybackBuffers, &RingBuffer::WrittenForGet);
+   return MinValue(mPlaybackBuffers, &MultiChannelRingBuffer::WrittenForGet);
 }
 
 size_t AudioIO::GetCommonlyAvailCapture()
@@ -2005,10 +2078,9 @@ bool AudioIO::ProcessPlaybackSlices(
       // atomic variables, the time queue doesn't.
       mPlaybackSchedule.mTimeQueue.Producer(mPlaybackSchedule, slice);
 
-      // mPlaybackMixers correspond one-to-one with mPlaybackSequences
+      // mPlaybackMixers and mPlaybackBuffers correspond one-to-one with
+      // mPlaybackSequences
       size_t iSequence = 0;
-      // mPlaybackBuffers correspond many-to-one with mPlaybackSequences
-      size_t iBuffer = 0;
       for (auto &mixer : mPlaybackMixers) {
          // The mixer here isn't actually mixing: it's just doing
          // resampling, format conversion, and possibly time track
@@ -2018,16 +2090,21 @@ bool AudioIO::ProcessPlaybackSlices(
             if (toProduce)
                produced = mixer->Process(toProduce);
             //wxASSERT(produced <= toProduce);
-            // Copy (non-interleaved) mixer outputs to one or more ring buffers
-            const auto nChannels = mPlaybackSequences[iSequence++]->NChannels();
-            for (size_t j = 0; j < nChannels; ++j) {
-               auto warpedSamples = mixer->GetBuffer(j);
-               const auto put = mPlaybackBuffers[iBuffer++]->Put(
-                  warpedSamples, floatSample, produced, frames - produced);
-               // wxASSERT(put == frames);
-               // but we can't assert in this thread
-               wxUnusedVar(put);
-            }
+            // Copy (non-interleaved) mixer outputs to the channels of the
+            // ring buffer
+            auto &ringBuffer = *mPlaybackBuffers[iSequence++];
+            const auto nChannels = ringBuffer.Channels();
+            // Avoiding std::vector
+            const auto warpedSamples =
+               static_cast<constSamplePtr*>(
+                  alloca(nChannels * sizeof(constSamplePtr)));
+            for (size_t j = 0; j < nChannels; ++j)
+               warpedSamples[j] = mixer->GetBuffer(j);
+            const auto put = ringBuffer.Put(
+               warpedSamples, floatSample, produced, frames - produced);
+            // wxASSERT(put == frames);
+            // but we can't assert in this thread
+            wxUnusedVar(put);
          }
       }
 
@@ -2059,9 +2136,10 @@ void AudioIO::TransformPlayBuffers(
    const auto pointers = stackAllocate(float*, mNumPlaybackChannels);
 
    const auto numPlaybackSequences = mPlaybackSequences.size();
-   // mPlaybackBuffers correspond many-to-one with mPlaybackSequences
+   // mPlaybackBuffers correspond one-to-one with mPlaybackSequences
    size_t iBuffer = 0;
    for (const auto vt : mPlaybackSequences) {
+      auto &ringBuffer = *mPlaybackBuffers[iBuffer++];
       if (!vt)
          continue;
       const auto pGroup = vt->FindChannelGroup();
@@ -2076,8 +2154,7 @@ void AudioIO::TransformPlayBuffers(
          size_t len = 0;
          size_t iChannel = 0;
          for (; iChannel < nChannels; ++iChannel) {
-            auto &ringBuffer = *mPlaybackBuffers[iBuffer + iChannel];
-            const auto pair = ringBuffer.GetUnflushed(iBlock);
+            const auto pair = ringBuffer.GetUnflushed(iChannel, iBlock);
             // Playback RingBuffers have float format: see AllocateBuffers
             pointers[iChannel] = reinterpret_cast<float*>(pair.first);
             // The lengths of corresponding unflushed blocks should be
@@ -2103,15 +2180,10 @@ void AudioIO::TransformPlayBuffers(
                // The single dummy output buffer:
                mScratchPointers[mNumPlaybackChannels],
                mNumPlaybackChannels, len);
-            iChannel = 0;
-            for (; iChannel < nChannels; ++iChannel) {
-               auto &ringBuffer = *mPlaybackBuffers[iBuffer + iChannel];
-               auto discarded = ringBuffer.Unput(discardable);
-               // assert(discarded == discardable);
-            }
+            auto discarded = ringBuffer.Unput(discardable);
+            // assert(discarded == discardable);
          }
       }
-      iBuffer += vt->NChannels();
    }
 }
 
@@ -2142,6 +2214,9 @@ void AudioIO::DrainRecordBuffers()
    };
 
    GuardedCall( [&] {
+      // Don't make recording wait for the database
+      RecordableSequence::DeferredWritesScope deferWrites;
+
       // start record buffering
       const auto avail = GetCommonlyAvailCapture(); // samples
       const auto remainingTime =
@@ -2680,10 +2755,10 @@ bool AudioIoCallback::FillOutputBuffers(
 
    bool drop = false;        // Sequence should become silent.
    bool discardable = false; // Sequence has already been faded to silence.
-   // mPlaybackBuffers buffers correspond many-to-one with mPlaybackSequences
-   size_t iBuffer = 0;
+   // mPlaybackBuffers correspond one-to-one with mPlaybackSequences
    for (unsigned tt = 0; tt < numPlaybackSequences; ++tt) {
       auto vt = mPlaybackSequences[tt].get();
+      auto &ringBuffer = *mPlaybackBuffers[tt];
       const auto width = vt->NChannels();
 
       // IF mono THEN clear 'the other' channel.
@@ -2701,30 +2776,29 @@ bool AudioIoCallback::FillOutputBuffers(
 
       decltype(framesPerBuffer) len = 0;
 
-      for (size_t c = 0; c < width; ++c) {
-         if (discardable) {
-            len = mPlaybackBuffers[iBuffer]->Discard(toGet);
-            // keep going here.
-            // we may still need to issue a paComplete.
+      if (discardable) {
+         len = ringBuffer.Discard(toGet);
+         // keep going here.
+         // we may still need to issue a paComplete.
 
-            // Keep tempBufs initialized to avoid NaNs and Infs
+         // Keep tempBufs initialized to avoid NaNs and Infs
+         for (size_t c = 0; c < width; ++c)
             memset(tempBufs[c], 0, framesPerBuffer * sizeof(float));
-         }
-         else {
-            len = mPlaybackBuffers[iBuffer]
-               ->Get((samplePtr)tempBufs[c], floatSample, toGet);
-            // wxASSERT( len == toGet );
-            if (len < framesPerBuffer)
-               // This used to happen normally at the end of non-looping
-               // plays, but it can also be an anomalous case where the
-               // supply from SequenceBufferExchange fails to keep up with the
-               // real-time demand in this thread (see bug 1932).  We
-               // must supply something to the sound card, so pad it with
-               // zeroes and not random garbage.
+      }
+      else {
+         len = ringBuffer.Get(
+            reinterpret_cast<const samplePtr*>(tempBufs), floatSample, toGet);
+         // wxASSERT( len == toGet );
+         if (len < framesPerBuffer)
+            // This used to happen normally at the end of non-looping
+            // plays, but it can also be an anomalous case where the
+            // supply from SequenceBufferExchange fails to keep up with the
+            // real-time demand in this thread (see bug 1932).  We
+            // must supply something to the sound card, so pad it with
+            // zeroes and not random garbage.
+            for (size_t c = 0; c < width; ++c)
                memset((void*)&tempBufs[c][len], 0,
                   (framesPerBuffer - len) * sizeof(float));
-         }
-         ++iBuffer;
       }
 
       // PRL:  More recent rewrites of SequenceBufferExchange should guarantee a
@@ -3194,6 +3268,10 @@ int AudioIoCallback::AudioCallback(
          outputMeterFloats))
       return mCallbackReturn;
 
+   // Don't wait for the audio thread's sleep interval if the playback
+   // buffers are running low
+   RequestAudioThreadWake();
+
    // To move the cursor onwards.  (uses mMaxFramesOutput)
    UpdateTimePosition(framesPerBuffer);
 
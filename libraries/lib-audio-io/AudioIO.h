@@ -17,6 +17,8 @@
 #include "AudioIOSequences.h"
 #include "PlaybackSchedule.h" // member variable
 
+#include <chrono>
+#include <condition_variable>
 #include <functional>
 #include <memory>
 #include <mutex>
@@ -32,6 +34,7 @@
 class wxArrayString;
 class AudioIOBase;
 class AudioIO;
+class MultiChannelRingBuffer;
 class RingBuffer;
 class Mixer;
 class OtherPlayableSequence;
@@ -271,8 +274,12 @@ public:
    using RingBuffers = std::vector<std::unique_ptr<RingBuffer>>;
    RingBuffers mCaptureBuffers;
    RecordableSequences mCaptureSequences;
+   using PlaybackBuffers =
+      std::vector<std::unique_ptr<MultiChannelRingBuffer>>;
    /*! Read by worker threads but unchanging during playback */
-   RingBuffers mPlaybackBuffers;
+   /*! One for each of mPlaybackSequences, with as many channels; or, a single
+    mono buffer if there are no playback sequences */
+   PlaybackBuffers mPlaybackBuffers;
    ConstPlayableSequences      mPlaybackSequences;
    // Old gain is used in playback in linearly interpolating
    // the gain.
@@ -318,6 +325,34 @@ public:
    std::atomic<bool>   mAudioThreadShouldCallSequenceBufferExchangeOnce;
    std::atomic<bool>   mAudioThreadSequenceBufferExchangeLoopRunning;
    std::atomic<bool>   mAudioThreadSequenceBufferExchangeLoopActive;
+
+   using WakeClock = std::chrono::steady_clock;
+   //! Set by the callback when the playback queue falls below
+   //! mPlaybackLowWater; cleared by the audio thread when it starts a pass
+   std::atomic<bool>   mAudioThreadWakeRequested{ false };
+   //! When the wake was requested, in WakeClock ticks
+   std::atomic<WakeClock::rep> mAudioThreadWakeTime{ 0 };
+   std::mutex          mAudioThreadWakeMutex;
+   std::condition_variable mAudioThreadWakeCondition;
+   /// Occupancy of the playback queue below which the callback wakes the
+   /// audio thread before its sleep interval elapses
+   size_t              mPlaybackLowWater{ 0 };
+
+   //! Written only by the audio thread
+   std::atomic<unsigned long long> mAudioThreadWakeups{ 0 },
+      mAudioThreadTimeouts{ 0 }, mAudioThreadFills{ 0 };
+   //! Sum and maximum of wake-to-fill latencies, in WakeClock ticks
+   std::atomic<WakeClock::rep> mAudioThreadFillLatency{ 0 },
+      mAudioThreadMaxFillLatency{ 0 };
+
+   //! Called in the callback, after the playback buffers are read
+   void RequestAudioThreadWake();
+   //! Called in the audio thread between passes
+   /*! @return whether woken by RequestAudioThreadWake() before the deadline */
+   bool WaitForAudioThreadWake(WakeClock::time_point deadline);
+   //! Called in the audio thread after a pass that a wake request started
+   void RecordAudioThreadFill();
+   void ResetAudioThreadStatistics();
       
    std::atomic<Acknowledge>  mAudioThreadAcknowledge;
 
@@ -342,8 +377,10 @@ public:
    PaError             mLastPaError;
 
 protected:
+   template<typename Buffer>
    static size_t MinValue(
-      const RingBuffers &buffers, size_t (RingBuffer::*pmf)() const);
+      const std::vector<std::unique_ptr<Buffer>> &buffers,
+      size_t (Buffer::*pmf)() const);
 
    float GetMixerOutputVol() {
       return mMixerOutputVol.load(std::memory_order_relaxed); }
@@ -392,6 +429,18 @@ public:
    const std::vector< std::pair<double, double> > &LostCaptureIntervals()
    { return mLostCaptureIntervals; }
 
+   //! How the audio thread was woken since the start of the stream
+   struct AudioThreadStatistics {
+      //! Passes started early because the callback found playback low
+      unsigned long long wakeups{ 0 };
+      //! Passes started because the sleep interval elapsed
+      unsigned long long timeouts{ 0 };
+      //! From the callback's request to the end of the buffer exchange
+      std::chrono::microseconds meanWakeToFill{ 0 };
+      std::chrono::microseconds maxWakeToFill{ 0 };
+   };
+   AudioThreadStatistics GetAudioThreadStatistics() const;
+
    // Used only for testing purposes in alpha builds
    bool mSimulateRecordingErrors{ false };
 
@@ -0,0 +1,269 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  MultiChannelRingBuffer.cpp
+
+*******************************************************************//*!
+
+\class MultiChannelRingBuffer
+\brief Holds streamed audio samples of several channels that advance
+together.
+
+  The same single-reader, single-writer lock-free protocol as RingBuffer,
+  but one pair of atomic indices serves all the channels, so the costs of
+  synchronization do not grow with their number.
+
+  The channels are not interleaved:  each occupies a contiguous, cache-line
+  aligned stretch of one allocation, so that the writer may transform
+  unflushed samples in place, channel by channel.
+
+*//*******************************************************************/
+
+
+#include "MultiChannelRingBuffer.h"
+#include "Dither.h"
+#include <cstdint>
+#include <cstring>
+
+namespace {
+constexpr size_t CacheLineBytes = 64;
+
+size_t RoundUpToCacheLine(size_t bytes)
+{
+   return (bytes + CacheLineBytes - 1) / CacheLineBytes * CacheLineBytes;
+}
+
+samplePtr AlignToCacheLine(samplePtr ptr)
+{
+   const auto address = reinterpret_cast<std::uintptr_t>(ptr);
+   return ptr + (RoundUpToCacheLine(address) - address);
+}
+}
+
+MultiChannelRingBuffer::MultiChannelRingBuffer(
+   sampleFormat format, size_t nChannels, size_t size)
+   : mBufferSize{ std::max<size_t>(size, 64) }
+   , mChannels{ std::max<size_t>(nChannels, 1) }
+   , mFormat{ format }
+   , mChannelBytes{ RoundUpToCacheLine(mBufferSize * SAMPLE_SIZE(mFormat)) }
+   // Allocate one cache line more, for the alignment
+   , mBuffer{
+      (mChannels * mChannelBytes + CacheLineBytes) / SAMPLE_SIZE(mFormat),
+      mFormat }
+   , mStorage{ AlignToCacheLine(mBuffer.ptr()) }
+{
+}
+
+MultiChannelRingBuffer::~MultiChannelRingBuffer()
+{
+}
+
+// Calculations of free and filled space, given snapshots taken of the start
+// and end values
+
+size_t MultiChannelRingBuffer::Filled(size_t start, size_t end) const
+{
+   return (end + mBufferSize - start) % mBufferSize;
+}
+
+size_t MultiChannelRingBuffer::Free(size_t start, size_t end) const
+{
+   return std::max<size_t>(mBufferSize - Filled( start, end ), 4) - 4;
+}
+
+//
+// For the writer only:
+// The memory orders are as explained for RingBuffer
+//
+
+size_t MultiChannelRingBuffer::AvailForPut() const
+{
+   auto start = mStart.load( std::memory_order_relaxed );
+   return Free( start, mWritten );
+}
+
+size_t MultiChannelRingBuffer::WrittenForGet() const
+{
+   auto start = mStart.load( std::memory_order_relaxed );
+   return Filled( start, mWritten );
+}
+
+size_t MultiChannelRingBuffer::Put(const constSamplePtr *buffers,
+   sampleFormat format, size_t samplesToCopy, size_t padding)
+{
+   mLastPadding = padding;
+   auto start = mStart.load( std::memory_order_acquire );
+   auto end = mWritten;
+   const auto free = Free( start, end );
+   samplesToCopy = std::min( samplesToCopy, free );
+   padding = std::min( padding, free - samplesToCopy );
+   const auto sampleSize = SAMPLE_SIZE(mFormat);
+   size_t copied = 0;
+   auto pos = end;
+
+   while ( samplesToCopy ) {
+      auto block = std::min( samplesToCopy, mBufferSize - pos );
+
+      for (size_t iChannel = 0; iChannel < mChannels; ++iChannel)
+         CopySamples(buffers[iChannel] + copied * SAMPLE_SIZE(format), format,
+                     Channel(iChannel) + pos * sampleSize, mFormat,
+                     block, DitherType::none);
+
+      pos = (pos + block) % mBufferSize;
+      samplesToCopy -= block;
+      copied += block;
+   }
+
+   while ( padding ) {
+      const auto block = std::min( padding, mBufferSize - pos );
+      for (size_t iChannel = 0; iChannel < mChannels; ++iChannel)
+         ClearSamples( Channel(iChannel), mFormat, pos, block );
+      pos = (pos + block) % mBufferSize;
+      padding -= block;
+      copied += block;
+   }
+
+   mWritten = pos;
+   return copied;
+}
+
+size_t MultiChannelRingBuffer::Unput(size_t size)
+{
+   const auto sampleSize = SAMPLE_SIZE(mFormat);
+
+   // un-put some of the un-flushed data which is from mEnd to mWritten
+   // bound the result
+   auto end = mEnd.load(std::memory_order_relaxed);
+   size = std::min(size, Filled(end, mWritten));
+   const auto result = size;
+
+   // The same moves as in RingBuffer::Unput, repeated in each channel
+
+   // First memmove
+   auto limit = end < mWritten ? mWritten : mBufferSize;
+   // Source offset for move
+   auto source = std::min(end + size, limit);
+   // How many to move
+   auto count = limit - source;
+   // Discount how many really discarded
+   size -= (source - end);
+
+   for (size_t iChannel = 0; iChannel < mChannels; ++iChannel) {
+      const auto buffer = Channel(iChannel);
+      memmove(buffer + end * sampleSize, buffer + source * sampleSize,
+         count * sampleSize);
+
+      if (end >= mWritten) {
+         // The unflushed data were wrapped around, not contiguous
+         // Rotate some samples from start of buffer, but discarding
+         // any remaining number that must be un-put
+         // Then shift samples near the start of buffer
+         const auto dst = end + count;
+         auto pSrc = buffer + size * sampleSize;
+         auto toMove = mWritten - size;
+         auto toMove1 = std::min(toMove, mBufferSize - dst);
+         auto toMove2 = toMove - toMove1;
+         memmove(buffer + dst * sampleSize, pSrc, toMove1 * sampleSize);
+         memmove(buffer, pSrc + toMove1 * sampleSize, toMove2 * sampleSize);
+      }
+   }
+   if (end >= mWritten)
+      end += count;
+
+   // Move mWritten backwards by result
+   mWritten = (mWritten + (mBufferSize - result)) % mBufferSize;
+
+   // Adjust mLastPadding
+   mLastPadding = std::min(mLastPadding, Filled(end, mWritten));
+
+   return result;
+}
+
+std::pair<samplePtr, size_t>
+MultiChannelRingBuffer::GetUnflushed(size_t iChannel, unsigned iBlock)
+{
+   // This function is called by the writer
+
+   // Find total number of samples unflushed:
+   auto end = mEnd.load(std::memory_order_relaxed);
+   const size_t size = Filled(end, mWritten) - mLastPadding;
+
+   // How many in the first part:
+   const size_t size0 = std::min(size, mBufferSize - end);
+   // How many wrap around the ring buffer:
+   const size_t size1 = size - size0;
+
+   const auto buffer = Channel(iChannel);
+   if (iBlock == 0)
+      return {
+         size0 ? buffer + end * SAMPLE_SIZE(mFormat) : nullptr,
+         size0 };
+   else
+      return {
+         size1 ? buffer : nullptr,
+         size1 };
+}
+
+void MultiChannelRingBuffer::Flush()
+{
+   // Atomically update the end pointer with release, so the nonatomic writes
+   // just done to the buffers of all channels don't get reordered after
+   mEnd.store(mWritten, std::memory_order_release);
+   mLastPadding = 0;
+}
+
+//
+// For the reader only:
+//
+
+size_t MultiChannelRingBuffer::AvailForGet() const
+{
+   auto end = mEnd.load( std::memory_order_relaxed ); // get away with it here
+   auto start = mStart.load( std::memory_order_relaxed );
+   return Filled( start, end );
+}
+
+size_t MultiChannelRingBuffer::Get(const samplePtr *buffers,
+   sampleFormat format, size_t samplesToCopy)
+{
+   // Must match the writer's release with acquire for well defined reads of
+   // the buffers
+   auto end = mEnd.load( std::memory_order_acquire );
+   auto start = mStart.load( std::memory_order_relaxed );
+   samplesToCopy = std::min( samplesToCopy, Filled( start, end ) );
+   const auto sampleSize = SAMPLE_SIZE(mFormat);
+   size_t copied = 0;
+
+   while(samplesToCopy) {
+      auto block = std::min( samplesToCopy, mBufferSize - start );
+
+      for (size_t iChannel = 0; iChannel < mChannels; ++iChannel)
+         CopySamples(Channel(iChannel) + start * sampleSize, mFormat,
+                     buffers[iChannel] + copied * SAMPLE_SIZE(format), format,
+                     block, DitherType::none);
+
+      start = (start + block) % mBufferSize;
+      samplesToCopy -= block;
+      copied += block;
+   }
+
+   // Communicate to writer that we have consumed some data,
+   // with nonrelaxed ordering
+   mStart.store( start, std::memory_order_release );
+
+   return copied;
+}
+
+size_t MultiChannelRingBuffer::Discard(size_t samplesToDiscard)
+{
+   auto end = mEnd.load( std::memory_order_relaxed ); // get away with it here
+   auto start = mStart.load( std::memory_order_relaxed );
+   samplesToDiscard = std::min( samplesToDiscard, Filled( start, end ) );
+
+   // Communicate to writer that we have skipped some data, and that's all
+   mStart.store((start + samplesToDiscard) % mBufferSize,
+                std::memory_order_relaxed);
+
+   return samplesToDiscard;
+}
@@ -0,0 +1,94 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  MultiChannelRingBuffer.h
+
+*******************************************************************/
+
+#ifndef __AUDACITY_MULTI_CHANNEL_RING_BUFFER__
+#define __AUDACITY_MULTI_CHANNEL_RING_BUFFER__
+
+#include "SampleFormat.h"
+#include <atomic>
+
+//! Like RingBuffer, but for several channels that are always written and
+//! read in step
+/*!
+ All channels share one allocation, each channel starting on its own cache
+ line, and share one pair of atomic indices.
+
+ Functions that take or return buffers deal with one pointer per channel.
+ */
+class AUDIO_IO_API MultiChannelRingBuffer final : public NonInterferingBase {
+ public:
+   MultiChannelRingBuffer(
+      sampleFormat format, size_t nChannels, size_t size);
+   ~MultiChannelRingBuffer();
+
+   size_t Channels() const { return mChannels; }
+
+   //
+   // For the writer only:
+   //
+
+   size_t AvailForPut() const;
+   //! Reader may concurrently cause a decrease of what this returns
+   size_t WrittenForGet() const;
+   //! Does not apply dithering
+   /*!
+    @param buffers one for each channel; may be null when samples is zero
+    */
+   size_t Put(const constSamplePtr *buffers, sampleFormat format,
+              size_t samples,
+              // optional number of trailing zeroes
+              size_t padding = 0);
+   //! Remove an initial segment of data that has been Put but not Flushed yet
+   /*!
+    @return how many were unput from each channel
+    */
+   size_t Unput(size_t size);
+   //! Get access to written but unflushed data of one channel, which is in at
+   //! most two blocks of the same lengths for all channels
+   //! Excludes the padding of the most recent Put()
+   std::pair<samplePtr, size_t> GetUnflushed(
+      size_t iChannel, unsigned iBlock);
+   //! Flush after a sequence of Put calls to let consumer see
+   void Flush();
+
+   //
+   // For the reader only:
+   //
+
+   size_t AvailForGet() const;
+   //! Does not apply dithering
+   /*!
+    @param buffers one for each channel
+    */
+   size_t Get(const samplePtr *buffers, sampleFormat format, size_t samples);
+   size_t Discard(size_t samples);
+
+ private:
+   size_t Filled(size_t start, size_t end) const;
+   size_t Free(size_t start, size_t end) const;
+   samplePtr Channel(size_t iChannel) const
+   { return mStorage + iChannel * mChannelBytes; }
+
+   size_t mWritten{0};
+   size_t mLastPadding{0};
+
+   // Align the two atomics to avoid false sharing
+   NonInterfering< std::atomic<size_t> > mStart{ 0 }, mEnd{ 0 };
+
+   const size_t  mBufferSize;
+   const size_t  mChannels;
+
+   const sampleFormat  mFormat;
+   //! Distance in bytes between the starts of consecutive channels
+   const size_t  mChannelBytes;
+   const SampleBuffer  mBuffer;
+   //! Start of the first channel, cache-line aligned within mBuffer
+   const samplePtr  mStorage;
+};
+
+#endif /*  __AUDACITY_MULTI_CHANNEL_RING_BUFFER__ */
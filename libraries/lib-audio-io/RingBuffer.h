@@ -14,7 +14,7 @@
 #include "SampleFormat.h"
 #include <atomic>
 
-class RingBuffer final : public NonInterferingBase {
+class AUDIO_IO_API RingBuffer final : public NonInterferingBase {
  public:
    RingBuffer(sampleFormat format, size_t size);
    ~RingBuffer();
@@ -0,0 +1,178 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  MultiChannelRingBufferTests.cpp
+
+**********************************************************************/
+#include "MultiChannelRingBuffer.h"
+#include "RingBuffer.h"
+
+#include <catch2/catch.hpp>
+
+#include <memory>
+#include <vector>
+
+namespace {
+using Channels = std::vector<std::vector<float>>;
+
+Channels MakeRamps(size_t nChannels, size_t len, float first)
+{
+   Channels channels(nChannels, std::vector<float>(len));
+   for (size_t iChannel = 0; iChannel < nChannels; ++iChannel)
+      for (size_t i = 0; i < len; ++i)
+         channels[iChannel][i] = first + 1000 * iChannel + i;
+   return channels;
+}
+
+std::vector<constSamplePtr> Sources(const Channels &channels)
+{
+   std::vector<constSamplePtr> result;
+   for (auto &channel : channels)
+      result.push_back(reinterpret_cast<constSamplePtr>(channel.data()));
+   return result;
+}
+
+std::vector<samplePtr> Destinations(Channels &channels)
+{
+   std::vector<samplePtr> result;
+   for (auto &channel : channels)
+      result.push_back(reinterpret_cast<samplePtr>(channel.data()));
+   return result;
+}
+}
+
+TEST_CASE("MultiChannelRingBuffer")
+{
+   constexpr size_t nChannels = 3;
+   constexpr size_t size = 100;
+   MultiChannelRingBuffer buffer{ floatSample, nChannels, size };
+   REQUIRE(buffer.Channels() == nChannels);
+
+   SECTION("Samples wrap around the end and come back in order")
+   {
+      Channels out(nChannels, std::vector<float>(size));
+      float first = 0;
+      // Repeated passes leave the indices at various places
+      for (int pass = 0; pass < 5; ++pass, first += 70) {
+         const auto in = MakeRamps(nChannels, 70, first);
+         REQUIRE(buffer.Put(Sources(in).data(), floatSample, 70) == 70);
+         // Not visible to the reader until flushed
+         REQUIRE(buffer.AvailForGet() == 0);
+         buffer.Flush();
+         REQUIRE(buffer.AvailForGet() == 70);
+         REQUIRE(buffer.Get(Destinations(out).data(), floatSample, 70) == 70);
+         for (size_t iChannel = 0; iChannel < nChannels; ++iChannel)
+            for (size_t i = 0; i < 70; ++i)
+               REQUIRE(out[iChannel][i] == in[iChannel][i]);
+      }
+   }
+
+   SECTION("Put is limited by the free space")
+   {
+      const auto in = MakeRamps(nChannels, 2 * size, 0);
+      const auto put = buffer.Put(Sources(in).data(), floatSample, 2 * size);
+      REQUIRE(put == buffer.WrittenForGet());
+      REQUIRE(put < size);
+      REQUIRE(buffer.AvailForPut() == 0);
+   }
+
+   SECTION("Padding writes zeroes in all channels")
+   {
+      const auto in = MakeRamps(nChannels, 10, 1);
+      REQUIRE(buffer.Put(Sources(in).data(), floatSample, 10, 5) == 15);
+      buffer.Flush();
+      Channels out(nChannels, std::vector<float>(15, -1));
+      REQUIRE(buffer.Get(Destinations(out).data(), floatSample, 15) == 15);
+      for (auto &channel : out)
+         for (size_t i = 10; i < 15; ++i)
+            REQUIRE(channel[i] == 0);
+   }
+
+   SECTION("Unflushed samples are in the same blocks for all channels")
+   {
+      // Move the indices near the end, so that the next Put wraps
+      const auto first = MakeRamps(nChannels, 90, 0);
+      buffer.Put(Sources(first).data(), floatSample, 90);
+      buffer.Flush();
+      REQUIRE(buffer.Discard(90) == 90);
+
+      const auto in = MakeRamps(nChannels, 20, 0);
+      buffer.Put(Sources(in).data(), floatSample, 20);
+      for (size_t iChannel = 0; iChannel < nChannels; ++iChannel) {
+         const auto [ptr0, len0] = buffer.GetUnflushed(iChannel, 0);
+         const auto [ptr1, len1] = buffer.GetUnflushed(iChannel, 1);
+         REQUIRE(len0 == 10);
+         REQUIRE(len1 == 10);
+         REQUIRE(reinterpret_cast<float*>(ptr0)[0] == in[iChannel][0]);
+         REQUIRE(reinterpret_cast<float*>(ptr1)[0] == in[iChannel][10]);
+      }
+   }
+
+   SECTION("Unput removes an initial segment of unflushed samples")
+   {
+      const auto first = MakeRamps(nChannels, 90, 0);
+      buffer.Put(Sources(first).data(), floatSample, 90);
+      buffer.Flush();
+      buffer.Discard(90);
+
+      const auto in = MakeRamps(nChannels, 20, 0);
+      buffer.Put(Sources(in).data(), floatSample, 20);
+      REQUIRE(buffer.Unput(15) == 15);
+      buffer.Flush();
+      Channels out(nChannels, std::vector<float>(5));
+      REQUIRE(buffer.Get(Destinations(out).data(), floatSample, 20) == 5);
+      for (size_t iChannel = 0; iChannel < nChannels; ++iChannel)
+         for (size_t i = 0; i < 5; ++i)
+            REQUIRE(out[iChannel][i] == in[iChannel][15 + i]);
+   }
+}
+
+TEST_CASE("MultiChannelRingBuffer benchmark", "[.][benchmark]")
+{
+   // A project of many stereo tracks, exchanging one callback's worth of
+   // samples at a time
+   constexpr size_t nTracks = 32;
+   constexpr size_t nChannels = 2 * nTracks;
+   constexpr size_t size = 44100;
+   constexpr size_t frames = 512;
+
+   const auto in = MakeRamps(2, frames, 0);
+   Channels out(2, std::vector<float>(frames));
+   const auto sources = Sources(in);
+   const auto destinations = Destinations(out);
+
+   std::vector<std::unique_ptr<RingBuffer>> ringBuffers;
+   for (size_t i = 0; i < nChannels; ++i)
+      ringBuffers.push_back(std::make_unique<RingBuffer>(floatSample, size));
+
+   std::vector<std::unique_ptr<MultiChannelRingBuffer>> multiBuffers;
+   for (size_t i = 0; i < nTracks; ++i)
+      multiBuffers.push_back(
+         std::make_unique<MultiChannelRingBuffer>(floatSample, 2, size));
+
+   BENCHMARK("One RingBuffer per channel")
+   {
+      for (size_t i = 0; i < nChannels; ++i)
+         ringBuffers[i]->Put(sources[i % 2], floatSample, frames);
+      for (auto &pBuffer : ringBuffers)
+         pBuffer->Flush();
+      size_t got = 0;
+      for (size_t i = 0; i < nChannels; ++i)
+         got += ringBuffers[i]->Get(destinations[i % 2], floatSample, frames);
+      return got;
+   };
+
+   BENCHMARK("One MultiChannelRingBuffer per track")
+   {
+      for (auto &pBuffer : multiBuffers)
+         pBuffer->Put(sources.data(), floatSample, frames);
+      for (auto &pBuffer : multiBuffers)
+         pBuffer->Flush();
+      size_t got = 0;
+      for (auto &pBuffer : multiBuffers)
+         got += pBuffer->Get(destinations.data(), floatSample, frames);
+      return got;
+   };
+}
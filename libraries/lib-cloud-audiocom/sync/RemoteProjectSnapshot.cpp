@@ -500,7 +500,7 @@ void RemoteProjectSnapshot::OnProjectBlobDownloaded(
    }
 
    auto deleteAutosaveStatement = db->CreateStatement(
-      "DELETE FROM " + mSnapshotDBName + ".autosave WHERE id = 1");
+      "DELETE FROM " + mSnapshotDBName + ".autosave");
 
    if (!deleteAutosaveStatement)
    {
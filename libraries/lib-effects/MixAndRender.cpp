@@ -116,7 +116,9 @@ Track::Holder MixAndRender(const TrackIterRange<const WaveTrack> &trackRange,
       // Throw to abort mix-and-render if read fails:
       true, warpOptions,
       startTime, endTime, mono ? 1 : 2, maxBlockLen, false,
-      rate, format);
+      rate, format, true, nullptr, Mixer::ApplyGain::MapChannels,
+      // Tracks may be fetched and resampled concurrently
+      MixerOptions::Threading{ 0 });
 
    using namespace BasicUI;
    auto updateResult = ProgressResult::Success;
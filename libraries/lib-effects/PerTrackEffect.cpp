@@ -25,12 +25,17 @@
 #include "AudioGraphTask.h"
 #include "EffectStage.h"
 #include "SyncLock.h"
+#include "ThreadPool.h"
 #include "TimeWarper.h"
 #include "ViewInfo.h"
 #include "WaveTrack.h"
 #include "WaveTrackSink.h"
 #include "WideSampleSource.h"
 
+#include <algorithm>
+#include <atomic>
+#include <numeric>
+
 PerTrackEffect::Instance::~Instance() = default;
 
 bool PerTrackEffect::Instance::Process(EffectSettings &settings)
@@ -61,6 +66,11 @@ bool PerTrackEffect::DoPass2() const
    return false;
 }
 
+bool PerTrackEffect::CanProcessTracksConcurrently() const
+{
+   return false;
+}
+
 bool PerTrackEffect::Process(
    EffectInstance &instance, EffectSettings &settings) const
 {
@@ -97,6 +107,11 @@ bool PerTrackEffect::ProcessPass(TrackList &outputs,
    bool isGenerator = GetType() == EffectTypeGenerate;
    bool isProcessor = GetType() == EffectTypeProcess;
 
+   if (isProcessor && CanProcessTracksConcurrently() &&
+      Parallel::ThreadPool::Get().Workers() > 0 &&
+      outputs.Selected<const WaveTrack>().size() > 1)
+      return ProcessPassConcurrently(outputs, instance, settings);
+
    Buffers inBuffers, outBuffers;
    ChannelName map[3];
    size_t prevBufferSize = 0;
@@ -355,6 +370,141 @@ bool PerTrackEffect::ProcessPass(TrackList &outputs,
    return bGoodResult;
 }
 
+bool PerTrackEffect::ProcessPassConcurrently(TrackList &outputs,
+   Instance &instance, EffectSettings &settings)
+{
+   const auto duration = settings.extra.GetDuration();
+   const auto numAudioIn = instance.GetAudioInCount();
+   const auto numAudioOut = instance.GetAudioOutCount();
+   if (numAudioOut < 1)
+      return false;
+   const bool multichannel = numAudioIn > 1;
+   const auto effectiveFormat =
+      instance.NeedsDither() ? widestSampleFormat : narrowestSampleFormat;
+
+   struct Job {
+      WaveTrack &track;
+      std::shared_ptr<EffectInstance> pInstance;
+      sampleCount start;
+      sampleCount len;
+      bool ok;
+   };
+   std::vector<Job> jobs;
+
+   // Visit the tracks and make the instances on this thread; only the
+   // processing goes to the other threads
+   for (const auto pTrack : outputs.Any()) {
+      const auto pWaveTrack = track_cast<WaveTrack*>(pTrack);
+      if (!pWaveTrack || !pWaveTrack->GetSelected()) {
+         if (SyncLock::IsSyncLockSelected(*pTrack))
+            pTrack->SyncLockAdjust(mT1, mT0 + duration);
+         continue;
+      }
+      auto &job = jobs.emplace_back(Job{ *pWaveTrack,
+         jobs.empty()
+            ? std::dynamic_pointer_cast<EffectInstanceEx>(
+               instance.shared_from_this())
+            : MakeInstance() });
+      GetBounds(job.track, &job.start, &job.len);
+      if (job.len > 0 && numAudioIn < 1)
+         return false;
+   }
+
+   std::vector<std::atomic<double>> fractions(jobs.size());
+   for (auto &fraction : fractions)
+      fraction.store(0, std::memory_order_relaxed);
+   std::atomic<bool> cancelled{ false };
+
+   const auto processJob = [&](size_t iJob) {
+      auto &job = jobs[iJob];
+      auto &wt = job.track;
+      auto &jobInstance = *job.pInstance;
+      auto jobSettings = settings;
+      std::vector<std::shared_ptr<EffectInstance>> recycledInstances{
+         job.pInstance
+      };
+
+      const auto nPasses = multichannel ? 1 : wt.NChannels();
+      const auto processPass = [&](WaveChannel &chan, size_t iPass) {
+         const int channel = multichannel ? -1 : static_cast<int>(iPass);
+         ChannelName map[3];
+         const auto numChannels = MakeChannelMap(wt, channel, map);
+         WaveChannel *pRight{};
+         if (multichannel && numChannels == 2)
+            // TODO: more-than-two-channels
+            pRight = (*wt.Channels().rbegin()).get();
+
+         const auto max = wt.GetMaxBlockSize() * 2;
+         const auto blockSize = jobInstance.SetBlockSize(max);
+         if (blockSize == 0)
+            return false;
+         const auto bufferSize =
+            ((max + (blockSize - 1)) / blockSize) * blockSize;
+         if (bufferSize == 0)
+            return false;
+         // New buffers are zeroed, as unused input buffers must be
+         Buffers inBuffers{ std::max(1u, numAudioIn), blockSize,
+            std::max<size_t>(1, bufferSize / blockSize) };
+         Buffers outBuffers{ numAudioOut, blockSize,
+            (bufferSize / blockSize) + 1 };
+
+         const auto pollUser = [&, iPass,
+            length = std::max(job.len.as_double(), 1.0)
+         ](sampleCount inPos){
+            fractions[iJob].store(
+               (iPass + (inPos - job.start).as_double() / length) / nPasses,
+               std::memory_order_relaxed);
+            return !cancelled.load(std::memory_order_relaxed);
+         };
+
+         WideSampleSequence *pSeq = &chan;
+         if (pRight)
+            pSeq = &wt;
+         WideSampleSource source{
+            *pSeq, size_t(pRight ? 2 : 1), job.start, job.len, pollUser };
+         WaveTrackSink sink{ chan, pRight, nullptr, job.start, true,
+            effectiveFormat };
+         const auto factory =
+         [this, &recycledInstances, counter = 0]() mutable {
+            auto index = counter++;
+            if (index < recycledInstances.size())
+               return recycledInstances[index];
+            else
+               return recycledInstances.emplace_back(MakeInstance());
+         };
+         if (!ProcessTrack(channel, factory, jobSettings, source, sink,
+            std::nullopt, wt.GetRate(), wt, inBuffers, outBuffers))
+            return false;
+         sink.Flush(outBuffers);
+         return sink.IsOk();
+      };
+
+      job.ok = true;
+      size_t iPass = 0;
+      for (const auto pChannel : wt.Channels()) {
+         if (iPass == nPasses || !(job.ok = processPass(*pChannel, iPass++)))
+            break;
+      }
+   };
+
+   // Weigh the progress of the tracks by their lengths
+   const auto totalLength = std::max(1.0, std::accumulate(
+      jobs.begin(), jobs.end(), 0.0, [](double sum, const Job &job) {
+         return sum + job.len.as_double(); }));
+   const auto finished = Parallel::ThreadPool::Get().ParallelFor(
+      jobs.size(), processJob, [&]{
+         auto done = 0.0;
+         for (size_t iJob = 0; iJob < jobs.size(); ++iJob)
+            done += jobs[iJob].len.as_double() *
+               fractions[iJob].load(std::memory_order_relaxed);
+         return !TotalProgress(done / totalLength);
+      }, cancelled);
+
+   return finished &&
+      std::all_of(jobs.begin(), jobs.end(),
+         [](const Job &job){ return job.ok; });
+}
+
 bool PerTrackEffect::ProcessTrack(int channel, const Factory &factory,
    EffectSettings &settings,
    AudioGraph::Source &upstream, AudioGraph::Sink &sink,
@@ -33,6 +33,10 @@ class SampleTrack;
    MakeInstance(), which must be a subclass of PerTrackEffect::Instance.
    Also uses GetLatency() to determine how many leading output samples to
    discard and how many extra samples to produce.
+
+   An effect of type EffectTypeProcess that overrides
+   CanProcessTracksConcurrently() has its selected tracks processed at once,
+   on the threads of the ThreadPool, each by its own instance.
  */
 class EFFECTS_API PerTrackEffect
    : public Effect
@@ -63,6 +67,16 @@ protected:
    /* virtual */ bool DoPass1() const;
    /* virtual */ bool DoPass2() const;
 
+   //! Whether instances may process different tracks on different threads
+   /*!
+    Then MakeInstance() may be called on any thread, and instances must keep
+    their state to themselves, use no user interface while processing, and
+    not read mSampleCnt, which is not set.  Each thread has a copy of the
+    settings.
+    Default implementation returns false.
+    */
+   virtual bool CanProcessTracksConcurrently() const;
+
    // non-virtual
    bool Process(EffectInstance &instance, EffectSettings &settings) const;
 
@@ -79,6 +93,9 @@ private:
 
    bool ProcessPass(TrackList &outputs,
       Instance &instance, EffectSettings &settings);
+   //! ProcessPass() for effects that CanProcessTracksConcurrently()
+   bool ProcessPassConcurrently(TrackList &outputs,
+      Instance &instance, EffectSettings &settings);
    using Factory = std::function<std::shared_ptr<EffectInstance>()>;
    /*!
     Previous contents of inBuffers and outBuffers are ignored
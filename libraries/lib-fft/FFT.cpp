@@ -48,7 +48,7 @@
 #include <stdlib.h>
 #include <math.h>
 
-#include "RealFFTf.h"
+#include "FFTEngine.h"
 
 using Floats = ArrayOf<float>;
 static ArraysOf<int> gFFTBitTable;
@@ -222,24 +222,21 @@ void FFT(size_t NumSamples,
 /*
  * Real Fast Fourier Transform
  *
- * This is merely a wrapper of RealFFTf() from RealFFTf.h.
+ * This is merely a wrapper of FFTEngine::Forward().
  */
 
 void RealFFT(size_t NumSamples, const float *RealIn, float *RealOut, float *ImagOut)
 {
-   auto hFFT = GetFFT(NumSamples);
+   auto &engine = FFTEngine::Get(NumSamples);
    Floats pFFT{ NumSamples };
-   // Copy the data into the processing buffer
-   for(size_t i = 0; i < NumSamples; i++)
-      pFFT[i] = RealIn[i];
 
    // Perform the FFT
-   RealFFTf(pFFT.get(), hFFT.get());
+   engine.Forward(RealIn, pFFT.get());
 
    // Copy the data into the real and imaginary outputs
    for (size_t i = 1; i<(NumSamples / 2); i++) {
-      RealOut[i]=pFFT[hFFT->BitReversed[i]  ];
-      ImagOut[i]=pFFT[hFFT->BitReversed[i]+1];
+      RealOut[i]=pFFT[2*i  ];
+      ImagOut[i]=pFFT[2*i+1];
    }
    // Handle the (real-only) DC and Fs/2 bins
    RealOut[0] = pFFT[0];
@@ -261,12 +258,12 @@ void RealFFT(size_t NumSamples, const float *RealIn, float *RealOut, float *Imag
  * Only the first half of RealIn and ImagIn are used due to this
  * symmetry assumption.
  *
- * This is merely a wrapper of InverseRealFFTf() from RealFFTf.h.
+ * This is merely a wrapper of FFTEngine::Inverse().
  */
 void InverseRealFFT(size_t NumSamples, const float *RealIn, const float *ImagIn,
 		    float *RealOut)
 {
-   auto hFFT = GetFFT(NumSamples);
+   auto &engine = FFTEngine::Get(NumSamples);
    Floats pFFT{ NumSamples };
    // Copy the data into the processing buffer
    for (size_t i = 0; i < (NumSamples / 2); i++)
@@ -282,42 +279,20 @@ void InverseRealFFT(size_t NumSamples, const float *RealIn, const float *ImagIn,
    pFFT[1] = RealIn[NumSamples / 2];
 
    // Perform the FFT
-   InverseRealFFTf(pFFT.get(), hFFT.get());
-
-   // Copy the data to the (purely real) output buffer
-   ReorderToTime(hFFT.get(), pFFT.get(), RealOut);
+   engine.Inverse(pFFT.get(), RealOut);
 }
 
 /*
  * PowerSpectrum
  *
- * This function uses RealFFTf() from RealFFTf.h to perform the real
- * FFT computation, and then squares the real and imaginary part of
- * each coefficient, extracting the power and throwing away the phase.
- *
- * For speed, it does not call RealFFT, but duplicates some
- * of its code.
+ * This function is merely a wrapper of FFTEngine::PowerSpectrum(), which
+ * squares the real and imaginary part of each coefficient, extracting the
+ * power and throwing away the phase.
  */
 
 void PowerSpectrum(size_t NumSamples, const float *In, float *Out)
 {
-   auto hFFT = GetFFT(NumSamples);
-   Floats pFFT{ NumSamples };
-   // Copy the data into the processing buffer
-   for (size_t i = 0; i<NumSamples; i++)
-      pFFT[i] = In[i];
-
-   // Perform the FFT
-   RealFFTf(pFFT.get(), hFFT.get());
-
-   // Copy the data into the real and imaginary outputs
-   for (size_t i = 1; i<NumSamples / 2; i++) {
-      Out[i]= (pFFT[hFFT->BitReversed[i]  ]*pFFT[hFFT->BitReversed[i]  ])
-         + (pFFT[hFFT->BitReversed[i]+1]*pFFT[hFFT->BitReversed[i]+1]);
-   }
-   // Handle the (real-only) DC and Fs/2 bins
-   Out[0] = pFFT[0]*pFFT[0];
-   Out[NumSamples / 2] = pFFT[1]*pFFT[1];
+   FFTEngine::Get(NumSamples).PowerSpectrum(In, Out);
 }
 
 /*
@@ -0,0 +1,147 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file FFTEngine.cpp
+
+**********************************************************************/
+#include "FFTEngine.h"
+#include "PowerSpectrumGetter.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <pffft.h>
+
+namespace {
+size_t Log2(size_t size)
+{
+   size_t result = 0;
+   while (size > 1)
+      size >>= 1, ++result;
+   return result;
+}
+
+//! Working storage of one thread, grown as needed and never shrunk
+struct Scratch
+{
+   PffftFloatVector data, work;
+};
+
+Scratch &GetScratch(size_t size)
+{
+   thread_local Scratch scratch;
+   if (scratch.data.size() < size) {
+      scratch.data.resize(size);
+      scratch.work.resize(size);
+   }
+   return scratch;
+}
+
+//! One engine for each power of two, made on demand and kept until exit
+struct Engines
+{
+   ~Engines()
+   {
+      for (auto &slot : slots)
+         delete slot.load(std::memory_order_relaxed);
+   }
+   std::array<std::atomic<const FFTEngine*>, 8 * sizeof(size_t)> slots{};
+};
+}
+
+void FFTEngine::SetupDeleter::operator ()(PFFFT_Setup *p) const
+{
+   if (p)
+      pffft_destroy_setup(p);
+}
+
+const FFTEngine &FFTEngine::Get(size_t size)
+{
+   assert(size >= 4 && (size & (size - 1)) == 0);
+   static Engines engines;
+   auto &slot = engines.slots[Log2(size)];
+   auto pEngine = slot.load(std::memory_order_acquire);
+   if (pEngine)
+      return *pEngine;
+
+   // Another thread might race to make the same engine; if it wins, use its
+   // engine and discard this one
+   const auto pNew = new FFTEngine{ size };
+   if (slot.compare_exchange_strong(pEngine, pNew,
+      std::memory_order_acq_rel, std::memory_order_acquire))
+      return *pNew;
+   delete pNew;
+   return *pEngine;
+}
+
+FFTEngine::FFTEngine(size_t size)
+   : mSize{ size }
+{
+   if (size % pffft_min_fft_size(PFFFT_REAL) == 0)
+      mSetup.reset(pffft_new_setup(static_cast<int>(size), PFFFT_REAL));
+   else
+      mParam = GetFFT(size);
+}
+
+FFTEngine::~FFTEngine() = default;
+
+const float *FFTEngine::ForwardToScratch(const float *in) const
+{
+   auto &scratch = GetScratch(mSize);
+   const auto data = scratch.data.data(), work = scratch.work.data();
+   std::copy(in, in + mSize, data);
+   if (mSetup) {
+      pffft_transform_ordered(mSetup.get(), data, data, work, PFFFT_FORWARD);
+      return data;
+   }
+
+   // Undo the bit reversal of RealFFTf
+   RealFFTf(data, mParam.get());
+   work[0] = data[0];
+   work[1] = data[1];
+   for (size_t ii = 1; ii < mParam->Points; ++ii) {
+      const auto index = mParam->BitReversed[ii];
+      work[2 * ii] = data[index];
+      work[2 * ii + 1] = data[index + 1];
+   }
+   return work;
+}
+
+void FFTEngine::Forward(const float *in, float *out) const
+{
+   const auto result = ForwardToScratch(in);
+   std::copy(result, result + mSize, out);
+}
+
+void FFTEngine::Inverse(const float *in, float *out) const
+{
+   auto &scratch = GetScratch(mSize);
+   const auto data = scratch.data.data(), work = scratch.work.data();
+   std::copy(in, in + mSize, data);
+   if (mSetup) {
+      pffft_transform_ordered(mSetup.get(), data, data, work, PFFFT_BACKWARD);
+      // pffft does not normalize
+      const auto scale = 1.0f / mSize;
+      std::transform(data, data + mSize, out,
+         [scale](float x){ return x * scale; });
+   }
+   else {
+      InverseRealFFTf(data, mParam.get());
+      ReorderToTime(mParam.get(), data, out);
+   }
+}
+
+void FFTEngine::PowerSpectrum(const float *in, float *out) const
+{
+   const auto spectrum = ForwardToScratch(in);
+   const auto half = mSize / 2;
+   out[0] = spectrum[0] * spectrum[0];
+   for (size_t ii = 1; ii < half; ++ii) {
+      const auto re = spectrum[2 * ii], im = spectrum[2 * ii + 1];
+      out[ii] = re * re + im * im;
+   }
+   out[half] = spectrum[1] * spectrum[1];
+}
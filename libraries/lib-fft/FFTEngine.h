@@ -0,0 +1,69 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file FFTEngine.h
+  @brief Real fast Fourier transforms of cached sizes, using SIMD
+
+**********************************************************************/
+#pragma once
+
+#include "RealFFTf.h"
+
+#include <cstddef>
+#include <memory>
+
+struct PFFFT_Setup;
+
+//! Real transforms of one power-of-two size
+/*!
+ Sizes that are multiples of 32 use pffft, whose butterflies use SSE on x86
+ and NEON on ARM.  Smaller sizes use the scalar RealFFTf.
+
+ Spectra are packed in place of the N real samples:
+ `{ Re X[0], Re X[N/2], Re X[1], Im X[1], ..., Re X[N/2-1], Im X[N/2-1] }`,
+ with X[k] the sum of x[n] * exp(-2 pi i n k / N).
+
+ All member functions are const and may be called concurrently.  Input and
+ output need no particular alignment, and may be the same.
+ */
+class FFT_API FFTEngine final
+{
+public:
+   //! The shared engine for the size, made at the first request
+   /*!
+    Found without locking after the first request.
+    @pre `size >= 4` and is a power of two
+    */
+   static const FFTEngine &Get(size_t size);
+
+   FFTEngine(const FFTEngine&) = delete;
+   FFTEngine &operator=(const FFTEngine&) = delete;
+   ~FFTEngine();
+
+   size_t Size() const { return mSize; }
+
+   //! Write the packed spectrum of Size() samples
+   void Forward(const float *in, float *out) const;
+
+   //! Inverse of Forward(), including division by Size()
+   void Inverse(const float *in, float *out) const;
+
+   //! Write Size() / 2 + 1 squared magnitudes, from DC to Nyquist frequency
+   void PowerSpectrum(const float *in, float *out) const;
+
+private:
+   explicit FFTEngine(size_t size);
+
+   //! @return the packed spectrum, in storage of the calling thread
+   const float *ForwardToScratch(const float *in) const;
+
+   struct SetupDeleter { void operator ()(PFFFT_Setup *p) const; };
+
+   const size_t mSize;
+   //! Non-null when pffft supports the size
+   std::unique_ptr<PFFFT_Setup, SetupDeleter> mSetup;
+   //! Non-null otherwise
+   HFFT mParam;
+};
@@ -9,6 +9,7 @@
 
 **********************************************************************/
 #include "PowerSpectrumGetter.h"
+#include "FFTEngine.h"
 
 #include <cassert>
 #include <pffft.h>
@@ -39,9 +40,7 @@ PffftConstFloats PffftFloatVector::aligned(PffftAlignedCount c) const
 }
 
 PowerSpectrumGetter::PowerSpectrumGetter(int fftSize)
-    : mFftSize { fftSize }
-    , mSetup { pffft_new_setup(fftSize, PFFFT_REAL) }
-    , mWork(fftSize)
+    : mEngine { FFTEngine::Get(fftSize) }
 {
 }
 
@@ -52,13 +51,5 @@ PowerSpectrumGetter::~PowerSpectrumGetter()
 void PowerSpectrumGetter::operator()(
    PffftFloats alignedBuffer, PffftFloats alignedOutput)
 {
-   const auto buffer = alignedBuffer.get();
-   const auto output = alignedOutput.get();
-   pffft_transform_ordered(mSetup.get(),
-      buffer, buffer, mWork.data(), PFFFT_FORWARD);
-   output[0] = buffer[0] * buffer[0];
-   for (auto i = 1; i < mFftSize / 2; ++i)
-      output[i] =
-         buffer[i * 2] * buffer[i * 2] + buffer[i * 2 + 1] * buffer[i * 2 + 1];
-   output[mFftSize / 2] = buffer[1] * buffer[1];
+   mEngine.PowerSpectrum(alignedBuffer.get(), alignedOutput.get());
 }
@@ -11,6 +11,7 @@
 #pragma once
 
 struct PFFFT_Setup;
+class FFTEngine;
 
 #include <memory>
 #include <type_traits>
@@ -221,7 +222,5 @@ public:
    void operator()(PffftFloats alignedBuffer, PffftFloats alignedOutput);
 
 private:
-   const int mFftSize;
-   PffftSetupHolder mSetup;
-   PffftFloatVector mWork;
+   const FFTEngine &mEngine;
 };
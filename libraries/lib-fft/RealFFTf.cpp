@@ -38,12 +38,12 @@
 
 #include "RealFFTf.h"
 
+#include <array>
+#include <atomic>
 #include <vector>
 #include <stdlib.h>
 #include <math.h>
 
-#include <wx/thread.h>
-
 #ifndef M_PI
 #define	M_PI		3.14159265358979323846  /* pi */
 #endif
@@ -93,50 +93,45 @@ HFFT InitializeFFT(size_t fftlen)
    return h;
 }
 
-enum : size_t { MAX_HFFT = 10 };
+namespace {
+// Maintain a pool, with one table for each power of two, so that lookup needs
+// no lock.  Pooled tables are kept until exit, and the pool has no destructor,
+// so that handles held by other static objects remain valid.
+std::array<std::atomic<FFTParam*>, 8 * sizeof(size_t)> hFFTPool{};
 
-// Maintain a pool:
-static std::vector< std::unique_ptr<FFTParam> > hFFTArray(MAX_HFFT);
-wxCriticalSection getFFTMutex;
+std::atomic<FFTParam*> &GetSlot(size_t fftlen)
+{
+   size_t log2 = 0;
+   while (fftlen > 1)
+      fftlen >>= 1, ++log2;
+   return hFFTPool[log2];
+}
+}
 
 /* Get a handle to the FFT tables of the desired length */
 /* This version keeps common tables rather than allocating a NEW table every time */
 HFFT GetFFT(size_t fftlen)
 {
-   // To do:  smarter policy about when to retain in the pool and when to
-   // allocate a unique instance.
-
-   wxCriticalSectionLocker locker{ getFFTMutex };
-   
-   size_t h = 0;
-   auto n = fftlen/2;
-   auto size = hFFTArray.size();
-   for(;
-       (h < size) && hFFTArray[h] && (n != hFFTArray[h]->Points);
-       h++)
-      ;
-   if(h < size) {
-      if(hFFTArray[h] == NULL) {
-         hFFTArray[h].reset( InitializeFFT(fftlen).release() );
-      }
-      return HFFT{ hFFTArray[h].get() };
-   } else {
-      // All buffers used, so fall back to allocating a NEW set of tables
-      return InitializeFFT(fftlen);
+   auto &slot = GetSlot(fftlen);
+   auto pParam = slot.load(std::memory_order_acquire);
+   if (!pParam) {
+      // Another thread might race to make the same tables; if it wins, use
+      // its tables and discard these
+      auto pNew = InitializeFFT(fftlen).release();
+      if (slot.compare_exchange_strong(pParam, pNew,
+         std::memory_order_acq_rel, std::memory_order_acquire))
+         pParam = pNew;
+      else
+         delete pNew;
    }
+   return HFFT{ pParam };
 }
 
 /* Release a previously requested handle to the FFT tables */
 void FFTDeleter::operator() (FFTParam *hFFT) const
 {
-   wxCriticalSectionLocker locker{ getFFTMutex };
-
-   auto it = hFFTArray.begin(), end = hFFTArray.end();
-   while (it != end && it->get() != hFFT)
-      ++it;
-   if ( it != end )
-      ;
-   else
+   // Pooled tables are never deleted
+   if (hFFT && GetSlot(2 * hFFT->Points).load(std::memory_order_acquire) != hFFT)
       delete hFFT;
 }
 
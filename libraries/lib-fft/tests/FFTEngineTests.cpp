@@ -0,0 +1,165 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  FFTEngineTests.cpp
+
+**********************************************************************/
+#include "FFTEngine.h"
+
+#include <catch2/catch.hpp>
+
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+std::vector<float> RandomValues(size_t len, unsigned seed)
+{
+   std::mt19937 engine { seed };
+   std::uniform_real_distribution<float> distribution { -1, 1 };
+   std::vector<float> values(len);
+   for (auto &value : values)
+      value = distribution(engine);
+   return values;
+}
+
+//! The packed spectrum, computed as before FFTEngine
+std::vector<float> ReferenceSpectrum(const std::vector<float> &in)
+{
+   const auto size = in.size();
+   auto hFFT = GetFFT(size);
+   auto buffer = in;
+   RealFFTf(buffer.data(), hFFT.get());
+   std::vector<float> result(size);
+   result[0] = buffer[0];
+   result[1] = buffer[1];
+   for (size_t ii = 1; ii < hFFT->Points; ++ii) {
+      result[2 * ii] = buffer[hFFT->BitReversed[ii]];
+      result[2 * ii + 1] = buffer[hFFT->BitReversed[ii] + 1];
+   }
+   return result;
+}
+
+// Sizes using RealFFTf, and using pffft
+const auto Sizes = { 4, 8, 16, 32, 256, 4096 };
+}
+
+TEST_CASE("FFTEngine")
+{
+   SECTION("Engines are shared")
+   {
+      for (const size_t size : Sizes) {
+         auto &engine = FFTEngine::Get(size);
+         REQUIRE(engine.Size() == size);
+         REQUIRE(&FFTEngine::Get(size) == &engine);
+      }
+   }
+
+   SECTION("Concurrent requests get the same engine")
+   {
+      constexpr size_t size = 1 << 16, nThreads = 4;
+      const FFTEngine *engines[nThreads]{};
+      std::vector<std::thread> threads;
+      for (size_t ii = 0; ii < nThreads; ++ii)
+         threads.emplace_back([&engines, ii]{
+            engines[ii] = &FFTEngine::Get(size); });
+      for (auto &thread : threads)
+         thread.join();
+      for (auto pEngine : engines)
+         REQUIRE(pEngine == engines[0]);
+   }
+
+   SECTION("Forward agrees with RealFFTf")
+   {
+      for (const size_t size : Sizes) {
+         const auto in = RandomValues(size, size);
+         const auto expected = ReferenceSpectrum(in);
+         std::vector<float> actual(size);
+         FFTEngine::Get(size).Forward(in.data(), actual.data());
+         const auto tolerance = 1e-6f * size;
+         for (size_t ii = 0; ii < size; ++ii)
+            REQUIRE(actual[ii] == Approx(expected[ii]).margin(tolerance));
+      }
+   }
+
+   SECTION("Inverse undoes Forward, in place")
+   {
+      for (const size_t size : Sizes) {
+         const auto in = RandomValues(size, size);
+         auto buffer = in;
+         auto &engine = FFTEngine::Get(size);
+         engine.Forward(buffer.data(), buffer.data());
+         engine.Inverse(buffer.data(), buffer.data());
+         for (size_t ii = 0; ii < size; ++ii)
+            REQUIRE(buffer[ii] == Approx(in[ii]).margin(1e-5));
+      }
+   }
+
+   SECTION("PowerSpectrum squares the magnitudes")
+   {
+      for (const size_t size : Sizes) {
+         const auto in = RandomValues(size, size);
+         const auto spectrum = ReferenceSpectrum(in);
+         std::vector<float> power(size / 2 + 1);
+         FFTEngine::Get(size).PowerSpectrum(in.data(), power.data());
+         const auto tolerance = 1e-5f * size * size;
+         REQUIRE(power[0] ==
+            Approx(spectrum[0] * spectrum[0]).margin(tolerance));
+         REQUIRE(power[size / 2] ==
+            Approx(spectrum[1] * spectrum[1]).margin(tolerance));
+         for (size_t ii = 1; ii < size / 2; ++ii) {
+            const auto re = spectrum[2 * ii], im = spectrum[2 * ii + 1];
+            REQUIRE(power[ii] == Approx(re * re + im * im).margin(tolerance));
+         }
+      }
+   }
+}
+
+TEST_CASE("FFTEngine benchmark", "[.][benchmark]")
+{
+   // The default spectrogram window
+   constexpr size_t size = 2048;
+   const auto in = RandomValues(size, 1);
+   std::vector<float> buffer(size), out(size / 2 + 1);
+
+   BENCHMARK("RealFFTf power spectrum")
+   {
+      // As PowerSpectrum() did before FFTEngine
+      auto hFFT = GetFFT(size);
+      std::copy(in.begin(), in.end(), buffer.begin());
+      RealFFTf(buffer.data(), hFFT.get());
+      for (size_t ii = 1; ii < size / 2; ++ii) {
+         const auto index = hFFT->BitReversed[ii];
+         out[ii] = buffer[index] * buffer[index] +
+            buffer[index + 1] * buffer[index + 1];
+      }
+      out[0] = buffer[0] * buffer[0];
+      out[size / 2] = buffer[1] * buffer[1];
+      return out[1];
+   };
+
+   BENCHMARK("FFTEngine power spectrum")
+   {
+      FFTEngine::Get(size).PowerSpectrum(in.data(), out.data());
+      return out[1];
+   };
+
+   BENCHMARK("RealFFTf round trip")
+   {
+      auto hFFT = GetFFT(size);
+      std::copy(in.begin(), in.end(), buffer.begin());
+      RealFFTf(buffer.data(), hFFT.get());
+      InverseRealFFTf(buffer.data(), hFFT.get());
+      return buffer[0];
+   };
+
+   BENCHMARK("FFTEngine round trip")
+   {
+      auto &engine = FFTEngine::Get(size);
+      engine.Forward(in.data(), buffer.data());
+      engine.Inverse(buffer.data(), buffer.data());
+      return buffer[0];
+   };
+}
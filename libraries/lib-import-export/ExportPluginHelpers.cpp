@@ -42,7 +42,9 @@ std::unique_ptr<Mixer> ExportPluginHelpers::CreateMixer(const TrackList &tracks,
                   numOutChannels, outBufferSize, outInterleaved,
                   outRate, outFormat,
                   true, mixerSpec,
-                  mixerSpec ? Mixer::ApplyGain::MapChannels : Mixer::ApplyGain::Mixdown);
+                  mixerSpec ? Mixer::ApplyGain::MapChannels : Mixer::ApplyGain::Mixdown,
+                  // Tracks may be fetched and resampled concurrently
+                  MixerOptions::Threading{ 0 });
 }
 
 namespace
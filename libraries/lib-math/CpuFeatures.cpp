@@ -0,0 +1,47 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file CpuFeatures.cpp
+
+**********************************************************************/
+#include "CpuFeatures.h"
+
+#if defined(AUDACITY_X86_SIMD) && defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+namespace {
+bool DetectAVX2()
+{
+#if !defined(AUDACITY_X86_SIMD)
+   return false;
+#elif defined(_MSC_VER)
+   int info[4];
+   __cpuid(info, 0);
+   if (info[0] < 7)
+      return false;
+   __cpuid(info, 1);
+   // OSXSAVE and AVX
+   constexpr int osxsave = 1 << 27, avx = 1 << 28;
+   if ((info[2] & (osxsave | avx)) != (osxsave | avx))
+      return false;
+   // The operating system saves the YMM registers
+   if ((_xgetbv(0) & 6) != 6)
+      return false;
+   __cpuidex(info, 7, 0);
+   return (info[1] & (1 << 5)) != 0;
+#else
+   __builtin_cpu_init();
+   return __builtin_cpu_supports("avx2");
+#endif
+}
+}
+
+bool CpuFeatures::HasAVX2()
+{
+   static const bool result = DetectAVX2();
+   return result;
+}
@@ -0,0 +1,32 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file CpuFeatures.h
+  @brief Run-time detection of instruction set extensions
+
+**********************************************************************/
+#pragma once
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(_M_AMD64) || \
+   ((defined(__i386__) || defined(_M_IX86)) && \
+      (defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)))
+//! Defined when SSE2 may be assumed at compile time and AVX2 may be
+//! detected at run time
+#define AUDACITY_X86_SIMD 1
+#endif
+
+#if defined(AUDACITY_X86_SIMD) && (defined(__GNUC__) || defined(__clang__))
+//! Lets one function use AVX2 when the rest of the file is compiled without
+#define AUDACITY_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define AUDACITY_TARGET_AVX2
+#endif
+
+namespace CpuFeatures
+{
+//! Whether the processor and the operating system support AVX2
+/*! Computed once; cheap to call repeatedly */
+MATH_API bool HasAVX2();
+}
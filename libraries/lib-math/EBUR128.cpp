@@ -9,7 +9,91 @@ Max Maisel
 ***********************************************************************/
 
 #include "EBUR128.h"
+#include "CpuFeatures.h"
+#include <algorithm>
 #include <cstring>
+#include <vector>
+
+#if defined(AUDACITY_X86_SIMD)
+#include <emmintrin.h>
+#endif
+
+namespace {
+#if defined(AUDACITY_X86_SIMD)
+/// The state of one filter of two channels, lane 0 for the first
+struct BiquadPair
+{
+   BiquadPair(const Biquad &first, const Biquad &second)
+      : b0{ _mm_set_pd(second.fNumerCoeffs[Biquad::B0],
+                       first.fNumerCoeffs[Biquad::B0]) }
+      , b1{ _mm_set_pd(second.fNumerCoeffs[Biquad::B1],
+                       first.fNumerCoeffs[Biquad::B1]) }
+      , b2{ _mm_set_pd(second.fNumerCoeffs[Biquad::B2],
+                       first.fNumerCoeffs[Biquad::B2]) }
+      , a1{ _mm_set_pd(second.fDenomCoeffs[Biquad::A1],
+                       first.fDenomCoeffs[Biquad::A1]) }
+      , a2{ _mm_set_pd(second.fDenomCoeffs[Biquad::A2],
+                       first.fDenomCoeffs[Biquad::A2]) }
+      , prevIn{ _mm_set_pd(second.fPrevIn, first.fPrevIn) }
+      , prevPrevIn{ _mm_set_pd(second.fPrevPrevIn, first.fPrevPrevIn) }
+      , prevOut{ _mm_set_pd(second.fPrevOut, first.fPrevOut) }
+      , prevPrevOut{ _mm_set_pd(second.fPrevPrevOut, first.fPrevPrevOut) }
+   {
+   }
+
+   /// The same operations as Biquad::ProcessOne, in the same order, including
+   /// the rounding of the result to float
+   __m128d ProcessOne(__m128d in)
+   {
+      auto out = _mm_add_pd(_mm_mul_pd(in, b0), _mm_mul_pd(prevIn, b1));
+      out = _mm_add_pd(out, _mm_mul_pd(prevPrevIn, b2));
+      out = _mm_sub_pd(out, _mm_mul_pd(prevOut, a1));
+      out = _mm_sub_pd(out, _mm_mul_pd(prevPrevOut, a2));
+      prevPrevIn = prevIn;
+      prevIn = in;
+      prevPrevOut = prevOut;
+      prevOut = out;
+      return _mm_cvtps_pd(_mm_cvtpd_ps(out));
+   }
+
+   void Store(Biquad &first, Biquad &second) const
+   {
+      _mm_storel_pd(&first.fPrevIn, prevIn);
+      _mm_storeh_pd(&second.fPrevIn, prevIn);
+      _mm_storel_pd(&first.fPrevPrevIn, prevPrevIn);
+      _mm_storeh_pd(&second.fPrevPrevIn, prevPrevIn);
+      _mm_storel_pd(&first.fPrevOut, prevOut);
+      _mm_storeh_pd(&second.fPrevOut, prevOut);
+      _mm_storel_pd(&first.fPrevPrevOut, prevPrevOut);
+      _mm_storeh_pd(&second.fPrevPrevOut, prevPrevOut);
+   }
+
+   const __m128d b0, b1, b2, a1, a2;
+   __m128d prevIn, prevPrevIn, prevOut, prevPrevOut;
+};
+
+/// Weight two channels and add their powers to out, or assign them to it if
+/// assign is true, in the order of the channels
+void FilterAndSquarePair(ArrayOf<Biquad> &first, ArrayOf<Biquad> &second,
+   const float *in0, const float *in1, double *out, size_t len, bool assign)
+{
+   BiquadPair hsf{ first[0], second[0] };
+   BiquadPair hpf{ first[1], second[1] };
+   for (size_t i = 0; i < len; ++i)
+   {
+      const auto value = hpf.ProcessOne(hsf.ProcessOne(
+         _mm_set_pd(in1[i], in0[i])));
+      const auto power = _mm_mul_pd(value, value);
+      auto sum = assign ? _mm_setzero_pd() : _mm_load_sd(out + i);
+      sum = _mm_add_sd(sum, power);
+      sum = _mm_add_sd(sum, _mm_unpackhi_pd(power, power));
+      _mm_store_sd(out + i, sum);
+   }
+   hsf.Store(first[0], second[0]);
+   hpf.Store(first[1], second[1]);
+}
+#endif
+}
 
 EBUR128::EBUR128(double rate, size_t channels)
    : mChannelCount{ channels }
@@ -19,6 +103,7 @@ EBUR128::EBUR128(double rate, size_t channels)
 {
    mLoudnessHist.reinit(HIST_BIN_COUNT, false);
    mBlockRingBuffer.reinit(mBlockSize);
+   mSegmentSums.reinit((mBlockSize + mBlockOverlap - 1) / mBlockOverlap, true);
    mWeightingFilter.reinit(mChannelCount, false);
    for(size_t channel = 0; channel < mChannelCount; ++channel)
       mWeightingFilter[channel] = CalcWeightingFilter(mRate);
@@ -97,8 +182,73 @@ void EBUR128::ProcessSampleFromChannel(float x_in, size_t channel) const
 
 void EBUR128::NextSample()
 {
-   ++mBlockRingPos;
-   ++mBlockRingSize;
+   Advance(1);
+}
+
+void EBUR128::ProcessSamples(const float *const *buffers, size_t len)
+{
+   std::vector<const float *> offsetBuffers(mChannelCount);
+   size_t done = 0;
+   while (done < len)
+   {
+      // Stop at the end of the segment, where a block may be complete.
+      const auto segmentEnd = std::min(
+         (mBlockRingPos / mBlockOverlap + 1) * mBlockOverlap, mBlockSize);
+      const auto count = std::min(len - done, segmentEnd - mBlockRingPos);
+      for (size_t channel = 0; channel < mChannelCount; ++channel)
+         offsetBuffers[channel] = buffers[channel] + done;
+      FilterAndSquare(offsetBuffers.data(), count);
+      Advance(count);
+      done += count;
+   }
+}
+
+/// Weight len samples of each channel, and store their summed powers into
+/// the ring from mBlockRingPos on.
+void EBUR128::FilterAndSquare(const float *const *buffers, size_t len)
+{
+   const auto out = &mBlockRingBuffer[mBlockRingPos];
+   size_t channel = 0;
+#if defined(AUDACITY_X86_SIMD)
+   for (; channel + 1 < mChannelCount; channel += 2)
+      FilterAndSquarePair(mWeightingFilter[channel],
+         mWeightingFilter[channel + 1], buffers[channel],
+         buffers[channel + 1], out, len, channel == 0);
+#endif
+   for (; channel < mChannelCount; ++channel)
+   {
+      auto &hsf = mWeightingFilter[channel][0];
+      auto &hpf = mWeightingFilter[channel][1];
+      const auto in = buffers[channel];
+      for (size_t i = 0; i < len; ++i)
+      {
+         const double value = hpf.ProcessOne(hsf.ProcessOne(in[i]));
+         if (channel == 0)
+            out[i] = value * value;
+         else
+            out[i] += value * value;
+      }
+   }
+}
+
+/// Move on by len samples, which must not pass the end of a segment.
+void EBUR128::Advance(size_t len)
+{
+   mBlockRingPos += len;
+   mBlockRingSize += len;
+   mSampleCount += len;
+
+   const auto segmentEnd =
+      mBlockRingPos % mBlockOverlap == 0 || mBlockRingPos == mBlockSize;
+   if (segmentEnd)
+   {
+      // Sum the segment once, rather than once for each block it is in.
+      const auto segment = (mBlockRingPos - 1) / mBlockOverlap;
+      double sum = 0;
+      for (size_t i = segment * mBlockOverlap; i < mBlockRingPos; ++i)
+         sum += mBlockRingBuffer[i];
+      mSegmentSums[segment] = sum;
+   }
 
    if(mBlockRingPos % mBlockOverlap == 0)
    {
@@ -109,7 +259,6 @@ void EBUR128::NextSample()
    // Close the ring.
    if(mBlockRingPos == mBlockSize)
       mBlockRingPos = 0;
-   ++mSampleCount;
 }
 
 double EBUR128::IntegrativeLoudness()
@@ -173,8 +322,17 @@ void EBUR128::AddBlockToHistogram(size_t validLen)
 
    size_t idx;
    double blockVal = 0;
-   for(size_t i = 0; i < validLen; ++i)
-      blockVal += mBlockRingBuffer[i];
+   if(validLen >= mBlockSize)
+   {
+      // The ring is full, and all its segments are summed.
+      validLen = mBlockSize;
+      const auto segmentCount = (mBlockSize + mBlockOverlap - 1) / mBlockOverlap;
+      for(size_t i = 0; i < segmentCount; ++i)
+         blockVal += mSegmentSums[i];
+   }
+   else
+      for(size_t i = 0; i < validLen; ++i)
+         blockVal += mBlockRingBuffer[i];
 
    // Histogram values are simplified log10() immediate values
    // without -0.691 + 10*(...) to safe computing power. This is
@@ -18,7 +18,7 @@ Max Maisel
 #include <cmath>
 
 /// \brief Implements EBU-R128 loudness measurement.
-class EBUR128
+class MATH_API EBUR128
 {
 public:
    EBUR128(double rate, size_t channels);
@@ -29,6 +29,10 @@ public:
    static ArrayOf<Biquad> CalcWeightingFilter(double fs);
    void ProcessSampleFromChannel(float x_in, size_t channel) const;
    void NextSample();
+   /// Process len samples of each channel, as ProcessSampleFromChannel()
+   /// for each channel and NextSample() would for each sample, but filtering
+   /// two channels at once where the processor allows.
+   void ProcessSamples(const float *const *buffers, size_t len);
    double IntegrativeLoudness();
    inline double IntegrativeLoudnessToLUFS(double loudness)
       { return 10 * log10(loudness); }
@@ -36,12 +40,17 @@ public:
 private:
    void HistogramSums(size_t start_idx, double& sum_v, long int& sum_c) const;
    void AddBlockToHistogram(size_t validLen);
+   void FilterAndSquare(const float *const *buffers, size_t len);
+   void Advance(size_t len);
 
    static constexpr size_t HIST_BIN_COUNT = 65536;
    /// EBU R128 absolute threshold
    static constexpr double GAMMA_A = (-70.0 + 0.691) / 10.0;
    ArrayOf<long int> mLoudnessHist;
    Doubles mBlockRingBuffer;
+   /// Sums of mBlockRingBuffer over each mBlockOverlap long segment, the
+   /// last one possibly shorter, so that each block sums these only.
+   Doubles mSegmentSums;
    size_t mSampleCount{ 0 };
    size_t mBlockRingPos{ 0 };
    size_t mBlockRingSize{ 0 };
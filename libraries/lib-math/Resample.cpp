@@ -30,20 +30,34 @@
 #include <soxr.h>
 
 Resample::Resample(const bool useBestMethod, const double dMinFactor, const double dMaxFactor)
+   : mMinFactor{ dMinFactor }
+   , mMaxFactor{ dMaxFactor }
 {
    this->SetMethod(useBestMethod);
+   mbWantConstRateResampling = (dMinFactor == dMaxFactor);
+   MakeHandle();
+}
+
+void Resample::MakeHandle()
+{
    soxr_quality_spec_t q_spec;
-   if (dMinFactor == dMaxFactor)
-   {
-      mbWantConstRateResampling = true; // constant rate resampling
+   if (mbWantConstRateResampling)
+      // constant rate resampling
       q_spec = soxr_quality_spec("\0\1\4\6"[mMethod], 0);
-   }
    else
-   {
-      mbWantConstRateResampling = false; // variable rate resampling
+      // variable rate resampling
       q_spec = soxr_quality_spec(SOXR_HQ, SOXR_VR);
-   }
-   mHandle.reset(soxr_create(1, dMinFactor, 1, 0, 0, &q_spec, 0));
+   mHandle.reset(soxr_create(1, mMinFactor, 1, 0, 0, &q_spec, 0));
+   mFresh = true;
+}
+
+void Resample::Reset()
+{
+   // soxr_clear() would not be cheaper, as it designs the filters again too.
+   // Making a new handle also avoids the trouble of bug 2025 with reuse of
+   // flushed constant rate resamplers.
+   if (!mFresh)
+      MakeHandle();
 }
 
 Resample::~Resample()
@@ -93,6 +107,7 @@ std::pair<size_t, size_t>
                         size_t       outBufferLen)
 {
    size_t idone, odone;
+   mFresh = false;
    if (mbWantConstRateResampling)
    {
       soxr_process(mHandle.get(),
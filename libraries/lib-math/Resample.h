@@ -39,6 +39,17 @@ class MATH_API Resample final
    Resample(const bool useBestMethod, const double dMinFactor, const double dMaxFactor);
    ~Resample();
 
+   //! Which of the methods named by the settings is used
+   int GetMethod() const { return mMethod; }
+   double GetMinFactor() const { return mMinFactor; }
+   double GetMaxFactor() const { return mMaxFactor; }
+
+   //! Whether Process() has not been called since construction or Reset()
+   bool IsFresh() const { return mFresh; }
+   //! Forget all input, to begin a new stream with the same parameters
+   /*! As costly as construction, unless IsFresh() */
+   void Reset();
+
    static EnumSetting< int > FastMethodSetting;
    static EnumSetting< int > BestMethodSetting;
 
@@ -74,11 +85,14 @@ class MATH_API Resample final
 
  protected:
    void SetMethod(const bool useBestMethod);
+   void MakeHandle();
 
  protected:
    int   mMethod; // resampler-specific enum for resampling method
+   const double mMinFactor, mMaxFactor;
    soxrHandle mHandle; // constant-rate or variable-rate resampler (XOR per instance)
    bool mbWantConstRateResampling;
+   bool mFresh{ true };
 };
 
 #endif // __AUDACITY_RESAMPLE_H__
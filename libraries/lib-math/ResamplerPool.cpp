@@ -0,0 +1,151 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file ResamplerPool.cpp
+
+**********************************************************************/
+#include "ResamplerPool.h"
+#include "Prefs.h"
+#include "Resample.h"
+
+#include <algorithm>
+
+namespace {
+bool Matches(const Resample &resample,
+   int method, double minFactor, double maxFactor)
+{
+   return resample.GetMethod() == method &&
+      resample.GetMinFactor() == minFactor &&
+      resample.GetMaxFactor() == maxFactor;
+}
+
+//! Remove and return the first resampler in the queue with the given
+//! parameters, or null
+std::unique_ptr<Resample> Take(std::deque<std::unique_ptr<Resample>> &queue,
+   int method, double minFactor, double maxFactor)
+{
+   const auto end = queue.end(),
+      iter = std::find_if(queue.begin(), end, [&](const auto &pResample){
+         return Matches(*pResample, method, minFactor, maxFactor);
+      });
+   if (iter == end)
+      return nullptr;
+   auto result = move(*iter);
+   queue.erase(iter);
+   return result;
+}
+}
+
+ResamplerPool &ResamplerPool::Get()
+{
+   // Enough for a few previews of many tracks
+   static ResamplerPool instance{ 64 };
+   return instance;
+}
+
+ResamplerPool::ResamplerPool(size_t capacity)
+   : mCapacity{ capacity }
+{
+}
+
+ResamplerPool::~ResamplerPool()
+{
+   {
+      std::lock_guard<std::mutex> lock{ mMutex };
+      mStop = true;
+   }
+   mCondition.notify_one();
+   if (mCleaner.joinable())
+      mCleaner.join();
+}
+
+std::unique_ptr<Resample> ResamplerPool::Acquire(
+   bool useBestMethod, double minFactor, double maxFactor)
+{
+   const auto method = useBestMethod
+      ? Resample::BestMethodSetting.ReadEnum()
+      : Resample::FastMethodSetting.ReadEnum();
+   std::unique_ptr<Resample> result;
+   {
+      std::unique_lock<std::mutex> lock{ mMutex };
+      result = Take(mClean, method, minFactor, maxFactor);
+      if (!result) {
+         // Waiting for the cleaner, or resetting here, costs no more than
+         // construction
+         mCleaned.wait(lock, [&]{
+            return !(mpCleaning &&
+               Matches(*mpCleaning, method, minFactor, maxFactor)); });
+         result = Take(mClean, method, minFactor, maxFactor);
+         if (!result)
+            result = Take(mDirty, method, minFactor, maxFactor);
+      }
+      if (result)
+         ++mStatistics.reused;
+      else
+         ++mStatistics.created;
+   }
+   if (result)
+      result->Reset();
+   else
+      result = std::make_unique<Resample>(useBestMethod, minFactor, maxFactor);
+   return result;
+}
+
+void ResamplerPool::Release(std::unique_ptr<Resample> pResample)
+{
+   if (!pResample)
+      return;
+   // Destroy any evicted resampler after unlocking
+   std::unique_ptr<Resample> pEvicted;
+   std::lock_guard<std::mutex> lock{ mMutex };
+   if (mClean.size() + mDirty.size() >= mCapacity) {
+      auto &queue = mClean.empty() ? mDirty : mClean;
+      if (queue.empty())
+         // Capacity is zero
+         return;
+      pEvicted = move(queue.front());
+      queue.pop_front();
+   }
+   if (pResample->IsFresh())
+      mClean.push_back(move(pResample));
+   else {
+      mDirty.push_back(move(pResample));
+      if (!mCleaner.joinable())
+         mCleaner = std::thread{ [this]{ CleanerLoop(); } };
+      mCondition.notify_one();
+   }
+}
+
+auto ResamplerPool::GetStatistics() const -> Statistics
+{
+   std::lock_guard<std::mutex> lock{ mMutex };
+   return mStatistics;
+}
+
+void ResamplerPool::CleanerLoop()
+{
+   std::unique_lock<std::mutex> lock{ mMutex };
+   while (true) {
+      mCondition.wait(lock, [this]{ return mStop || !mDirty.empty(); });
+      if (mStop)
+         return;
+      auto pResample = move(mDirty.front());
+      mDirty.pop_front();
+      mpCleaning = pResample.get();
+      lock.unlock();
+      pResample->Reset();
+      lock.lock();
+      mpCleaning = nullptr;
+      if (mClean.size() + mDirty.size() < mCapacity)
+         mClean.push_back(move(pResample));
+      mCleaned.notify_all();
+      if (pResample) {
+         // Evicted while unlocked
+         lock.unlock();
+         pResample.reset();
+         lock.lock();
+      }
+   }
+}
@@ -0,0 +1,77 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file ResamplerPool.h
+  @brief Recycles Resample objects, which are costly to construct
+
+**********************************************************************/
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+class Resample;
+
+//! Keeps resamplers given back by their users, to hand out again for the
+//! same method and range of factors
+/*!
+ Construction of a Resample designs its filters, which takes long enough to
+ be noticed when a Mixer is made for each preview of an effect.
+
+ A resampler that has processed samples must be reset before reuse, which is
+ as costly as construction; a background thread does that soon after it is
+ given back.
+ */
+class MATH_API ResamplerPool final
+{
+public:
+   //! The pool shared by the application
+   static ResamplerPool &Get();
+
+   //! @param capacity most resamplers kept
+   explicit ResamplerPool(size_t capacity);
+   ResamplerPool(const ResamplerPool&) = delete;
+   ResamplerPool &operator=(const ResamplerPool&) = delete;
+   ~ResamplerPool();
+
+   //! A resampler as if newly constructed with the same arguments
+   std::unique_ptr<Resample> Acquire(
+      bool useBestMethod, double minFactor, double maxFactor);
+
+   //! Give back a resampler for later reuse; null is allowed
+   void Release(std::unique_ptr<Resample> pResample);
+
+   struct Statistics {
+      //! How many resamplers Acquire() constructed
+      size_t created{};
+      //! How many resamplers Acquire() recycled
+      size_t reused{};
+   };
+   Statistics GetStatistics() const;
+
+private:
+   void CleanerLoop();
+
+   const size_t mCapacity;
+
+   mutable std::mutex mMutex;
+   std::condition_variable mCondition;
+   //! Resamplers ready for reuse, oldest first
+   std::deque<std::unique_ptr<Resample>> mClean;
+   //! Resamplers needing Reset(), oldest first
+   std::deque<std::unique_ptr<Resample>> mDirty;
+   //! Resampler being reset by the cleaner, out of both queues
+   const Resample *mpCleaning{};
+   //! Notified when the cleaner finishes with mpCleaning
+   std::condition_variable mCleaned;
+   Statistics mStatistics;
+   bool mStop{ false };
+   //! Started when first needed
+   std::thread mCleaner;
+};
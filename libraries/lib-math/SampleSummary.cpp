@@ -0,0 +1,146 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file SampleSummary.cpp
+
+**********************************************************************/
+#include "SampleSummary.h"
+#include "CpuFeatures.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(AUDACITY_X86_SIMD)
+#include <immintrin.h>
+#endif
+
+MinMaxSumSquares SampleSummary::ComputeScalar(const float *samples, size_t len)
+{
+   MinMaxSumSquares result;
+   for (size_t i = 0; i < len; ++i) {
+      const auto sample = samples[i];
+      result.min = std::min(result.min, sample);
+      result.max = std::max(result.max, sample);
+      result.sumSquares += sample * sample;
+   }
+   return result;
+}
+
+namespace {
+//! Finish with the samples left over after the vector loop
+void AccumulateTail(
+   MinMaxSumSquares &result, const float *samples, size_t len)
+{
+   const auto tail = SampleSummary::ComputeScalar(samples, len);
+   result.min = std::min(result.min, tail.min);
+   result.max = std::max(result.max, tail.max);
+   result.sumSquares += tail.sumSquares;
+}
+
+#if defined(AUDACITY_X86_SIMD)
+MinMaxSumSquares ComputeSSE2(const float *samples, size_t len)
+{
+   auto vMin = _mm_set1_ps(FLT_MAX);
+   auto vMax = _mm_set1_ps(-FLT_MAX);
+   // Two accumulators hide the latency of the additions
+   auto vSum0 = _mm_setzero_ps();
+   auto vSum1 = _mm_setzero_ps();
+
+   size_t i = 0;
+   for (; i + 8 <= len; i += 8) {
+      const auto x0 = _mm_loadu_ps(samples + i);
+      const auto x1 = _mm_loadu_ps(samples + i + 4);
+      vMin = _mm_min_ps(vMin, _mm_min_ps(x0, x1));
+      vMax = _mm_max_ps(vMax, _mm_max_ps(x0, x1));
+      vSum0 = _mm_add_ps(vSum0, _mm_mul_ps(x0, x0));
+      vSum1 = _mm_add_ps(vSum1, _mm_mul_ps(x1, x1));
+   }
+
+   alignas(16) float mins[4], maxes[4], sums[4];
+   _mm_store_ps(mins, vMin);
+   _mm_store_ps(maxes, vMax);
+   _mm_store_ps(sums, _mm_add_ps(vSum0, vSum1));
+
+   MinMaxSumSquares result{
+      std::min(std::min(mins[0], mins[1]), std::min(mins[2], mins[3])),
+      std::max(std::max(maxes[0], maxes[1]), std::max(maxes[2], maxes[3])),
+      (sums[0] + sums[1]) + (sums[2] + sums[3])
+   };
+   AccumulateTail(result, samples + i, len - i);
+   return result;
+}
+
+AUDACITY_TARGET_AVX2
+MinMaxSumSquares ComputeAVX2(const float *samples, size_t len)
+{
+   auto vMin = _mm256_set1_ps(FLT_MAX);
+   auto vMax = _mm256_set1_ps(-FLT_MAX);
+   auto vSum0 = _mm256_setzero_ps();
+   auto vSum1 = _mm256_setzero_ps();
+
+   size_t i = 0;
+   for (; i + 16 <= len; i += 16) {
+      const auto x0 = _mm256_loadu_ps(samples + i);
+      const auto x1 = _mm256_loadu_ps(samples + i + 8);
+      vMin = _mm256_min_ps(vMin, _mm256_min_ps(x0, x1));
+      vMax = _mm256_max_ps(vMax, _mm256_max_ps(x0, x1));
+      vSum0 = _mm256_add_ps(vSum0, _mm256_mul_ps(x0, x0));
+      vSum1 = _mm256_add_ps(vSum1, _mm256_mul_ps(x1, x1));
+   }
+
+   alignas(32) float mins[8], maxes[8], sums[8];
+   _mm256_store_ps(mins, vMin);
+   _mm256_store_ps(maxes, vMax);
+   _mm256_store_ps(sums, _mm256_add_ps(vSum0, vSum1));
+   // Avoid the penalty for mixing AVX with the SSE code of the callers
+   _mm256_zeroupper();
+
+   MinMaxSumSquares result;
+   float sumSquares = 0;
+   for (int j = 0; j < 8; ++j) {
+      result.min = std::min(result.min, mins[j]);
+      result.max = std::max(result.max, maxes[j]);
+      sumSquares += sums[j];
+   }
+   result.sumSquares = sumSquares;
+   AccumulateTail(result, samples + i, len - i);
+   return result;
+}
+#endif
+
+using Kernel = MinMaxSumSquares (*)(const float *, size_t);
+
+Kernel ChooseKernel()
+{
+#if defined(AUDACITY_X86_SIMD)
+   if (CpuFeatures::HasAVX2())
+      return ComputeAVX2;
+   return ComputeSSE2;
+#else
+   return SampleSummary::ComputeScalar;
+#endif
+}
+}
+
+MinMaxSumSquares SampleSummary::Compute(const float *samples, size_t len)
+{
+   static const auto kernel = ChooseKernel();
+   return kernel(samples, len);
+}
+
+double SampleSummary::Summarize(
+   const float *samples, size_t len, size_t frameSize, float *dest)
+{
+   double totalSquares = 0;
+   for (size_t start = 0; start < len; start += frameSize, dest += 3) {
+      const auto count = std::min(frameSize, len - start);
+      const auto summary = Compute(samples + start, count);
+      totalSquares += summary.sumSquares;
+      dest[0] = summary.min;
+      dest[1] = summary.max;
+      dest[2] = std::sqrt(summary.sumSquares / count);
+   }
+   return totalSquares;
+}
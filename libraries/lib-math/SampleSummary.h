@@ -0,0 +1,41 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file SampleSummary.h
+  @brief Vectorized extremes and sums of squares of float samples
+
+**********************************************************************/
+#pragma once
+
+#include <cfloat>
+#include <cstddef>
+
+//! Extremes and sum of squares of a run of samples
+/*! Default values are those of an empty run */
+struct MinMaxSumSquares
+{
+   float min = FLT_MAX;
+   float max = -FLT_MAX;
+   float sumSquares = 0;
+};
+
+namespace SampleSummary
+{
+//! Uses the widest instructions that the processor supports
+MATH_API MinMaxSumSquares Compute(const float *samples, size_t len);
+
+//! Reference implementation without explicit vectorization
+MATH_API MinMaxSumSquares ComputeScalar(const float *samples, size_t len);
+
+//! Write (min, max, rms) triples for consecutive frames of frameSize samples
+/*!
+ The last frame may be shorter; its rms is for the samples it has.
+ @pre `frameSize > 0`
+ @param dest receives 3 * ceil(len / frameSize) floats
+ @return the sum of squares of all samples, accumulated in double precision
+ */
+MATH_API double Summarize(
+   const float *samples, size_t len, size_t frameSize, float *dest);
+}
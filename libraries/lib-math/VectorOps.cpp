@@ -0,0 +1,175 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file VectorOps.cpp
+
+**********************************************************************/
+#include "VectorOps.h"
+#include "CpuFeatures.h"
+
+#include <cstring>
+
+#if defined(AUDACITY_X86_SIMD)
+#include <immintrin.h>
+#endif
+
+namespace {
+// Plain loops, for the tails left by the vector loops, and for other
+// processors
+
+void MultiplyAddScalar(float *dst, const float *src, float gain, size_t len)
+{
+   for (size_t i = 0; i < len; ++i)
+      dst[i] += src[i] * gain;
+}
+
+void MultiplyByEnvelopeScalar(float *dst, const double *gains, size_t len)
+{
+   for (size_t i = 0; i < len; ++i)
+      dst[i] *= gains[i];
+}
+
+void InterleaveScalar(
+   float *dst, const float *const *srcs, size_t nChannels, size_t first,
+   size_t len)
+{
+   for (size_t c = 0; c < nChannels; ++c) {
+      auto pDst = dst + first * nChannels + c;
+      const auto pSrc = srcs[c];
+      for (size_t i = first; i < len; ++i, pDst += nChannels)
+         *pDst = pSrc[i];
+   }
+}
+
+#if defined(AUDACITY_X86_SIMD)
+void MultiplyAddSSE2(float *dst, const float *src, float gain, size_t len)
+{
+   const auto vGain = _mm_set1_ps(gain);
+   size_t i = 0;
+   for (; i + 8 <= len; i += 8) {
+      const auto x0 = _mm_mul_ps(_mm_loadu_ps(src + i), vGain);
+      const auto x1 = _mm_mul_ps(_mm_loadu_ps(src + i + 4), vGain);
+      _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), x0));
+      _mm_storeu_ps(dst + i + 4, _mm_add_ps(_mm_loadu_ps(dst + i + 4), x1));
+   }
+   MultiplyAddScalar(dst + i, src + i, gain, len - i);
+}
+
+AUDACITY_TARGET_AVX2
+void MultiplyAddAVX2(float *dst, const float *src, float gain, size_t len)
+{
+   const auto vGain = _mm256_set1_ps(gain);
+   size_t i = 0;
+   for (; i + 16 <= len; i += 16) {
+      // Separate multiplication and addition, not FMA, so that results are
+      // the same as from the other kernels
+      const auto x0 = _mm256_mul_ps(_mm256_loadu_ps(src + i), vGain);
+      const auto x1 = _mm256_mul_ps(_mm256_loadu_ps(src + i + 8), vGain);
+      _mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_loadu_ps(dst + i), x0));
+      _mm256_storeu_ps(dst + i + 8,
+         _mm256_add_ps(_mm256_loadu_ps(dst + i + 8), x1));
+   }
+   // Avoid the penalty for mixing AVX with the SSE code of the callers
+   _mm256_zeroupper();
+   MultiplyAddScalar(dst + i, src + i, gain, len - i);
+}
+
+void MultiplyByEnvelopeSSE2(float *dst, const double *gains, size_t len)
+{
+   size_t i = 0;
+   for (; i + 4 <= len; i += 4) {
+      const auto x = _mm_loadu_ps(dst + i);
+      const auto lo = _mm_mul_pd(_mm_cvtps_pd(x), _mm_loadu_pd(gains + i));
+      const auto hi = _mm_mul_pd(
+         _mm_cvtps_pd(_mm_movehl_ps(x, x)), _mm_loadu_pd(gains + i + 2));
+      _mm_storeu_ps(dst + i,
+         _mm_movelh_ps(_mm_cvtpd_ps(lo), _mm_cvtpd_ps(hi)));
+   }
+   MultiplyByEnvelopeScalar(dst + i, gains + i, len - i);
+}
+
+AUDACITY_TARGET_AVX2
+void MultiplyByEnvelopeAVX2(float *dst, const double *gains, size_t len)
+{
+   size_t i = 0;
+   for (; i + 8 <= len; i += 8) {
+      const auto x0 = _mm256_mul_pd(
+         _mm256_cvtps_pd(_mm_loadu_ps(dst + i)), _mm256_loadu_pd(gains + i));
+      const auto x1 = _mm256_mul_pd(
+         _mm256_cvtps_pd(_mm_loadu_ps(dst + i + 4)),
+         _mm256_loadu_pd(gains + i + 4));
+      _mm_storeu_ps(dst + i, _mm256_cvtpd_ps(x0));
+      _mm_storeu_ps(dst + i + 4, _mm256_cvtpd_ps(x1));
+   }
+   _mm256_zeroupper();
+   MultiplyByEnvelopeScalar(dst + i, gains + i, len - i);
+}
+
+// Shuffling is limited by memory bandwidth, and SSE2 suffices for that
+
+void InterleaveSSE2(
+   float *dst, const float *const *srcs, size_t nChannels, size_t len)
+{
+   size_t i = 0;
+   if (nChannels == 2) {
+      const auto left = srcs[0], right = srcs[1];
+      for (; i + 4 <= len; i += 4) {
+         const auto l = _mm_loadu_ps(left + i);
+         const auto r = _mm_loadu_ps(right + i);
+         _mm_storeu_ps(dst + 2 * i, _mm_unpacklo_ps(l, r));
+         _mm_storeu_ps(dst + 2 * i + 4, _mm_unpackhi_ps(l, r));
+      }
+   }
+   InterleaveScalar(dst, srcs, nChannels, i, len);
+}
+#endif
+
+struct Kernels
+{
+   void (*multiplyAdd)(float *, const float *, float, size_t);
+   void (*multiplyByEnvelope)(float *, const double *, size_t);
+   void (*interleave)(float *, const float *const *, size_t, size_t);
+};
+
+Kernels ChooseKernels()
+{
+#if defined(AUDACITY_X86_SIMD)
+   if (CpuFeatures::HasAVX2())
+      return { MultiplyAddAVX2, MultiplyByEnvelopeAVX2, InterleaveSSE2 };
+   return { MultiplyAddSSE2, MultiplyByEnvelopeSSE2, InterleaveSSE2 };
+#else
+   return { MultiplyAddScalar, MultiplyByEnvelopeScalar,
+      [](float *dst, const float *const *srcs, size_t nChannels, size_t len){
+         InterleaveScalar(dst, srcs, nChannels, 0, len); } };
+#endif
+}
+
+const Kernels &GetKernels()
+{
+   static const auto kernels = ChooseKernels();
+   return kernels;
+}
+}
+
+void VectorOps::MultiplyAdd(
+   float *dst, const float *src, float gain, size_t len)
+{
+   GetKernels().multiplyAdd(dst, src, gain, len);
+}
+
+void VectorOps::MultiplyByEnvelope(
+   float *dst, const double *gains, size_t len)
+{
+   GetKernels().multiplyByEnvelope(dst, gains, len);
+}
+
+void VectorOps::Interleave(
+   float *dst, const float *const *srcs, size_t nChannels, size_t len)
+{
+   if (nChannels == 1)
+      std::memcpy(dst, srcs[0], len * sizeof(float));
+   else
+      GetKernels().interleave(dst, srcs, nChannels, len);
+}
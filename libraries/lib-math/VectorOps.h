@@ -0,0 +1,39 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file VectorOps.h
+  @brief Vectorized gains, accumulation and channel interleaving of float
+  samples
+
+**********************************************************************/
+#pragma once
+
+#include <cstddef>
+
+//! Kernels for the inner loops of mixing
+/*!
+ Each uses the widest instructions that the processor supports, chosen once
+ at run time.
+
+ Every output sample is computed with the same operations, in the same order,
+ as the plain loop in the comment of the function, so that results do not
+ depend on the processor.  In particular, products are never fused with
+ additions.
+
+ Source and destination ranges must not overlap, unless they are the same.
+ */
+namespace VectorOps
+{
+//! `dst[i] += src[i] * gain`
+MATH_API void MultiplyAdd(
+   float *dst, const float *src, float gain, size_t len);
+
+//! `dst[i] *= gains[i]`, with the product in double precision
+MATH_API void MultiplyByEnvelope(float *dst, const double *gains, size_t len);
+
+//! `dst[i * nChannels + c] = srcs[c][i]`
+MATH_API void Interleave(
+   float *dst, const float *const *srcs, size_t nChannels, size_t len);
+}
@@ -0,0 +1,158 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  EBUR128Tests.cpp
+
+**********************************************************************/
+#include "EBUR128.h"
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <initializer_list>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace {
+//! Tones and noise under a slow swell, different in each channel
+std::vector<std::vector<float>>
+ReferenceSignal(double rate, size_t nChannels, size_t len)
+{
+   std::mt19937 engine{ 7 };
+   std::uniform_real_distribution<float> noise{ -0.05f, 0.05f };
+   std::vector<std::vector<float>> channels(nChannels, std::vector<float>(len));
+   for (size_t channel = 0; channel < nChannels; ++channel)
+      for (size_t i = 0; i < len; ++i) {
+         const auto t = i / rate;
+         const auto swell = 0.5 + 0.45 * sin(2 * M_PI * 0.3 * t);
+         channels[channel][i] = swell * (
+            0.5 * sin(2 * M_PI * (220 * (channel + 1)) * t) +
+            0.2 * sin(2 * M_PI * 5000 * t)) + noise(engine);
+      }
+   return channels;
+}
+
+//! Feed one sample of one channel at a time, as the Loudness effect did
+double PerSampleLoudness(
+   double rate, const std::vector<std::vector<float>> &channels)
+{
+   EBUR128 processor{ rate, channels.size() };
+   for (size_t i = 0; i < channels[0].size(); ++i) {
+      for (size_t channel = 0; channel < channels.size(); ++channel)
+         processor.ProcessSampleFromChannel(channels[channel][i], channel);
+      processor.NextSample();
+   }
+   return processor.IntegrativeLoudness();
+}
+
+//! Feed buffers of uneven sizes
+double BufferedLoudness(
+   double rate, const std::vector<std::vector<float>> &channels)
+{
+   EBUR128 processor{ rate, channels.size() };
+   const auto len = channels[0].size();
+   const size_t sizes[] = { 4096, 17, 1000, 1, 44100 };
+   std::vector<const float *> buffers(channels.size());
+   for (size_t done = 0, iSize = 0; done < len; ++iSize) {
+      const auto count = std::min(sizes[iSize % std::size(sizes)], len - done);
+      for (size_t channel = 0; channel < channels.size(); ++channel)
+         buffers[channel] = channels[channel].data() + done;
+      processor.ProcessSamples(buffers.data(), count);
+      done += count;
+   }
+   return processor.IntegrativeLoudness();
+}
+
+//! Sections of a 1 kHz sine, each of a peak level in dBFS and a duration,
+//! as in the test signals of EBU Tech 3341
+std::vector<float> Sine(
+   double rate, std::initializer_list<std::pair<double, double>> sections)
+{
+   std::vector<float> samples;
+   for (const auto &[level, seconds] : sections) {
+      const auto amplitude = pow(10.0, level / 20);
+      const size_t len = seconds * rate;
+      for (size_t i = 0; i < len; ++i) {
+         const auto t = samples.size() / rate;
+         samples.push_back(amplitude * sin(2 * M_PI * 1000 * t));
+      }
+   }
+   return samples;
+}
+
+double LUFS(double rate, const std::vector<std::vector<float>> &channels)
+{
+   EBUR128 processor{ rate, channels.size() };
+   return processor.IntegrativeLoudnessToLUFS(
+      BufferedLoudness(rate, channels));
+}
+}
+
+TEST_CASE("EBUR128")
+{
+   SECTION("Buffers give the loudness of single samples")
+   {
+      for (const double rate : { 8000.0, 44100.0, 96000.0 })
+         for (const size_t nChannels : { 1, 2, 3 })
+            for (const double seconds : { 0.25, 3.7 }) {
+               const auto signal =
+                  ReferenceSignal(rate, nChannels, seconds * rate);
+               const auto expected = PerSampleLoudness(rate, signal);
+               CAPTURE(rate, nChannels, seconds);
+               REQUIRE(expected > 0);
+               // The filters keep the rounding of Biquad::ProcessOne, and
+               // the powers are summed in the same order
+               REQUIRE(BufferedLoudness(rate, signal) == expected);
+            }
+   }
+
+   // The tolerance of EBU Tech 3341 for integrated loudness is 0.1 LU
+   SECTION("Stereo sine at -23 dBFS measures -23 LUFS")
+   {
+      for (const double rate : { 44100.0, 48000.0 }) {
+         CAPTURE(rate);
+         const auto sine = Sine(rate, { { -23, 20 } });
+         REQUIRE(LUFS(rate, { sine, sine }) == Approx(-23).margin(0.1));
+      }
+   }
+
+   SECTION("Mono sine measures the power of its one channel")
+   {
+      const double rate = 48000;
+      // Channel powers are summed, so one channel is 3 LU quieter than the
+      // same signal in two, which a mono track gives when treated as dual
+      // mono
+      REQUIRE(LUFS(rate, { Sine(rate, { { -20, 20 } }) }) ==
+         Approx(-23).margin(0.1));
+      REQUIRE(LUFS(rate, { Sine(rate, { { -23, 20 } }) }) ==
+         Approx(-26.01).margin(0.1));
+   }
+
+   SECTION("Quiet sections are gated out")
+   {
+      const double rate = 48000;
+      // Below the relative gate, as in case 3 of EBU Tech 3341
+      const auto relative =
+         Sine(rate, { { -36, 10 }, { -23, 60 }, { -36, 10 } });
+      REQUIRE(LUFS(rate, { relative, relative }) == Approx(-23).margin(0.1));
+      // Below the absolute gate too, as in case 4
+      const auto absolute = Sine(rate,
+         { { -72, 10 }, { -36, 10 }, { -23, 60 }, { -36, 10 }, { -72, 10 } });
+      REQUIRE(LUFS(rate, { absolute, absolute }) == Approx(-23).margin(0.1));
+      // Above the relative gate, as in case 5, so averaged in
+      const auto averaged =
+         Sine(rate, { { -26, 20 }, { -20, 20.1 }, { -26, 20 } });
+      REQUIRE(LUFS(rate, { averaged, averaged }) == Approx(-23).margin(0.1));
+   }
+
+   SECTION("Silence has no loudness")
+   {
+      const std::vector<std::vector<float>> silence(
+         2, std::vector<float>(44100));
+      REQUIRE(PerSampleLoudness(44100, silence) == 0);
+      REQUIRE(BufferedLoudness(44100, silence) == 0);
+   }
+}
@@ -0,0 +1,110 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  SampleSummaryTests.cpp
+
+**********************************************************************/
+#include "SampleSummary.h"
+
+#include <catch2/catch.hpp>
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace {
+std::vector<float> RandomSamples(size_t len)
+{
+   std::mt19937 engine { 42 };
+   std::uniform_real_distribution<float> distribution { -1.f, 1.f };
+   std::vector<float> samples(len);
+   for (auto &sample : samples)
+      sample = distribution(engine);
+   return samples;
+}
+
+//! The loop that SqliteSampleBlock::CalcSummary used for 256-sample frames
+double LegacySummarize(const float *samples, size_t len, float *dest)
+{
+   double totalSquares = 0.0;
+   const int sumLen = (len + 255) / 256;
+   for (int i = 0; i < sumLen; ++i)
+   {
+      float min = samples[i * 256];
+      float max = samples[i * 256];
+      float sumsq = min * min;
+
+      int jcount = 256;
+      if (jcount > int(len) - i * 256)
+         jcount = len - i * 256;
+
+      for (int j = 1; j < jcount; ++j)
+      {
+         float f1 = samples[i * 256 + j];
+         sumsq += f1 * f1;
+         if (f1 < min)
+            min = f1;
+         else if (f1 > max)
+            max = f1;
+      }
+      totalSquares += sumsq;
+      dest[i * 3] = min;
+      dest[i * 3 + 1] = max;
+      dest[i * 3 + 2] = (float) std::sqrt(sumsq / jcount);
+   }
+   return totalSquares;
+}
+}
+
+TEST_CASE("SampleSummary")
+{
+   SECTION("Compute agrees with the scalar reference")
+   {
+      for (const size_t len : { 0, 1, 3, 7, 8, 15, 16, 17, 255, 256, 1000 })
+      {
+         const auto samples = RandomSamples(len);
+         const auto expected =
+            SampleSummary::ComputeScalar(samples.data(), len);
+         const auto actual = SampleSummary::Compute(samples.data(), len);
+         REQUIRE(actual.min == expected.min);
+         REQUIRE(actual.max == expected.max);
+         REQUIRE(actual.sumSquares == Approx(expected.sumSquares));
+      }
+   }
+
+   SECTION("Summarize agrees with the loop it replaces")
+   {
+      // A partial last frame
+      constexpr size_t len = 10 * 256 + 17;
+      constexpr size_t frames = 11;
+      const auto samples = RandomSamples(len);
+      std::vector<float> expected(3 * frames), actual(3 * frames);
+      const auto expectedTotal =
+         LegacySummarize(samples.data(), len, expected.data());
+      const auto actualTotal =
+         SampleSummary::Summarize(samples.data(), len, 256, actual.data());
+      REQUIRE(actualTotal == Approx(expectedTotal));
+      for (size_t i = 0; i < 3 * frames; ++i)
+         REQUIRE(actual[i] == Approx(expected[i]));
+   }
+}
+
+TEST_CASE("SampleSummary benchmark", "[.][benchmark]")
+{
+   // One block of the default maximum size
+   constexpr size_t len = 262144;
+   const auto samples = RandomSamples(len);
+   std::vector<float> summary(3 * len / 256);
+
+   BENCHMARK("Legacy 256-sample summary")
+   {
+      return LegacySummarize(samples.data(), len, summary.data());
+   };
+
+   BENCHMARK("SampleSummary::Summarize")
+   {
+      return SampleSummary::Summarize(samples.data(), len, 256, summary.data());
+   };
+}
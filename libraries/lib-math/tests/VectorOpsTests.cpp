@@ -0,0 +1,139 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  VectorOpsTests.cpp
+
+**********************************************************************/
+#include "VectorOps.h"
+
+#include <catch2/catch.hpp>
+
+#include <random>
+#include <vector>
+
+namespace {
+template<typename T> std::vector<T> RandomValues(size_t len, unsigned seed)
+{
+   std::mt19937 engine { seed };
+   std::uniform_real_distribution<T> distribution { -1, 1 };
+   std::vector<T> values(len);
+   for (auto &value : values)
+      value = distribution(engine);
+   return values;
+}
+
+// Lengths exercising the vector loops and their tails
+const auto Lengths = { 0, 1, 3, 4, 7, 8, 15, 16, 17, 31, 1000 };
+}
+
+TEST_CASE("VectorOps")
+{
+   SECTION("MultiplyAdd is exact")
+   {
+      for (const size_t len : Lengths) {
+         const auto src = RandomValues<float>(len, 1);
+         auto expected = RandomValues<float>(len, 2);
+         auto actual = expected;
+         const float gain = 0.7f;
+         for (size_t i = 0; i < len; ++i)
+            expected[i] += src[i] * gain;
+         VectorOps::MultiplyAdd(actual.data(), src.data(), gain, len);
+         REQUIRE(actual == expected);
+      }
+   }
+
+   SECTION("MultiplyByEnvelope is exact")
+   {
+      for (const size_t len : Lengths) {
+         const auto gains = RandomValues<double>(len, 3);
+         auto expected = RandomValues<float>(len, 4);
+         auto actual = expected;
+         for (size_t i = 0; i < len; ++i)
+            expected[i] *= gains[i];
+         VectorOps::MultiplyByEnvelope(actual.data(), gains.data(), len);
+         REQUIRE(actual == expected);
+      }
+   }
+
+   SECTION("Interleave is exact")
+   {
+      for (const size_t nChannels : { 1, 2, 3, 6 }) {
+         for (const size_t len : Lengths) {
+            std::vector<std::vector<float>> channels;
+            std::vector<const float *> srcs;
+            for (size_t c = 0; c < nChannels; ++c) {
+               channels.push_back(RandomValues<float>(len, 6 + c));
+               srcs.push_back(channels.back().data());
+            }
+
+            std::vector<float> interleaved(len * nChannels);
+            VectorOps::Interleave(
+               interleaved.data(), srcs.data(), nChannels, len);
+            for (size_t i = 0; i < len; ++i)
+               for (size_t c = 0; c < nChannels; ++c)
+                  REQUIRE(interleaved[i * nChannels + c] == channels[c][i]);
+         }
+      }
+   }
+}
+
+TEST_CASE("VectorOps benchmark", "[.][benchmark]")
+{
+   // A typical mixer buffer
+   constexpr size_t len = 4096;
+   const auto src = RandomValues<float>(len, 1);
+   const auto gains = RandomValues<double>(len, 2);
+   std::vector<float> dst(len);
+   // The mixer's output buffers are reached through a vector of vectors
+   std::vector<std::vector<float>> dests{ dst };
+
+   BENCHMARK("Scalar multiply-add")
+   {
+      const float gain = 0.5f;
+      for (size_t j = 0; j < len; ++j)
+         dests[0][j] += src[j] * gain;
+      return dests[0][0];
+   };
+
+   BENCHMARK("VectorOps::MultiplyAdd")
+   {
+      VectorOps::MultiplyAdd(dests[0].data(), src.data(), 0.5f, len);
+      return dests[0][0];
+   };
+
+   BENCHMARK("Scalar envelope")
+   {
+      for (size_t i = 0; i < len; ++i)
+         dst[i] *= gains[i];
+      return dst[0];
+   };
+
+   BENCHMARK("VectorOps::MultiplyByEnvelope")
+   {
+      VectorOps::MultiplyByEnvelope(dst.data(), gains.data(), len);
+      return dst[0];
+   };
+
+   const auto right = RandomValues<float>(len, 3);
+   const float *srcs[]{ src.data(), right.data() };
+   std::vector<float> interleaved(2 * len);
+
+   BENCHMARK("Strided stereo interleave")
+   {
+      for (size_t c = 0; c < 2; ++c) {
+         auto d = interleaved.data() + c;
+         auto s = srcs[c];
+         for (size_t i = 0; i < len; ++i, d += 2, ++s)
+            *d = *s;
+      }
+      return interleaved[0];
+   };
+
+   BENCHMARK("VectorOps::Interleave")
+   {
+      VectorOps::Interleave(interleaved.data(), srcs, 2, len);
+      return interleaved[0];
+   };
+}
@@ -11,6 +11,26 @@
 
 PlayableSequence::~PlayableSequence() = default;
 
+namespace {
+thread_local bool sDeferWrites = false;
+}
+
+RecordableSequence::DeferredWritesScope::DeferredWritesScope()
+   : mWasInEffect{ sDeferWrites }
+{
+   sDeferWrites = true;
+}
+
+RecordableSequence::DeferredWritesScope::~DeferredWritesScope()
+{
+   sDeferWrites = mWasInEffect;
+}
+
+bool RecordableSequence::DeferredWritesScope::InEffect()
+{
+   return sDeferWrites;
+}
+
 RecordableSequence::~RecordableSequence() = default;
 
 OtherPlayableSequence::~OtherPlayableSequence() = default;
@@ -40,6 +40,26 @@ using ConstPlayableSequences =
  (but it also requires random access for insertion of silence)
  */
 struct MIXER_API RecordableSequence {
+   //! While one exists, appends made on the same thread may queue their
+   //! writes to storage, rather than wait for them
+   /*!
+    For the recording drain only:  queued writes are committed apart from
+    any transaction that the thread may have open
+    */
+   class MIXER_API DeferredWritesScope final {
+   public:
+      DeferredWritesScope();
+      ~DeferredWritesScope();
+      DeferredWritesScope(const DeferredWritesScope&) = delete;
+      DeferredWritesScope &operator=(const DeferredWritesScope&) = delete;
+
+      //! Whether a scope exists on the calling thread
+      static bool InEffect();
+
+   private:
+      const bool mWasInEffect;
+   };
+
    virtual ~RecordableSequence();
    virtual sampleFormat GetSampleFormat() const = 0;
    virtual double GetRate() const = 0;
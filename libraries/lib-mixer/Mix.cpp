@@ -21,6 +21,8 @@
 #include "EffectStage.h"
 #include "Dither.h"
 #include "Resample.h"
+#include "ThreadPool.h"
+#include "VectorOps.h"
 #include "WideSampleSequence.h"
 #include "float_cast.h"
 #include <numeric>
@@ -76,7 +78,7 @@ Mixer::Mixer(Inputs inputs,
    const size_t outBufferSize, const bool outInterleaved,
    double outRate, sampleFormat outFormat,
    const bool highQuality, MixerSpec *const mixerSpec,
-   ApplyGain applyGain
+   ApplyGain applyGain, const MixerOptions::Threading &threading
 )  : mNumChannels{ numOutChannels }
    , mInputs{ move(inputs) }
    , mBufferSize{ FindBufferSize(mInputs, outBufferSize) }
@@ -105,6 +107,7 @@ Mixer::Mixer(Inputs inputs,
       ](auto &buffer){ buffer.Allocate(size, format); }
    )}
    , mEffectiveFormat{ floatSample }
+   , mNumThreads{ threading.nThreads }
 {
    assert(BufferSize() <= outBufferSize);
    const auto nChannelsIn =
@@ -176,9 +179,23 @@ Mixer::Mixer(Inputs inputs,
             mSettings.pop_back();
          }
       }
+      if (pDownstream == &source)
+         mConcurrentSources.push_back(mDecoratedSources.size());
       mDecoratedSources.emplace_back(Source{ source, *pDownstream });
    }
 
+   // A time warp envelope is shared by all sources, and its lookups are not
+   // safe for concurrent use
+   if (mNumThreads != 1 && Parallel::ThreadPool::Get().Workers() > 0 &&
+      mConcurrentSources.size() > 1 && !warpOptions.envelope
+   ) {
+      // Like mFloatBuffers
+      mSourceBuffers.reserve(mDecoratedSources.size());
+      for (size_t ii = 0; ii < mDecoratedSources.size(); ++ii)
+         mSourceBuffers.emplace_back(3, mBufferSize, 1, 1);
+      mResults.resize(mDecoratedSources.size());
+   }
+
    // Decide once at construction time
    std::tie(mNeedsDither, mEffectiveFormat) = NeedsDither(needsDither, outRate);
 }
@@ -261,23 +278,17 @@ static void MixBuffers(unsigned numChannels,
    for (unsigned int c = 0; c < numChannels; c++) {
       if (!channelFlags[c])
          continue;
-      for (int j = 0; j < len; ++j)
-         dests[c][j] += pSrc[j] * gains[c];   // the actual mixing process
+      // the actual mixing process
+      VectorOps::MultiplyAdd(dests[c].data(), pSrc, gains[c], len);
    }
 }
 
 #define stackAllocate(T, count) static_cast<T*>(alloca(count * sizeof(T)))
 
-size_t Mixer::Process(const size_t maxToProcess)
+void Mixer::MixSource(const Source &source,
+   const AudioGraph::Buffers &buffers, size_t result, size_t maxChannels)
 {
-   assert(maxToProcess <= BufferSize());
-
-   // MB: this is wrong! mT represented warped time, and mTime is too inaccurate to use
-   // it here. It's also unnecessary I think.
-   //if (mT >= mT1)
-   //   return 0;
-
-   size_t maxOut = 0;
+   auto &upstream = source.upstream;
    const auto channelFlags = stackAllocate(unsigned char, mNumChannels);
    const auto gains = stackAllocate(float, mNumChannels);
    if (mApplyGain == ApplyGain::Discard)
@@ -304,6 +315,99 @@ size_t Mixer::Process(const size_t maxToProcess)
       return channelFlags;
    };
 
+   // Insert effect stages here!  Passing them all channels of the track
+
+   const auto limit = std::min<size_t>(upstream.Channels(), maxChannels);
+   for (size_t j = 0; j < limit; ++j) {
+      const auto pFloat = (const float *)buffers.GetReadPosition(j);
+      auto &sequence = upstream.GetSequence();
+      if (mApplyGain != ApplyGain::Discard) {
+         for (size_t c = 0; c < mNumChannels; ++c) {
+            if (mNumChannels > 1)
+               gains[c] = sequence.GetChannelGain(c);
+            else
+               gains[c] = sequence.GetChannelGain(j);
+         }
+         if(mApplyGain == ApplyGain::Mixdown && !mHasMixerSpec && mNumChannels == 1)
+            gains[0] /= static_cast<float>(limit);
+      }
+
+      const auto flags =
+         findChannelFlags(upstream.MixerSpec(j), sequence, j);
+      MixBuffers(mNumChannels, flags, gains, *pFloat, mTemp, result);
+   }
+}
+
+void Mixer::UpdateTime(MixerSource &source)
+{
+   const auto newT = source.TakeTime();
+   if (!newT)
+      return;
+   auto &[mT0, mT1, _, mTime] = *mTimesAndSpeed;
+   if (mT1 < mT0)
+      mTime = std::min(mTime, *newT);
+   else
+      mTime = std::max(mTime, *newT);
+}
+
+std::optional<size_t>
+Mixer::ProcessParallel(const size_t maxToProcess, size_t maxChannels)
+{
+   const auto acquire = [&](size_t iSource){
+      auto &buffers = mSourceBuffers[iSource];
+      mResults[iSource] =
+         mDecoratedSources[iSource].downstream.Acquire(buffers, maxToProcess);
+   };
+
+   // Sources with effect stages are acquired on this thread first
+   for (size_t iSource = 0, iConcurrent = 0;
+      iSource < mDecoratedSources.size(); ++iSource
+   ) {
+      if (iConcurrent < mConcurrentSources.size() &&
+          mConcurrentSources[iConcurrent] == iSource)
+         ++iConcurrent;
+      else
+         acquire(iSource);
+   }
+   Parallel::ThreadPool::Get().ParallelFor(mConcurrentSources.size(),
+      [&](size_t ii){ acquire(mConcurrentSources[ii]); }, mNumThreads);
+
+   const auto failed = std::any_of(mResults.begin(), mResults.end(),
+      [](const auto &oResult){ return !oResult; });
+
+   // Mix in the same order as the serial path does, for identical sums
+   size_t maxOut = 0;
+   for (size_t iSource = 0; iSource < mDecoratedSources.size(); ++iSource) {
+      const auto &source = mDecoratedSources[iSource];
+      auto &buffers = mSourceBuffers[iSource];
+      if (const auto oResult = mResults[iSource]) {
+         const auto result = *oResult;
+         UpdateTime(source.upstream);
+         if (!failed) {
+            maxOut = std::max(maxOut, result);
+            MixSource(source, buffers, result, maxChannels);
+         }
+         source.downstream.Release();
+         buffers.Advance(result);
+         buffers.Rotate();
+      }
+   }
+   if (failed)
+      return {};
+   return maxOut;
+}
+
+size_t Mixer::Process(const size_t maxToProcess)
+{
+   assert(maxToProcess <= BufferSize());
+
+   // MB: this is wrong! mT represented warped time, and mTime is too inaccurate to use
+   // it here. It's also unnecessary I think.
+   //if (mT >= mT1)
+   //   return 0;
+
+   size_t maxOut = 0;
+
    auto &[mT0, mT1, _, mTime] = *mTimesAndSpeed;
    auto oldTime = mTime;
    // backwards (as possibly in scrubbing)
@@ -313,7 +417,14 @@ size_t Mixer::Process(const size_t maxToProcess)
    // TODO: more-than-two-channels
    auto maxChannels = std::max(2u, mFloatBuffers.Channels());
 
-   for (auto &[ upstream, downstream ] : mDecoratedSources) {
+   if (!mSourceBuffers.empty()) {
+      const auto oMaxOut = ProcessParallel(maxToProcess, maxChannels);
+      if (!oMaxOut)
+         return 0;
+      maxOut = *oMaxOut;
+   }
+   else for (auto &source : mDecoratedSources) {
+      auto &[ upstream, downstream ] = source;
       auto oResult = downstream.Acquire(mFloatBuffers, maxToProcess);
       // One of MixVariableRates or MixSameRate assigns into mTemp[*][*] which
       // are the sources for the CopySamples calls, and they copy into
@@ -322,28 +433,9 @@ size_t Mixer::Process(const size_t maxToProcess)
          return 0;
       auto result = *oResult;
       maxOut = std::max(maxOut, result);
+      UpdateTime(upstream);
 
-      // Insert effect stages here!  Passing them all channels of the track
-
-      const auto limit = std::min<size_t>(upstream.Channels(), maxChannels);
-      for (size_t j = 0; j < limit; ++j) {
-         const auto pFloat = (const float *)mFloatBuffers.GetReadPosition(j);
-         auto &sequence = upstream.GetSequence();
-         if (mApplyGain != ApplyGain::Discard) {
-            for (size_t c = 0; c < mNumChannels; ++c) {
-               if (mNumChannels > 1)
-                  gains[c] = sequence.GetChannelGain(c);
-               else
-                  gains[c] = sequence.GetChannelGain(j);
-            }
-            if(mApplyGain == ApplyGain::Mixdown && !mHasMixerSpec && mNumChannels == 1)
-               gains[0] /= static_cast<float>(limit);
-         }
-         
-         const auto flags =
-            findChannelFlags(upstream.MixerSpec(j), sequence, j);
-         MixBuffers(mNumChannels, flags, gains, *pFloat, mTemp, result);
-      }
+      MixSource(source, mFloatBuffers, result, maxChannels);
 
       downstream.Release();
       mFloatBuffers.Advance(result);
@@ -359,7 +451,15 @@ size_t Mixer::Process(const size_t maxToProcess)
    auto ditherType = mNeedsDither
       ? (mHighQuality ? gHighQualityDither : gLowQualityDither)
       : DitherType::none;
-   for (size_t c = 0; c < mNumChannels; ++c)
+   if (mInterleaved && mFormat == floatSample && mNumChannels > 1) {
+      // Same-format copying would not dither anyway
+      const auto srcs = stackAllocate(const float *, mNumChannels);
+      for (size_t c = 0; c < mNumChannels; ++c)
+         srcs[c] = mTemp[c].data();
+      VectorOps::Interleave(reinterpret_cast<float *>(mBuffer[0].ptr()),
+         srcs, mNumChannels, maxOut);
+   }
+   else for (size_t c = 0; c < mNumChannels; ++c)
       CopySamples((constSamplePtr)mTemp[c].data(), floatSample,
          (mInterleaved
             ? mBuffer[0].ptr() + (c * SAMPLE_SIZE(mFormat))
@@ -15,6 +15,7 @@
 #include "AudioGraphBuffers.h"
 #include "MixerOptions.h"
 #include "SampleFormat.h"
+#include <optional>
 
 class sampleCount;
 class BoundedEnvelope;
@@ -69,7 +70,8 @@ class MIXER_API Mixer {
          bool highQuality = true,
          //! Null or else must have a lifetime enclosing this object's
          MixerSpec *mixerSpec = nullptr,
-         ApplyGain applyGain = ApplyGain::MapChannels);
+         ApplyGain applyGain = ApplyGain::MapChannels,
+         const MixerOptions::Threading &threading = {});
 
    Mixer(const Mixer&) = delete;
    Mixer &operator=(const Mixer&) = delete;
@@ -122,6 +124,17 @@ class MIXER_API Mixer {
 
    void Clear();
 
+   struct Source;
+   //! Accumulate the samples acquired from one source into mTemp
+   void MixSource(const Source &source, const AudioGraph::Buffers &buffers,
+      size_t result, size_t maxChannels);
+   //! Combine the time reached by one source into mTimesAndSpeed
+   void UpdateTime(MixerSource &source);
+   //! Acquire from the sources concurrently, then mix them in order
+   /*! @return as for Process(), or nullopt if any source failed */
+   std::optional<size_t>
+   ProcessParallel(size_t maxToProcess, size_t maxChannels);
+
  private:
 
    // Input
@@ -169,5 +182,16 @@ class MIXER_API Mixer {
 
    struct Source { MixerSource &upstream; AudioGraph::Source &downstream; };
    std::vector<Source> mDecoratedSources;
+
+   //! Threads that Process() may use, as in MixerOptions::Threading
+   const size_t mNumThreads;
+   //! Non-empty only when processing in parallel; then each of
+   //! mDecoratedSources acquires into its own buffers
+   std::vector<AudioGraph::Buffers> mSourceBuffers;
+   //! Indices of the decorated sources without effect stages
+   /*! Others are acquired on the calling thread, because effect instances
+    need not tolerate concurrent processing of other instances */
+   std::vector<size_t> mConcurrentSources;
+   std::vector<std::optional<size_t>> mResults;
 };
 #endif
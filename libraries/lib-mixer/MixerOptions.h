@@ -101,6 +101,13 @@ struct TimesAndSpeed final {
    // consistency with AudioIO - mT represented warped time there)
 };
 
+//! How many threads Mixer::Process() may use
+struct Threading final {
+   //! 1 for processing on the calling thread only; 0 for as many threads as
+   //! Parallel::ThreadPool::Get() offers
+   size_t nThreads{ 1 };
+};
+
 struct StageSpecification final {
    using Factory = std::function<std::shared_ptr<EffectInstance>()>;
 
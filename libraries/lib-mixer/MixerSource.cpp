@@ -16,8 +16,11 @@
 #include "AudioGraphBuffers.h"
 #include "Envelope.h"
 #include "Resample.h"
+#include "ResamplerPool.h"
+#include "VectorOps.h"
 #include "WideSampleSequence.h"
 #include "float_cast.h"
+#include <utility>
 
 namespace {
 template<typename T, typename F> std::vector<T>
@@ -39,10 +42,26 @@ initVector(size_t dim1, size_t dim2)
 
 void MixerSource::MakeResamplers()
 {
-   for (size_t j = 0; j < mnChannels; ++j)
-      mResample[j] = std::make_unique<Resample>(
+   auto &pool = ResamplerPool::Get();
+   for (size_t j = 0; j < mnChannels; ++j) {
+      pool.Release(move(mResample[j]));
+      mResample[j] = pool.Acquire(
          mResampleParameters.mHighQuality,
          mResampleParameters.mMinFactor, mResampleParameters.mMaxFactor);
+   }
+}
+
+bool MixerSource::NeedsResampling() const
+{
+   return mResampleParameters.mVariableRates ||
+      GetSequence().GetRate() != mRate;
+}
+
+void MixerSource::ReleaseResamplers()
+{
+   auto &pool = ResamplerPool::Get();
+   for (auto &pResample : mResample)
+      pool.Release(move(pResample));
 }
 
 namespace {
@@ -106,6 +125,10 @@ size_t MixerSource::MixVariableRates(
    double t = ((pos).as_long_long() +
                (backwards ? queueLen : - queueLen)) / sequenceRate;
 
+   // In case the sequence rate changed since construction
+   if (!mResample[0])
+      MakeResamplers();
+
    while (out < maxOut) {
       if (queueLen < (int)sProcessLen) {
          // Shift pending portion to start of the buffer
@@ -140,8 +163,8 @@ size_t MixerSource::MixVariableRates(
                backwards);
             for (size_t iChannel = 0; iChannel < nChannels; ++iChannel) {
                const auto queue = mSampleQueue[iChannel].data();
-               for (decltype(getLen) i = 0; i < getLen; i++)
-                  queue[(queueLen) + i] *= mEnvValues[i];
+               VectorOps::MultiplyByEnvelope(
+                  &queue[queueLen], mEnvValues.data(), getLen);
             }
 
             if (backwards)
@@ -262,11 +285,10 @@ size_t MixerSource::MixSameRate(unsigned nChannels, const size_t maxOut,
 
    mpSeq->GetEnvelopeValues(mEnvValues.data(), slen, t, backwards);
 
-   for (size_t iChannel = 0; iChannel < nChannels; ++iChannel) {
-      const auto pFloat = floatBuffers[iChannel];
-      for (size_t i = 0; i < slen; i++)
-         pFloat[i] *= mEnvValues[i]; // Track gain control will go here?
-   }
+   for (size_t iChannel = 0; iChannel < nChannels; ++iChannel)
+      // Track gain control will go here?
+      VectorOps::MultiplyByEnvelope(
+         floatBuffers[iChannel], mEnvValues.data(), slen);
 
    if (backwards)
       pos -= slen;
@@ -308,10 +330,14 @@ MixerSource::MixerSource(
    assert(mTimesAndSpeed);
    auto t0 = mTimesAndSpeed->mT0;
    mSamplePos = GetSequence().TimeToLongSamples(t0);
-   MakeResamplers();
+   if (NeedsResampling())
+      MakeResamplers();
 }
 
-MixerSource::~MixerSource() = default;
+MixerSource::~MixerSource()
+{
+   ReleaseResamplers();
+}
 
 const WideSampleSequence &MixerSource::GetSequence() const
 {
@@ -342,8 +368,6 @@ std::optional<size_t> MixerSource::Acquire(Buffers &data, size_t bound)
    assert(bound <= data.BlockSize());
    assert(data.BlockSize() <= data.Remaining());
 
-   auto &[mT0, mT1, _, mTime] = *mTimesAndSpeed;
-   const bool backwards = (mT1 < mT0);
    // TODO: more-than-two-channels
    const auto maxChannels = mMaxChannels = data.Channels();
    const auto limit = std::min<size_t>(mnChannels, maxChannels);
@@ -353,15 +377,11 @@ std::optional<size_t> MixerSource::Acquire(Buffers &data, size_t bound)
    for (size_t j = 0; j < limit; ++j)
       pFloats[j] = &data.GetWritePosition(j);
    const auto rate = GetSequence().GetRate();
-   auto result = (mResampleParameters.mVariableRates || rate != mRate)
+   auto result = NeedsResampling()
       ? MixVariableRates(limit, bound, pFloats)
       : MixSameRate(limit, bound, pFloats);
    maxTrack = std::max(maxTrack, result);
-   auto newT = mSamplePos.as_double() / rate;
-   if (backwards)
-      mTime = std::min(mTime, newT);
-   else
-      mTime = std::max(mTime, newT);
+   mLastTime = mSamplePos.as_double() / rate;
    for (size_t j = 0; j < limit; ++j) {
       mixed[j] = result;
    }
@@ -389,6 +409,11 @@ sampleCount MixerSource::Remaining() const
    return mLastProduced;
 }
 
+std::optional<double> MixerSource::TakeTime()
+{
+   return std::exchange(mLastTime, std::nullopt);
+}
+
 bool MixerSource::Release()
 {
    mLastProduced = 0;
@@ -410,11 +435,12 @@ void MixerSource::Reposition(double time, bool skipping)
    mSamplePos = GetSequence().TimeToLongSamples(time);
    mQueueStart = 0;
    mQueueLen = 0;
+   mLastTime.reset();
 
    // Bug 2025:  libsoxr 0.1.3, first used in Audacity 2.3.0, crashes with
    // constant rate resampling if you try to reuse the resampler after it has
    // flushed.  Should that be considered a bug in sox?  This works around it.
    // (See also bug 1887, and the same work around in Mixer::Restart().)
-   if (skipping)
+   if (skipping && NeedsResampling())
       MakeResamplers();
 }
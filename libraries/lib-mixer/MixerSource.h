@@ -18,6 +18,7 @@
 #include "MixerOptions.h"
 #include "SampleCount.h"
 #include <memory>
+#include <optional>
 
 class Resample;
 class SampleTrack;
@@ -62,10 +63,23 @@ public:
    bool Terminates() const override;
    void Reposition(double time, bool skipping);
 
+   //! Sequence time reached by the last Acquire(), if not taken already
+   /*!
+    Acquire() does not itself update the shared TimesAndSpeed, so that
+    sources may be acquired concurrently
+    */
+   std::optional<double> TakeTime();
+
    bool VariableRates() const { return mResampleParameters.mVariableRates; }
 
 private:
+   //! Replace any resamplers with fresh ones from the ResamplerPool
    void MakeResamplers();
+   //! Give resamplers back to the ResamplerPool
+   void ReleaseResamplers();
+   //! False when rates are exactly equal and there is no time warp, so that
+   //! MixSameRate() can pass samples through
+   bool NeedsResampling() const;
 
    //! Cut the queue into blocks of this finer size
    //! for variable rate resampling.  Each block is resampled at some
@@ -125,6 +139,7 @@ private:
    int mQueueLen;
 
    const ResampleParameters mResampleParameters;
+   //! Null unless NeedsResampling()
    std::vector<std::unique_ptr<Resample>> mResample;
 
    //! Gain envelopes are applied to input before other transformations
@@ -137,5 +152,6 @@ private:
    //! Remember how many channels were passed to Acquire()
    unsigned mMaxChannels{};
    size_t mLastProduced{};
+   std::optional<double> mLastTime;
 };
 #endif
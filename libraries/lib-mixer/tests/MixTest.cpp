@@ -0,0 +1,150 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  MixTest.cpp
+
+**********************************************************************/
+#include <catch2/catch.hpp>
+
+#include "Mix.h"
+#include "MockedPrefs.h"
+#include "ResamplerPool.h"
+#include "WideSampleSequence.h"
+
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace {
+//! Deterministic noise, different in every channel of every sequence
+class NoiseSequence final : public WideSampleSequence
+{
+public:
+   NoiseSequence(unsigned seed, size_t nChannels, double rate, float gain)
+      : mSeed{ seed }, mNChannels{ nChannels }, mRate{ rate }, mGain{ gain }
+   {}
+
+   size_t NChannels() const override { return mNChannels; }
+   float GetChannelGain(int) const override { return mGain; }
+
+   bool DoGet(size_t iChannel, size_t nBuffers, const samplePtr buffers[],
+      sampleFormat format, sampleCount start, size_t len, bool backwards,
+      fillFormat, bool, sampleCount* pNumWithinClips) const override
+   {
+      REQUIRE(format == floatSample);
+      for (size_t ii = 0; ii < nBuffers; ++ii) {
+         const auto dest = reinterpret_cast<float*>(buffers[ii]);
+         for (size_t jj = 0; jj < len; ++jj) {
+            const auto pos = backwards
+               ? start.as_long_long() - 1 - jj
+               : start.as_long_long() + jj;
+            dest[jj] = Noise(iChannel + ii, pos);
+         }
+      }
+      if (pNumWithinClips)
+         *pNumWithinClips = len;
+      return true;
+   }
+
+   double GetStartTime() const override { return 0; }
+   double GetEndTime() const override { return 10; }
+   double GetRate() const override { return mRate; }
+   sampleFormat WidestEffectiveFormat() const override { return floatSample; }
+   bool HasTrivialEnvelope() const override { return true; }
+   void GetEnvelopeValues(
+      double* buffer, size_t bufferLen, double, bool) const override
+   {
+      std::fill(buffer, buffer + bufferLen, 1.0);
+   }
+
+   AudioGraph::ChannelType GetChannelType() const override
+   {
+      return mNChannels == 1
+         ? AudioGraph::MonoChannel : AudioGraph::LeftChannel;
+   }
+
+private:
+   float Noise(size_t iChannel, long long pos) const
+   {
+      auto x = static_cast<unsigned>(pos) * 2654435761u
+         ^ (mSeed * 40503u + iChannel * 97u);
+      x ^= x >> 15;
+      x *= 2246822519u;
+      x ^= x >> 13;
+      return (x & 0xFFFF) / 32768.0f - 1.0f;
+   }
+
+   const unsigned mSeed;
+   const size_t mNChannels;
+   const double mRate;
+   const float mGain;
+};
+
+//! Output of mixing many sequences of differing rates and widths
+std::vector<float> Mix(size_t nThreads, bool resample = true)
+{
+   Mixer::Inputs inputs;
+   const double rates[] = { 44100, 48000, 22050, 96000 };
+   for (unsigned ii = 0; ii < 16; ++ii)
+      inputs.emplace_back(std::make_shared<NoiseSequence>(
+         ii, 1 + ii % 2, resample ? rates[ii % 4] : 44100,
+         0.1f + ii * 0.07f));
+
+   constexpr size_t bufferSize = 1024;
+   Mixer mixer{ move(inputs), true, Mixer::WarpOptions{ 1.0, 1.0 },
+      0.0, 2.0, 2, bufferSize, true, 44100, floatSample,
+      true, nullptr, Mixer::ApplyGain::MapChannels,
+      MixerOptions::Threading{ nThreads } };
+
+   std::vector<float> result;
+   while (const auto count = mixer.Process()) {
+      const auto samples =
+         reinterpret_cast<const float*>(mixer.GetBuffer());
+      result.insert(result.end(), samples, samples + 2 * count);
+   }
+   return result;
+}
+}
+
+TEST_CASE("Mixer")
+{
+   MockedPrefs mockedPrefs;
+
+   SECTION("Parallel processing gives the same bits as serial processing")
+   {
+      const auto serial = Mix(1);
+      REQUIRE(!serial.empty());
+      for (const size_t nThreads : { 0, 2, 3 }) {
+         const auto parallel = Mix(nThreads);
+         REQUIRE(parallel.size() == serial.size());
+         REQUIRE(0 == memcmp(parallel.data(), serial.data(),
+            serial.size() * sizeof(float)));
+      }
+   }
+
+   SECTION("Resamplers are recycled, giving the same results")
+   {
+      auto &pool = ResamplerPool::Get();
+      const auto first = Mix(1);
+      const auto before = pool.GetStatistics();
+      const auto second = Mix(1);
+      const auto after = pool.GetStatistics();
+      REQUIRE(after.created == before.created);
+      REQUIRE(after.reused > before.reused);
+      REQUIRE(second.size() == first.size());
+      REQUIRE(0 == memcmp(second.data(), first.data(),
+         first.size() * sizeof(float)));
+   }
+
+   SECTION("Equal rates need no resamplers")
+   {
+      auto &pool = ResamplerPool::Get();
+      const auto before = pool.GetStatistics();
+      REQUIRE(!Mix(1, false).empty());
+      const auto after = pool.GetStatistics();
+      REQUIRE(after.created == before.created);
+      REQUIRE(after.reused == before.reused);
+   }
+}
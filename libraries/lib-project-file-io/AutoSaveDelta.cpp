@@ -0,0 +1,168 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  AutoSaveDelta.cpp
+
+**********************************************************************/
+
+#include "AutoSaveDelta.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "MemoryStream.h"
+
+namespace
+{
+// Operations in the encoded delta, each followed by 64 bit little-endian
+// numbers
+enum DeltaOps : char
+{
+   DO_Literal = 'L', // length, bytes
+   DO_Copy = 'C',    // offset and length in the base
+};
+
+// FNV-1a
+uint64_t Hash(uint64_t result, const uint8_t* data, size_t length)
+{
+   for (size_t ii = 0; ii < length; ++ii)
+   {
+      result ^= data[ii];
+      result *= 1099511628211ull;
+   }
+   return result;
+}
+
+// Hash of the length and of the bytes at each end only.  Contents are
+// compared in full anyway, so hashing all of them would only cost time.
+uint64_t Fingerprint(const uint8_t* data, size_t length)
+{
+   constexpr size_t EndBytes = 256;
+   auto result = Hash(
+      14695981039346656037ull, reinterpret_cast<const uint8_t*>(&length),
+      sizeof(length));
+   if (length <= 2 * EndBytes)
+      return Hash(result, data, length);
+   result = Hash(result, data, EndBytes);
+   return Hash(result, data + length - EndBytes, EndBytes);
+}
+
+void WriteNumber(MemoryStream& out, uint64_t value)
+{
+   uint8_t bytes[sizeof(value)];
+   for (auto& byte : bytes)
+   {
+      byte = static_cast<uint8_t>(value & 0xFF);
+      value >>= 8;
+   }
+   out.AppendData(bytes, sizeof(bytes));
+}
+
+bool ReadNumber(const uint8_t*& in, const uint8_t* end, uint64_t& value)
+{
+   if (end - in < static_cast<ptrdiff_t>(sizeof(value)))
+      return false;
+   value = 0;
+   for (size_t ii = sizeof(value); ii-- > 0;)
+      value = (value << 8) | in[ii];
+   in += sizeof(value);
+   return true;
+}
+} // namespace
+
+AutoSaveDelta::AutoSaveDelta(const MemoryStream& base, const Segments& segments)
+{
+   const auto data = static_cast<const uint8_t*>(base.GetData());
+   mBase.assign(data, data + base.GetSize());
+   mSegments.reserve(segments.size());
+   for (const auto& segment : segments)
+      mSegments.emplace(
+         Fingerprint(data + segment.offset, segment.length), segment);
+}
+
+size_t AutoSaveDelta::GetBaseSize() const noexcept
+{
+   return mBase.size();
+}
+
+size_t AutoSaveDelta::Encode(
+   const MemoryStream& data, const Segments& segments,
+   MemoryStream& delta) const
+{
+   const auto bytes = static_cast<const uint8_t*>(data.GetData());
+   size_t literalBytes = 0;
+
+   const auto writeLiteral = [&](size_t offset, size_t length) {
+      if (length == 0)
+         return;
+      delta.AppendByte(DO_Literal);
+      WriteNumber(delta, length);
+      delta.AppendData(bytes + offset, length);
+      literalBytes += length;
+   };
+
+   size_t position = 0;
+   for (const auto& segment : segments)
+   {
+      writeLiteral(position, segment.offset - position);
+      position = segment.offset + segment.length;
+
+      const auto pSegment = bytes + segment.offset;
+      const auto [first, last] =
+         mSegments.equal_range(Fingerprint(pSegment, segment.length));
+      // Equal fingerprints only make equal contents likely
+      const auto iter = std::find_if(first, last, [&](const auto& pair) {
+         return pair.second.length == segment.length &&
+                memcmp(mBase.data() + pair.second.offset, pSegment,
+                   segment.length) == 0;
+      });
+      if (iter == last)
+         writeLiteral(segment.offset, segment.length);
+      else
+      {
+         delta.AppendByte(DO_Copy);
+         WriteNumber(delta, iter->second.offset);
+         WriteNumber(delta, iter->second.length);
+      }
+   }
+   writeLiteral(position, data.GetSize() - position);
+
+   return literalBytes;
+}
+
+bool AutoSaveDelta::Apply(
+   const void* base, size_t baseSize, const void* delta, size_t deltaSize,
+   MemoryStream& result)
+{
+   const auto baseBytes = static_cast<const uint8_t*>(base);
+   auto in = static_cast<const uint8_t*>(delta);
+   const auto end = in + deltaSize;
+
+   while (in != end)
+   {
+      const auto op = *in++;
+      uint64_t offset, length;
+      switch (op)
+      {
+      case DO_Literal:
+         if (!ReadNumber(in, end, length) ||
+             static_cast<uint64_t>(end - in) < length)
+            return false;
+         result.AppendData(in, length);
+         in += length;
+         break;
+      case DO_Copy:
+         if (
+            !ReadNumber(in, end, offset) || !ReadNumber(in, end, length) ||
+            offset > baseSize || baseSize - offset < length)
+            return false;
+         result.AppendData(baseBytes + offset, length);
+         break;
+      default:
+         return false;
+      }
+   }
+   return true;
+}
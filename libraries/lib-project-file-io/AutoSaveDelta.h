@@ -0,0 +1,73 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  AutoSaveDelta.h
+
+**********************************************************************/
+
+#ifndef __AUDACITY_AUTO_SAVE_DELTA__
+#define __AUDACITY_AUTO_SAVE_DELTA__
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+class MemoryStream;
+
+//! Describes a full autosave document, so that later autosaves can be
+//! written as deltas that reuse its unchanged parts
+/*!
+ The document is divided by the writer into segments (one for each track);
+ bytes outside of the segments (the project header and tail) are always
+ written literally.  A segment of a later document is written as a reference
+ into the base document, when the base has a segment of the same contents.
+ The bytes of the base are kept, so that contents are compared in full and
+ not trusted to a hash.
+
+ Deltas are cumulative:  each is relative to the base, never to another
+ delta, so that recovery needs only the base and the latest delta.
+ */
+class PROJECT_FILE_IO_API AutoSaveDelta final
+{
+public:
+   //! A range of bytes in a serialized document
+   struct Segment
+   {
+      size_t offset;
+      size_t length;
+   };
+   using Segments = std::vector<Segment>;
+
+   //! Remember a copy of a base document, and its segments
+   AutoSaveDelta(const MemoryStream& base, const Segments& segments);
+
+   size_t GetBaseSize() const noexcept;
+
+   //! Append to delta an encoding of data, as literal bytes and references to
+   //! segments of the base
+   /*!
+    @pre segments are ordered, not overlapping, and within data
+    @return the count of literal bytes appended
+    */
+   size_t
+   Encode(const MemoryStream& data, const Segments& segments,
+      MemoryStream& delta) const;
+
+   //! Reconstruct a document from its base and a delta made by Encode
+   /*!
+    @return false if the delta does not fit the base
+    */
+   static bool Apply(
+      const void* base, size_t baseSize, const void* delta, size_t deltaSize,
+      MemoryStream& result);
+
+private:
+   std::vector<uint8_t> mBase;
+   // Maps fingerprints of segment contents to the segments of the base
+   std::unordered_multimap<uint64_t, Segment> mSegments;
+};
+
+#endif
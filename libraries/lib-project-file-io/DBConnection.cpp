@@ -15,11 +15,26 @@ Paul Licameli -- split from ProjectFileIO.cpp
 
 #include <wx/string.h>
 
+#include <algorithm>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#elif defined(__APPLE__)
+#include <sys/attr.h>
+#include <sys/clonefile.h>
+#endif
+
 #include "AudacityLogger.h"
 #include "BasicUI.h"
 #include "FileNames.h"
 #include "Internat.h"
+#include "Prefs.h"
 #include "Project.h"
+#include "ProjectFileIO.h"
 #include "FileException.h"
 #include "wxFileNameWrapper.h"
 #include "SentryHelper.h"
@@ -48,6 +63,11 @@ static const char *FastConfig =
    "PRAGMA <schema>.synchronous = OFF;"
    "PRAGMA <schema>.journal_mode = OFF;";
 
+//! Megabytes of the project file that SQLite may map into memory; zero,
+//! the default, reads through the ordinary file interface
+static IntSetting ProjectMemoryMapSize{
+   L"/Performance/ProjectMemoryMapSize", 0 };
+
 DBConnection::DBConnection(
    const std::weak_ptr<AudacityProject> &pProject,
    const std::shared_ptr<DBConnectionErrors> &pErrors,
@@ -202,6 +222,9 @@ int DBConnection::OpenStepByStep(const FilePath fileName)
       return rc;
    }
 
+   // Not fatal if this fails; reads just take the usual path
+   MemoryMapMode();
+
    rc = sqlite3_open(name, &mCheckpointDB);
    if (rc != SQLITE_OK)
    {
@@ -241,6 +264,9 @@ bool DBConnection::Close()
       return true;
    }
 
+   // Finish deferred writes before their checkpoints
+   StopWriter();
+
    // Uninstall our checkpoint hook so that no additional checkpoints
    // are sent our way.  (Though this shouldn't really happen.)
    sqlite3_wal_hook(mDB, nullptr, nullptr);
@@ -334,6 +360,7 @@ bool DBConnection::Close()
                    sqlite3_errmsg(mDB));
    }
    mDB = nullptr;
+   mMemoryMapped = false;
 
    return true;
 }
@@ -390,6 +417,26 @@ int DBConnection::SetPageSize(const char* schema)
    return ModeConfig(mDB, schema, PageSizeConfig);
 }
 
+int DBConnection::MemoryMapMode(const char* schema)
+{
+   const auto megabytes = ProjectMemoryMapSize.Read();
+   if (megabytes <= 0)
+      return SQLITE_OK;
+
+   const auto config = wxString::Format(
+      "PRAGMA <schema>.mmap_size = %lld;",
+      static_cast<long long>(megabytes) * 1024 * 1024);
+   const auto rc = ModeConfig(mDB, schema, config.utf8_str());
+   if (strcmp(schema, "main") == 0)
+      mMemoryMapped = (rc == SQLITE_OK);
+   return rc;
+}
+
+bool DBConnection::IsMemoryMapped() const
+{
+   return mMemoryMapped;
+}
+
 int DBConnection::ModeConfig(sqlite3 *db, const char *schema, const char *config)
 {
    // Ensure attached DB connection gets configured
@@ -597,6 +644,444 @@ int DBConnection::CheckpointHook(void *data, sqlite3 *db, const char *schema, in
    return SQLITE_OK;
 }
 
+// Most writes waiting for the writer thread before DeferWrite() blocks
+static constexpr size_t MaxDeferredWrites = 64;
+
+long long DBConnection::ReserveBlockID()
+{
+   std::lock_guard<std::mutex> guard(mBlockIDMutex);
+
+   if (mNextBlockID == 0)
+   {
+      // Continue after the greatest id ever used, as AUTOINCREMENT would
+      sqlite3_stmt *stmt = nullptr;
+      int rc = sqlite3_prepare_v2(mDB,
+         "SELECT max("
+         "  coalesce((SELECT seq FROM sqlite_sequence"
+         "              WHERE name = 'sampleblocks'), 0),"
+         "  coalesce((SELECT max(blockid) FROM sampleblocks), 0));",
+         -1, &stmt, nullptr);
+      if (rc == SQLITE_OK)
+      {
+         auto finalizer = finally([&stmt] { sqlite3_finalize(stmt); });
+         rc = sqlite3_step(stmt);
+         if (rc == SQLITE_ROW)
+            mNextBlockID = sqlite3_column_int64(stmt, 0) + 1;
+      }
+
+      if (mNextBlockID == 0)
+      {
+         ADD_EXCEPTION_CONTEXT("sqlite3.rc", std::to_string(rc));
+         ADD_EXCEPTION_CONTEXT("sqlite3.context", "DBConnection::ReserveBlockID");
+
+         wxLogMessage("Failed to find next block id for %s\n"
+                      "\tError: %s\n",
+                      sqlite3_db_filename(mDB, nullptr),
+                      sqlite3_errmsg(mDB));
+
+         ThrowException( false );
+      }
+   }
+
+   return mNextBlockID++;
+}
+
+bool DBConnection::ReadSampleBlockMetadata(
+   sqlite3 *db, SampleBlockMetadataMap &result)
+{
+   // length() of a blob is found without reading the blob
+   sqlite3_stmt *stmt = nullptr;
+   int rc = sqlite3_prepare_v2(db,
+      "SELECT blockid, sampleformat, summin, summax, sumrms,"
+      "       length(samples)"
+      "  FROM sampleblocks;",
+      -1, &stmt, nullptr);
+   if (rc != SQLITE_OK)
+      return false;
+   auto finalizer = finally([&stmt] { sqlite3_finalize(stmt); });
+
+   while ((rc = sqlite3_step(stmt)) == SQLITE_ROW)
+      result.emplace(sqlite3_column_int64(stmt, 0), SampleBlockMetadata {
+         sqlite3_column_int(stmt, 1),
+         sqlite3_column_double(stmt, 2),
+         sqlite3_column_double(stmt, 3),
+         sqlite3_column_double(stmt, 4),
+         sqlite3_column_int(stmt, 5)
+      });
+
+   return rc == SQLITE_DONE;
+}
+
+void DBConnection::PreloadSampleBlockMetadata()
+{
+   // Blocks created lazily read their rows only when needed
+   if (LazyProjectOpen.Read())
+      return;
+
+   SampleBlockMetadataMap metadata;
+   if (!ReadSampleBlockMetadata(mDB, metadata))
+   {
+      wxLogMessage("Failed to preload sample block metadata for %s\n"
+                   "\tError: %s\n",
+                   sqlite3_db_filename(mDB, nullptr),
+                   sqlite3_errmsg(mDB));
+      metadata.clear();
+   }
+
+   std::lock_guard<std::mutex> guard(mPreloadMutex);
+   mPreloadedMetadata.swap(metadata);
+}
+
+void DBConnection::DiscardSampleBlockMetadata()
+{
+   SampleBlockMetadataMap metadata;
+   std::lock_guard<std::mutex> guard(mPreloadMutex);
+   mPreloadedMetadata.swap(metadata);
+}
+
+auto DBConnection::TakeSampleBlockMetadata(long long id)
+   -> std::optional<SampleBlockMetadata>
+{
+   std::lock_guard<std::mutex> guard(mPreloadMutex);
+   const auto iter = mPreloadedMetadata.find(id);
+   if (iter == mPreloadedMetadata.end())
+      return {};
+   auto result = iter->second;
+   mPreloadedMetadata.erase(iter);
+   return result;
+}
+
+int DBConnection::CopySampleBlocks(sqlite3 *db, const char *schema,
+   std::vector<long long> blockids, const CopyProgress &progress)
+{
+   // Large enough to amortize the statements; small enough that progress
+   // is polled often even for the largest blocks
+   constexpr size_t BlocksPerStatement = 32;
+   constexpr size_t StatementsPerTransaction = 128;
+
+   // Ids in order let both tables be walked, and the destination only
+   // appended to, rather than split in random places
+   std::sort(blockids.begin(), blockids.end());
+
+   std::vector<sqlite3_stmt *> statements(BlocksPerStatement + 1);
+   auto finalizer = finally([&] {
+      for (auto stmt : statements)
+         sqlite3_finalize(stmt);
+   });
+   const auto prepare = [&](size_t count, sqlite3_stmt *&stmt) {
+      if (stmt)
+         return SQLITE_OK;
+      std::string sql = std::string { "INSERT INTO " } + schema +
+         ".sampleblocks SELECT * FROM main.sampleblocks WHERE blockid IN (?";
+      for (size_t ii = 1; ii < count; ++ii)
+         sql += ",?";
+      sql += ");";
+      return sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
+   };
+
+   // Without a journal a transaction is not for rollback; committing only
+   // now and then saves syncs.  Don't commit what the caller began.
+   const bool ownTransactions = sqlite3_get_autocommit(db) != 0;
+   auto rollback = finally([&] {
+      if (ownTransactions && !sqlite3_get_autocommit(db))
+         sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+   });
+
+   int rc = SQLITE_OK;
+   const auto total = blockids.size();
+   size_t done = 0, nStatements = 0;
+   while (done < total)
+   {
+      if (ownTransactions && sqlite3_get_autocommit(db) &&
+          (rc = sqlite3_exec(db, "BEGIN;", nullptr, nullptr, nullptr))
+             != SQLITE_OK)
+         return rc;
+
+      const auto count = std::min(BlocksPerStatement, total - done);
+      auto &stmt = statements[count];
+      if ((rc = prepare(count, stmt)) != SQLITE_OK)
+         return rc;
+      for (size_t ii = 0; ii < count; ++ii)
+         if ((rc = sqlite3_bind_int64(stmt, ii + 1, blockids[done + ii]))
+             != SQLITE_OK)
+            return rc;
+      rc = sqlite3_step(stmt);
+      sqlite3_reset(stmt);
+      if (rc != SQLITE_DONE)
+         return rc;
+      done += count;
+
+      if (ownTransactions &&
+          (++nStatements % StatementsPerTransaction == 0 || done == total) &&
+          (rc = sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr))
+             != SQLITE_OK)
+         return rc;
+
+      if (progress && !progress(done, total))
+         return SQLITE_INTERRUPT;
+   }
+
+   return SQLITE_OK;
+}
+
+namespace
+{
+// Share the storage of a file with a new one, in constant time, where the
+// file system can; destpath must not exist
+bool CloneFile(const char *srcpath, const char *destpath)
+{
+#if defined(__linux__)
+   const int src = open(srcpath, O_RDONLY | O_CLOEXEC);
+   if (src < 0)
+      return false;
+   auto closeSrc = finally([&] { close(src); });
+
+   const int dest =
+      open(destpath, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+   if (dest < 0)
+      return false;
+
+   bool cloned = false;
+   auto closeDest = finally([&] {
+      close(dest);
+      if (!cloned)
+         unlink(destpath);
+   });
+
+   struct stat srcStat, destStat;
+   if (fstat(src, &srcStat) != 0 || fstat(dest, &destStat) != 0 ||
+       srcStat.st_dev != destStat.st_dev)
+      return false;
+
+#ifdef FICLONE
+   // Share all extents of the file, as btrfs and xfs can.  Other file
+   // systems would copy all the data here, before the caller can show
+   // progress, so they are left to the copy of rows, which can.
+   if (ioctl(dest, FICLONE, src) == 0)
+      return cloned = true;
+#endif
+   return false;
+#elif defined(__APPLE__)
+   // Fails for another volume or for a file system other than APFS
+   return clonefile(srcpath, destpath, 0) == 0;
+#else
+   return false;
+#endif
+}
+}
+
+bool DBConnection::CloneDatabaseFile(sqlite3 *db, const std::string &destpath)
+{
+   // The file alone holds the whole database only outside of transactions,
+   // and when the log is checkpointed into it
+   if (!sqlite3_get_autocommit(db))
+      return false;
+
+   const char *srcpath = sqlite3_db_filename(db, "main");
+   if (!srcpath || !*srcpath)
+      return false;
+
+   // Does nothing if the database is not in WAL mode
+   int logFrames = 0, checkpointedFrames = 0;
+   if (sqlite3_wal_checkpoint_v2(db, "main", SQLITE_CHECKPOINT_TRUNCATE,
+          &logFrames, &checkpointedFrames) != SQLITE_OK)
+      return false;
+
+   return CloneFile(srcpath, destpath.c_str());
+}
+
+bool DBConnection::DeferWrite(DeferredWrite write)
+{
+   std::unique_lock<std::mutex> lock(mWriterMutex);
+
+   if (!mWriterThread.joinable())
+   {
+      // First use; the writer gets its own connection, like the checkpointer
+      const char *name = sqlite3_db_filename(mDB, "main");
+      if (!name || !*name)
+         return false;
+
+      int rc = sqlite3_open(name, &mWriterDB);
+      if (rc == SQLITE_OK)
+         rc = ModeConfig(mWriterDB, "main", SafeConfig);
+      if (rc != SQLITE_OK)
+      {
+         ADD_EXCEPTION_CONTEXT("sqlite3.rc", std::to_string(rc));
+         ADD_EXCEPTION_CONTEXT("sqlite3.context", "DBConnection::DeferWrite::open");
+
+         wxLogMessage("Failed to open writer connection to %s: %d, %s\n",
+            name,
+            rc,
+            sqlite3_errstr(rc));
+
+         sqlite3_close(mWriterDB);
+         mWriterDB = nullptr;
+         ThrowException( true );
+      }
+
+      // Commits on this connection also grow the WAL
+      sqlite3_wal_hook(mWriterDB, CheckpointHook, this);
+
+      auto db = mWriterDB;
+      mWriterThread = std::thread([this, db]{ WriterThread(db); });
+   }
+
+   mWriterProgress.wait(lock, [this]{
+      return mWriterRC != SQLITE_OK ||
+         mDeferredWrites.size() < MaxDeferredWrites;
+   });
+   if (mWriterRC != SQLITE_OK)
+      ThrowException( true );
+
+   mDeferredWrites.push_back(std::move(write));
+   mWriterCondition.notify_one();
+   return true;
+}
+
+void DBConnection::FlushDeferredWrites()
+{
+   std::unique_lock<std::mutex> lock(mWriterMutex);
+
+   if (mWriterRC != SQLITE_OK)
+   {
+      // Try again what failed before
+      mWriterRC = SQLITE_OK;
+      mWriterCondition.notify_one();
+   }
+
+   mWriterProgress.wait(lock, [this]{
+      return mWriterRC != SQLITE_OK || !mWriterThread.joinable() ||
+         (mDeferredWrites.empty() && mWritingOwners.empty());
+   });
+   if (mWriterRC != SQLITE_OK)
+      ThrowException( true );
+}
+
+bool DBConnection::CancelDeferredWrite(const void *owner)
+{
+   std::unique_lock<std::mutex> lock(mWriterMutex);
+
+   // If the write is under way, let it finish, successfully or not
+   mWriterProgress.wait(lock, [&]{
+      return end(mWritingOwners) ==
+         std::find(begin(mWritingOwners), end(mWritingOwners), owner);
+   });
+
+   const auto oldEnd = mDeferredWrites.end();
+   const auto newEnd = std::remove_if(mDeferredWrites.begin(), oldEnd,
+      [owner](const DeferredWrite &write){ return write.owner == owner; });
+   if (newEnd == oldEnd)
+      return false;
+   mDeferredWrites.erase(newEnd, oldEnd);
+   mWriterProgress.notify_all();
+   return true;
+}
+
+int DBConnection::WriteBatch(sqlite3 *db, std::vector<DeferredWrite> &batch)
+{
+   // One transaction, and so one sync of the WAL, for all of the batch
+   int rc = sqlite3_exec(db, "BEGIN IMMEDIATE;", nullptr, nullptr, nullptr);
+   for (auto iter = batch.begin(); rc == SQLITE_OK && iter != batch.end();
+        ++iter)
+      rc = iter->write(db);
+   if (rc == SQLITE_OK)
+      rc = sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+
+   if (rc != SQLITE_OK)
+   {
+      wxLogMessage("Failed deferred writes to %s\n"
+                   "\tError: %s\n",
+                   sqlite3_db_filename(db, nullptr),
+                   sqlite3_errmsg(db));
+
+      // Harmless if the transaction did not begin
+      sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+      return rc;
+   }
+
+   for (auto &write : batch)
+      if (write.committed)
+         write.committed();
+
+   return rc;
+}
+
+void DBConnection::WriterThread(sqlite3 *db)
+{
+   std::unique_lock<std::mutex> lock(mWriterMutex);
+
+   while (true)
+   {
+      // Wait for work or the stop signal; after a failure, wait for a retry
+      mWriterCondition.wait(lock, [this]{
+         return mWriterStop ||
+            (mWriterRC == SQLITE_OK && !mDeferredWrites.empty());
+      });
+
+      // Requested to stop, and nothing more to do
+      if (mWriterRC != SQLITE_OK || mDeferredWrites.empty())
+         break;
+
+      // Take everything queued so far
+      std::vector<DeferredWrite> batch(
+         std::make_move_iterator(mDeferredWrites.begin()),
+         std::make_move_iterator(mDeferredWrites.end()));
+      mDeferredWrites.clear();
+      for (const auto &write : batch)
+         mWritingOwners.push_back(write.owner);
+      // There is room in the queue again
+      mWriterProgress.notify_all();
+
+      lock.unlock();
+      const auto rc = WriteBatch(db, batch);
+      lock.lock();
+
+      mWritingOwners.clear();
+      if (rc != SQLITE_OK)
+      {
+         // Keep the writes, in order, for another try
+         mDeferredWrites.insert(mDeferredWrites.begin(),
+            std::make_move_iterator(batch.begin()),
+            std::make_move_iterator(batch.end()));
+         mWriterRC = rc;
+      }
+      mWriterProgress.notify_all();
+   }
+}
+
+void DBConnection::StopWriter()
+{
+   if (!mWriterThread.joinable())
+      return;
+
+   // Tell the writer thread to finish, giving any failed writes another try
+   {
+      std::lock_guard<std::mutex> guard(mWriterMutex);
+      mWriterRC = SQLITE_OK;
+      mWriterStop = true;
+      mWriterCondition.notify_one();
+   }
+
+   // And wait for it to do so
+   mWriterThread.join();
+
+   std::lock_guard<std::mutex> guard(mWriterMutex);
+   if (!mDeferredWrites.empty())
+   {
+      wxLogMessage("Discarding %lu deferred writes to %s\n",
+                   static_cast<unsigned long>(mDeferredWrites.size()),
+                   sqlite3_db_filename(mWriterDB, nullptr));
+      mDeferredWrites.clear();
+   }
+   mWriterRC = SQLITE_OK;
+   mWriterStop = false;
+   // Wake anyone still waiting for room or for a flush
+   mWriterProgress.notify_all();
+
+   sqlite3_close(mWriterDB);
+   mWriterDB = nullptr;
+}
+
 // Install an implementation of TransactionScope
 #include "TransactionScope.h"
 
@@ -14,11 +14,16 @@ Paul Licameli -- split from ProjectFileIO.h
 
 #include <atomic>
 #include <condition_variable>
+#include <deque>
 #include <functional>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <optional>
+#include <string>
 #include <thread>
+#include <unordered_map>
+#include <vector>
 
 #include "ClientData.h"
 #include "Identifier.h"
@@ -62,6 +67,11 @@ public:
    int SafeMode(const char *schema = "main");
    int FastMode(const char* schema = "main");
    int SetPageSize(const char* schema = "main");
+   //! Let SQLite read the file through a memory map, if the preference
+   //! enables it
+   int MemoryMapMode(const char* schema = "main");
+   //! Whether MemoryMapMode() succeeded for the main schema
+   bool IsMemoryMapped() const;
 
    bool Assign(sqlite3 *handle);
    sqlite3 *Detach();
@@ -74,6 +84,7 @@ public:
    enum StatementID
    {
       GetSamples,
+      GetSamplesBatch,
       GetSummary256,
       GetSummary64k,
       LoadSampleBlock,
@@ -87,6 +98,91 @@ public:
    void SetBypass( bool bypass );
    bool ShouldBypass();
 
+   //! @return a number for a new row of sampleblocks, that no row has
+   //! ever had in this database
+   long long ReserveBlockID();
+
+   //! Columns of a row of sampleblocks, other than summaries and samples
+   struct SampleBlockMetadata
+   {
+      int sampleFormat;
+      double sumMin;
+      double sumMax;
+      double sumRms;
+      int sampleBytes;
+   };
+   using SampleBlockMetadataMap =
+      std::unordered_map<long long, SampleBlockMetadata>;
+
+   //! Read the metadata of all rows of sampleblocks in one scan of the table
+   /*! @return false if the query fails */
+   static bool
+   ReadSampleBlockMetadata(sqlite3 *db, SampleBlockMetadataMap &result);
+
+   //! Hold the metadata of all sample blocks for TakeSampleBlockMetadata(),
+   //! before creating many blocks, as when loading a project
+   /*! Failure is not an error; blocks are then loaded one at a time.
+    Does nothing when LazyProjectOpen is set */
+   void PreloadSampleBlockMetadata();
+   //! Free the preloaded metadata that was not taken
+   void DiscardSampleBlockMetadata();
+   //! Remove the preloaded metadata of a block and return it, if there is any
+   std::optional<SampleBlockMetadata> TakeSampleBlockMetadata(long long id);
+
+   //! Called with the counts of rows copied and to copy; returns false to
+   //! cancel
+   using CopyProgress = std::function<bool(size_t done, size_t total)>;
+
+   //! Copy rows of sampleblocks from the main database into the same table
+   //! of another attached one
+   /*!
+    Rows are copied in order of id, many in each statement, and many
+    statements in each transaction unless the caller has one open
+    @return an sqlite result code; SQLITE_INTERRUPT if progress cancelled
+    */
+   static int CopySampleBlocks(sqlite3 *db, const char *schema,
+      std::vector<long long> blockids, const CopyProgress &progress = {});
+
+   //! Copy the file of the main database by sharing its storage (reflink,
+   //! or clonefile on macOS), which takes no time proportional to its size
+   /*!
+    @pre no other connection writes to the database meanwhile
+    @return false, leaving no file, if the file system can't share storage,
+    if the destination exists or is on another file system, or if there is
+    an open transaction or the write-ahead log can't be checkpointed into
+    the file
+    */
+   static bool CloneDatabaseFile(sqlite3 *db, const std::string &destpath);
+
+   //! Work for the writer thread, done on its own connection in one
+   //! transaction with whatever else was queued
+   struct DeferredWrite
+   {
+      //! Identifies writes for CancelDeferredWrite()
+      const void *owner;
+      //! Must not throw; returns an sqlite result code
+      std::function<int(sqlite3 *db)> write;
+      //! Called in the writer thread after the transaction commits
+      std::function<void()> committed;
+   };
+
+   //! Queue a write for the writer thread, waiting while the queue is full
+   /*!
+    @return false, queuing nothing, if the database has no file to be opened
+    again by the writer thread
+    @throws FileException if an earlier deferred write failed
+    */
+   bool DeferWrite(DeferredWrite write);
+
+   //! Wait until the writer thread has committed all queued writes
+   /*! @throws FileException if a deferred write failed, which is retried
+    first */
+   void FlushDeferredWrites();
+
+   //! Remove queued writes of owner, waiting if one is being written
+   /*! @return whether a write was removed before it was done */
+   bool CancelDeferredWrite(const void *owner);
+
    //! Just set stored errors
    void SetError(
       const TranslatableString &msg,
@@ -106,6 +202,11 @@ private:
    void CheckpointThread(sqlite3 *db, const FilePath &fileName);
    static int CheckpointHook(void *data, sqlite3 *db, const char *schema, int pages);
 
+   int WriteBatch(sqlite3 *db, std::vector<DeferredWrite> &batch);
+   void WriterThread(sqlite3 *db);
+   //! Stop the writer thread, after it does what it can
+   void StopWriter();
+
 private:
    std::weak_ptr<AudacityProject> mpProject;
    sqlite3 *mDB;
@@ -118,6 +219,26 @@ private:
    std::atomic_bool mCheckpointPending{ false };
    std::atomic_bool mCheckpointActive{ false };
 
+   sqlite3 *mWriterDB{};
+   std::thread mWriterThread;
+   std::mutex mWriterMutex;
+   //! Wakes the writer thread
+   std::condition_variable mWriterCondition;
+   //! Wakes threads waiting for the writer to make progress
+   std::condition_variable mWriterProgress;
+   std::deque<DeferredWrite> mDeferredWrites;
+   //! Owners of the writes that the writer thread has taken from the queue
+   std::vector<const void *> mWritingOwners;
+   //! Result code of the last failed batch, which remains queued
+   int mWriterRC{ 0 };
+   bool mWriterStop{ false };
+
+   std::mutex mBlockIDMutex;
+   long long mNextBlockID{ 0 };
+
+   std::mutex mPreloadMutex;
+   SampleBlockMetadataMap mPreloadedMetadata;
+
    std::mutex mStatementMutex;
    using StatementIndex = std::pair<enum StatementID, std::thread::id>;
    std::map<StatementIndex, sqlite3_stmt *> mStatements;
@@ -127,6 +248,8 @@ private:
 
    // Bypass transactions if database will be deleted after close
    bool mBypass;
+
+   bool mMemoryMapped{ false };
 };
 
 using Connection = std::unique_ptr<DBConnection>;
@@ -21,6 +21,7 @@ Paul Licameli split from AudacityProject.cpp
 #include <wx/utils.h>
 
 #include "ActiveProjects.h"
+#include "AutoSaveDelta.h"
 #include "CodeConversions.h"
 #include "DBConnection.h"
 #include "FileNames.h"
@@ -124,7 +125,8 @@ static const char *ProjectFileSchema =
    // CREATE SQL autosave
    // autosave is a binary representation of an XML file.
    // it's in binary for speed.
-   // One instance only.  id is always 1.
+   // One full document with id 1, and optionally one row with id 2 that
+   // holds a delta against it (see AutoSaveDelta).
    // dict is a dictionary of fieldnames.
    // doc is the binary representation of the XML
    // in the doc, fieldnames are replaced by 2 byte dictionary
@@ -372,6 +374,84 @@ protected:
 
 constexpr std::array<const char*, 2> BufferedProjectBlobStream::Columns;
 
+//! Reads the contents of memory streams, one after another
+class BufferedMemoryStream final : public BufferedStreamReader
+{
+public:
+   BufferedMemoryStream(std::vector<const MemoryStream*> streams)
+       : BufferedStreamReader(32 * 1024)
+       , mStreams(std::move(streams))
+   {
+      for (auto pStream : mStreams)
+         mSize += pStream->GetSize();
+   }
+
+protected:
+   bool HasMoreData() const override
+   {
+      return mOffset < mSize;
+   }
+
+   size_t ReadData(void* buffer, size_t maxBytes) override
+   {
+      while (mNextStream < mStreams.size())
+      {
+         auto& stream = *mStreams[mNextStream];
+         const auto available = stream.GetSize() - mStreamOffset;
+         if (available == 0)
+         {
+            ++mNextStream;
+            mStreamOffset = 0;
+            continue;
+         }
+         const auto bytes = std::min(maxBytes, available);
+         std::memcpy(buffer,
+            static_cast<const uint8_t*>(stream.GetData()) + mStreamOffset,
+            bytes);
+         mStreamOffset += bytes;
+         mOffset += bytes;
+         return bytes;
+      }
+      return 0;
+   }
+
+private:
+   const std::vector<const MemoryStream*> mStreams;
+   size_t mNextStream { 0 };
+   size_t mStreamOffset { 0 };
+   size_t mOffset { 0 };
+   size_t mSize { 0 };
+};
+
+BoolSetting LazyProjectOpen{ L"/Performance/LazyProjectOpen", false };
+
+//! Row of the autosave table holding the delta against the full document
+constexpr int AutoSaveDeltaId = 2;
+
+//! Earlier versions recover only the full autosave document, losing the
+//! edits in a delta; so they must not open a project file that has one
+constexpr ProjectFormatVersion AutoSaveDeltaFormatVersion = { 3, 6, 0, 0 };
+
+namespace {
+bool ReadBlob(sqlite3* db, const char* column, int64_t rowID, MemoryStream& out)
+{
+   auto blobStream =
+      SQLiteBlobStream::Open(db, "main", "autosave", column, rowID, true);
+   if (!blobStream)
+      return false;
+
+   std::vector<char> buffer(64 * 1024);
+   while (!blobStream->IsEof())
+   {
+      auto bytes = static_cast<int>(buffer.size());
+      if (blobStream->Read(buffer.data(), bytes) != SQLITE_OK)
+         return false;
+      out.AppendData(buffer.data(), bytes);
+   }
+   return true;
+}
+}
+
 bool ProjectFileIO::InitializeSQL()
 {
    if (audacity::sqlite::Initialize().IsError())
@@ -789,15 +869,19 @@ bool ProjectFileIO::CheckVersion()
    return true;
 }
 
-bool ProjectFileIO::InstallSchema(sqlite3 *db, const char *schema /* = "main" */)
+wxString ProjectFileIO::SchemaSQL(const char *schema /* = "main" */)
 {
-   int rc;
-
    wxString sql;
    sql.Printf(ProjectFileSchema, ProjectFileID, BaseProjectFormatVersion.GetPacked());
    sql.Replace("<schema>", schema);
+   return sql;
+}
 
-   rc = sqlite3_exec(db, sql, nullptr, nullptr, nullptr);
+bool ProjectFileIO::InstallSchema(sqlite3 *db, const char *schema /* = "main" */)
+{
+   int rc;
+
+   rc = sqlite3_exec(db, SchemaSQL(schema), nullptr, nullptr, nullptr);
    if (rc != SQLITE_OK)
    {
       SetDBError(
@@ -925,6 +1009,9 @@ bool ProjectFileIO::CopyTo(const FilePath &destpath,
    if (!pConn)
       return false;
 
+   // Blocks still queued for the writer thread must be copied too
+   pConn->FlushDeferredWrites();
+
    // Get access to the active tracklist
    auto pProject = &mProject;
 
@@ -937,22 +1024,6 @@ bool ProjectFileIO::CopyTo(const FilePath &destpath,
          if (trackList)
             WaveTrackUtilities::InspectBlocks(*trackList, {}, &blockids);
    }
-   // Collect ALL blockids
-   else
-   {
-      auto cb = [&blockids](int cols, char **vals, char **){
-         SampleBlockID blockid;
-         wxString{ vals[0] }.ToLongLong(&blockid);
-         blockids.insert(blockid);
-         return 0;
-      };
-
-      if (!Query("SELECT blockid FROM sampleblocks;", cb))
-      {
-         // Error message already captured.
-         return false;
-      }
-   }
 
    // Create the project doc
    ProjectSerializer doc;
@@ -1004,6 +1075,28 @@ bool ProjectFileIO::CopyTo(const FilePath &destpath,
       }
    });
 
+   // When keeping all blocks, the copy is the whole file but for its
+   // documents; let the file system clone it if it can
+   const bool cloned = !prune &&
+      DBConnection::CloneDatabaseFile(db, destpath.ToUTF8().data());
+
+   // Collect ALL blockids
+   if (!prune && !cloned)
+   {
+      auto cb = [&blockids](int cols, char **vals, char **){
+         SampleBlockID blockid;
+         wxString{ vals[0] }.ToLongLong(&blockid);
+         blockids.insert(blockid);
+         return 0;
+      };
+
+      if (!Query("SELECT blockid FROM sampleblocks;", cb))
+      {
+         // Error message already captured.
+         return false;
+      }
+   }
+
    // Attach the destination database 
    wxString sql;
    wxString dbName = destpath;
@@ -1041,104 +1134,65 @@ bool ProjectFileIO::CopyTo(const FilePath &destpath,
    }
 
    {
-      // Ensure statement gets cleaned up
-      sqlite3_stmt *stmt = nullptr;
-      auto cleanup = finally([&]
-      {
-         if (stmt)
-         {
-            // No need to check return code
-            sqlite3_finalize(stmt);
-         }
-      });
-
-      // Prepare the statement only once
-      rc = sqlite3_prepare_v2(db,
-                              "INSERT INTO outbound.sampleblocks"
-                              "  SELECT * FROM main.sampleblocks"
-                              "  WHERE blockid = ?;",
-                              -1,
-                              &stmt,
-                              nullptr);
-      if (rc != SQLITE_OK)
-      {
-         ADD_EXCEPTION_CONTEXT("sqlite3.rc", std::to_string(rc));
-         ADD_EXCEPTION_CONTEXT(
-            "sqlite3.context", "ProjectGileIO::CopyTo.prepare");
-
-         SetDBError(
-            XO("Unable to prepare project file command:\n\n%s").Format(sql)
-         );
-         return false;
-      }
-
       /* i18n-hint: This title appears on a dialog that indicates the progress
          in doing something.*/
       auto progress =
          BasicUI::MakeProgress(XO("Progress"), msg, ProgressShowCancel);
-      ProgressResult result = ProgressResult::Success;
-
-      wxLongLong_t count = 0;
-      wxLongLong_t total = blockids.size();
 
-      // Start a transaction.  Since we're running without a journal,
-      // this really doesn't provide rollback.  It just prevents SQLite
-      // from auto committing after each step through the loop.
-      //
-      // Also note that we will have an open transaction if we fail
-      // while copying the blocks. This is fine since we're just going
-      // to delete the database anyway.
-      sqlite3_exec(db, "BEGIN;", nullptr, nullptr, nullptr);
-
-      // Copy sample blocks from the main DB to the outbound DB
-      for (auto blockid : blockids)
+      if (!cloned)
       {
-         // Bind statement parameters
-         rc = sqlite3_bind_int64(stmt, 1, blockid);
+         // Copy sample blocks from the main DB to the outbound DB, in
+         // batches, polling for cancellation between them.
+         //
+         // Note that we may leave committed blocks behind if we fail while
+         // copying them. This is fine since we're just going to delete the
+         // database anyway.
+         sql = "INSERT INTO outbound.sampleblocks"
+               "  SELECT * FROM main.sampleblocks;";
+         rc = DBConnection::CopySampleBlocks(db, "outbound",
+            { blockids.begin(), blockids.end() },
+            [&](size_t count, size_t total) {
+               // Note that we're not setting success if cancelled, so the
+               // finally block above will take care of cleaning up
+               return progress->Poll(count, total) == ProgressResult::Success;
+            });
+         if (rc == SQLITE_INTERRUPT)
+            return false;
          if (rc != SQLITE_OK)
          {
             ADD_EXCEPTION_CONTEXT("sqlite3.rc", std::to_string(rc));
             ADD_EXCEPTION_CONTEXT(
-               "sqlite3.context", "ProjectGileIO::CopyTo.bind");
+               "sqlite3.context", "ProjectGileIO::CopyTo.step");
 
             SetDBError(
-               XO("Failed to bind SQL parameter")
+               XO("Failed to update the project file.\nThe following command failed:\n\n%s").Format(sql)
             );
-
             return false;
          }
+      }
 
-         // Process it
-         rc = sqlite3_step(stmt);
-         if (rc != SQLITE_DONE)
+      // Start a transaction.  Since we're running without a journal,
+      // this really doesn't provide rollback.  It just lets the documents
+      // be replaced at once.
+      sqlite3_exec(db, "BEGIN;", nullptr, nullptr, nullptr);
+
+      // The clone has the documents of this project, which are replaced
+      if (cloned)
+      {
+         sql = "DELETE FROM outbound.project;"
+               "DELETE FROM outbound.autosave;";
+         rc = sqlite3_exec(db, sql, nullptr, nullptr, nullptr);
+         if (rc != SQLITE_OK)
          {
             ADD_EXCEPTION_CONTEXT("sqlite3.rc", std::to_string(rc));
             ADD_EXCEPTION_CONTEXT(
-               "sqlite3.context", "ProjectGileIO::CopyTo.step");
+               "sqlite3.context", "ProjectGileIO::CopyTo.delete");
 
             SetDBError(
                XO("Failed to update the project file.\nThe following command failed:\n\n%s").Format(sql)
             );
             return false;
          }
-
-         // Reset statement to beginning
-         if (sqlite3_reset(stmt) != SQLITE_OK)
-         {
-            ADD_EXCEPTION_CONTEXT("sqlite3.rc", std::to_string(rc));
-            ADD_EXCEPTION_CONTEXT(
-               "sqlite3.context", "ProjectGileIO::CopyTo.reset");
-
-            THROW_INCONSISTENCY_EXCEPTION;
-         }
-
-         result = progress->Poll(++count, total);
-         if (result != ProgressResult::Success)
-         {
-            // Note that we're not setting success, so the finally
-            // block above will take care of cleaning up
-            return false;
-         }
       }
 
       // Write the doc.
@@ -1616,6 +1670,10 @@ void ProjectFileIO::SetFileName(const FilePath &fileName)
       ActiveProjects::Remove(mFileName);
    }
 
+   // The connection may change with the name; the next autosave must be a
+   // full document
+   mpAutoSaveBase.reset();
+
    mFileName = fileName;
 
    if (!mFileName.empty())
@@ -1744,7 +1802,8 @@ void ProjectFileIO::WriteXMLHeader(XMLWriter &xmlFile) const
 
 void ProjectFileIO::WriteXML(XMLWriter &xmlFile,
                              bool recording /* = false */,
-                             const TrackList *tracks /* = nullptr */)
+                             const TrackList *tracks /* = nullptr */,
+                             const TrackWriteCallback &onTrack /* = {} */)
 // may throw
 {
    auto &proj = mProject;
@@ -1777,8 +1836,12 @@ void ProjectFileIO::WriteXML(XMLWriter &xmlFile,
          // when pushing.  Don't auto-save it.
          return;
       }
+      if (onTrack)
+         onTrack(&t);
       useTrack->WriteXML(xmlFile);
    });
+   if (onTrack)
+      onTrack(nullptr);
 
    xmlFile.EndTag(wxT("project"));
 
@@ -1787,12 +1850,52 @@ void ProjectFileIO::WriteXML(XMLWriter &xmlFile,
 
 bool ProjectFileIO::AutoSave(bool recording)
 {
+   // The document must not name blocks that aren't yet in the database
+   if (auto &pConn = CurrConn())
+      pConn->FlushDeferredWrites();
+
+   // Divide the document into one segment for each track
    ProjectSerializer autosave;
+   AutoSaveDelta::Segments segments;
+   const auto &data = autosave.GetData();
    WriteXMLHeader(autosave);
-   WriteXML(autosave, recording);
+   WriteXML(autosave, recording, nullptr, [&](const Track *pTrack) {
+      if (!segments.empty())
+         segments.back().length = data.GetSize() - segments.back().offset;
+      if (pTrack)
+         segments.push_back({ data.GetSize(), 0 });
+   });
+
+   // Tracks not changed since the last full document need not be written
+   // again; but write a full document again when the delta grows too large
+   if (mpAutoSaveBase)
+   {
+      MemoryStream delta;
+      const auto literalBytes =
+         mpAutoSaveBase->Encode(data, segments, delta);
+      if (literalBytes <= mpAutoSaveBase->GetBaseSize() / 2)
+      {
+         if (!WriteDoc("autosave", autosave.GetDict(), delta, AutoSaveDeltaId))
+            return false;
+         mModified = true;
+         return true;
+      }
+   }
+
+   mpAutoSaveBase.reset();
 
-   if (WriteDoc("autosave", autosave))
+   TransactionScope transaction(mProject, "AutoSave");
+
+   // Remove the delta against the previous full document
+   char sql[256];
+   sqlite3_snprintf(sizeof(sql), sql,
+      "DELETE FROM main.autosave WHERE id = %d;", AutoSaveDeltaId);
+   if (!Query(sql, [](auto...) { return 0; }))
+      return false;
+
+   if (WriteDoc("autosave", autosave) && transaction.Commit())
    {
+      mpAutoSaveBase = std::make_unique<AutoSaveDelta>(data, segments);
       mModified = true;
       return true;
    }
@@ -1822,6 +1925,7 @@ bool ProjectFileIO::AutoSaveDelete(sqlite3 *db /* = nullptr */)
    }
 
    mModified = false;
+   mpAutoSaveBase.reset();
 
    return true;
 }
@@ -1829,6 +1933,15 @@ bool ProjectFileIO::AutoSaveDelete(sqlite3 *db /* = nullptr */)
 bool ProjectFileIO::WriteDoc(const char *table,
                              const ProjectSerializer &autosave,
                              const char *schema /* = "main" */)
+{
+   return WriteDoc(table, autosave.GetDict(), autosave.GetData(), 1, schema);
+}
+
+bool ProjectFileIO::WriteDoc(const char *table,
+                             const MemoryStream &dict,
+                             const MemoryStream &data,
+                             int id,
+                             const char *schema /* = "main" */)
 {
    auto db = DB();
 
@@ -1836,14 +1949,14 @@ bool ProjectFileIO::WriteDoc(const char *table,
 
    int rc;
 
-   // For now, we always use an ID of 1. This will replace the previously
-   // written row every time.
+   // Documents use an ID of 1, and autosave deltas AutoSaveDeltaId.  This
+   // will replace the previously written row every time.
    char sql[256];
    sqlite3_snprintf(
       sizeof(sql), sql,
-      "INSERT INTO %s.%s(id, dict, doc) VALUES(1, ?1, ?2)"
+      "INSERT INTO %s.%s(id, dict, doc) VALUES(%d, ?1, ?2)"
       "       ON CONFLICT(id) DO UPDATE SET dict = ?1, doc = ?2;",
-      schema, table);
+      schema, table, id);
 
    sqlite3_stmt *stmt = nullptr;
    auto cleanup = finally([&]
@@ -1867,9 +1980,6 @@ bool ProjectFileIO::WriteDoc(const char *table,
       return false;
    }
 
-   const MemoryStream& dict = autosave.GetDict();
-   const MemoryStream& data = autosave.GetData();
-
    // Bind statement parameters
    // Might return SQL_MISUSE which means it's our mistake that we violated
    // preconditions; should return SQL_OK which is 0
@@ -1911,8 +2021,8 @@ bool ProjectFileIO::WriteDoc(const char *table,
 
    int64_t rowID = 0;
 
-   const wxString rowIDSql =
-      wxString::Format("SELECT ROWID FROM %s.%s WHERE id = 1;", schema, table);
+   const wxString rowIDSql = wxString::Format(
+      "SELECT ROWID FROM %s.%s WHERE id = %d;", schema, table, id);
 
    if (!GetValue(rowIDSql, rowID, true))
    {
@@ -1973,8 +2083,12 @@ bool ProjectFileIO::WriteDoc(const char *table,
    if (!writeStream("doc", data))
       return false;
 
-   const auto requiredVersion =
+   auto requiredVersion =
       ProjectFormatExtensionsRegistry::Get().GetRequiredVersion(mProject);
+   // Writing the next full autosave document removes the delta, and lowers
+   // the version again
+   if (id == AutoSaveDeltaId && requiredVersion < AutoSaveDeltaFormatVersion)
+      requiredVersion = AutoSaveDeltaFormatVersion;
 
    const wxString setVersionSql =
       wxString::Format("PRAGMA user_version = %u", requiredVersion.GetPacked());
@@ -2065,11 +2179,26 @@ auto ProjectFileIO::LoadProject(const FilePath &fileName, bool ignoreAutosave)
       return {};
    else
    {
+      // Read the metadata of all sample blocks in one query, rather than
+      // one query for each block named in the document
+      auto &pConn = CurrConn();
+      pConn->PreloadSampleBlockMetadata();
+      auto discard =
+         finally([&pConn] { pConn->DiscardSampleBlockMetadata(); });
+
       // Load 'er up
-      BufferedProjectBlobStream stream(
-         DB(), "main", useAutosave ? "autosave" : "project", rowId);
+      int64_t deltaRowId = -1;
+      const wxString deltaSql = wxString::Format(
+         "SELECT ROWID FROM main.autosave WHERE id = %d;", AutoSaveDeltaId);
+      if (useAutosave && GetValue(deltaSql, deltaRowId, true))
+         success = LoadAutoSaveDelta(rowId, deltaRowId);
+      else
+      {
+         BufferedProjectBlobStream stream(
+            DB(), "main", useAutosave ? "autosave" : "project", rowId);
 
-      success = ProjectSerializer::Decode(stream, this);
+         success = ProjectSerializer::Decode(stream, this);
+      }
 
       if (!success)
       {
@@ -2125,6 +2254,27 @@ auto ProjectFileIO::LoadProject(const FilePath &fileName, bool ignoreAutosave)
    return result;
 }
 
+bool ProjectFileIO::LoadAutoSaveDelta(int64_t baseRowId, int64_t deltaRowId)
+{
+   // The delta was written with the newer dictionary, which extends that of
+   // the full document
+   MemoryStream base, dict, delta, doc;
+   if (!ReadBlob(DB(), "doc", baseRowId, base) ||
+       !ReadBlob(DB(), "dict", deltaRowId, dict) ||
+       !ReadBlob(DB(), "doc", deltaRowId, delta))
+      return false;
+
+   if (!AutoSaveDelta::Apply(base.GetData(), base.GetSize(),
+      delta.GetData(), delta.GetSize(), doc))
+   {
+      wxLogMessage("Autosave delta does not match the full document");
+      return false;
+   }
+
+   BufferedMemoryStream stream({ &dict, &doc });
+   return ProjectSerializer::Decode(stream, this);
+}
+
 bool ProjectFileIO::UpdateSaved(const TrackList *tracks)
 {
    ProjectSerializer doc;
@@ -2153,6 +2303,9 @@ bool ProjectFileIO::UpdateSaved(const TrackList *tracks)
 bool ProjectFileIO::SaveProject(
    const FilePath &fileName, const TrackList *lastSaved)
 {
+   if (auto &pConn = CurrConn())
+      pConn->FlushDeferredWrites();
+
    // In the case where we're saving a temporary project to a permanent project,
    // we'll try to simply rename the project to save a bit of time. We then fall
    // through to the normal Save (not SaveAs) processing.
@@ -28,10 +28,13 @@ struct sqlite3_stmt;
 struct sqlite3_value;
 
 class AudacityProject;
+class AutoSaveDelta;
 class DBConnection;
 struct DBConnectionErrors;
 class ProjectSerializer;
+class MemoryStream;
 class SqliteSampleBlock;
+class Track;
 class TrackList;
 class WaveTrack;
 
@@ -46,6 +49,18 @@ using Connection = std::unique_ptr<DBConnection>;
 
 using BlockIDs = std::unordered_set<SampleBlockID>;
 
+//! Whether sample blocks named in a project document read their rows only
+//! when first painted, played or edited, so that opening a project takes time
+//! in proportion to what is used
+/*!
+ The cost is that a missing or unreadable row no longer fails the opening of
+ the project.  It is found when the block is first used:  the user is told in
+ idle time, and reads that may not throw, as in playback, give silence.  A
+ row holding other than the count of samples that the sequence implies is
+ logged, and the count of the sequence is kept.
+ */
+extern PROJECT_FILE_IO_API BoolSetting LazyProjectOpen;
+
 //! Subscribe to ProjectFileIO to receive messages; always in idle time
 enum class ProjectFileIOMessage : int {
    CheckpointFailure,   //!< Failure happened in a worker thread
@@ -84,6 +99,10 @@ public:
    // class.  Reinvocations have no effect.  Return value is true for success.
    static bool InitializeSQL();
 
+   //! The statements that create the tables of a project file, and stamp
+   //! its version, in the given attached database
+   static wxString SchemaSQL(const char *schema = "main");
+
    static ProjectFileIO &Get( AudacityProject &project );
    static const ProjectFileIO &Get( const AudacityProject &project );
 
@@ -231,9 +250,14 @@ public:
 private:
    void OnCheckpointFailure();
 
+   //! Called with each track before it is written, then with null after the
+   //! last
+   using TrackWriteCallback = std::function<void(const Track *)>;
+
    void WriteXMLHeader(XMLWriter &xmlFile) const;
    void WriteXML(XMLWriter &xmlFile, bool recording = false,
-      const TrackList *tracks = nullptr) /* not override */;
+      const TrackList *tracks = nullptr,
+      const TrackWriteCallback &onTrack = {}) /* not override */;
 
    // XMLTagHandler callback methods
    bool HandleXMLTag(const std::string_view& tag, const AttributesList &attrs) override;
@@ -274,6 +298,13 @@ private:
 
    // Write project or autosave XML (binary) documents
    bool WriteDoc(const char *table, const ProjectSerializer &autosave, const char *schema = "main");
+   //! Write the row with the given id; doc need not be a ProjectSerializer's
+   bool WriteDoc(const char *table, const MemoryStream &dict,
+      const MemoryStream &doc, int id, const char *schema = "main");
+
+   //! Reconstruct the autosave document from the full document and the delta
+   //! in the rows of the autosave table, then parse it
+   bool LoadAutoSaveDelta(int64_t baseRowId, int64_t deltaRowId);
 
    // Application defined function to verify blockid exists is in set of blockids
    static void InSet(sqlite3_context *context, int argc, sqlite3_value **argv);
@@ -320,6 +351,10 @@ private:
    // Has this project been modified
    bool mModified;
 
+   // The last full autosave document written to the current connection,
+   // against which later autosaves may be written as deltas
+   std::unique_ptr<AutoSaveDelta> mpAutoSaveBase;
+
    // Is this project still a temporary/unsaved project
    bool mTemporary;
 
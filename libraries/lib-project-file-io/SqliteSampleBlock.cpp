@@ -11,10 +11,13 @@ Paul Licameli -- split from SampleBlock.cpp and SampleBlock.h
 #include <float.h>
 #include <sqlite3.h>
 
+#include "AudacityException.h"
 #include "BasicUI.h"
 #include "DBConnection.h"
 #include "ProjectFileIO.h"
 #include "SampleFormat.h"
+#include "SampleSummary.h"
+#include "AudioIOSequences.h"
 #include "AudioSegmentSampleView.h"
 #include "XMLTagHandler.h"
 
@@ -24,13 +27,112 @@ Paul Licameli -- split from SampleBlock.cpp and SampleBlock.h
 #include "WaveTrack.h"
 #include "WaveTrackUtilities.h"
 
+#include "Prefs.h"
 #include "SentryHelper.h"
 #include <wx/log.h>
 
+#include <atomic>
+#include <list>
 #include <mutex>
+#include <unordered_map>
 
 class SqliteSampleBlockFactory;
 
+//! Megabytes of decoded samples that each project may keep for reuse
+static IntSetting SampleBlockCacheSize{
+   L"/Performance/SampleBlockCacheSize", 64 };
+
+///\brief Decoded float samples of recently read blocks, shared by all blocks
+/// of one factory, evicting the least recently used under a byte budget
+/*!
+ Views handed out by blocks may outlive eviction from this cache; the cache
+ only decides how long the samples stay alive when nothing else uses them.
+ */
+class SampleBlockCache final
+{
+public:
+   using Samples = std::shared_ptr<std::vector<float>>;
+
+   explicit SampleBlockCache(size_t budget) : mBudget{ budget } {}
+
+   //! @return the cached samples, or null; counts a hit or a miss
+   Samples Find(SampleBlockID id);
+   //! Replaces any previous entry for id and evicts old entries as needed
+   void Insert(SampleBlockID id, Samples pSamples);
+   void Erase(SampleBlockID id);
+
+   SampleBlockCacheStatistics GetStatistics() const;
+
+private:
+   static size_t Bytes(const Samples &pSamples)
+   {
+      return pSamples->size() * sizeof(float);
+   }
+
+   using Entries = std::list<std::pair<SampleBlockID, Samples>>;
+
+   mutable std::mutex mMutex;
+   //! Most recently used first
+   Entries mEntries;
+   std::unordered_map<SampleBlockID, Entries::iterator> mIndex;
+   const size_t mBudget;
+   size_t mBytes{ 0 };
+
+   std::atomic<size_t> mHits{ 0 };
+   std::atomic<size_t> mMisses{ 0 };
+};
+
+auto SampleBlockCache::Find(SampleBlockID id) -> Samples
+{
+   std::lock_guard<std::mutex> lock(mMutex);
+   const auto iter = mIndex.find(id);
+   if (iter == mIndex.end()) {
+      ++mMisses;
+      return {};
+   }
+   ++mHits;
+   // Move to the front
+   mEntries.splice(mEntries.begin(), mEntries, iter->second);
+   return iter->second->second;
+}
+
+void SampleBlockCache::Insert(SampleBlockID id, Samples pSamples)
+{
+   if (!pSamples || Bytes(pSamples) > mBudget)
+      return;
+   std::lock_guard<std::mutex> lock(mMutex);
+   if (const auto iter = mIndex.find(id); iter != mIndex.end()) {
+      mBytes -= Bytes(iter->second->second);
+      mEntries.erase(iter->second);
+      mIndex.erase(iter);
+   }
+   mBytes += Bytes(pSamples);
+   mEntries.emplace_front(id, std::move(pSamples));
+   mIndex[id] = mEntries.begin();
+   while (mBytes > mBudget) {
+      auto &last = mEntries.back();
+      mBytes -= Bytes(last.second);
+      mIndex.erase(last.first);
+      mEntries.pop_back();
+   }
+}
+
+void SampleBlockCache::Erase(SampleBlockID id)
+{
+   std::lock_guard<std::mutex> lock(mMutex);
+   if (const auto iter = mIndex.find(id); iter != mIndex.end()) {
+      mBytes -= Bytes(iter->second->second);
+      mEntries.erase(iter->second);
+      mIndex.erase(iter);
+   }
+}
+
+SampleBlockCacheStatistics SampleBlockCache::GetStatistics() const
+{
+   std::lock_guard<std::mutex> lock(mMutex);
+   return { mHits.load(), mMisses.load(), mBytes, mBudget };
+}
+
 ///\brief Implementation of @ref SampleBlock using Sqlite database
 class SqliteSampleBlock final : public SampleBlock
 {
@@ -54,6 +156,10 @@ public:
    //! Numbers of bytes needed for 256 and for 64k summaries
    using Sizes = std::pair< size_t, size_t >;
    void Commit(Sizes sizes);
+   //! Leave the INSERT to the connection's writer thread, keeping samples
+   //! and summaries in memory until it is committed
+   /*! @return false if the connection can't defer writes */
+   bool DeferCommit(Sizes sizes);
 
    void Delete();
 
@@ -80,10 +186,53 @@ public:
 
    size_t GetSpaceUsage() const override;
    void SaveXML(XMLWriter &xmlFile) override;
+   void SetImpliedSampleCount(size_t count) override;
 
 private:
    bool IsSilent() const { return mBlockID <= 0; }
+   //! Bind parameters of the INSERT statement
+   int BindInsert(sqlite3_stmt *stmt, SampleBlockID id, Sizes sizes);
+   //! The deferred write, done on the writer thread's connection
+   int Insert(sqlite3 *db, Sizes sizes);
+   //! Called on the writer thread after the row is committed
+   void OnCommitted();
+   //! While the row is not yet committed, copy from memory
+   bool ReadPendingSamples(samplePtr dest,
+                           sampleFormat destformat,
+                           size_t sampleoffset,
+                           size_t numsamples);
+   bool GetPendingSummary(float *dest,
+                          size_t frameoffset,
+                          size_t numframes,
+                          const ArrayOf<char> &summary,
+                          size_t summaryBytes);
    void Load(SampleBlockID sbid);
+   //! Load() a block created lazily, if not yet done; safe on any thread
+   void Materialize() const;
+   //! Set the sample count from the size of the row, unless a sequence
+   //! already implied it
+   void SetStoredSampleCount();
+   //! Read from the database, bypassing the factory's cache
+   size_t ReadSamples(samplePtr dest,
+                      sampleFormat destformat,
+                      size_t sampleoffset,
+                      size_t numsamples);
+   //! Copy float samples straight out of a memory mapped database into
+   //! dest, without an intermediate statement row
+   /*! @return false if the direct path is unavailable */
+   bool ReadMappedFloats(float *dest,
+                         size_t sampleoffset,
+                         size_t numsamples);
+   //! Satisfy a read of floats from the factory's cache if possible
+   bool ReadCachedSamples(samplePtr dest,
+                          sampleFormat destformat,
+                          size_t sampleoffset,
+                          size_t numsamples);
+   //! Having read all of the block, keep it in the factory's cache
+   void CacheSamples(constSamplePtr src,
+                     sampleFormat srcformat,
+                     size_t sampleoffset,
+                     size_t numsamples);
    bool GetSummary(float *dest,
                    size_t frameoffset,
                    size_t numframes,
@@ -95,6 +244,14 @@ private:
                   sampleFormat srcformat,
                   size_t srcoffset,
                   size_t srcbytes);
+   //! Copy from a blob retrieved from the database, padding with zeroes
+   static void CopyBlob(void *dest,
+                        sampleFormat destformat,
+                        const void *blob,
+                        size_t blobbytes,
+                        sampleFormat srcformat,
+                        size_t srcoffset,
+                        size_t srcbytes);
 
    enum {
       fields = 3, /* min, max, rms */
@@ -115,11 +272,21 @@ private:
    friend SqliteSampleBlockFactory;
 
    const std::shared_ptr<SqliteSampleBlockFactory> mpFactory;
-   bool mValid{ false };
+   //! Whether the fields are read from the database; may become true late
+   //! for blocks created lazily
+   std::atomic<bool> mValid{ false };
+   mutable std::mutex mLoadMutex;
+   //! Whether Materialize() failed and told the user; guarded by mLoadMutex
+   mutable bool mLoadFailed{ false };
    bool mLocked = false;
 
    SampleBlockID mBlockID{ 0 };
 
+   //! Guards the samples and summaries while the row is not yet committed
+   std::mutex mPendingMutex;
+   std::atomic<bool> mPending{ false };
+   Sizes mPendingSizes;
+
    ArrayOf<char> mSamples;
    size_t mSampleBytes;
    size_t mSampleCount;
@@ -169,6 +336,15 @@ public:
    SampleBlockPtr DoCreateFromId(
       sampleFormat srcformat, SampleBlockID id) override;
 
+   //! If lazy, the block reads its row only when first needed
+   SampleBlockPtr CreateFromId(
+      sampleFormat srcformat, SampleBlockID id, bool lazy);
+
+   bool DoGetSamples(
+      const SampleBlockReads &reads, sampleFormat destformat) override;
+
+   SampleBlockCacheStatistics GetCacheStatistics() const override;
+
    SampleBlock::DeletionCallback GetSampleBlockDeletionCallback() const
    {
       return mSampleBlockDeletionCallback;
@@ -185,6 +361,9 @@ private:
    SampleBlock::DeletionCallback mSampleBlockDeletionCallback;
    const std::shared_ptr<ConnectionPtr> mppConnection;
 
+   //! Decoded samples, shared by all blocks of the project
+   SampleBlockCache mSampleCache;
+
    // Track all blocks that this factory has created, but don't control
    // their lifetimes (so use weak_ptr)
    // (Must also use weak pointers because the blocks have shared pointers
@@ -192,11 +371,15 @@ private:
    using AllBlocksMap =
       std::map< SampleBlockID, std::weak_ptr< SqliteSampleBlock > >;
    AllBlocksMap mAllBlocks;
+   //! Blocks may be created on several threads at once
+   std::mutex mAllBlocksMutex;
 };
 
 SqliteSampleBlockFactory::SqliteSampleBlockFactory( AudacityProject &project )
    : mProject{ project }
    , mppConnection{ ConnectionPtr::Get(project).shared_from_this() }
+   , mSampleCache{ static_cast<size_t>(
+      std::max(0, SampleBlockCacheSize.Read())) * 1024 * 1024 }
 {
    mUndoSubscription = UndoManager::Get(project)
       .Subscribe([this](UndoRedoMessage message){
@@ -219,13 +402,20 @@ SampleBlockPtr SqliteSampleBlockFactory::DoCreate(
    auto sb = std::make_shared<SqliteSampleBlock>(shared_from_this());
    sb->SetSamples(src, numsamples, srcformat);
    // block id has now been assigned
+   std::lock_guard<std::mutex> lock(mAllBlocksMutex);
    mAllBlocks[ sb->GetBlockID() ] = sb;
    return sb;
 }
 
+SampleBlockCacheStatistics SqliteSampleBlockFactory::GetCacheStatistics() const
+{
+   return mSampleCache.GetStatistics();
+}
+
 auto SqliteSampleBlockFactory::GetActiveBlockIDs() -> SampleBlockIDs
 {
    SampleBlockIDs result;
+   std::lock_guard<std::mutex> lock(mAllBlocksMutex);
    for (auto end = mAllBlocks.end(), it = mAllBlocks.begin(); it != end;) {
       if (it->second.expired())
          // Tighten up the map
@@ -268,7 +458,7 @@ SampleBlockPtr SqliteSampleBlockFactory::DoCreateFromXML(
       long long nValue;
 
       if (attr == "blockid" && value.TryGet(nValue))
-         return DoCreateFromId(srcformat, nValue);
+         return CreateFromId(srcformat, nValue, LazyProjectOpen.Read());
    }
 
    return nullptr;
@@ -276,11 +466,18 @@ SampleBlockPtr SqliteSampleBlockFactory::DoCreateFromXML(
 
 SampleBlockPtr SqliteSampleBlockFactory::DoCreateFromId(
    sampleFormat srcformat, SampleBlockID id)
+{
+   return CreateFromId(srcformat, id, false);
+}
+
+SampleBlockPtr SqliteSampleBlockFactory::CreateFromId(
+   sampleFormat srcformat, SampleBlockID id, bool lazy)
 {
    if (id <= 0)
       return DoCreateSilent(-id, floatSample);
 
    // First see if this block id was previously loaded
+   std::lock_guard<std::mutex> lock(mAllBlocksMutex);
    auto& wb = mAllBlocks[id];
 
    if (auto block = wb.lock())
@@ -290,13 +487,138 @@ SampleBlockPtr SqliteSampleBlockFactory::DoCreateFromId(
    auto ssb           = std::make_shared<SqliteSampleBlock>(shared_from_this());
    wb                 = ssb;
    ssb->mSampleFormat = srcformat;
-   // This may throw database errors
-   // It initializes the rest of the fields
-   ssb->Load(static_cast<SampleBlockID>(id));
+   if (lazy)
+      // The sequence will tell the sample count; Materialize() does the rest
+      ssb->mBlockID = id;
+   else
+      // This may throw database errors
+      // It initializes the rest of the fields
+      ssb->Load(static_cast<SampleBlockID>(id));
 
    return ssb;
 }
 
+bool SqliteSampleBlockFactory::DoGetSamples(
+   const SampleBlockReads &reads, sampleFormat destformat)
+{
+   // Most statements executed at once; unused parameters stay NULL
+   // and match nothing
+   static constexpr int BatchSize = 32;
+   static const std::string sql = []{
+      std::string result =
+         "SELECT blockid, samples FROM sampleblocks WHERE blockid IN (";
+      for (int ii = 1; ii <= BatchSize; ++ii)
+         result += (ii > 1 ? ",?" : "?") + std::to_string(ii);
+      return result + ");";
+   }();
+
+   bool result = true;
+
+   // Reads that must go to the database
+   std::vector<std::pair<SqliteSampleBlock *, const SampleBlockRead *>> pending;
+   for (const auto &read : reads) {
+      const auto pBlock = dynamic_cast<SqliteSampleBlock *>(read.pBlock);
+      if (!pBlock || pBlock->IsSilent()) {
+         if (read.pBlock->GetSamples(read.dest, destformat,
+               read.sampleoffset, read.numsamples) != read.numsamples)
+            result = false;
+         continue;
+      }
+      if (pBlock->mPending) {
+         // No row to select yet
+         pBlock->DoGetSamples(
+            read.dest, destformat, read.sampleoffset, read.numsamples);
+         continue;
+      }
+      pBlock->Materialize();
+      if (!pBlock->ReadCachedSamples(
+            read.dest, destformat, read.sampleoffset, read.numsamples))
+         pending.emplace_back(pBlock, &read);
+   }
+
+   if (pending.size() == 1) {
+      // No round trips to save
+      const auto &[pBlock, pRead] = pending.front();
+      if (pBlock->DoGetSamples(pRead->dest, destformat,
+            pRead->sampleoffset, pRead->numsamples) != pRead->numsamples)
+         result = false;
+      return result;
+   }
+
+   for (auto first = pending.begin(), end = pending.end(); first != end;) {
+      const auto last = first + std::min<ptrdiff_t>(BatchSize, end - first);
+      const auto conn = first->first->Conn();
+      const auto db = conn->DB();
+
+      // Prepare and cache statement...automatically finalized at DB close
+      const auto stmt =
+         conn->Prepare(DBConnection::GetSamplesBatch, sql.c_str());
+
+      // A sequence may use one block more than once
+      std::unordered_multimap<SampleBlockID, decltype(first)> byId;
+      int param = 0;
+      for (auto iter = first; iter != last; ++iter) {
+         const auto id = iter->first->mBlockID;
+         byId.emplace(id, iter);
+         // Bind statement parameters
+         // Might return SQLITE_MISUSE which means it's our mistake that we
+         // violated preconditions; should return SQL_OK which is 0
+         if (sqlite3_bind_int64(stmt, ++param, id))
+         {
+            ADD_EXCEPTION_CONTEXT(
+               "sqlite3.rc", std::to_string(sqlite3_errcode(db)));
+            ADD_EXCEPTION_CONTEXT("sqlite3.context",
+               "SqliteSampleBlockFactory::DoGetSamples::bind");
+
+            wxASSERT_MSG(false, wxT("Binding failed...bug!!!"));
+         }
+      }
+
+      // Execute the statement, one row for each distinct block
+      int rc;
+      while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+         const auto [rowBegin, rowEnd] =
+            byId.equal_range(sqlite3_column_int64(stmt, 0));
+         const auto blob = sqlite3_column_blob(stmt, 1);
+         const auto blobbytes = (size_t) sqlite3_column_bytes(stmt, 1);
+         for (auto found = rowBegin; found != rowEnd; ++found) {
+            const auto &[pBlock, pRead] = *found->second;
+            const auto format = pBlock->mSampleFormat;
+            const auto size = SAMPLE_SIZE(format);
+            SqliteSampleBlock::CopyBlob(pRead->dest, destformat,
+               blob, blobbytes,
+               format, pRead->sampleoffset * size, pRead->numsamples * size);
+            pBlock->CacheSamples(pRead->dest, destformat,
+               pRead->sampleoffset, pRead->numsamples);
+         }
+         byId.erase(rowBegin, rowEnd);
+      }
+
+      // Clear statement bindings and rewind statement
+      sqlite3_clear_bindings(stmt);
+      sqlite3_reset(stmt);
+
+      if (rc != SQLITE_DONE || !byId.empty())
+      {
+         ADD_EXCEPTION_CONTEXT("sqlite3.rc", std::to_string(rc));
+         ADD_EXCEPTION_CONTEXT("sqlite3.context",
+            "SqliteSampleBlockFactory::DoGetSamples::step");
+
+         wxLogDebug(
+            wxT("SqliteSampleBlockFactory::DoGetSamples - SQLITE error %s"),
+            sqlite3_errmsg(db));
+
+         // Just showing the user a simple message, not the library error too
+         // which isn't internationalized
+         conn->ThrowException( false );
+      }
+
+      first = last;
+   }
+
+   return result;
+}
+
 BlockSampleView SqliteSampleBlock::GetFloatSampleView(bool mayThrow)
 {
    assert(mSampleCount > 0);
@@ -312,18 +634,32 @@ BlockSampleView SqliteSampleBlock::GetFloatSampleView(bool mayThrow)
    if (cache)
       return cache;
 
+   // Another view of the same block may have died, leaving the samples in
+   // the factory's cache
+   if (!IsSilent() && (cache = mpFactory->mSampleCache.Find(mBlockID))) {
+      mCache = cache;
+      return cache;
+   }
+
    const auto newCache =
       std::make_shared<std::vector<float>>(mSampleCount);
    try {
-      const auto cachedSize = DoGetSamples(
-         reinterpret_cast<samplePtr>(newCache->data()), floatSample, 0,
-         mSampleCount);
+      const auto cachedSize = IsSilent()
+         ? DoGetSamples(
+            reinterpret_cast<samplePtr>(newCache->data()), floatSample, 0,
+            mSampleCount)
+         : ReadSamples(
+            reinterpret_cast<samplePtr>(newCache->data()), floatSample, 0,
+            mSampleCount);
       assert(cachedSize == mSampleCount);
+      if (!IsSilent())
+         mpFactory->mSampleCache.Insert(mBlockID, newCache);
    }
    catch (...)
    {
       if (mayThrow)
          std::rethrow_exception(std::current_exception());
+      // Don't share the zeroes with other views
       std::fill(newCache->begin(), newCache->end(), 0.f);
    }
    mCache = newCache;
@@ -364,6 +700,10 @@ SqliteSampleBlock::~SqliteSampleBlock()
 
    // See ProjectFileIO::Bypass() for a description of mIO.mBypass
    GuardedCall( [this]{
+      if (mPending && Conn()->CancelDeferredWrite(this))
+         // There never was a row
+         return;
+
       if (!mLocked && !Conn()->ShouldBypass())
       {
          // In case Delete throws, don't let an exception escape a destructor,
@@ -406,14 +746,30 @@ SampleBlockID SqliteSampleBlock::GetBlockID() const
 
 sampleFormat SqliteSampleBlock::GetSampleFormat() const
 {
+   // Until loaded, a block created lazily has the format of its sequence,
+   // which Load() may replace with the stored one, perhaps on another thread
+   Materialize();
    return mSampleFormat;
 }
 
 size_t SqliteSampleBlock::GetSampleCount() const
 {
+   // Non-silent blocks have samples; zero means a block created lazily
+   // that was not told its count
+   if (mSampleCount == 0)
+      Materialize();
    return mSampleCount;
 }
 
+void SqliteSampleBlock::SetImpliedSampleCount(size_t count)
+{
+   std::lock_guard<std::mutex> lock(mLoadMutex);
+   // The first sequence naming a shared block decides; others are checked
+   // against it
+   if (!mValid && mSampleCount == 0)
+      mSampleCount = count;
+}
+
 size_t SqliteSampleBlock::DoGetSamples(samplePtr dest,
                                      sampleFormat destformat,
                                      size_t sampleoffset,
@@ -425,6 +781,113 @@ size_t SqliteSampleBlock::DoGetSamples(samplePtr dest,
       return numsamples;
    }
 
+   if (ReadCachedSamples(dest, destformat, sampleoffset, numsamples))
+      return numsamples;
+
+   const auto result = ReadSamples(dest, destformat, sampleoffset, numsamples);
+   CacheSamples(dest, destformat, sampleoffset, numsamples);
+   return result;
+}
+
+bool SqliteSampleBlock::ReadPendingSamples(samplePtr dest,
+                                           sampleFormat destformat,
+                                           size_t sampleoffset,
+                                           size_t numsamples)
+{
+   if (!mPending)
+      return false;
+   std::lock_guard<std::mutex> lock(mPendingMutex);
+   if (!mPending)
+      return false;
+
+   const auto size = SAMPLE_SIZE(mSampleFormat);
+   CopyBlob(dest, destformat, mSamples.get(), mSampleBytes,
+      mSampleFormat, sampleoffset * size, numsamples * size);
+   return true;
+}
+
+bool SqliteSampleBlock::ReadMappedFloats(float *dest,
+                                         size_t sampleoffset,
+                                         size_t numsamples)
+{
+   const auto conn = Conn();
+   if (!conn->IsMemoryMapped())
+      return false;
+
+   Materialize();
+
+   // The incremental blob interface reads only the samples column, with
+   // no conversion, and with mmap enabled SQLite serves it from the
+   // mapped pages rather than a private page cache copy
+   sqlite3_blob *blob = nullptr;
+   if (sqlite3_blob_open(conn->DB(), "main", "sampleblocks", "samples",
+         mBlockID, 0, &blob) != SQLITE_OK) {
+      // Let the usual path report any error
+      sqlite3_blob_close(blob);
+      return false;
+   }
+   auto closer = finally([&]{ sqlite3_blob_close(blob); });
+
+   const auto blobSamples =
+      static_cast<size_t>(sqlite3_blob_bytes(blob)) / sizeof(float);
+   const auto offset = std::min(sampleoffset, blobSamples);
+   const auto count = std::min(numsamples, blobSamples - offset);
+   if (count > 0 && sqlite3_blob_read(blob, dest,
+         static_cast<int>(count * sizeof(float)),
+         static_cast<int>(offset * sizeof(float))) != SQLITE_OK)
+      return false;
+   std::fill(dest + count, dest + numsamples, 0.f);
+   return true;
+}
+
+bool SqliteSampleBlock::ReadCachedSamples(samplePtr dest,
+                                          sampleFormat destformat,
+                                          size_t sampleoffset,
+                                          size_t numsamples)
+{
+   if (destformat != floatSample)
+      return false;
+
+   const auto pSamples = mpFactory->mSampleCache.Find(mBlockID);
+   if (!pSamples)
+      return false;
+
+   // Same zero-padding as GetBlob gives
+   const auto offset = std::min(sampleoffset, pSamples->size());
+   const auto count = std::min(numsamples, pSamples->size() - offset);
+   const auto floats = reinterpret_cast<float *>(dest);
+   std::copy_n(pSamples->data() + offset, count, floats);
+   std::fill(floats + count, floats + numsamples, 0.f);
+   return true;
+}
+
+void SqliteSampleBlock::CacheSamples(constSamplePtr src,
+                                     sampleFormat srcformat,
+                                     size_t sampleoffset,
+                                     size_t numsamples)
+{
+   // Partial reads are not worth keeping
+   if (srcformat != floatSample ||
+       !mValid || sampleoffset != 0 || numsamples < mSampleCount)
+      return;
+   const auto floats = reinterpret_cast<const float *>(src);
+   mpFactory->mSampleCache.Insert(mBlockID,
+      std::make_shared<std::vector<float>>(floats, floats + mSampleCount));
+}
+
+size_t SqliteSampleBlock::ReadSamples(samplePtr dest,
+                                      sampleFormat destformat,
+                                      size_t sampleoffset,
+                                      size_t numsamples)
+{
+   if (ReadPendingSamples(dest, destformat, sampleoffset, numsamples))
+      return numsamples;
+
+   if (destformat == floatSample && mSampleFormat == floatSample &&
+       ReadMappedFloats(
+          reinterpret_cast<float *>(dest), sampleoffset, numsamples))
+      return numsamples;
+
    // Prepare and cache statement...automatically finalized at DB close
    sqlite3_stmt *stmt = Conn()->Prepare(DBConnection::GetSamples,
       "SELECT samples FROM sampleblocks WHERE blockid = ?1;");
@@ -447,6 +910,12 @@ void SqliteSampleBlock::SetSamples(constSamplePtr src,
 
    CalcSummary( sizes );
 
+   // Don't make recording wait for the database.  Other threads insert
+   // now, inside whatever transaction is open, so that rollback undoes them.
+   if (RecordableSequence::DeferredWritesScope::InEffect() &&
+       DeferCommit(sizes))
+      return;
+
    Commit( sizes );
 }
 
@@ -454,16 +923,37 @@ bool SqliteSampleBlock::GetSummary256(float *dest,
                                       size_t frameoffset,
                                       size_t numframes)
 {
-   return GetSummary(dest, frameoffset, numframes, DBConnection::GetSummary256,
-      "SELECT summary256 FROM sampleblocks WHERE blockid = ?1;");
+   return GetPendingSummary(dest, frameoffset, numframes,
+         mSummary256, mPendingSizes.first) ||
+      GetSummary(dest, frameoffset, numframes, DBConnection::GetSummary256,
+         "SELECT summary256 FROM sampleblocks WHERE blockid = ?1;");
 }
 
 bool SqliteSampleBlock::GetSummary64k(float *dest,
                                       size_t frameoffset,
                                       size_t numframes)
 {
-   return GetSummary(dest, frameoffset, numframes, DBConnection::GetSummary64k,
-      "SELECT summary64k FROM sampleblocks WHERE blockid = ?1;");
+   return GetPendingSummary(dest, frameoffset, numframes,
+         mSummary64k, mPendingSizes.second) ||
+      GetSummary(dest, frameoffset, numframes, DBConnection::GetSummary64k,
+         "SELECT summary64k FROM sampleblocks WHERE blockid = ?1;");
+}
+
+bool SqliteSampleBlock::GetPendingSummary(float *dest,
+                                          size_t frameoffset,
+                                          size_t numframes,
+                                          const ArrayOf<char> &summary,
+                                          size_t summaryBytes)
+{
+   if (!mPending)
+      return false;
+   std::lock_guard<std::mutex> lock(mPendingMutex);
+   if (!mPending)
+      return false;
+
+   CopyBlob(dest, floatSample, summary.get(), summaryBytes, floatSample,
+      frameoffset * bytesPerFrame, numframes * bytesPerFrame);
+   return true;
 }
 
 bool SqliteSampleBlock::GetSummary(float *dest,
@@ -522,14 +1012,9 @@ MinMaxRMS SqliteSampleBlock::DoGetMinMaxRMS(size_t start, size_t len)
    if (IsSilent())
       return {};
 
-   float min = FLT_MAX;
-   float max = -FLT_MAX;
-   float sumsq = 0;
+   MinMaxSumSquares summary;
 
-   if (!mValid)
-   {
-      Load(mBlockID);
-   }
+   Materialize();
 
    if (start < mSampleCount)
    {
@@ -540,25 +1025,11 @@ MinMaxRMS SqliteSampleBlock::DoGetMinMaxRMS(size_t start, size_t len)
       float *samples = (float *) blockData.ptr();
 
       size_t copied = DoGetSamples((samplePtr) samples, floatSample, start, len);
-      for (size_t i = 0; i < copied; ++i, ++samples)
-      {
-         float sample = *samples;
-
-         if (sample > max)
-         {
-            max = sample;
-         }
-
-         if (sample < min)
-         {
-            min = sample;
-         }
-
-         sumsq += (sample * sample);
-      }
+      summary = SampleSummary::Compute(samples, copied);
    }
 
-   return { min, max, (float) sqrt(sumsq / len) };
+   return { summary.min, summary.max,
+      (float) sqrt(summary.sumSquares / len) };
 }
 
 /// Retrieves the minimum, maximum, and maximum RMS of this entire
@@ -566,6 +1037,8 @@ MinMaxRMS SqliteSampleBlock::DoGetMinMaxRMS(size_t start, size_t len)
 /// these values are already computed.
 MinMaxRMS SqliteSampleBlock::DoGetMinMaxRMS() const
 {
+   if (!IsSilent())
+      Materialize();
    return { (float) mSumMin, (float) mSumMax, (float) mSumRms };
 }
 
@@ -573,6 +1046,9 @@ size_t SqliteSampleBlock::GetSpaceUsage() const
 {
    if (IsSilent())
       return 0;
+   else if (mPending)
+      // Estimate what the row will take
+      return mSampleBytes + mPendingSizes.first + mPendingSizes.second;
    else
       return ProjectFileIO::GetDiskUsage(*Conn(), mBlockID);
 }
@@ -588,13 +1064,9 @@ size_t SqliteSampleBlock::GetBlob(void *dest,
 
    wxASSERT(!IsSilent());
 
-   if (!mValid)
-   {
-      Load(mBlockID);
-   }
+   Materialize();
 
    int rc;
-   size_t minbytes = 0;
 
    // Bind statement parameters
    // Might return SQLITE_MISUSE which means it's our mistake that we violated
@@ -634,16 +1106,30 @@ size_t SqliteSampleBlock::GetBlob(void *dest,
    }
 
    // Retrieve returned data
-   samplePtr src = (samplePtr) sqlite3_column_blob(stmt, 0);
-   size_t blobbytes = (size_t) sqlite3_column_bytes(stmt, 0);
+   CopyBlob(dest, destformat,
+            sqlite3_column_blob(stmt, 0),
+            (size_t) sqlite3_column_bytes(stmt, 0),
+            srcformat, srcoffset, srcbytes);
 
-   srcoffset = std::min(srcoffset, blobbytes);
-   minbytes = std::min(srcbytes, blobbytes - srcoffset);
+   // Clear statement bindings and rewind statement
+   sqlite3_clear_bindings(stmt);
+   sqlite3_reset(stmt);
 
-   if (srcoffset != 0)
-   {
-      srcoffset += 0;
-   }
+   return srcbytes;
+}
+
+void SqliteSampleBlock::CopyBlob(void *dest,
+                                 sampleFormat destformat,
+                                 const void *blob,
+                                 size_t blobbytes,
+                                 sampleFormat srcformat,
+                                 size_t srcoffset,
+                                 size_t srcbytes)
+{
+   auto src = (constSamplePtr) blob;
+
+   srcoffset = std::min(srcoffset, blobbytes);
+   const auto minbytes = std::min(srcbytes, blobbytes - srcoffset);
 
    /*
     Will dithering happen in CopySamples?  Answering this as of 3.0.3 by
@@ -678,6 +1164,9 @@ size_t SqliteSampleBlock::GetBlob(void *dest,
     the sample format is the same as what the track was constructed with.
 
     Therefore, no dithering even there!
+
+    (The batched reads of SqliteSampleBlockFactory::DoGetSamples() come only
+    from Sequence::Get() and so are covered by the same reasoning.)
     */
    wxASSERT(destformat == floatSample || destformat == srcformat);
 
@@ -693,12 +1182,6 @@ size_t SqliteSampleBlock::GetBlob(void *dest,
    {
       memset(dest, 0, srcbytes - minbytes);
    }
-
-   // Clear statement bindings and rewind statement
-   sqlite3_clear_bindings(stmt);
-   sqlite3_reset(stmt);
-
-   return srcbytes;
 }
 
 void SqliteSampleBlock::Load(SampleBlockID sbid)
@@ -709,12 +1192,26 @@ void SqliteSampleBlock::Load(SampleBlockID sbid)
    wxASSERT(sbid > 0);
 
    mValid = false;
-   mSampleCount = 0;
    mSampleBytes = 0;
    mSumMin = FLT_MAX;
    mSumMax = -FLT_MAX;
    mSumMin = 0.0;
 
+   // Use metadata read with those of all other blocks, if the project is
+   // being loaded
+   if (const auto metadata = Conn()->TakeSampleBlockMetadata(sbid))
+   {
+      mBlockID = sbid;
+      mSampleFormat = (sampleFormat) metadata->sampleFormat;
+      mSumMin = metadata->sumMin;
+      mSumMax = metadata->sumMax;
+      mSumRms = metadata->sumRms;
+      mSampleBytes = metadata->sampleBytes;
+      SetStoredSampleCount();
+      mValid = true;
+      return;
+   }
+
    // Prepare and cache statement...automatically finalized at DB close
    sqlite3_stmt *stmt = Conn()->Prepare(DBConnection::LoadSampleBlock,
       "SELECT sampleformat, summin, summax, sumrms,"
@@ -760,7 +1257,7 @@ void SqliteSampleBlock::Load(SampleBlockID sbid)
    mSumMax = sqlite3_column_double(stmt, 2);
    mSumRms = sqlite3_column_double(stmt, 3);
    mSampleBytes = sqlite3_column_int(stmt, 4);
-   mSampleCount = mSampleBytes / SAMPLE_SIZE(mSampleFormat);
+   SetStoredSampleCount();
 
    // Clear statement bindings and rewind statement
    sqlite3_clear_bindings(stmt);
@@ -769,30 +1266,84 @@ void SqliteSampleBlock::Load(SampleBlockID sbid)
    mValid = true;
 }
 
-void SqliteSampleBlock::Commit(Sizes sizes)
+void SqliteSampleBlock::Materialize() const
+{
+   if (mValid || IsSilent())
+      return;
+   std::lock_guard<std::mutex> lock(mLoadMutex);
+   if (mValid)
+      return;
+   try {
+      const_cast<SqliteSampleBlock *>(this)->Load(mBlockID);
+   }
+   catch (...) {
+      // The row of the block is missing or unreadable, which opening the
+      // project no longer found.  Playback and painting read with mayThrow
+      // false, often on other threads, and would just give silence; so tell
+      // the user in idle time, once for each block
+      if (!mLoadFailed) {
+         mLoadFailed = true;
+         AudacityException::EnqueueAction(
+            std::current_exception(), DefaultDelayedHandlerAction);
+      }
+      throw;
+   }
+}
+
+void SqliteSampleBlock::SetStoredSampleCount()
+{
+   const size_t storedCount = mSampleBytes / SAMPLE_SIZE(mSampleFormat);
+   if (mSampleCount == 0)
+      mSampleCount = storedCount;
+   else if (mSampleCount != storedCount)
+      // A sequence already depends on the count; reads past the stored
+      // samples give zeroes
+      wxLogWarning(
+         "Sample block %lld has %lld samples, but its sequence implies %lld",
+         static_cast<long long>(mBlockID),
+         static_cast<long long>(storedCount),
+         static_cast<long long>(mSampleCount));
+}
+
+static const char *const InsertSampleBlockSQL =
+   "INSERT INTO sampleblocks (blockid, sampleformat, summin, summax, sumrms,"
+   "                          summary256, summary64k, samples)"
+   "                         VALUES(?1,?2,?3,?4,?5,?6,?7,?8);";
+
+int SqliteSampleBlock::BindInsert(
+   sqlite3_stmt *stmt, SampleBlockID id, Sizes sizes)
 {
    const auto mSummary256Bytes = sizes.first;
    const auto mSummary64kBytes = sizes.second;
 
+   // Explicit ids, reserved from the connection, so that rows inserted by the
+   // writer thread and by this thread can't collide
+   return
+      sqlite3_bind_int64(stmt, 1, id) ||
+      sqlite3_bind_int(stmt, 2, static_cast<int>(mSampleFormat)) ||
+      sqlite3_bind_double(stmt, 3, mSumMin) ||
+      sqlite3_bind_double(stmt, 4, mSumMax) ||
+      sqlite3_bind_double(stmt, 5, mSumRms) ||
+      sqlite3_bind_blob(stmt, 6, mSummary256.get(), mSummary256Bytes, SQLITE_STATIC) ||
+      sqlite3_bind_blob(stmt, 7, mSummary64k.get(), mSummary64kBytes, SQLITE_STATIC) ||
+      sqlite3_bind_blob(stmt, 8, mSamples.get(), mSampleBytes, SQLITE_STATIC);
+}
+
+void SqliteSampleBlock::Commit(Sizes sizes)
+{
    auto db = DB();
    int rc;
 
+   const auto id = Conn()->ReserveBlockID();
+
    // Prepare and cache statement...automatically finalized at DB close
    sqlite3_stmt *stmt = Conn()->Prepare(DBConnection::InsertSampleBlock,
-      "INSERT INTO sampleblocks (sampleformat, summin, summax, sumrms,"
-      "                          summary256, summary64k, samples)"
-      "                         VALUES(?1,?2,?3,?4,?5,?6,?7);");
+      InsertSampleBlockSQL);
 
    // Bind statement parameters
    // Might return SQLITE_MISUSE which means it's our mistake that we violated
    // preconditions; should return SQL_OK which is 0
-   if (sqlite3_bind_int(stmt, 1, static_cast<int>(mSampleFormat)) ||
-       sqlite3_bind_double(stmt, 2, mSumMin) ||
-       sqlite3_bind_double(stmt, 3, mSumMax) ||
-       sqlite3_bind_double(stmt, 4, mSumRms) ||
-       sqlite3_bind_blob(stmt, 5, mSummary256.get(), mSummary256Bytes, SQLITE_STATIC) ||
-       sqlite3_bind_blob(stmt, 6, mSummary64k.get(), mSummary64kBytes, SQLITE_STATIC) ||
-       sqlite3_bind_blob(stmt, 7, mSamples.get(), mSampleBytes, SQLITE_STATIC))
+   if (BindInsert(stmt, id, sizes))
    {
 
       ADD_EXCEPTION_CONTEXT(
@@ -821,8 +1372,7 @@ void SqliteSampleBlock::Commit(Sizes sizes)
       Conn()->ThrowException( true );
    }
 
-   // Retrieve returned data
-   mBlockID = sqlite3_last_insert_rowid(db);
+   mBlockID = id;
 
    // Reset local arrays
    mSamples.reset();
@@ -840,6 +1390,57 @@ void SqliteSampleBlock::Commit(Sizes sizes)
    mValid = true;
 }
 
+bool SqliteSampleBlock::DeferCommit(Sizes sizes)
+{
+   const auto conn = Conn();
+
+   // The id is final at once, so the block can go into sequences and be
+   // saved in project XML before the row exists
+   mBlockID = conn->ReserveBlockID();
+   mPendingSizes = sizes;
+   mPending = true;
+   mValid = true;
+
+   bool deferred = false;
+   auto undo = finally([&]{
+      if (!deferred) {
+         mPending = false;
+         mValid = false;
+         mBlockID = 0;
+      }
+   });
+
+   deferred = conn->DeferWrite({ this,
+      [this, sizes](sqlite3 *db){ return Insert(db, sizes); },
+      [this]{ OnCommitted(); }
+   });
+   return deferred;
+}
+
+int SqliteSampleBlock::Insert(sqlite3 *db, Sizes sizes)
+{
+   sqlite3_stmt *stmt = nullptr;
+   int rc = sqlite3_prepare_v2(db, InsertSampleBlockSQL, -1, &stmt, nullptr);
+   if (rc != SQLITE_OK)
+      return rc;
+   auto finalizer = finally([&stmt] { sqlite3_finalize(stmt); });
+
+   rc = BindInsert(stmt, mBlockID, sizes);
+   if (rc == SQLITE_OK)
+      rc = sqlite3_step(stmt);
+   return rc == SQLITE_DONE ? SQLITE_OK : rc;
+}
+
+void SqliteSampleBlock::OnCommitted()
+{
+   // Release the memory, now that readers can go to the database
+   std::lock_guard<std::mutex> lock(mPendingMutex);
+   mPending = false;
+   mSamples.reset();
+   mSummary256.reset();
+   mSummary64k.reset();
+}
+
 void SqliteSampleBlock::Delete()
 {
    auto db = DB();
@@ -884,6 +1485,8 @@ void SqliteSampleBlock::Delete()
    // Clear statement bindings and rewind statement
    sqlite3_clear_bindings(stmt);
    sqlite3_reset(stmt);
+
+   mpFactory->mSampleCache.Erase(mBlockID);
 }
 
 void SqliteSampleBlock::SaveXML(XMLWriter &xmlFile)
@@ -937,48 +1540,18 @@ void SqliteSampleBlock::CalcSummary(Sizes sizes)
    float min;
    float max;
    float sumsq;
-   double totalSquares = 0.0;
    double fraction = 0.0;
 
    // Recalc 256 summaries
    int sumLen = (mSampleCount + 255) / 256;
    int summaries = 256;
 
-   for (int i = 0; i < sumLen; ++i)
-   {
-      min = samples[i * 256];
-      max = samples[i * 256];
-      sumsq = min * min;
-
-      int jcount = 256;
-      if (jcount > mSampleCount - i * 256)
-      {
-         jcount = mSampleCount - i * 256;
-         fraction = 1.0 - (jcount / 256.0);
-      }
-
-      for (int j = 1; j < jcount; ++j)
-      {
-         float f1 = samples[i * 256 + j];
-         sumsq += f1 * f1;
-
-         if (f1 < min)
-         {
-            min = f1;
-         }
-         else if (f1 > max)
-         {
-            max = f1;
-         }
-      }
-
-      totalSquares += sumsq;
-
-      summary256[i * fields] = min;
-      summary256[i * fields + 1] = max;
-      // The rms is correct, but this may be for less than 256 samples in last loop.
-      summary256[i * fields + 2] = (float) sqrt(sumsq / jcount);
-   }
+   // The rms is correct, but this may be for less than 256 samples in the
+   // last frame.
+   const double totalSquares =
+      SampleSummary::Summarize(samples, mSampleCount, 256, summary256);
+   if (const auto remainder = mSampleCount % 256)
+      fraction = 1.0 - (remainder / 256.0);
 
    for (int i = sumLen, frames256 = mSummary256Bytes / bytesPerFrame;
         i < frames256; ++i)
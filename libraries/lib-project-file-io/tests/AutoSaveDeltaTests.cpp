@@ -0,0 +1,182 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+ Audacity: A Digital Audio Editor
+
+ AutoSaveDeltaTests.cpp
+
+ **********************************************************************/
+#include <catch2/catch.hpp>
+
+#include <sqlite3.h>
+
+#include <string>
+#include <vector>
+
+#include "AutoSaveDelta.h"
+#include "MemoryStream.h"
+#include "MemoryX.h"
+#include "ProjectFileTestUtils.h"
+
+namespace
+{
+//! A document of a header, the given parts as segments, and a tail
+struct Document
+{
+   explicit Document(const std::vector<std::string>& parts)
+   {
+      Append("head");
+      for (const auto& part : parts)
+      {
+         segments.push_back({ data.GetSize(), part.size() });
+         Append(part);
+      }
+      Append("tail");
+   }
+
+   void Append(const std::string& bytes)
+   {
+      data.AppendData(bytes.data(), bytes.size());
+   }
+
+   std::string Bytes() const
+   {
+      return { static_cast<const char*>(data.GetData()), data.GetSize() };
+   }
+
+   MemoryStream data;
+   AutoSaveDelta::Segments segments;
+};
+
+std::string Apply(const Document& base, const MemoryStream& delta)
+{
+   MemoryStream result;
+   REQUIRE(AutoSaveDelta::Apply(
+      base.data.GetData(), base.data.GetSize(), delta.GetData(),
+      delta.GetSize(), result));
+   return { static_cast<const char*>(result.GetData()), result.GetSize() };
+}
+//! Write a row of the autosave table, as ProjectFileIO::WriteDoc does
+void WriteRow(sqlite3* db, int id, const MemoryStream& doc)
+{
+   sqlite3_stmt* stmt = nullptr;
+   REQUIRE(
+      sqlite3_prepare_v2(
+         db,
+         "INSERT INTO autosave(id, dict, doc) VALUES(?1, ?2, ?3)"
+         "       ON CONFLICT(id) DO UPDATE SET dict = ?2, doc = ?3;",
+         -1, &stmt, nullptr) == SQLITE_OK);
+   auto finalize = finally([&] { sqlite3_finalize(stmt); });
+   const char dict[] = "dict";
+   sqlite3_bind_int(stmt, 1, id);
+   sqlite3_bind_blob(stmt, 2, dict, sizeof dict, SQLITE_STATIC);
+   sqlite3_bind_blob(stmt, 3, doc.GetData(), doc.GetSize(), SQLITE_STATIC);
+   REQUIRE(sqlite3_step(stmt) == SQLITE_DONE);
+}
+} // namespace
+
+TEST_CASE("AutoSaveDelta")
+{
+   const Document base { { "track one", "track two", "track three" } };
+   const AutoSaveDelta autoSaveDelta { base.data, base.segments };
+   REQUIRE(autoSaveDelta.GetBaseSize() == base.data.GetSize());
+
+   SECTION("Unchanged segments are not written")
+   {
+      MemoryStream delta;
+      REQUIRE(autoSaveDelta.Encode(base.data, base.segments, delta) == 8);
+      REQUIRE(Apply(base, delta) == base.Bytes());
+   }
+
+   SECTION("Changed, added, removed and reordered segments")
+   {
+      const Document document { { "track three", "track 2", "track one",
+                                  "track four" } };
+      MemoryStream delta;
+      REQUIRE(
+         autoSaveDelta.Encode(document.data, document.segments, delta) ==
+         8 + std::string("track 2track four").size());
+      REQUIRE(Apply(base, delta) == document.Bytes());
+   }
+
+   SECTION("Segments of equal contents at different places")
+   {
+      const Document document { { "track one", "track one" } };
+      MemoryStream delta;
+      REQUIRE(
+         autoSaveDelta.Encode(document.data, document.segments, delta) == 8);
+      REQUIRE(Apply(base, delta) == document.Bytes());
+   }
+
+   SECTION("The base document need not outlive the encoder")
+   {
+      const auto encoder = [] {
+         const Document temporary { { "track one", "track two" } };
+         return AutoSaveDelta { temporary.data, temporary.segments };
+      }();
+      const Document document { { "track two", "track one" } };
+      MemoryStream delta;
+      REQUIRE(encoder.Encode(document.data, document.segments, delta) == 8);
+      REQUIRE(
+         Apply(Document { { "track one", "track two" } }, delta) ==
+         document.Bytes());
+   }
+
+   SECTION("A delta that does not fit the base is rejected")
+   {
+      const Document document { { "track one" } };
+      MemoryStream delta;
+      autoSaveDelta.Encode(document.data, document.segments, delta);
+
+      const Document shorter { {} };
+      MemoryStream result;
+      REQUIRE(!AutoSaveDelta::Apply(
+         shorter.data.GetData(), shorter.data.GetSize(), delta.GetData(),
+         delta.GetSize(), result));
+
+      // Truncated
+      REQUIRE(!AutoSaveDelta::Apply(
+         base.data.GetData(), base.data.GetSize(), delta.GetData(),
+         delta.GetSize() - 1, result));
+   }
+}
+
+// Measures the database writes of an autosave after an edit of one track of
+// many, which is what deltas save; not the serialization of the project
+TEST_CASE("AutoSaveDelta benchmark", "[.][benchmark]")
+{
+   constexpr size_t nTracks = 100;
+   constexpr size_t trackBytes = 64 * 1024;
+   std::vector<std::string> parts;
+   for (size_t ii = 0; ii < nTracks; ++ii)
+      parts.push_back(
+         std::to_string(ii) + std::string(trackBytes, 'a' + ii % 26));
+   const Document base { parts };
+   parts[nTracks / 2] += " edited";
+   const Document document { parts };
+
+   const TemporaryDirectory directory { "AutoSaveDeltaTests" };
+   sqlite3* db = nullptr;
+   REQUIRE(
+      sqlite3_open(directory.File("project.aup3").c_str(), &db) == SQLITE_OK);
+   auto close = finally([&] { sqlite3_close(db); });
+   InstallProjectSchema(db);
+   WriteRow(db, 1, base.data);
+
+   const AutoSaveDelta autoSaveDelta { base.data, base.segments };
+   MemoryStream delta;
+   autoSaveDelta.Encode(document.data, document.segments, delta);
+   REQUIRE(delta.GetSize() < document.data.GetSize() / 50);
+
+   BENCHMARK("Write the full document")
+   {
+      WriteRow(db, 1, document.data);
+   };
+
+   BENCHMARK("Encode and write a delta")
+   {
+      MemoryStream delta;
+      autoSaveDelta.Encode(document.data, document.segments, delta);
+      WriteRow(db, 2, delta);
+   };
+}
@@ -0,0 +1,241 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+ Audacity: A Digital Audio Editor
+
+ CopySampleBlocksTests.cpp
+
+ **********************************************************************/
+#include <catch2/catch.hpp>
+
+#include <sqlite3.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "DBConnection.h"
+#include "ProjectFileTestUtils.h"
+
+namespace
+{
+namespace fs = std::filesystem;
+
+// 16 MB of samples
+constexpr int nBlocks = 256;
+constexpr int blockBytes = 64 * 1024;
+
+sqlite3* MakeDatabase(const std::string& path)
+{
+   sqlite3* db = nullptr;
+   REQUIRE(sqlite3_open(path.c_str(), &db) == SQLITE_OK);
+   REQUIRE(
+      sqlite3_exec(db, "PRAGMA journal_mode = WAL;", nullptr, nullptr, nullptr)
+      == SQLITE_OK);
+   InstallProjectSchema(db);
+
+   sqlite3_stmt* stmt = nullptr;
+   REQUIRE(
+      sqlite3_prepare_v2(
+         db,
+         "INSERT INTO sampleblocks (blockid, sampleformat, samples)"
+         "                         VALUES(?1, ?2, ?3);",
+         -1, &stmt, nullptr) == SQLITE_OK);
+   REQUIRE(sqlite3_exec(db, "BEGIN;", nullptr, nullptr, nullptr) == SQLITE_OK);
+   std::vector<char> samples(blockBytes);
+   for (int id = 1; id <= nBlocks; ++id)
+   {
+      std::fill(samples.begin(), samples.end(), static_cast<char>(id));
+      sqlite3_bind_int64(stmt, 1, id);
+      sqlite3_bind_int(stmt, 2, 0x0004000F);
+      sqlite3_bind_blob(
+         stmt, 3, samples.data(), samples.size(), SQLITE_TRANSIENT);
+      REQUIRE(sqlite3_step(stmt) == SQLITE_DONE);
+      sqlite3_reset(stmt);
+   }
+   sqlite3_finalize(stmt);
+   REQUIRE(
+      sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr) == SQLITE_OK);
+   return db;
+}
+
+//! Attach a new database as "outbound" with the journal off, as
+//! ProjectFileIO::CopyTo does
+void Attach(sqlite3* db, const std::string& path)
+{
+   const auto sql = sqlite3_mprintf(
+      "ATTACH DATABASE %Q AS outbound;"
+      "PRAGMA outbound.journal_mode = OFF;"
+      "PRAGMA outbound.synchronous = OFF;",
+      path.c_str());
+   REQUIRE(sqlite3_exec(db, sql, nullptr, nullptr, nullptr) == SQLITE_OK);
+   sqlite3_free(sql);
+   InstallProjectSchema(db, "outbound");
+}
+
+void Detach(sqlite3* db)
+{
+   REQUIRE(
+      sqlite3_exec(db, "DETACH DATABASE outbound;", nullptr, nullptr, nullptr)
+      == SQLITE_OK);
+}
+
+//! Ids of the rows, and whether each blob holds only its id
+std::vector<long long> ReadBlocks(sqlite3* db, const char* name, bool& valid)
+{
+   std::vector<long long> result;
+   sqlite3_stmt* stmt = nullptr;
+   const auto sql = sqlite3_mprintf(
+      "SELECT blockid, samples FROM %s.sampleblocks ORDER BY blockid;", name);
+   REQUIRE(sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) == SQLITE_OK);
+   sqlite3_free(sql);
+   valid = true;
+   while (sqlite3_step(stmt) == SQLITE_ROW)
+   {
+      const auto id = sqlite3_column_int64(stmt, 0);
+      const auto bytes = static_cast<const char*>(sqlite3_column_blob(stmt, 1));
+      const auto size = sqlite3_column_bytes(stmt, 1);
+      valid = valid && size == blockBytes &&
+              std::all_of(bytes, bytes + size, [&](char byte) {
+                 return byte == static_cast<char>(id);
+              });
+      result.push_back(id);
+   }
+   sqlite3_finalize(stmt);
+   return result;
+}
+
+//! What ProjectFileIO::CopyTo did before there were batches: one statement
+//! for each block in the order of an unordered set
+void CopyEachBlock(sqlite3* db, const std::unordered_set<long long>& blockids)
+{
+   sqlite3_stmt* stmt = nullptr;
+   sqlite3_prepare_v2(
+      db,
+      "INSERT INTO outbound.sampleblocks"
+      "  SELECT * FROM main.sampleblocks"
+      "  WHERE blockid = ?;",
+      -1, &stmt, nullptr);
+   sqlite3_exec(db, "BEGIN;", nullptr, nullptr, nullptr);
+   for (auto blockid : blockids)
+   {
+      sqlite3_bind_int64(stmt, 1, blockid);
+      sqlite3_step(stmt);
+      sqlite3_reset(stmt);
+   }
+   sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+   sqlite3_finalize(stmt);
+}
+} // namespace
+
+TEST_CASE("CopySampleBlocks")
+{
+   const TemporaryDirectory directory { "CopySampleBlocksTests" };
+   const auto db = MakeDatabase(directory.File("source.aup3"));
+   const auto destpath = directory.File("dest.aup3");
+
+   SECTION("Copies the given blocks")
+   {
+      Attach(db, destpath);
+      std::vector<long long> blockids;
+      for (int id = nBlocks; id > 0; id -= 2)
+         blockids.push_back(id);
+
+      size_t lastDone = 0, lastTotal = 0;
+      REQUIRE(
+         DBConnection::CopySampleBlocks(
+            db, "outbound", blockids, [&](size_t done, size_t total) {
+               lastDone = done;
+               lastTotal = total;
+               return true;
+            }) == SQLITE_OK);
+      REQUIRE(lastDone == blockids.size());
+      REQUIRE(lastTotal == blockids.size());
+      REQUIRE(sqlite3_get_autocommit(db));
+
+      bool valid = false;
+      const auto copied = ReadBlocks(db, "outbound", valid);
+      REQUIRE(valid);
+      REQUIRE(copied ==
+              std::vector<long long>(blockids.rbegin(), blockids.rend()));
+      Detach(db);
+   }
+
+   SECTION("Stops when cancelled")
+   {
+      Attach(db, destpath);
+      std::vector<long long> blockids;
+      for (int id = 1; id <= nBlocks; ++id)
+         blockids.push_back(id);
+      REQUIRE(
+         DBConnection::CopySampleBlocks(
+            db, "outbound", blockids,
+            [](size_t, size_t) { return false; }) == SQLITE_INTERRUPT);
+      REQUIRE(sqlite3_get_autocommit(db));
+      Detach(db);
+   }
+
+   SECTION("Clones the whole file")
+   {
+      // The file system of the temporary directory might not be able to
+      if (!DBConnection::CloneDatabaseFile(db, destpath))
+      {
+         REQUIRE(!fs::exists(destpath));
+         WARN("File system of " << destpath << " could not clone the file");
+         return;
+      }
+      // Never overwrites
+      REQUIRE(!DBConnection::CloneDatabaseFile(db, destpath));
+
+      Attach(db, destpath);
+      bool valid = false;
+      REQUIRE(ReadBlocks(db, "outbound", valid).size() == nBlocks);
+      REQUIRE(valid);
+      Detach(db);
+   }
+
+   sqlite3_close(db);
+}
+
+TEST_CASE("CopySampleBlocks benchmark", "[.][benchmark]")
+{
+   const TemporaryDirectory directory { "CopySampleBlocksTests" };
+   const auto db = MakeDatabase(directory.File("source.aup3"));
+   const auto destpath = directory.File("dest.aup3");
+
+   std::unordered_set<long long> blockSet;
+   for (int id = 1; id <= nBlocks; ++id)
+      blockSet.insert(id);
+   const std::vector<long long> blockids(blockSet.begin(), blockSet.end());
+
+   const auto fresh = [&] {
+      std::error_code ec;
+      fs::remove(destpath, ec);
+   };
+
+   BENCHMARK("16 MB, one block at a time")
+   {
+      fresh();
+      Attach(db, destpath);
+      CopyEachBlock(db, blockSet);
+      Detach(db);
+   };
+
+   BENCHMARK("16 MB, in batches")
+   {
+      fresh();
+      Attach(db, destpath);
+      DBConnection::CopySampleBlocks(db, "outbound", blockids);
+      Detach(db);
+   };
+
+   BENCHMARK("16 MB, clone of the file")
+   {
+      fresh();
+      return DBConnection::CloneDatabaseFile(db, destpath);
+   };
+
+   sqlite3_close(db);
+}
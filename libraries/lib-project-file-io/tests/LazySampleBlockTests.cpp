@@ -0,0 +1,218 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+ Audacity: A Digital Audio Editor
+
+ LazySampleBlockTests.cpp
+
+ **********************************************************************/
+#include <catch2/catch.hpp>
+
+#include <sqlite3.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <wx/log.h>
+
+#include "DBConnection.h"
+#include "MemoryX.h"
+#include "MockedPrefs.h"
+#include "Project.h"
+#include "ProjectFileIO.h"
+#include "ProjectFileTestUtils.h"
+#include "SampleBlock.h"
+#include "XMLTagHandler.h"
+
+namespace
+{
+constexpr size_t nSamples = 100;
+constexpr float sumMin = -0.5f;
+constexpr float sumMax = 0.75f;
+constexpr float sumRms = 0.25f;
+
+//! A project file with blocks 1 and 2, each of nSamples float samples
+void MakeDatabase(const std::string& path)
+{
+   sqlite3* db = nullptr;
+   REQUIRE(sqlite3_open(path.c_str(), &db) == SQLITE_OK);
+   auto close = finally([&] { sqlite3_close(db); });
+   InstallProjectSchema(db);
+
+   sqlite3_stmt* stmt = nullptr;
+   REQUIRE(
+      sqlite3_prepare_v2(
+         db,
+         "INSERT INTO sampleblocks (blockid, sampleformat, summin, summax,"
+         "                          sumrms, samples)"
+         "                         VALUES(?1,?2,?3,?4,?5,?6);",
+         -1, &stmt, nullptr) == SQLITE_OK);
+   auto finalize = finally([&] { sqlite3_finalize(stmt); });
+   std::vector<float> samples(nSamples);
+   for (size_t ii = 0; ii < nSamples; ++ii)
+      samples[ii] = ii / 1000.0f;
+   for (int id = 1; id <= 2; ++id)
+   {
+      sqlite3_bind_int64(stmt, 1, id);
+      sqlite3_bind_int(stmt, 2, floatSample);
+      sqlite3_bind_double(stmt, 3, sumMin);
+      sqlite3_bind_double(stmt, 4, sumMax);
+      sqlite3_bind_double(stmt, 5, sumRms);
+      sqlite3_bind_blob(
+         stmt, 6, samples.data(), samples.size() * sizeof(float),
+         SQLITE_STATIC);
+      REQUIRE(sqlite3_step(stmt) == SQLITE_DONE);
+      sqlite3_reset(stmt);
+   }
+}
+
+//! Collects what is logged while it exists
+class LogCapture final : public wxLog
+{
+public:
+   LogCapture()
+       : mpPrevious { wxLog::SetActiveTarget(this) }
+   {
+   }
+
+   ~LogCapture() override
+   {
+      wxLog::SetActiveTarget(mpPrevious);
+   }
+
+   wxString mText;
+
+protected:
+   void DoLogTextAtLevel(wxLogLevel, const wxString& msg) override
+   {
+      mText += msg;
+   }
+
+private:
+   wxLog* const mpPrevious;
+};
+} // namespace
+
+TEST_CASE("SqliteSampleBlock from a project document")
+{
+   MockedPrefs mockedPrefs;
+   // The setting caches its value beyond the mocked preferences
+   auto reset = finally([] { LazyProjectOpen.Reset(); });
+   const TemporaryDirectory directory { "LazySampleBlockTests" };
+   const auto path = directory.File("project.aup3");
+   MakeDatabase(path);
+
+   // The connection that ProjectFileIO opens for the project
+   const auto project = AudacityProject::Create();
+   auto& pConnection = ConnectionPtr::Get(*project).mpConnection;
+   pConnection = std::make_unique<DBConnection>(
+      project, std::make_shared<DBConnectionErrors>(), nullptr);
+   REQUIRE(pConnection->Open(wxString::FromUTF8(path)) == SQLITE_OK);
+   // Blocks destroyed by the test leave their rows
+   pConnection->SetBypass(true);
+   auto close = finally([&] {
+      pConnection->Close();
+      pConnection.reset();
+   });
+
+   const auto factory = SampleBlockFactory::New(*project);
+   const auto fromXML = [&](long long id) {
+      const AttributesList attributes {
+         { "blockid", XMLAttributeValueView { id } }
+      };
+      return factory->CreateFromXML(floatSample, attributes);
+   };
+   const auto deleteRow = [&](long long id) {
+      const auto sql =
+         "DELETE FROM sampleblocks WHERE blockid = " + std::to_string(id);
+      REQUIRE(
+         sqlite3_exec(pConnection->DB(), sql.c_str(), nullptr, nullptr,
+                      nullptr) == SQLITE_OK);
+   };
+
+   SECTION("Without LazyProjectOpen, a block reads its row when created")
+   {
+      LazyProjectOpen.Write(false);
+      const auto block = fromXML(1);
+      REQUIRE(block->GetSampleCount() == nSamples);
+
+      deleteRow(2);
+      REQUIRE_THROWS(fromXML(2));
+   }
+
+   LazyProjectOpen.Write(true);
+
+   SECTION("A lazy block takes its count from the sequence, the rest from "
+           "its row")
+   {
+      const auto block = fromXML(1);
+      block->SetImpliedSampleCount(nSamples);
+      // The row is not read for the count
+      deleteRow(2);
+      const auto missing = fromXML(2);
+      missing->SetImpliedSampleCount(nSamples);
+      REQUIRE(missing->GetSampleCount() == nSamples);
+
+      REQUIRE(block->GetSampleCount() == nSamples);
+      const auto summary = block->GetMinMaxRMS();
+      REQUIRE(summary.min == sumMin);
+      REQUIRE(summary.max == sumMax);
+      REQUIRE(summary.RMS == sumRms);
+      std::vector<float> samples(nSamples);
+      REQUIRE(
+         block->GetSamples(
+            reinterpret_cast<samplePtr>(samples.data()), floatSample, 0,
+            nSamples) == nSamples);
+      REQUIRE(samples[nSamples - 1] == (nSamples - 1) / 1000.0f);
+   }
+
+   SECTION("A missing row is found when the lazy block is first used")
+   {
+      deleteRow(1);
+      const auto block = fromXML(1);
+      block->SetImpliedSampleCount(nSamples);
+
+      REQUIRE_THROWS(block->GetMinMaxRMS());
+      // As playback reads:  silence, and no exception
+      std::vector<float> samples(nSamples, 1.0f);
+      REQUIRE(
+         block->GetSamples(
+            reinterpret_cast<samplePtr>(samples.data()), floatSample, 0,
+            nSamples, false) == 0);
+      REQUIRE(samples[0] == 0.0f);
+   }
+
+   SECTION("The first sequence to name a block decides its count")
+   {
+      const auto block = fromXML(1);
+      block->SetImpliedSampleCount(nSamples);
+      // Another sequence sharing the block
+      const auto shared = fromXML(1);
+      REQUIRE(shared == block);
+      shared->SetImpliedSampleCount(nSamples / 2);
+      REQUIRE(block->GetSampleCount() == nSamples);
+   }
+
+   SECTION("A stored count other than implied is logged, and not taken")
+   {
+      const auto block = fromXML(1);
+      block->SetImpliedSampleCount(nSamples / 2);
+
+      LogCapture capture;
+      block->GetMinMaxRMS();
+      REQUIRE(block->GetSampleCount() == nSamples / 2);
+      REQUIRE(capture.mText.Contains(
+         "Sample block 1 has 100 samples, but its sequence implies 50"));
+   }
+
+   SECTION("Block metadata is not preloaded for lazy blocks")
+   {
+      pConnection->PreloadSampleBlockMetadata();
+      REQUIRE(!pConnection->TakeSampleBlockMetadata(1));
+
+      LazyProjectOpen.Write(false);
+      pConnection->PreloadSampleBlockMetadata();
+      REQUIRE(pConnection->TakeSampleBlockMetadata(1));
+   }
+}
@@ -0,0 +1,23 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+ Audacity: A Digital Audio Editor
+
+ ProjectFileTestUtils.cpp
+
+ **********************************************************************/
+#include "ProjectFileTestUtils.h"
+
+#include <catch2/catch.hpp>
+
+#include <sqlite3.h>
+
+#include "ProjectFileIO.h"
+
+void InstallProjectSchema(sqlite3* db, const char* schema)
+{
+   const auto sql = ProjectFileIO::SchemaSQL(schema);
+   REQUIRE(
+      sqlite3_exec(db, sql.utf8_str(), nullptr, nullptr, nullptr) ==
+      SQLITE_OK);
+}
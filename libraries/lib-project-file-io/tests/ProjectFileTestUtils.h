@@ -0,0 +1,17 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+ Audacity: A Digital Audio Editor
+
+ ProjectFileTestUtils.h
+
+ **********************************************************************/
+#pragma once
+
+#include "TemporaryDirectory.h"
+
+struct sqlite3;
+
+//! Create the tables of a project file in the given attached database,
+//! with the same statements as ProjectFileIO
+void InstallProjectSchema(sqlite3* db, const char* schema = "main");
@@ -0,0 +1,174 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+ Audacity: A Digital Audio Editor
+
+ SampleBlockMetadataTests.cpp
+
+ **********************************************************************/
+#include <catch2/catch.hpp>
+
+#include <sqlite3.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "DBConnection.h"
+#include "MockedPrefs.h"
+#include "ProjectFileTestUtils.h"
+
+namespace
+{
+constexpr int nBlocks = 20000;
+constexpr int blockBytes = 1024;
+
+sqlite3* MakeDatabase(const std::string& path = ":memory:")
+{
+   sqlite3* db = nullptr;
+   REQUIRE(sqlite3_open(path.c_str(), &db) == SQLITE_OK);
+   InstallProjectSchema(db);
+   REQUIRE(sqlite3_exec(db, "BEGIN;", nullptr, nullptr, nullptr) == SQLITE_OK);
+
+   sqlite3_stmt* stmt = nullptr;
+   REQUIRE(
+      sqlite3_prepare_v2(
+         db,
+         "INSERT INTO sampleblocks (blockid, sampleformat, summin, summax,"
+         "                          sumrms, samples)"
+         "                         VALUES(?1,?2,?3,?4,?5,?6);",
+         -1, &stmt, nullptr) == SQLITE_OK);
+   const std::vector<char> samples(blockBytes);
+   for (int id = 1; id <= nBlocks; ++id)
+   {
+      sqlite3_bind_int64(stmt, 1, id);
+      sqlite3_bind_int(stmt, 2, 0x0004000F);
+      sqlite3_bind_double(stmt, 3, -1.0 / id);
+      sqlite3_bind_double(stmt, 4, 1.0 / id);
+      sqlite3_bind_double(stmt, 5, 0.5 / id);
+      sqlite3_bind_blob(
+         stmt, 6, samples.data(), samples.size() - id % 4, SQLITE_STATIC);
+      REQUIRE(sqlite3_step(stmt) == SQLITE_DONE);
+      sqlite3_reset(stmt);
+   }
+   sqlite3_finalize(stmt);
+
+   REQUIRE(
+      sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr) == SQLITE_OK);
+   return db;
+}
+
+bool SameMetadata(
+   const DBConnection::SampleBlockMetadata& a,
+   const DBConnection::SampleBlockMetadata& b)
+{
+   return a.sampleFormat == b.sampleFormat && a.sumMin == b.sumMin &&
+          a.sumMax == b.sumMax && a.sumRms == b.sumRms &&
+          a.sampleBytes == b.sampleBytes;
+}
+
+//! What SqliteSampleBlock::Load does without preloaded metadata
+DBConnection::SampleBlockMetadataMap ReadEachBlock(sqlite3* db)
+{
+   DBConnection::SampleBlockMetadataMap result;
+   sqlite3_stmt* stmt = nullptr;
+   sqlite3_prepare_v2(
+      db,
+      "SELECT sampleformat, summin, summax, sumrms,"
+      "       length(samples)"
+      "  FROM sampleblocks WHERE blockid = ?1;",
+      -1, &stmt, nullptr);
+   for (int id = 1; id <= nBlocks; ++id)
+   {
+      sqlite3_bind_int64(stmt, 1, id);
+      if (sqlite3_step(stmt) == SQLITE_ROW)
+         result.emplace(id, DBConnection::SampleBlockMetadata {
+            sqlite3_column_int(stmt, 0),
+            sqlite3_column_double(stmt, 1),
+            sqlite3_column_double(stmt, 2),
+            sqlite3_column_double(stmt, 3),
+            sqlite3_column_int(stmt, 4) });
+      sqlite3_reset(stmt);
+   }
+   sqlite3_finalize(stmt);
+   return result;
+}
+} // namespace
+
+TEST_CASE("ReadSampleBlockMetadata")
+{
+   const auto db = MakeDatabase();
+
+   DBConnection::SampleBlockMetadataMap metadata;
+   REQUIRE(DBConnection::ReadSampleBlockMetadata(db, metadata));
+   REQUIRE(metadata.size() == nBlocks);
+
+   const auto expected = ReadEachBlock(db);
+   REQUIRE(std::all_of(
+      expected.begin(), expected.end(), [&](const auto& pair) {
+         const auto iter = metadata.find(pair.first);
+         return iter != metadata.end() && SameMetadata(iter->second, pair.second);
+      }));
+
+   sqlite3_close(db);
+}
+
+TEST_CASE("PreloadSampleBlockMetadata")
+{
+   MockedPrefs mockedPrefs;
+   const TemporaryDirectory directory { "SampleBlockMetadataTests" };
+   const auto path = directory.File("project.aup3");
+
+   const auto db = MakeDatabase(path);
+   const auto expected = ReadEachBlock(db);
+   sqlite3_close(db);
+
+   // The connection that ProjectFileIO::LoadProject preloads, and that
+   // SqliteSampleBlock::Load then takes from
+   DBConnection connection {
+      {}, std::make_shared<DBConnectionErrors>(), nullptr
+   };
+   REQUIRE(connection.Open(wxString::FromUTF8(path)) == SQLITE_OK);
+
+   // Nothing is held until preloaded
+   REQUIRE(!connection.TakeSampleBlockMetadata(1));
+
+   connection.PreloadSampleBlockMetadata();
+   for (const auto id : { 1, 2, nBlocks / 2, nBlocks })
+   {
+      const auto taken = connection.TakeSampleBlockMetadata(id);
+      REQUIRE(taken);
+      REQUIRE(SameMetadata(*taken, expected.at(id)));
+      // Each is given to one block only
+      REQUIRE(!connection.TakeSampleBlockMetadata(id));
+   }
+   REQUIRE(!connection.TakeSampleBlockMetadata(nBlocks + 1));
+
+   // What blocks did not take is freed after loading
+   connection.DiscardSampleBlockMetadata();
+   REQUIRE(!connection.TakeSampleBlockMetadata(3));
+
+   REQUIRE(connection.Close());
+}
+
+// Measures only the queries that SqliteSampleBlock::Load no longer makes for
+// each block, as a proxy for the time to open a project
+TEST_CASE("ReadSampleBlockMetadata benchmark", "[.][benchmark]")
+{
+   const auto db = MakeDatabase();
+
+   BENCHMARK("One query for each block")
+   {
+      return ReadEachBlock(db);
+   };
+
+   BENCHMARK("One scan of the table")
+   {
+      DBConnection::SampleBlockMetadataMap result;
+      DBConnection::ReadSampleBlockMetadata(db, result);
+      return result;
+   };
+
+   sqlite3_close(db);
+}
@@ -13,6 +13,7 @@
 #include "ClipInterface.h"
 #include "ClipSegment.h"
 #include "SilenceSegment.h"
+#include "TimeAndPitchCheckpoints.h"
 #include "TimeAndPitchInterface.h"
 
 #include <algorithm>
@@ -31,6 +32,8 @@ std::vector<std::shared_ptr<AudioSegment>>
 AudioSegmentFactory::CreateAudioSegmentSequence(
    double playbackStartTime, PlaybackDirection direction)
 {
+   mRandomAccess = mStarted;
+   mStarted = true;
    return direction == PlaybackDirection::forward ?
              CreateAudioSegmentSequenceForward(playbackStartTime) :
              CreateAudioSegmentSequenceBackward(playbackStartTime);
@@ -60,7 +63,8 @@ AudioSegmentFactory::CreateAudioSegmentSequenceForward(double t0)
       else if (clip->GetPlayEndTime() <= t0)
          continue;
       segments.push_back(std::make_shared<ClipSegment>(
-         *clip, t0 - clip->GetPlayStartTime(), PlaybackDirection::forward));
+         *clip, t0 - clip->GetPlayStartTime(), PlaybackDirection::forward,
+         GetCheckpoints(*clip, PlaybackDirection::forward)));
       t0 = clip->GetPlayEndTime();
    }
    return segments;
@@ -91,8 +95,32 @@ AudioSegmentFactory::CreateAudioSegmentSequenceBackward(double t0)
       else if (clip->GetPlayStartTime() >= t0)
          continue;
       segments.push_back(std::make_shared<ClipSegment>(
-         *clip, clip->GetPlayEndTime() - t0, PlaybackDirection::backward));
+         *clip, clip->GetPlayEndTime() - t0, PlaybackDirection::backward,
+         GetCheckpoints(*clip, PlaybackDirection::backward)));
       t0 = clip->GetPlayStartTime();
    }
    return segments;
 }
+
+std::shared_ptr<TimeAndPitchCheckpoints> AudioSegmentFactory::GetCheckpoints(
+   const ClipInterface& clip, PlaybackDirection direction)
+{
+   // Continuous playback or export never resumes from a checkpoint
+   if (!mRandomAccess)
+      return nullptr;
+   auto it = std::find_if(
+      mCheckpoints.begin(), mCheckpoints.end(), [&](const auto& entry) {
+         return entry.clip == &clip && entry.direction == direction;
+      });
+   if (it == mCheckpoints.end())
+   {
+      if (mCheckpoints.size() == MaxCheckpointedClips)
+         mCheckpoints.pop_back();
+      mCheckpoints.insert(
+         mCheckpoints.begin(),
+         { &clip, direction, std::make_shared<TimeAndPitchCheckpoints>() });
+   }
+   else
+      std::rotate(mCheckpoints.begin(), it, it + 1);
+   return mCheckpoints.front().checkpoints;
+}
@@ -13,11 +13,13 @@
 
 #include "AudioSegmentFactoryInterface.h"
 #include "ClipInterface.h"
+#include "PlaybackDirection.h"
 #include "TimeAndPitchInterface.h"
 
 #include <memory>
 
 class ClipInterface;
+class TimeAndPitchCheckpoints;
 using ClipConstHolders = std::vector<std::shared_ptr<const ClipInterface>>;
 
 class STRETCHING_SEQUENCE_API AudioSegmentFactory final :
@@ -36,8 +38,28 @@ private:
    std::vector<std::shared_ptr<AudioSegment>>
    CreateAudioSegmentSequenceBackward(double playbackStartTime);
 
+   std::shared_ptr<TimeAndPitchCheckpoints>
+   GetCheckpoints(const ClipInterface&, PlaybackDirection);
+
 private:
+   //! Checkpoints are kept for this many clips and directions at most, the
+   //! most recently played
+   static constexpr size_t MaxCheckpointedClips = 4;
+
+   struct ClipCheckpoints
+   {
+      const ClipInterface* clip;
+      PlaybackDirection direction;
+      std::shared_ptr<TimeAndPitchCheckpoints> checkpoints;
+   };
+
    const ClipConstHolders mClips;
    const int mSampleRate;
    const int mNumChannels;
+   //! Whether playback started again elsewhere, as when scrubbing or looping,
+   //! from which on stretchers save checkpoints
+   bool mRandomAccess = false;
+   bool mStarted = false;
+   //! Most recently used first
+   std::vector<ClipCheckpoints> mCheckpoints;
 };
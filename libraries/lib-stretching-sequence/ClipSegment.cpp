@@ -36,20 +36,41 @@ GetTotalNumSamplesToProduce(const ClipInterface& clip, double durationToDiscard)
                            clip.GetStretchRatio() -
                         durationToDiscard * clip.GetRate() + .5 };
 }
+
+// Where the source starts reading, and the index of the first sample to
+// produce, from the start of the clip in the direction of playback
+TimeAndPitchCheckpoints::Position GetStart(
+   const ClipInterface& clip, double durationToDiscard,
+   const TimeAndPitchCheckpoints* checkpoints)
+{
+   const auto output = static_cast<long long>(
+      durationToDiscard * clip.GetRate() + .5);
+   if (checkpoints)
+      if (
+         const auto checkpoint =
+            checkpoints->Find(output, GetStretchingParameters(clip)))
+         return { checkpoint->input, output };
+   const auto input = static_cast<long long>(
+      clip.GetRate() * durationToDiscard / clip.GetStretchRatio() + .5);
+   return { input, output };
+}
 } // namespace
 
 ClipSegment::ClipSegment(
    const ClipInterface& clip, double durationToDiscard,
-   PlaybackDirection direction)
+   PlaybackDirection direction,
+   std::shared_ptr<TimeAndPitchCheckpoints> checkpoints)
     : mTotalNumSamplesToProduce { GetTotalNumSamplesToProduce(
          clip, durationToDiscard) }
-    , mSource { clip, durationToDiscard, direction }
+    , mCheckpoints { std::move(checkpoints) }
+    , mStart { GetStart(clip, durationToDiscard, mCheckpoints.get()) }
+    , mSource { clip, sampleCount { mStart.input }, direction }
     , mPreserveFormants { clip.GetPitchAndSpeedPreset() ==
                           PitchAndSpeedPreset::OptimizeForVoice }
     , mCentShift { clip.GetCentShift() }
     , mStretcher { std::make_unique<StaffPadTimeAndPitch>(
          clip.GetRate(), clip.NChannels(), mSource,
-         GetStretchingParameters(clip)) }
+         GetStretchingParameters(clip), mCheckpoints.get(), mStart) }
     , mOnSemitoneShiftChangeSubscription { clip.SubscribeToCentShiftChange(
          [this](int cents) {
             mCentShift = cents;
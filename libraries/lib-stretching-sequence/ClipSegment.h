@@ -14,6 +14,7 @@
 #include "ClipTimeAndPitchSource.h"
 #include "Observer.h"
 #include "PlaybackDirection.h"
+#include "TimeAndPitchCheckpoints.h"
 #include <atomic>
 #include <memory>
 
@@ -30,8 +31,13 @@ using PitchRatioChangeCbSubscriber =
 class STRETCHING_SEQUENCE_API ClipSegment final : public AudioSegment
 {
 public:
+   /*!
+    * \param checkpoints If not null, where the stretcher saves its state
+    * while reading, and from which it resumes if near enough
+    */
    ClipSegment(const ClipInterface&,
-      double durationToDiscard, PlaybackDirection);
+      double durationToDiscard, PlaybackDirection,
+      std::shared_ptr<TimeAndPitchCheckpoints> checkpoints = nullptr);
    ~ClipSegment() override;
 
    // AudioSegment
@@ -42,6 +48,8 @@ public:
 private:
    const sampleCount mTotalNumSamplesToProduce;
    sampleCount mTotalNumSamplesProduced = 0;
+   const std::shared_ptr<TimeAndPitchCheckpoints> mCheckpoints;
+   const TimeAndPitchCheckpoints::Position mStart;
    ClipTimeAndPitchSource mSource;
    bool mPreserveFormants;
    int mCentShift;
@@ -18,25 +18,34 @@
 namespace
 {
 sampleCount GetLastReadSample(
-   const ClipInterface& clip, double durationToDiscard,
+   const ClipInterface& clip, sampleCount numSamplesToDiscard,
    PlaybackDirection direction)
 {
    if (direction == PlaybackDirection::forward)
-      return sampleCount {
-         clip.GetRate() * durationToDiscard / clip.GetStretchRatio() + .5
-      };
+      return numSamplesToDiscard;
    else
-      return clip.GetVisibleSampleCount() - sampleCount {
-         clip.GetRate() * durationToDiscard / clip.GetStretchRatio() + .5
-      };
+      return clip.GetVisibleSampleCount() - numSamplesToDiscard;
 }
 } // namespace
 
 ClipTimeAndPitchSource::ClipTimeAndPitchSource(
    const ClipInterface& clip, double durationToDiscard,
+   PlaybackDirection direction)
+    : ClipTimeAndPitchSource { clip,
+                               sampleCount { clip.GetRate() *
+                                                durationToDiscard /
+                                                clip.GetStretchRatio() +
+                                             .5 },
+                               direction }
+{
+}
+
+ClipTimeAndPitchSource::ClipTimeAndPitchSource(
+   const ClipInterface& clip, sampleCount numSamplesToDiscard,
    PlaybackDirection direction)
     : mClip { clip }
-    , mLastReadSample { GetLastReadSample(clip, durationToDiscard, direction) }
+    , mLastReadSample { GetLastReadSample(
+         clip, numSamplesToDiscard, direction) }
     , mPlaybackDirection { direction }
 {
 }
@@ -26,6 +26,10 @@ class STRETCHING_SEQUENCE_API ClipTimeAndPitchSource final :
 public:
    ClipTimeAndPitchSource(
       const ClipInterface&, double durationToDiscard, PlaybackDirection);
+   //! Starts `numSamplesToDiscard` clip samples from the start of the clip, in
+   //! the direction of playback
+   ClipTimeAndPitchSource(
+      const ClipInterface&, sampleCount numSamplesToDiscard, PlaybackDirection);
 
    // TimeAndPitchSource
    void Pull(float* const*, size_t samplesPerChannel) override;
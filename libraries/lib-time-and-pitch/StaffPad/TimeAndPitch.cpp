@@ -87,6 +87,36 @@ struct TimeAndPitch::impl
   std::vector<int> peak_index, trough_index;
 };
 
+struct TimeAndPitch::State
+{
+  std::mt19937 randomGenerator;
+  CircularSampleBuffer<float> inResampleInputBuffer[2];
+  CircularSampleBuffer<float> inCircularBuffer[2];
+  CircularSampleBuffer<float> outCircularBuffer[2];
+  CircularSampleBuffer<float> normalizationBuffer;
+
+  SamplesReal last_phase;
+  SamplesReal phase_accum;
+  SamplesReal last_norm;
+  SamplesReal random_phases;
+
+  double exact_hop_a = 0.0, hop_a_err = 0.0;
+  double exact_hop_s = 0.0;
+  double next_exact_hop_s = 0.0;
+  double hop_s_err = 0.0;
+
+  int numChannels = 0;
+  int maxBlockSize = 0;
+  int fftSize = 0;
+  double resampleReadPos = 0.0;
+  int availableOutputSamples = 0;
+  double overlap_a = 0.0;
+  int analysis_hop_counter = 0;
+  double timeStretch = 1.0;
+  double pitchFactor = 1.0;
+  int outBufferWriteOffset = 0;
+};
+
 TimeAndPitch::TimeAndPitch(
    int fftSize, bool reduceImaging, ShiftTimbreCb shiftTimbreCb)
     : fftSize(fftSize)
@@ -189,6 +219,90 @@ void TimeAndPitch::reset()
 
 namespace {
 
+void copySamples(SamplesReal& dst, const SamplesReal& src)
+{
+  if (dst.getNumChannels() != src.getNumChannels() || dst.getNumSamples() != src.getNumSamples())
+    dst.setSize(src.getNumChannels(), src.getNumSamples());
+  dst.assignSamples(src);
+}
+
+} // namespace
+
+void TimeAndPitch::saveState(std::shared_ptr<State>& state) const
+{
+  if (!state)
+    state = std::make_shared<State>();
+  auto& s = *state;
+
+  s.randomGenerator = d->randomGenerator;
+  for (int ch = 0; ch < _numChannels; ++ch)
+  {
+    s.inResampleInputBuffer[ch].assign(d->inResampleInputBuffer[ch]);
+    s.inCircularBuffer[ch].assign(d->inCircularBuffer[ch]);
+    s.outCircularBuffer[ch].assign(d->outCircularBuffer[ch]);
+  }
+  s.normalizationBuffer.assign(d->normalizationBuffer);
+
+  copySamples(s.last_phase, d->last_phase);
+  copySamples(s.phase_accum, d->phase_accum);
+  copySamples(s.last_norm, d->last_norm);
+  copySamples(s.random_phases, d->random_phases);
+
+  s.exact_hop_a = d->exact_hop_a;
+  s.hop_a_err = d->hop_a_err;
+  s.exact_hop_s = d->exact_hop_s;
+  s.next_exact_hop_s = d->next_exact_hop_s;
+  s.hop_s_err = d->hop_s_err;
+
+  s.numChannels = _numChannels;
+  s.maxBlockSize = _maxBlockSize;
+  s.fftSize = fftSize;
+  s.resampleReadPos = _resampleReadPos;
+  s.availableOutputSamples = _availableOutputSamples;
+  s.overlap_a = _overlap_a;
+  s.analysis_hop_counter = _analysis_hop_counter;
+  s.timeStretch = _timeStretch;
+  s.pitchFactor = _pitchFactor;
+  s.outBufferWriteOffset = _outBufferWriteOffset;
+}
+
+void TimeAndPitch::restoreState(const State& s)
+{
+  assert(s.numChannels == _numChannels);
+  assert(s.maxBlockSize == _maxBlockSize);
+  assert(s.fftSize == fftSize);
+
+  d->randomGenerator = s.randomGenerator;
+  for (int ch = 0; ch < _numChannels; ++ch)
+  {
+    d->inResampleInputBuffer[ch].assign(s.inResampleInputBuffer[ch]);
+    d->inCircularBuffer[ch].assign(s.inCircularBuffer[ch]);
+    d->outCircularBuffer[ch].assign(s.outCircularBuffer[ch]);
+  }
+  d->normalizationBuffer.assign(s.normalizationBuffer);
+
+  d->last_phase.assignSamples(s.last_phase);
+  d->phase_accum.assignSamples(s.phase_accum);
+  d->last_norm.assignSamples(s.last_norm);
+  d->random_phases.assignSamples(s.random_phases);
+
+  d->exact_hop_a = s.exact_hop_a;
+  d->hop_a_err = s.hop_a_err;
+  d->exact_hop_s = s.exact_hop_s;
+  d->next_exact_hop_s = s.next_exact_hop_s;
+  d->hop_s_err = s.hop_s_err;
+
+  _resampleReadPos = s.resampleReadPos;
+  _availableOutputSamples = s.availableOutputSamples;
+  _overlap_a = s.overlap_a;
+  _analysis_hop_counter = s.analysis_hop_counter;
+  _timeStretch = s.timeStretch;
+  _pitchFactor = s.pitchFactor;
+  _outBufferWriteOffset = s.outBufferWriteOffset;
+}
+
+namespace {
+
 // wrap a phase value into -PI..PI
 inline float _unwrapPhase(float arg)
 {
@@ -83,6 +83,24 @@ public:
   */
   void reset();
 
+  /**
+    Processing state: buffered input and output, phases and hop errors.
+  */
+  struct State;
+
+  /**
+    Copy the processing state into `state`, which is allocated if null and
+    reused otherwise. Best called between hops, when all available output
+    samples have been retrieved.
+  */
+  void saveState(std::shared_ptr<State>& state) const;
+
+  /**
+    Resume processing from a state saved by an instance of the same FFT size,
+    set up with the same number of channels and block size.
+  */
+  void restoreState(const State& state);
+
 private:
   const int fftSize;
   static constexpr int overlap = 4;
@@ -79,7 +79,8 @@ GetFormantShifterLogger(int sampleRate)
 
 StaffPadTimeAndPitch::StaffPadTimeAndPitch(
    int sampleRate, size_t numChannels, TimeAndPitchSource& audioSource,
-   const Parameters& parameters)
+   const Parameters& parameters, TimeAndPitchCheckpoints* checkpoints,
+   TimeAndPitchCheckpoints::Position start)
     : mSampleRate(sampleRate)
     , mParameters(parameters)
     , mFormantShifterLogger(GetFormantShifterLogger(sampleRate))
@@ -91,6 +92,8 @@ StaffPadTimeAndPitch::StaffPadTimeAndPitch(
     , mAudioSource(audioSource)
     , mReadBuffer(maxBlockSize, numChannels)
     , mNumChannels(numChannels)
+    , mCheckpoints(checkpoints)
+    , mPosition(start)
 {
    if (mParameters.preserveFormants)
       mFormantShifter.Reset(
@@ -121,19 +124,26 @@ void StaffPadTimeAndPitch::GetSamples(float* const* output, size_t outputLen)
       }
       auto numOutputSamplesAvailable =
          mTimeAndPitch->getNumAvailableOutputSamples();
-      while (numOutputSamplesAvailable <= 0)
+      if (numOutputSamplesAvailable <= 0)
       {
-         auto numRequired = mTimeAndPitch->getSamplesToNextHop();
-         while (numRequired > 0)
+         while (numOutputSamplesAvailable <= 0)
          {
-            const auto numSamplesToFeed = std::min(numRequired, maxBlockSize);
-            mAudioSource.Pull(mReadBuffer.Get(), numSamplesToFeed);
-            mFormantShifterLogger->NewSamplesComing(numSamplesToFeed);
-            mTimeAndPitch->feedAudio(mReadBuffer.Get(), numSamplesToFeed);
-            numRequired -= numSamplesToFeed;
+            auto numRequired = mTimeAndPitch->getSamplesToNextHop();
+            while (numRequired > 0)
+            {
+               const auto numSamplesToFeed =
+                  std::min(numRequired, maxBlockSize);
+               mAudioSource.Pull(mReadBuffer.Get(), numSamplesToFeed);
+               mFormantShifterLogger->NewSamplesComing(numSamplesToFeed);
+               mTimeAndPitch->feedAudio(mReadBuffer.Get(), numSamplesToFeed);
+               mPosition.input += numSamplesToFeed;
+               numRequired -= numSamplesToFeed;
+            }
+            numOutputSamplesAvailable =
+               mTimeAndPitch->getNumAvailableOutputSamples();
          }
-         numOutputSamplesAvailable =
-            mTimeAndPitch->getNumAvailableOutputSamples();
+         // At a hop boundary
+         SaveCheckpoint();
       }
       while (numOutputSamples < outputLen && numOutputSamplesAvailable > 0)
       {
@@ -147,12 +157,15 @@ void StaffPadTimeAndPitch::GetSamples(float* const* output, size_t outputLen)
          mTimeAndPitch->retrieveAudio(buffer, numSamplesToGet);
          numOutputSamplesAvailable -= numSamplesToGet;
          numOutputSamples += numSamplesToGet;
+         mPosition.output += numSamplesToGet;
       }
    }
 }
 
 void StaffPadTimeAndPitch::OnCentShiftChange(int cents)
 {
+   // From here on, positions no longer match those of a new stretcher
+   mCheckpoints = nullptr;
    mParameters.pitchRatio = std::pow(2., cents / 1200.);
    // If pitch shifing was zero before, now it isn't. If it was non-zero before,
    // we don't unset the stretcher even if the new pitch shift is zero, or
@@ -166,6 +179,7 @@ void StaffPadTimeAndPitch::OnCentShiftChange(int cents)
 
 void StaffPadTimeAndPitch::OnFormantPreservationChange(bool preserve)
 {
+   mCheckpoints = nullptr;
    mParameters.preserveFormants = preserve;
    const auto fftSize = GetFftSize(mSampleRate, preserve);
    preserve ? mFormantShifter.Reset(fftSize) : mFormantShifter.Reset();
@@ -179,20 +193,43 @@ void StaffPadTimeAndPitch::InitializeStretcher()
 {
    mTimeAndPitch = CreateTimeAndPitch(
       mSampleRate, mNumChannels, mParameters, mFormantShifter);
-   auto numOutputSamplesToDiscard =
-      mTimeAndPitch->getLatencySamplesForStretchRatio(
-         mParameters.timeRatio * mParameters.pitchRatio);
+   const auto checkpoint =
+      mCheckpoints ?
+         mCheckpoints->FindCheckpoint(mPosition.output, mParameters) :
+         nullptr;
+   if (checkpoint)
+   {
+      // Skip the priming, and only run the few hops up to the start
+      mTimeAndPitch->restoreState(*checkpoint->state);
+      const auto numOutputSamplesToDiscard =
+         static_cast<int>(mPosition.output - checkpoint->position.output);
+      mPosition.input = checkpoint->position.input;
+      DiscardOutput(numOutputSamplesToDiscard);
+   }
+   else
+      DiscardOutput(mTimeAndPitch->getLatencySamplesForStretchRatio(
+         mParameters.timeRatio * mParameters.pitchRatio));
+   // Anchor the start, for a loop to come back to
+   SaveCheckpoint();
+}
+
+void StaffPadTimeAndPitch::DiscardOutput(int numOutputSamplesToDiscard)
+{
    AudioContainer container(maxBlockSize, mNumChannels);
    while (numOutputSamplesToDiscard > 0)
    {
       if (IllState())
          return;
-      auto numRequired = mTimeAndPitch->getSamplesToNextHop();
+      // A restored checkpoint may have output available already
+      auto numRequired = mTimeAndPitch->getNumAvailableOutputSamples() > 0 ?
+                            0 :
+                            mTimeAndPitch->getSamplesToNextHop();
       while (numRequired > 0)
       {
          const auto numSamplesToFeed = std::min(maxBlockSize, numRequired);
          mAudioSource.Pull(container.Get(), numSamplesToFeed);
          mTimeAndPitch->feedAudio(container.Get(), numSamplesToFeed);
+         mPosition.input += numSamplesToFeed;
          numRequired -= numSamplesToFeed;
       }
       const auto totalNumSamplesToRetrieve = std::min(
@@ -210,6 +247,40 @@ void StaffPadTimeAndPitch::InitializeStretcher()
    }
 }
 
+void StaffPadTimeAndPitch::SaveCheckpoint()
+{
+   if (!mCheckpoints)
+      return;
+
+   const auto latency = mTimeAndPitch->getLatencySamplesForStretchRatio(
+      mParameters.timeRatio * mParameters.pitchRatio);
+
+   // The first checkpoint after the start anchors it, unless one is there
+   // already ; later ones are spaced by half the latency, so that resuming
+   // never runs more than half the hops that priming does.
+   const auto anchor = !mLastCheckpointOutput.has_value();
+   if (anchor)
+   {
+      if (const auto existing =
+             mCheckpoints->FindCheckpoint(mPosition.output, mParameters);
+          existing && mPosition.output - existing->position.output <
+                         latency / 2)
+      {
+         mLastCheckpointOutput = existing->position.output;
+         return;
+      }
+   }
+   else if (mPosition.output - *mLastCheckpointOutput < latency / 2)
+      return;
+
+   auto& checkpoint = mCheckpoints->Add(anchor);
+   checkpoint.position = mPosition;
+   checkpoint.parameters = mParameters;
+   checkpoint.latency = latency;
+   mTimeAndPitch->saveState(checkpoint.state);
+   mLastCheckpointOutput = mPosition.output;
+}
+
 bool StaffPadTimeAndPitch::IllState() const
 {
    // It doesn't require samples, yet it doesn't have output samples available.
@@ -2,15 +2,23 @@
 #include "FormantShifter.h"
 #include "FormantShifterLoggerInterface.h"
 #include "StaffPad/TimeAndPitch.h"
+#include "TimeAndPitchCheckpoints.h"
 #include "TimeAndPitchInterface.h"
 
 class TIME_AND_PITCH_API StaffPadTimeAndPitch final :
     public TimeAndPitchInterface
 {
 public:
+   /*!
+    * \param checkpoints If not null, where checkpoints are saved while
+    * reading. The stretcher resumes from the one that
+    * `checkpoints->Find(start.output, parameters)` gives, if any, and then the
+    * source must be at its input position ; otherwise, at `start.input`.
+    */
    StaffPadTimeAndPitch(
       int sampleRate, size_t numChannels, TimeAndPitchSource&,
-      const Parameters&);
+      const Parameters&, TimeAndPitchCheckpoints* checkpoints = nullptr,
+      TimeAndPitchCheckpoints::Position start = {});
    void GetSamples(float* const*, size_t) override;
    void OnCentShiftChange(int cents) override;
    void OnFormantPreservationChange(bool preserve) override;
@@ -18,6 +26,8 @@ public:
 private:
    bool IllState() const;
    void InitializeStretcher();
+   void DiscardOutput(int numOutputSamplesToDiscard);
+   void SaveCheckpoint();
 
    const int mSampleRate;
    const std::unique_ptr<FormantShifterLoggerInterface> mFormantShifterLogger;
@@ -27,4 +37,8 @@ private:
    TimeAndPitchSource& mAudioSource;
    AudioContainer mReadBuffer;
    const size_t mNumChannels;
+   TimeAndPitchCheckpoints* mCheckpoints;
+   TimeAndPitchCheckpoints::Position mPosition;
+   //! Output position of the last checkpoint saved, if any
+   std::optional<long long> mLastCheckpointOutput;
 };
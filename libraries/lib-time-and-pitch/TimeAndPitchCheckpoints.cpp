@@ -0,0 +1,78 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  TimeAndPitchCheckpoints.cpp
+
+**********************************************************************/
+#include "TimeAndPitchCheckpoints.h"
+
+namespace
+{
+bool SameParameters(
+   const TimeAndPitchInterface::Parameters& a,
+   const TimeAndPitchInterface::Parameters& b)
+{
+   return a.timeRatio == b.timeRatio && a.pitchRatio == b.pitchRatio &&
+          a.preserveFormants == b.preserveFormants;
+}
+} // namespace
+
+TimeAndPitchCheckpoints::TimeAndPitchCheckpoints() = default;
+
+TimeAndPitchCheckpoints::~TimeAndPitchCheckpoints() = default;
+
+std::optional<TimeAndPitchCheckpoints::Position> TimeAndPitchCheckpoints::Find(
+   long long outputPosition,
+   const TimeAndPitchInterface::Parameters& parameters) const
+{
+   if (const auto checkpoint = FindCheckpoint(outputPosition, parameters))
+      return checkpoint->position;
+   return {};
+}
+
+size_t TimeAndPitchCheckpoints::Size() const
+{
+   return mRecent.size() + mAnchors.size();
+}
+
+void TimeAndPitchCheckpoints::Clear()
+{
+   mRecent.clear();
+   mNextRecent = 0;
+   mAnchors.clear();
+   mNextAnchor = 0;
+}
+
+const TimeAndPitchCheckpoints::Checkpoint*
+TimeAndPitchCheckpoints::FindCheckpoint(
+   long long outputPosition,
+   const TimeAndPitchInterface::Parameters& parameters) const
+{
+   const Checkpoint* best = nullptr;
+   for (const auto ring : { &mRecent, &mAnchors })
+      for (const auto& checkpoint : *ring)
+      {
+         const auto distance = outputPosition - checkpoint.position.output;
+         if (
+            distance < 0 || distance >= checkpoint.latency ||
+            !SameParameters(checkpoint.parameters, parameters))
+            continue;
+         if (!best || checkpoint.position.output > best->position.output)
+            best = &checkpoint;
+      }
+   return best;
+}
+
+TimeAndPitchCheckpoints::Checkpoint& TimeAndPitchCheckpoints::Add(bool anchor)
+{
+   auto& ring = anchor ? mAnchors : mRecent;
+   auto& next = anchor ? mNextAnchor : mNextRecent;
+   const auto capacity = anchor ? AnchorCapacity : RecentCapacity;
+   if (ring.size() < capacity)
+      return ring.emplace_back();
+   auto& checkpoint = ring[next];
+   next = (next + 1) % capacity;
+   return checkpoint;
+}
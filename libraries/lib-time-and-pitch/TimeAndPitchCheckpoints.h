@@ -0,0 +1,78 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  TimeAndPitchCheckpoints.h
+
+**********************************************************************/
+#pragma once
+
+#include "StaffPad/TimeAndPitch.h"
+#include "TimeAndPitchInterface.h"
+
+#include <memory>
+#include <optional>
+#include <vector>
+
+/*!
+ * \brief States of the stretcher of a StaffPadTimeAndPitch, saved at hop
+ * boundaries while it reads, so that a new one can resume near an earlier
+ * position instead of priming its STFT again.
+ *
+ * \details Positions count samples from the start of the source, in the
+ * direction of reading. Checkpoints are kept in two small rings: one for the
+ * latest reading, spaced by half the stretcher latency, and one for the
+ * positions where reading started, such as the start of a loop.
+ */
+class TIME_AND_PITCH_API TimeAndPitchCheckpoints final
+{
+public:
+   struct Position
+   {
+      long long input = 0;
+      long long output = 0;
+   };
+
+   static constexpr size_t RecentCapacity = 16;
+   static constexpr size_t AnchorCapacity = 4;
+
+   TimeAndPitchCheckpoints();
+   ~TimeAndPitchCheckpoints();
+
+   /*!
+    * \brief The latest checkpoint of these parameters not after
+    * `outputPosition`, and near enough that resuming from it costs less than
+    * priming a new stretcher.
+    */
+   std::optional<Position> Find(
+      long long outputPosition,
+      const TimeAndPitchInterface::Parameters& parameters) const;
+
+   size_t Size() const;
+   void Clear();
+
+private:
+   friend class StaffPadTimeAndPitch;
+
+   struct Checkpoint
+   {
+      Position position;
+      TimeAndPitchInterface::Parameters parameters;
+      //! Output samples a new stretcher discards when priming
+      long long latency = 0;
+      std::shared_ptr<staffpad::TimeAndPitch::State> state;
+   };
+
+   const Checkpoint* FindCheckpoint(
+      long long outputPosition,
+      const TimeAndPitchInterface::Parameters& parameters) const;
+
+   //! The entry to overwrite with a new checkpoint, reusing its buffers
+   Checkpoint& Add(bool anchor);
+
+   std::vector<Checkpoint> mRecent;
+   size_t mNextRecent = 0;
+   std::vector<Checkpoint> mAnchors;
+   size_t mNextAnchor = 0;
+};
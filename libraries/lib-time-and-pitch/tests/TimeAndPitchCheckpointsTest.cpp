@@ -0,0 +1,159 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  TimeAndPitchCheckpointsTest.cpp
+
+**********************************************************************/
+#include "TimeAndPitchCheckpoints.h"
+#include "AudioContainer.h"
+#include "MockedPrefs.h"
+#include "StaffPadTimeAndPitch.h"
+
+#include <catch2/catch.hpp>
+
+#include <cmath>
+#include <vector>
+
+namespace
+{
+constexpr auto sampleRate = 44100;
+
+//! A chord of sines, that can start reading anywhere
+class SeekableSource final : public TimeAndPitchSource
+{
+public:
+   explicit SeekableSource(long long start)
+       : mPosition { start }
+   {
+   }
+
+   void Pull(float* const* buffer, size_t samplesPerChannel) override
+   {
+      for (auto i = 0u; i < samplesPerChannel; ++i, ++mPosition)
+      {
+         const auto t = static_cast<double>(mPosition) / sampleRate;
+         buffer[0][i] = static_cast<float>(
+            .3 * std::sin(2 * M_PI * 220 * t) +
+            .2 * std::sin(2 * M_PI * 331 * t) +
+            .1 * std::sin(2 * M_PI * 1234 * t));
+      }
+   }
+
+private:
+   long long mPosition;
+};
+
+std::vector<float> Read(TimeAndPitchInterface& stretcher, size_t numSamples)
+{
+   std::vector<float> output(numSamples);
+   constexpr size_t blockSize = 512u;
+   for (size_t offset = 0; offset < numSamples; offset += blockSize)
+   {
+      float* buffer[] { output.data() + offset };
+      stretcher.GetSamples(buffer, std::min(blockSize, numSamples - offset));
+   }
+   return output;
+}
+
+constexpr size_t numSamples = 3 * sampleRate;
+
+TimeAndPitchInterface::Parameters Parameters()
+{
+   TimeAndPitchInterface::Parameters params;
+   params.timeRatio = 1.37;
+   params.pitchRatio = 1.;
+   return params;
+}
+
+//! Stretch from the start without seeking, leaving checkpoints behind
+std::vector<float> ReadContinuously(
+   const TimeAndPitchInterface::Parameters& params,
+   TimeAndPitchCheckpoints& checkpoints)
+{
+   SeekableSource source { 0 };
+   StaffPadTimeAndPitch continuous { sampleRate, 1, source, params,
+                                     &checkpoints };
+   return Read(continuous, numSamples);
+}
+} // namespace
+
+TEST_CASE("TimeAndPitchCheckpoints")
+{
+   MockedPrefs mockedPrefs;
+
+   const auto params = Parameters();
+   TimeAndPitchCheckpoints checkpoints;
+   const auto expected = ReadContinuously(params, checkpoints);
+
+   REQUIRE(checkpoints.Size() > 0);
+   REQUIRE(checkpoints.Size() <= TimeAndPitchCheckpoints::RecentCapacity +
+                                    TimeAndPitchCheckpoints::AnchorCapacity);
+
+   SECTION("Resuming from a checkpoint continues the same output")
+   {
+      const long long seekPosition = numSamples - 20000;
+      const auto found = checkpoints.Find(seekPosition, params);
+      REQUIRE(found.has_value());
+      REQUIRE(found->output <= seekPosition);
+
+      SeekableSource source { found->input };
+      StaffPadTimeAndPitch resumed { sampleRate, 1, source, params,
+                                     &checkpoints, { 0, seekPosition } };
+      const auto output = Read(resumed, 10000);
+      REQUIRE(std::equal(
+         output.begin(), output.end(), expected.begin() + seekPosition));
+   }
+
+   SECTION("Resuming from the anchor of the start")
+   {
+      const auto found = checkpoints.Find(100, params);
+      REQUIRE(found.has_value());
+      REQUIRE(found->output <= 100);
+   }
+
+   SECTION("Checkpoints are found only for the same parameters")
+   {
+      auto other = params;
+      other.timeRatio = 1.5;
+      REQUIRE(!checkpoints.Find(numSamples - 1, other).has_value());
+      other = params;
+      other.pitchRatio = 1.1;
+      REQUIRE(!checkpoints.Find(numSamples - 1, other).has_value());
+   }
+
+   SECTION("Checkpoints are not found before or far after them")
+   {
+      REQUIRE(!checkpoints.Find(-1, params).has_value());
+      REQUIRE(!checkpoints.Find(10 * numSamples, params).has_value());
+   }
+}
+
+TEST_CASE("TimeAndPitchCheckpoints benchmark", "[.][benchmark]")
+{
+   MockedPrefs mockedPrefs;
+
+   const auto params = Parameters();
+   TimeAndPitchCheckpoints checkpoints;
+   ReadContinuously(params, checkpoints);
+
+   // The time from a seek to the first block of output
+   const long long seekPosition = numSamples - 20000;
+   BENCHMARK("Seek with a fresh stretcher")
+   {
+      SeekableSource source { static_cast<long long>(
+         seekPosition / params.timeRatio) };
+      StaffPadTimeAndPitch fresh { sampleRate, 1, source, params, nullptr,
+                                   { 0, seekPosition } };
+      return Read(fresh, 512);
+   };
+   BENCHMARK("Seek resuming from a checkpoint")
+   {
+      const auto found = checkpoints.Find(seekPosition, params);
+      SeekableSource source { found->input };
+      StaffPadTimeAndPitch resumed { sampleRate, 1, source, params,
+                                     &checkpoints, { 0, seekPosition } };
+      return Read(resumed, 512);
+   };
+}
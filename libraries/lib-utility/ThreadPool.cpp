@@ -0,0 +1,208 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file ThreadPool.cpp
+
+**********************************************************************/
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <future>
+#include <optional>
+
+namespace Parallel
+{
+struct ThreadPool::Job
+{
+   struct Queue {
+      std::mutex mutex;
+      std::deque<size_t> indices;
+   };
+
+   Job(const std::function<void(size_t)> &task, size_t count, size_t nQueues)
+      : task{ task }, queues(nQueues), remaining{ count }
+   {
+      // Deal contiguous runs, so neighboring indices tend to run together
+      for (size_t iQueue = 0; iQueue < nQueues; ++iQueue) {
+         const auto begin = count * iQueue / nQueues;
+         const auto end = count * (iQueue + 1) / nQueues;
+         auto &indices = queues[iQueue].indices;
+         for (auto i = begin; i < end; ++i)
+            indices.push_back(i);
+      }
+   }
+
+   //! Take from the front of the thread's own queue, else from the back of
+   //! another
+   std::optional<size_t> Next(size_t iQueue)
+   {
+      {
+         auto &queue = queues[iQueue];
+         std::lock_guard<std::mutex> lock{ queue.mutex };
+         if (!queue.indices.empty()) {
+            const auto result = queue.indices.front();
+            queue.indices.pop_front();
+            return result;
+         }
+      }
+      for (size_t offset = 1; offset < queues.size(); ++offset) {
+         auto &queue = queues[(iQueue + offset) % queues.size()];
+         std::lock_guard<std::mutex> lock{ queue.mutex };
+         if (!queue.indices.empty()) {
+            const auto result = queue.indices.back();
+            queue.indices.pop_back();
+            return result;
+         }
+      }
+      return {};
+   }
+
+   void Run(size_t iQueue)
+   {
+      while (const auto index = Next(iQueue)) {
+         if (!failed.load(std::memory_order_acquire)) {
+            try {
+               task(*index);
+            }
+            catch (...) {
+               std::lock_guard<std::mutex> lock{ mutex };
+               if (!exception)
+                  exception = std::current_exception();
+               failed.store(true, std::memory_order_release);
+            }
+         }
+         if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            std::lock_guard<std::mutex> lock{ mutex };
+            done.notify_all();
+         }
+      }
+   }
+
+   const std::function<void(size_t)> &task;
+   std::vector<Queue> queues;
+   //! Queues not yet claimed by a thread; the caller claims the first
+   size_t nextQueue{ 1 };
+
+   std::atomic<size_t> remaining;
+   std::atomic<bool> failed{ false };
+   std::mutex mutex;
+   std::condition_variable done;
+   std::exception_ptr exception;
+};
+
+ThreadPool &ThreadPool::Get()
+{
+   static ThreadPool instance{
+      std::max(std::thread::hardware_concurrency(), 1u) - 1 };
+   return instance;
+}
+
+ThreadPool::ThreadPool(size_t nWorkers)
+{
+   mWorkers.reserve(nWorkers);
+   for (size_t i = 0; i < nWorkers; ++i)
+      mWorkers.emplace_back([this]{ WorkerLoop(); });
+}
+
+ThreadPool::~ThreadPool()
+{
+   {
+      std::lock_guard<std::mutex> lock{ mMutex };
+      mStop = true;
+   }
+   mCondition.notify_all();
+   for (auto &worker : mWorkers)
+      worker.join();
+}
+
+void ThreadPool::WorkerLoop()
+{
+   while (true) {
+      std::shared_ptr<Job> pJob;
+      size_t iQueue = 0;
+      {
+         std::unique_lock<std::mutex> lock{ mMutex };
+         mCondition.wait(lock, [this]{ return mStop || !mJobs.empty(); });
+         if (mStop)
+            return;
+         pJob = mJobs.front();
+         iQueue = pJob->nextQueue++;
+         if (pJob->nextQueue == pJob->queues.size())
+            mJobs.pop_front();
+      }
+      pJob->Run(iQueue);
+   }
+}
+
+void ThreadPool::ParallelFor(size_t count,
+   const std::function<void(size_t)> &task, size_t concurrency)
+{
+   if (concurrency == 0)
+      concurrency = Workers() + 1;
+   const auto nQueues = std::min({ concurrency, Workers() + 1, count });
+   if (nQueues <= 1) {
+      for (size_t i = 0; i < count; ++i)
+         task(i);
+      return;
+   }
+
+   const auto pJob = std::make_shared<Job>(task, count, nQueues);
+   {
+      std::lock_guard<std::mutex> lock{ mMutex };
+      mJobs.push_back(pJob);
+   }
+   for (size_t i = 1; i < nQueues; ++i)
+      mCondition.notify_one();
+
+   pJob->Run(0);
+
+   {
+      std::unique_lock<std::mutex> lock{ pJob->mutex };
+      pJob->done.wait(lock, [&]{
+         return pJob->remaining.load(std::memory_order_acquire) == 0; });
+   }
+   {
+      // Workers that have not yet claimed a queue need not do so now
+      std::lock_guard<std::mutex> lock{ mMutex };
+      const auto end = mJobs.end(),
+         iter = std::find(mJobs.begin(), end, pJob);
+      if (iter != end)
+         mJobs.erase(iter);
+   }
+   if (pJob->exception)
+      std::rethrow_exception(pJob->exception);
+}
+
+bool ThreadPool::ParallelFor(size_t count,
+   const std::function<void(size_t)> &task,
+   const std::function<bool()> &poll, std::atomic<bool> &cancelled)
+{
+   auto running = std::async(std::launch::async, [&]{
+      ParallelFor(count, task);
+   });
+
+   using namespace std::chrono_literals;
+   bool polling = true;
+   try {
+      while (running.wait_for(50ms) != std::future_status::ready)
+         if (polling && !poll()) {
+            polling = false;
+            cancelled.store(true, std::memory_order_relaxed);
+         }
+   }
+   catch (...) {
+      // Stop the tasks before what they use goes
+      cancelled.store(true, std::memory_order_relaxed);
+      running.wait();
+      throw;
+   }
+   // Rethrow any exception of the tasks
+   running.get();
+   return polling;
+}
+} // namespace Parallel
@@ -0,0 +1,85 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file ThreadPool.h
+  @brief A fixed set of worker threads for fork-join parallel loops
+
+**********************************************************************/
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Parallel
+{
+//! Worker threads that help callers of ParallelFor
+/*!
+ Each call of ParallelFor deals its indices into one queue for each
+ participating thread.  A thread that exhausts its own queue steals from the
+ back of the others, so that uneven tasks still balance.
+
+ The calling thread always participates, so ParallelFor makes progress even
+ when all workers are busy, including when called from inside a task.
+ */
+class UTILITY_API ThreadPool final
+{
+public:
+   //! The pool shared by the application, with one worker fewer than the
+   //! hardware threads
+   static ThreadPool &Get();
+
+   explicit ThreadPool(size_t nWorkers);
+   ThreadPool(const ThreadPool&) = delete;
+   ThreadPool &operator=(const ThreadPool&) = delete;
+   ~ThreadPool();
+
+   size_t Workers() const { return mWorkers.size(); }
+
+   //! Call task(i) for each i in [0, count), then return
+   /*!
+    The calls happen in unspecified order and on unspecified threads.
+    If any call throws, the first exception is rethrown after the others
+    finish; tasks not yet started are skipped.
+
+    @param concurrency most threads to use, including the caller; 0 for all
+    */
+   void ParallelFor(size_t count,
+      const std::function<void(size_t)> &task, size_t concurrency = 0);
+
+   //! ParallelFor on other threads, while the calling thread polls for
+   //! progress, as for a progress dialog
+   /*!
+    poll is called about every 50 ms until all tasks are done.  When it
+    returns false or throws, cancelled is set, for the tasks to observe, and
+    poll is not called again.  An exception of poll is rethrown when the
+    tasks have finished; otherwise an exception of a task is rethrown as by
+    ParallelFor.
+
+    @return false if poll cancelled
+    */
+   bool ParallelFor(size_t count,
+      const std::function<void(size_t)> &task,
+      const std::function<bool()> &poll, std::atomic<bool> &cancelled);
+
+private:
+   struct Job;
+
+   void WorkerLoop();
+
+   std::mutex mMutex;
+   std::condition_variable mCondition;
+   //! Jobs with queues not yet claimed by any thread
+   std::deque<std::shared_ptr<Job>> mJobs;
+   bool mStop{ false };
+   std::vector<std::thread> mWorkers;
+};
+} // namespace Parallel
@@ -0,0 +1,90 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  ThreadPoolTest.cpp
+
+**********************************************************************/
+#include <catch2/catch.hpp>
+#include "ThreadPool.h"
+
+#include <atomic>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+TEST_CASE("ThreadPool")
+{
+   Parallel::ThreadPool pool{ 3 };
+   REQUIRE(pool.Workers() == 3);
+
+   SECTION("Each index is visited exactly once")
+   {
+      for (const size_t count : { 0, 1, 2, 7, 1000 }) {
+         std::vector<std::atomic<int>> visits(count);
+         pool.ParallelFor(count, [&](size_t i){ ++visits[i]; });
+         for (auto &visit : visits)
+            REQUIRE(visit == 1);
+      }
+   }
+
+   SECTION("Concurrency can be limited to the calling thread")
+   {
+      const auto caller = std::this_thread::get_id();
+      bool elsewhere = false;
+      pool.ParallelFor(100, [&](size_t){
+         elsewhere = elsewhere || std::this_thread::get_id() != caller; }, 1);
+      REQUIRE(!elsewhere);
+   }
+
+   SECTION("Nested loops complete")
+   {
+      std::atomic<size_t> total{ 0 };
+      pool.ParallelFor(8, [&](size_t){
+         pool.ParallelFor(8, [&](size_t i){ total += i; });
+      });
+      REQUIRE(total == 8 * 28);
+   }
+
+   SECTION("An exception propagates to the caller")
+   {
+      REQUIRE_THROWS_AS(pool.ParallelFor(50, [](size_t i){
+         if (i == 17)
+            throw std::runtime_error{ "task failed" };
+      }), std::runtime_error);
+      // The pool remains usable
+      std::atomic<size_t> count{ 0 };
+      pool.ParallelFor(10, [&](size_t){ ++count; });
+      REQUIRE(count == 10);
+   }
+
+   SECTION("Polling can cancel the tasks")
+   {
+      std::atomic<bool> cancelled{ false };
+      std::atomic<size_t> started{ 0 };
+      size_t polls = 0;
+      const auto finished = pool.ParallelFor(4, [&](size_t){
+         ++started;
+         while (!cancelled.load(std::memory_order_relaxed))
+            std::this_thread::yield();
+      }, [&]{ return ++polls < 2; }, cancelled);
+      REQUIRE(!finished);
+      REQUIRE(polls == 2);
+      REQUIRE(started == 4);
+   }
+
+   SECTION("An exception of polling propagates after the tasks stop")
+   {
+      std::atomic<bool> cancelled{ false };
+      std::atomic<size_t> running{ 0 };
+      REQUIRE_THROWS_AS(pool.ParallelFor(4, [&](size_t){
+         ++running;
+         while (!cancelled.load(std::memory_order_relaxed))
+            std::this_thread::yield();
+         --running;
+      }, []() -> bool { throw std::runtime_error{ "cancelled" }; },
+         cancelled), std::runtime_error);
+      REQUIRE(running == 0);
+   }
+}
@@ -0,0 +1,206 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file SpectrogramFile.cpp
+
+**********************************************************************/
+#include "SpectrogramFile.h"
+
+#include "SampleBlock.h"
+#include "SampleCount.h"
+#include "Sequence.h"
+#include "WaveClip.h"
+
+#include <vector>
+#include <wx/ffile.h>
+#include <wx/filefn.h>
+#include <wx/log.h>
+
+namespace {
+//! Identifies the format; the rest of the file is a sequence of entries,
+//! each an EntryHeader followed by the floats of one column, all in native
+//! byte order
+constexpr uint64_t Magic = 0x3330435053445541; // "AUDSPC03"
+
+struct EntryHeader
+{
+   uint64_t key;
+   //! The sample the column is centered at
+   int64_t position;
+   //! Number of floats
+   uint64_t count;
+};
+
+bool WriteEntry(wxFFile &file, uint64_t key, int64_t position,
+   const float *data, size_t count)
+{
+   const EntryHeader header{ key, position, count };
+   const auto bytes = count * sizeof(float);
+   return file.Write(&header, sizeof header) == sizeof header &&
+      file.Write(data, bytes) == bytes;
+}
+
+//! 64 bit FNV-1a
+struct Hasher
+{
+   template<typename T> void Add(const T &value)
+   {
+      const auto bytes = reinterpret_cast<const unsigned char*>(&value);
+      for (size_t ii = 0; ii < sizeof(T); ++ii)
+         hash = (hash ^ bytes[ii]) * 0x100000001b3;
+   }
+   uint64_t hash{ 0xcbf29ce484222325 };
+};
+}
+
+uint64_t SpectrogramFile::Key(const WaveClipChannel &clip,
+   std::initializer_list<int> parameters)
+{
+   const auto pBlocks = clip.GetSequenceBlockArray();
+   if (!pBlocks || clip.GetAppendBufferLen() > 0)
+      return 0;
+
+   Hasher hasher;
+   for (const auto &block : *pBlocks) {
+      hasher.Add(block.sb->GetBlockID());
+      hasher.Add(block.start.as_long_long());
+      const auto summary = block.sb->GetMinMaxRMS(false);
+      hasher.Add(summary.min);
+      hasher.Add(summary.max);
+      hasher.Add(summary.RMS);
+   }
+   hasher.Add(clip.GetTrimLeft());
+   hasher.Add(clip.GetTrimRight());
+   hasher.Add(clip.GetStretchRatio());
+   hasher.Add(clip.GetRate());
+
+   for (const auto parameter : parameters)
+      hasher.Add(parameter);
+   // Reserve 0 for no key
+   return hasher.hash ? hasher.hash : 1;
+}
+
+SpectrogramFile::SpectrogramFile(const FilePath &fileName)
+   : mFileName{ fileName }
+{
+}
+
+void SpectrogramFile::ReadIndex()
+{
+   if (mIndexRead)
+      return;
+   mIndexRead = true;
+   mIndex.clear();
+
+   if (!wxFileExists(mFileName))
+      return;
+   wxFFile file{ mFileName, wxT("rb") };
+   uint64_t magic{};
+   if (!file.IsOpened() ||
+      file.Read(&magic, sizeof magic) != sizeof magic || magic != Magic)
+      return;
+
+   // Stop at any truncated entry
+   const uint64_t length = file.Length();
+   uint64_t offset = sizeof magic;
+   EntryHeader header;
+   while (file.Read(&header, sizeof header) == sizeof header) {
+      offset += sizeof header;
+      const auto bytes = header.count * sizeof(float);
+      if (bytes > length - offset)
+         break;
+      mIndex[header.key][header.position] = { offset, header.count };
+      offset += bytes;
+      if (!file.Seek(offset))
+         break;
+   }
+}
+
+bool SpectrogramFile::Load(uint64_t key, const sampleCount *where,
+   size_t nColumns, size_t nBins, float *freq)
+{
+   ReadIndex();
+   const auto iter = mIndex.find(key);
+   if (iter == mIndex.end())
+      return false;
+
+   // Read nothing unless all columns are stored
+   const auto &columns = iter->second;
+   std::vector<uint64_t> offsets(nColumns);
+   for (size_t xx = 0; xx < nColumns; ++xx) {
+      const auto found = columns.find(where[xx].as_long_long());
+      if (found == columns.end() || found->second.count != nBins)
+         return false;
+      offsets[xx] = found->second.offset;
+   }
+
+   wxFFile file{ mFileName, wxT("rb") };
+   if (!file.IsOpened())
+      return false;
+   const auto bytes = nBins * sizeof(float);
+   for (size_t xx = 0; xx < nColumns; ++xx)
+      if (!file.Seek(offsets[xx]) ||
+          file.Read(freq + nBins * xx, bytes) != bytes)
+         return false;
+   return true;
+}
+
+bool SpectrogramFile::Save(const Columns &columns, uint64_t maxRetainedBytes)
+{
+   // Index the file, if not done yet, before replacing it
+   ReadIndex();
+   if (columns.empty() && mIndex.empty())
+      return true;
+
+   const auto tempName = mFileName + wxT(".tmp");
+   bool ok = false;
+   {
+      wxFFile out{ tempName, wxT("wb") };
+      ok = out.IsOpened() && out.Write(&Magic, sizeof Magic) == sizeof Magic;
+      uint64_t total = 0;
+      for (const auto &[key, keyColumns] : columns)
+         for (const auto &[position, column] : keyColumns) {
+            if (!ok)
+               break;
+            ok = WriteEntry(out, key, position, column.data, column.count);
+            total += column.count * sizeof(float);
+         }
+
+      // Retain columns of other clips, zooms and scroll positions
+      if (ok && !mIndex.empty()) {
+         wxFFile in{ mFileName, wxT("rb") };
+         std::vector<float> buffer;
+         for (const auto &[key, locations] : mIndex) {
+            const auto pSaved = columns.find(key);
+            for (const auto &[position, location] : locations) {
+               if (!in.IsOpened() || !ok || total >= maxRetainedBytes)
+                  break;
+               if (pSaved != columns.end() && pSaved->second.count(position))
+                  continue;
+               buffer.resize(location.count);
+               const auto bytes = buffer.size() * sizeof(float);
+               if (!in.Seek(location.offset) ||
+                   in.Read(buffer.data(), bytes) != bytes)
+                  continue;
+               ok = WriteEntry(
+                  out, key, position, buffer.data(), buffer.size());
+               total += bytes;
+            }
+         }
+      }
+      ok = out.Close() && ok;
+   }
+
+   if (ok && wxRenameFile(tempName, mFileName, true)) {
+      // Index the new file at the next lookup
+      mIndex.clear();
+      mIndexRead = false;
+      return true;
+   }
+   wxLogMessage("Could not save spectrograms to %s", mFileName);
+   if (wxFileExists(tempName))
+      wxRemoveFile(tempName);
+   return false;
+}
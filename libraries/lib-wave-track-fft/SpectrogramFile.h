@@ -0,0 +1,97 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file SpectrogramFile.h
+  @brief A file of spectrogram columns, kept between sessions of a project
+
+**********************************************************************/
+#ifndef __AUDACITY_SPECTROGRAM_FILE__
+#define __AUDACITY_SPECTROGRAM_FILE__
+
+#include "Identifier.h"
+
+#include <cstdint>
+#include <initializer_list>
+#include <map>
+#include <unordered_map>
+
+class sampleCount;
+class WaveClipChannel;
+
+//! Columns of spectrograms, each keyed by Key() and by the sample at which
+//! it is centered
+/*!
+ So a column can never be mistaken for that of different samples or
+ settings, and columns stored for one zoom and scroll position serve any
+ other that centers columns at the same samples.
+
+ The index of the file is read at the first lookup.
+ */
+class WAVE_TRACK_FFT_API SpectrogramFile final
+{
+public:
+   //! Columns of earlier saves are dropped once the file grows past this
+   static constexpr uint64_t MaxRetainedBytes = 256 * 1024 * 1024;
+
+   //! Identifies the samples of a clip and the parameters of its spectrogram
+   /*!
+    Block ids are not reused within a project; the summaries of the blocks
+    guard against a file left beside a different project of the same name.
+    @param parameters of the spectrogram, which change all its columns
+    @return 0, which is never a key, if the clip has unflushed samples
+    */
+   static uint64_t Key(const WaveClipChannel &clip,
+      std::initializer_list<int> parameters);
+
+   explicit SpectrogramFile(const FilePath &fileName);
+   SpectrogramFile(const SpectrogramFile&) = delete;
+   SpectrogramFile &operator=(const SpectrogramFile&) = delete;
+
+   const FilePath &GetFileName() const { return mFileName; }
+
+   //! Fill freq with the stored columns for the key, centered at the samples
+   //! in where, if all of them are stored with nBins values
+   /*!
+    @param freq has room for nColumns * nBins values
+    @return whether all were found
+    */
+   bool Load(uint64_t key, const sampleCount *where, size_t nColumns,
+      size_t nBins, float *freq);
+
+   struct Column {
+      const float *data;
+      //! Number of floats
+      size_t count;
+   };
+   //! Columns by key, then by the sample they are centered at
+   using Columns = std::unordered_map<uint64_t, std::map<int64_t, Column>>;
+
+   //! Rewrite the file with the given columns, then the stored columns that
+   //! they do not replace, until the file holds maxRetainedBytes of columns
+   /*!
+    A new file is written and then replaces the old, so that an interrupted
+    save leaves the old one usable.
+    @return success
+    */
+   bool Save(const Columns &columns,
+      uint64_t maxRetainedBytes = MaxRetainedBytes);
+
+private:
+   void ReadIndex();
+
+   struct Location {
+      uint64_t offset;
+      //! Number of floats
+      uint64_t count;
+   };
+
+   const FilePath mFileName;
+   //! Locations of the columns of each key, by the sample they are centered
+   //! at
+   std::unordered_map<uint64_t, std::unordered_map<int64_t, Location>> mIndex;
+   bool mIndexRead{ false };
+};
+
+#endif
@@ -12,6 +12,8 @@ Edward Hui
 
 #include <algorithm>
 #include "FFT.h"
+#include "FFTEngine.h"
+#include "ThreadPool.h"
 #include "WaveTrack.h"
 
 SpectrumTransformer::SpectrumTransformer( bool needsOutput,
@@ -25,7 +27,7 @@ SpectrumTransformer::SpectrumTransformer( bool needsOutput,
 , mStepSize{ mWindowSize / mStepsPerWindow }
 , mLeadingPadding{ leadingPadding }
 , mTrailingPadding{ trailingPadding }
-, hFFT{ GetFFT(mWindowSize) }
+, mEngine{ FFTEngine::Get(mWindowSize) }
 , mFFTBuffer( mWindowSize )
 , mInWaveBuffer( mWindowSize )
 , mOutOverlapBuffer( mWindowSize )
@@ -103,7 +105,20 @@ bool SpectrumTransformer::DoFinish()
 void
 TrackSpectrumTransformer::DoOutput(const float *outBuffer, size_t mStepSize)
 {
-   mOutputTrack->Append((constSamplePtr)outBuffer, floatSample, mStepSize);
+   if (!mpSegmentOutput) {
+      mOutputTrack->Append((constSamplePtr)outBuffer, floatSample, mStepSize);
+      return;
+   }
+
+   // Discard the output of the warm-up, and any after the segment
+   auto len = mStepSize;
+   const auto skip = limitSampleBufferSize(len, mSegmentSkip);
+   mSegmentSkip -= skip;
+   outBuffer += skip;
+   len -= skip;
+   auto &output = *mpSegmentOutput;
+   len = std::min(len, mSegmentLength - output.size());
+   output.insert(output.end(), outBuffer, outBuffer + len);
 }
 
 bool SpectrumTransformer::Start(size_t queueLength)
@@ -211,7 +226,7 @@ void SpectrumTransformer::FillFirstWindow()
       else
          memmove(pFFTBuffer, pInWaveBuffer, mWindowSize * sizeof(float));
    }
-   RealFFTf(mFFTBuffer.data(), hFFT.get());
+   mEngine.Forward(mFFTBuffer.data(), mFFTBuffer.data());
 
    auto &record = Nth(0);
 
@@ -219,12 +234,11 @@ void SpectrumTransformer::FillFirstWindow()
    {
       float *pReal = &record.mRealFFTs[1];
       float *pImag = &record.mImagFFTs[1];
-      int *pBitReversed = &hFFT->BitReversed[1];
+      const float *pFFTBuffer = &mFFTBuffer[2];
       const auto last = mSpectrumSize - 1;
       for (size_t ii = 1; ii < last; ++ii) {
-         const int kk = *pBitReversed++;
-         *pReal++ = mFFTBuffer[kk];
-         *pImag++ = mFFTBuffer[kk + 1];
+         *pReal++ = *pFFTBuffer++;
+         *pImag++ = *pFFTBuffer++;
       }
       // DC and Fs/2 bins need to be handled specially
       const float dc = mFFTBuffer[0];
@@ -281,7 +295,6 @@ void SpectrumTransformer::OutputStep()
    if (!mNeedsOutput)
       return;
    if (QueueIsFull()) {
-      const auto last = mSpectrumSize - 1;
       Window &record = **mQueue.rbegin();
 
       const float *pReal = &record.mRealFFTs[1];
@@ -297,27 +310,21 @@ void SpectrumTransformer::OutputStep()
       mFFTBuffer[1] = record.mImagFFTs[0];
 
       // Invert the FFT into the output buffer
-      InverseRealFFTf(mFFTBuffer.data(), hFFT.get());
+      mEngine.Inverse(mFFTBuffer.data(), mFFTBuffer.data());
 
       // Overlap-add
       if (mOutWindow.size() > 0) {
          auto pOut = mOutOverlapBuffer.data();
          auto pWindow = mOutWindow.data();
-         auto pBitReversed = &hFFT->BitReversed[0];
-         for (size_t jj = 0; jj < last; ++jj) {
-            auto kk = *pBitReversed++;
-            *pOut++ += mFFTBuffer[kk] * (*pWindow++);
-            *pOut++ += mFFTBuffer[kk + 1] * (*pWindow++);
-         }
+         auto pFFTBuffer = mFFTBuffer.data();
+         for (size_t jj = 0; jj < mWindowSize; ++jj)
+            *pOut++ += *pFFTBuffer++ * (*pWindow++);
       }
       else {
          auto pOut = mOutOverlapBuffer.data();
-         auto pBitReversed = &hFFT->BitReversed[0];
-         for (size_t jj = 0; jj < last; ++jj) {
-            auto kk = *pBitReversed++;
-            *pOut++ += mFFTBuffer[kk];
-            *pOut++ += mFFTBuffer[kk + 1];
-         }
+         auto pFFTBuffer = mFFTBuffer.data();
+         for (size_t jj = 0; jj < mWindowSize; ++jj)
+            *pOut++ += *pFFTBuffer++;
       }
       auto buffer = mOutOverlapBuffer.data();
       if (mOutStepCount >= 0) {
@@ -370,6 +377,118 @@ bool TrackSpectrumTransformer::Process(const WindowProcessor &processor,
    return bLoopSuccess;
 }
 
+bool TrackSpectrumTransformer::ProcessSegmented(const Factory &factory,
+   const WindowProcessor &processor, const WaveChannel &channel,
+   size_t queueLength, sampleCount start, sampleCount len,
+   size_t warmupWindows, const ProgressReporter &progress)
+{
+   assert(NeedsOutput() && mLeadingPadding && mTrailingPadding);
+
+   // Segments of whole hops, long enough that the warm-up is a small part of
+   // each, but short enough that the output of one round of segments, kept
+   // in memory, stays small
+   constexpr size_t minSegmentLength = 1 << 18;
+   constexpr size_t maxSegmentLength = 1 << 20;
+   auto &pool = Parallel::ThreadPool::Get();
+   const auto concurrency = pool.Workers() + 1;
+   const auto segmentLength = std::clamp(
+      ((len + concurrency - 1) / concurrency).as_size_t(),
+      minSegmentLength, maxSegmentLength) / mStepSize * mStepSize;
+   const auto nSegments =
+      ((len + segmentLength - 1) / segmentLength).as_size_t();
+
+   if (pool.Workers() == 0 || nSegments < 2) {
+      sampleCount nWindows = 0;
+      return Process([&](SpectrumTransformer &transformer) {
+         return processor(transformer) && progress(std::min(1.0,
+            (++nWindows * mStepSize).as_double() / len.as_double()));
+      }, channel, queueLength, start, len);
+   }
+
+   std::atomic<bool> cancelled{ false };
+   std::atomic<long long> done{ 0 };
+   std::vector<FloatVector> outputs(std::min(concurrency, nSegments));
+   std::vector<char> results(outputs.size());
+   for (size_t first = 0; first < nSegments; first += outputs.size()) {
+      // Process a round of segments, then output them in order
+      const auto count = std::min(outputs.size(), nSegments - first);
+      const auto finished = pool.ParallelFor(count, [&](size_t ii) {
+         const sampleCount from = (first + ii) * segmentLength;
+         const auto to = std::min(len, from + segmentLength);
+         results[ii] = factory()->ProcessSegment(processor, channel,
+            queueLength, start, len, from, to, warmupWindows,
+            outputs[ii], cancelled, done);
+      }, [&]{
+         return progress(
+            done.load(std::memory_order_relaxed) / len.as_double());
+      }, cancelled);
+
+      if (!finished ||
+          !std::all_of(results.begin(), results.begin() + count,
+             [](char result) { return result; }))
+         return false;
+      for (size_t ii = 0; ii < count; ++ii)
+         DoOutput(outputs[ii].data(), outputs[ii].size());
+   }
+
+   return true;
+}
+
+bool TrackSpectrumTransformer::ProcessSegment(
+   const WindowProcessor &processor, const WaveChannel &channel,
+   size_t queueLength, sampleCount start, sampleCount len,
+   sampleCount from, sampleCount to, size_t warmupWindows,
+   FloatVector &output, const std::atomic<bool> &cancelled,
+   std::atomic<long long> &done)
+{
+   mpChannel = &channel;
+
+   // Begin at a hop, so that the windows after the leading padding are the
+   // same as those of Process()
+   const auto warmup = warmupWindows * mStepSize + (mWindowSize - mStepSize);
+   const auto warmStart =
+      std::max<sampleCount>(0, from - sampleCount(warmup)) / mStepSize
+         * mStepSize;
+   mSegmentSkip = from - warmStart;
+   mSegmentLength = (to - from).as_size_t();
+   output.clear();
+   output.reserve(mSegmentLength);
+   mpSegmentOutput = &output;
+
+   if (!Start(queueLength))
+      return false;
+
+   auto bufferSize = channel.GetMaxBlockSize();
+   FloatVector buffer(bufferSize);
+
+   bool bLoopSuccess = true;
+   auto samplePos = start + warmStart;
+   while (bLoopSuccess && output.size() < mSegmentLength &&
+          samplePos < start + len) {
+      if (cancelled.load(std::memory_order_relaxed))
+         return false;
+
+      const auto blockSize = limitSampleBufferSize(
+         std::min(bufferSize, channel.GetBestBlockSize(samplePos)),
+         start + len - samplePos);
+      channel.GetFloats(buffer.data(), samplePos, blockSize);
+      samplePos += blockSize;
+      const auto oldSize = output.size();
+      bLoopSuccess = ProcessSamples(processor, buffer.data(), blockSize);
+      done.fetch_add(output.size() - oldSize, std::memory_order_relaxed);
+   }
+
+   // Flush the queue, as at the end of Process(), if the segment reaches
+   // near enough to the end
+   if (bLoopSuccess && output.size() < mSegmentLength) {
+      const auto oldSize = output.size();
+      bLoopSuccess = Finish(processor);
+      done.fetch_add(output.size() - oldSize, std::memory_order_relaxed);
+   }
+
+   return bLoopSuccess && output.size() == mSegmentLength;
+}
+
 bool TrackSpectrumTransformer::DoFinish()
 {
    return SpectrumTransformer::DoFinish();
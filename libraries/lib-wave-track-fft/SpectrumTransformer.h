@@ -12,15 +12,17 @@ Paul Licameli
 #ifndef __AUDACITY_SPECTRUM_TRANSFORMER__
 #define __AUDACITY_SPECTRUM_TRANSFORMER__
  
+#include <atomic>
 #include <functional>
 #include <memory>
 #include <vector>
 #include "audacity/Types.h"
-#include "RealFFTf.h"
 #include "SampleCount.h"
 
 enum eWindowFunctions : int;
 
+class FFTEngine;
+
 class WaveChannel;
 
 /*!
@@ -32,7 +34,7 @@ class WaveChannel;
  and -behind to nearby windows.  May also be used just to gather information
  without producing output.
 */
-class SpectrumTransformer /* not final */
+class WAVE_TRACK_FFT_API SpectrumTransformer /* not final */
 {
 public:
    // Public interface
@@ -83,7 +85,7 @@ public:
    bool Finish(const WindowProcessor &processor);
 
    //! Derive this class to add information to the queue.  @see NewWindow()
-   struct Window
+   struct WAVE_TRACK_FFT_API Window
    {
       explicit Window(size_t windowSize)
          : mRealFFTs( windowSize / 2 )
@@ -164,7 +166,7 @@ protected:
 
 private:
    std::vector<std::unique_ptr<Window>> mQueue;
-   HFFT     hFFT;
+   const FFTEngine &mEngine;
    sampleCount mInSampleCount = 0;
    sampleCount mOutStepCount = 0; //!< sometimes negative
    size_t mInWavePos = 0;
@@ -183,12 +185,14 @@ private:
 class WaveTrack;
 
 //! Subclass of SpectrumTransformer that rewrites a track
-class TrackSpectrumTransformer /* not final */ : public SpectrumTransformer {
+class WAVE_TRACK_FFT_API TrackSpectrumTransformer /* not final */
+   : public SpectrumTransformer {
 public:
    /*!
     @copydoc SpectrumTransformer::SpectrumTransformer(bool,
        eWindowFunctions, eWindowFunctions, size_t, unsigned, bool, bool)
-    @pre `!needsOutput || pOutputTrack != nullptr`
+    @pre `!needsOutput || pOutputTrack != nullptr`, unless made by a
+    Factory for ProcessSegmented()
     */
    TrackSpectrumTransformer(WaveChannel *pOutputTrack,
       bool needsOutput, eWindowFunctions inWindowType,
@@ -199,7 +203,6 @@ public:
       }
       , mOutputTrack{ pOutputTrack }
    {
-      assert(!needsOutput || pOutputTrack != nullptr);
    }
    ~TrackSpectrumTransformer() override;
 
@@ -207,6 +210,33 @@ public:
    bool Process(const WindowProcessor &processor, const WaveChannel &channel,
       size_t queueLength, sampleCount start, sampleCount len);
 
+   //! Type of function that makes the transformer of one segment
+   /*! It is called on the thread that processes the segment.  The result
+      should be made with a null output track. */
+   using Factory = std::function<std::unique_ptr<TrackSpectrumTransformer>()>;
+
+   //! Type of function reporting the fraction done; returns false to cancel
+   using ProgressReporter = std::function<bool(double)>;
+
+   //! Like Process(), but splits the channel into segments aligned to window
+   //! hops, and processes them on several threads
+   /*!
+    Each segment is processed by its own transformer from the factory, fed
+    from `warmupWindows` hops before the segment (besides the padding of a
+    window), and its output before the segment is discarded.  The segments
+    are then output in order.  This is the same output as that of Process(),
+    if the processor depends on no windows more than `warmupWindows` hops
+    earlier.
+
+    Falls back to Process() when the range is too short to split, or there
+    are no worker threads.  `progress` is called only on this thread.
+    @pre `NeedsOutput()`, with leading and trailing padding
+    */
+   bool ProcessSegmented(const Factory &factory,
+      const WindowProcessor &processor, const WaveChannel &channel,
+      size_t queueLength, sampleCount start, sampleCount len,
+      size_t warmupWindows, const ProgressReporter &progress);
+
    //! Final flush and trimming of tail samples
    static bool PostProcess(WaveTrack &outputTrack, sampleCount len);
 
@@ -216,8 +246,23 @@ protected:
    bool DoFinish() override;
 
 private:
+   //! Process samples of [from, to) relative to start into output,
+   //! for ProcessSegmented()
+   bool ProcessSegment(const WindowProcessor &processor,
+      const WaveChannel &channel, size_t queueLength, sampleCount start,
+      sampleCount len, sampleCount from, sampleCount to, size_t warmupWindows,
+      FloatVector &output, const std::atomic<bool> &cancelled,
+      std::atomic<long long> &done);
+
    WaveChannel *const mOutputTrack;
    const WaveChannel *mpChannel = nullptr;
+
+   //! When processing a segment, output goes here rather than to the track
+   FloatVector *mpSegmentOutput = nullptr;
+   //! Output samples still to discard before the segment
+   sampleCount mSegmentSkip = 0;
+   //! Length of the segment
+   size_t mSegmentLength = 0;
 };
 
 #endif
@@ -0,0 +1,213 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+ Audacity: A Digital Audio Editor
+
+ SpectrogramFileTests.cpp
+
+ **********************************************************************/
+#include <catch2/catch.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <vector>
+
+#include "FakeSampleBlock.h"
+#include "MockedPrefs.h"
+#include "SampleCount.h"
+#include "SpectrogramFile.h"
+#include "TemporaryDirectory.h"
+#include "WaveClip.h"
+#include "WaveTrack.h"
+
+namespace
+{
+constexpr size_t nBins = 4;
+
+//! Columns of distinct values
+std::vector<float> MakeColumns(size_t nColumns, float first)
+{
+   std::vector<float> data(nColumns * nBins);
+   for (size_t ii = 0; ii < data.size(); ++ii)
+      data[ii] = first + ii;
+   return data;
+}
+
+//! Add the columns for the key, centered every 100 samples from 0
+void AddColumns(
+   SpectrogramFile::Columns& columns, uint64_t key,
+   const std::vector<float>& data)
+{
+   for (size_t xx = 0; xx < data.size() / nBins; ++xx)
+      columns[key][100 * xx] =
+         SpectrogramFile::Column { &data[nBins * xx], nBins };
+}
+
+bool Load(
+   SpectrogramFile& file, uint64_t key, std::vector<sampleCount> where,
+   const std::vector<float>& expected)
+{
+   std::vector<float> freq(where.size() * nBins);
+   return file.Load(key, where.data(), where.size(), nBins, freq.data()) &&
+          freq == expected;
+}
+
+void Append(WaveTrack& track, size_t len)
+{
+   const std::vector<float> samples(len, 0.25f);
+   track.Append(
+      0, reinterpret_cast<constSamplePtr>(samples.data()), floatSample, len);
+}
+} // namespace
+
+TEST_CASE("SpectrogramFile")
+{
+   const TemporaryDirectory directory { "SpectrogramFileTests" };
+   const auto path = directory.File("project.aup3-spectrogram");
+   const auto fileName = wxString::FromUTF8(path);
+
+   const auto data = MakeColumns(3, 1);
+   SpectrogramFile::Columns columns;
+   AddColumns(columns, 1, data);
+
+   SECTION("Columns saved are loaded in a later session")
+   {
+      REQUIRE(SpectrogramFile { fileName }.Save(columns));
+
+      SpectrogramFile file { fileName };
+      REQUIRE(Load(file, 1, { 0, 100, 200 }, data));
+      // Columns for another zoom or scroll position
+      REQUIRE(
+         Load(file, 1, { 100, 200 }, { data.begin() + nBins, data.end() }));
+
+      // But not those of other samples or settings, or not all stored, or of
+      // another number of bins
+      std::vector<float> freq(3 * nBins);
+      const sampleCount where[] { 0, 100, 200 };
+      REQUIRE(!file.Load(2, where, 3, nBins, freq.data()));
+      const sampleCount between[] { 0, 150 };
+      REQUIRE(!file.Load(1, between, 2, nBins, freq.data()));
+      REQUIRE(!file.Load(1, where, 3, nBins - 1, freq.data()));
+   }
+
+   SECTION("A truncated entry is ignored, but not those before it")
+   {
+      REQUIRE(SpectrogramFile { fileName }.Save(columns));
+      std::filesystem::resize_file(
+         path, std::filesystem::file_size(path) - sizeof(float));
+
+      SpectrogramFile file { fileName };
+      REQUIRE(
+         Load(file, 1, { 0, 100 }, { data.begin(), data.end() - nBins }));
+      std::vector<float> freq(nBins);
+      const sampleCount last[] { 200 };
+      REQUIRE(!file.Load(1, last, 1, nBins, freq.data()));
+   }
+
+   SECTION("A file of another format is ignored, and replaced")
+   {
+      std::ofstream { path } << "AUDSPC02 and more";
+
+      SpectrogramFile file { fileName };
+      std::vector<float> freq(nBins);
+      const sampleCount first[] { 0 };
+      REQUIRE(!file.Load(1, first, 1, nBins, freq.data()));
+
+      REQUIRE(file.Save(columns));
+      REQUIRE(Load(file, 1, { 0, 100, 200 }, data));
+   }
+
+   SECTION("Saving keeps stored columns that are not replaced, up to a limit")
+   {
+      REQUIRE(SpectrogramFile { fileName }.Save(columns));
+
+      // Replace the column at 0, and add one of another key
+      const auto replacement = MakeColumns(1, 100);
+      const auto other = MakeColumns(1, 200);
+      SpectrogramFile::Columns newColumns;
+      AddColumns(newColumns, 1, replacement);
+      AddColumns(newColumns, 2, other);
+
+      constexpr auto columnBytes = nBins * sizeof(float);
+      SECTION("All kept under the limit")
+      {
+         SpectrogramFile file { fileName };
+         REQUIRE(file.Save(newColumns));
+         REQUIRE(Load(file, 1, { 0 }, replacement));
+         REQUIRE(
+            Load(file, 1, { 100, 200 }, { data.begin() + nBins, data.end() }));
+         REQUIRE(Load(file, 2, { 0 }, other));
+      }
+
+      SECTION("None kept when the new columns reach the limit")
+      {
+         SpectrogramFile file { fileName };
+         REQUIRE(file.Save(newColumns, 2 * columnBytes));
+         REQUIRE(Load(file, 1, { 0 }, replacement));
+         REQUIRE(Load(file, 2, { 0 }, other));
+         std::vector<float> freq(nBins);
+         for (const sampleCount position : { 100, 200 })
+            REQUIRE(!file.Load(1, &position, 1, nBins, freq.data()));
+      }
+
+      SECTION("Some kept until the limit is reached")
+      {
+         SpectrogramFile file { fileName };
+         REQUIRE(file.Save(newColumns, 3 * columnBytes));
+         std::vector<float> freq(nBins);
+         size_t nKept = 0;
+         for (const sampleCount position : { 100, 200 })
+            nKept += file.Load(1, &position, 1, nBins, freq.data());
+         REQUIRE(nKept == 1);
+      }
+   }
+}
+
+TEST_CASE("SpectrogramFile::Key")
+{
+   MockedPrefs mockedPrefs;
+
+   const auto track = WaveTrack::Create(
+      std::make_shared<FakeSampleBlockFactory>(), floatSample, 44100);
+   Append(*track, 44100);
+   track->Flush();
+
+   const auto key = [&](std::initializer_list<int> parameters) {
+      const auto pClip = *(*track->Channels().begin())->Intervals().begin();
+      return SpectrogramFile::Key(*pClip, parameters);
+   };
+   const auto original = key({ 1, 2, 3, 4, 5 });
+   REQUIRE(original != 0);
+   REQUIRE(key({ 1, 2, 3, 4, 5 }) == original);
+
+   SECTION("Each parameter of the spectrogram changes the key")
+   {
+      REQUIRE(key({ 0, 2, 3, 4, 5 }) != original);
+      REQUIRE(key({ 1, 0, 3, 4, 5 }) != original);
+      REQUIRE(key({ 1, 2, 0, 4, 5 }) != original);
+      REQUIRE(key({ 1, 2, 3, 0, 5 }) != original);
+      REQUIRE(key({ 1, 2, 3, 4, 0 }) != original);
+   }
+
+   SECTION("Unflushed samples have no key, and flushed ones change it")
+   {
+      Append(*track, 100);
+      REQUIRE(key({ 1, 2, 3, 4, 5 }) == 0);
+      track->Flush();
+      REQUIRE(key({ 1, 2, 3, 4, 5 }) != 0);
+      REQUIRE(key({ 1, 2, 3, 4, 5 }) != original);
+   }
+
+   SECTION("Edits of the samples change the key")
+   {
+      track->Clear(0.1, 0.2);
+      REQUIRE(key({ 1, 2, 3, 4, 5 }) != original);
+   }
+
+   SECTION("Trimming changes the key")
+   {
+      (*track->Intervals().begin())->SetTrimLeft(0.1);
+      REQUIRE(key({ 1, 2, 3, 4, 5 }) != original);
+   }
+}
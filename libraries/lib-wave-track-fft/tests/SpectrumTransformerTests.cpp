@@ -0,0 +1,313 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+ Audacity: A Digital Audio Editor
+
+ SpectrumTransformerTests.cpp
+
+ **********************************************************************/
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "Dither.h"
+#include "FFT.h"
+#include "MockedPrefs.h"
+#include "SampleBlock.h"
+#include "SpectrumTransformer.h"
+#include "ThreadPool.h"
+#include "WaveTrack.h"
+
+namespace
+{
+//! A block that keeps its samples in memory
+class MemorySampleBlock final : public SampleBlock
+{
+public:
+   MemorySampleBlock(SampleBlockID id, std::vector<float> samples)
+       : mID { id }
+       , mSamples { std::move(samples) }
+   {
+   }
+
+   void CloseLock() noexcept override
+   {
+   }
+
+   SampleBlockID GetBlockID() const override
+   {
+      return mID;
+   }
+
+   BlockSampleView GetFloatSampleView(bool) override
+   {
+      return std::make_shared<std::vector<float>>(mSamples);
+   }
+
+   sampleFormat GetSampleFormat() const override
+   {
+      return floatSample;
+   }
+
+   size_t GetSampleCount() const override
+   {
+      return mSamples.size();
+   }
+
+   bool GetSummary256(float*, size_t, size_t) override
+   {
+      return false;
+   }
+
+   bool GetSummary64k(float*, size_t, size_t) override
+   {
+      return false;
+   }
+
+   size_t GetSpaceUsage() const override
+   {
+      return mSamples.size() * sizeof(float);
+   }
+
+   void SaveXML(XMLWriter&) override
+   {
+   }
+
+protected:
+   size_t DoGetSamples(
+      samplePtr dest, sampleFormat destformat, size_t sampleoffset,
+      size_t numsamples) override
+   {
+      if (sampleoffset >= mSamples.size())
+         return 0;
+      numsamples = std::min(numsamples, mSamples.size() - sampleoffset);
+      CopySamples(
+         reinterpret_cast<constSamplePtr>(mSamples.data() + sampleoffset),
+         floatSample, dest, destformat, numsamples, DitherType::none);
+      return numsamples;
+   }
+
+   MinMaxRMS DoGetMinMaxRMS(size_t start, size_t len) override
+   {
+      return Measure(start, len);
+   }
+
+   MinMaxRMS DoGetMinMaxRMS() const override
+   {
+      return Measure(0, mSamples.size());
+   }
+
+private:
+   MinMaxRMS Measure(size_t start, size_t len) const
+   {
+      if (len == 0)
+         return { 0, 0, 0 };
+      const auto first = mSamples.begin() + start;
+      const auto [min, max] = std::minmax_element(first, first + len);
+      double sumsq = 0;
+      std::for_each(first, first + len, [&](float x) { sumsq += x * x; });
+      return { *min, *max, static_cast<float>(std::sqrt(sumsq / len)) };
+   }
+
+   const SampleBlockID mID;
+   const std::vector<float> mSamples;
+};
+
+class MemorySampleBlockFactory final : public SampleBlockFactory
+{
+public:
+   SampleBlockIDs GetActiveBlockIDs() override
+   {
+      return {};
+   }
+
+protected:
+   SampleBlockPtr DoCreate(
+      constSamplePtr src, size_t numsamples, sampleFormat srcformat) override
+   {
+      std::vector<float> samples(numsamples);
+      CopySamples(
+         src, srcformat, reinterpret_cast<samplePtr>(samples.data()),
+         floatSample, numsamples, DitherType::none);
+      return std::make_shared<MemorySampleBlock>(
+         ++mLastID, std::move(samples));
+   }
+
+   SampleBlockPtr DoCreateSilent(size_t numsamples, sampleFormat) override
+   {
+      return std::make_shared<MemorySampleBlock>(
+         ++mLastID, std::vector<float>(numsamples));
+   }
+
+   SampleBlockPtr DoCreateFromXML(sampleFormat, const AttributesList&) override
+   {
+      return nullptr;
+   }
+
+   SampleBlockPtr DoCreateFromId(sampleFormat, SampleBlockID) override
+   {
+      return nullptr;
+   }
+
+private:
+   SampleBlockID mLastID = 0;
+};
+
+constexpr size_t windowSize = 2048;
+constexpr unsigned stepsPerWindow = 4;
+constexpr size_t queueLength = 2;
+constexpr float gainFloor = 0.01f;
+constexpr float release = 0.9f;
+
+//! Gates windows by their power, and lets the gain of a window decay over
+//! later windows down to a floor, as the release of the noise reduction
+//! effect does
+class GateTransformer final : public TrackSpectrumTransformer
+{
+public:
+   explicit GateTransformer(WaveChannel* pOutputTrack)
+       : TrackSpectrumTransformer { pOutputTrack, true, eWinFuncHann,
+                                    eWinFuncHann, windowSize, stepsPerWindow,
+                                    true, true }
+   {
+   }
+
+   static bool Processor(SpectrumTransformer& trans)
+   {
+      auto& transformer = static_cast<GateTransformer&>(trans);
+      auto& newest = transformer.NthWindow(0);
+      double power = 0;
+      for (const auto coefficient : newest.mRealFFTs)
+         power += coefficient * coefficient;
+      for (const auto coefficient : newest.mImagFFTs)
+         power += coefficient * coefficient;
+      newest.mGain = std::max(
+         power > 1 ? 1.0f : gainFloor,
+         transformer.NthWindow(1).mGain * release);
+
+      if (transformer.QueueIsFull())
+      {
+         auto& latest = transformer.NthWindow(queueLength - 1);
+         for (auto& coefficient : latest.mRealFFTs)
+            coefficient *= latest.mGain;
+         for (auto& coefficient : latest.mImagFFTs)
+            coefficient *= latest.mGain;
+      }
+      return true;
+   }
+
+   //! Windows earlier than these make no difference to the gain of a window,
+   //! counted as EffectNoiseReduction::Worker::WarmupWindows() does
+   static size_t WarmupWindows()
+   {
+      size_t nDecay = 0;
+      for (float gain = 1.0f; gain > gainFloor; gain *= release)
+         ++nDecay;
+      return nDecay;
+   }
+
+private:
+   struct GateWindow : Window
+   {
+      using Window::Window;
+      float mGain = 0;
+   };
+
+   GateWindow& NthWindow(int nn)
+   {
+      return static_cast<GateWindow&>(Nth(nn));
+   }
+
+   std::unique_ptr<Window> NewWindow(size_t size) override
+   {
+      return std::make_unique<GateWindow>(size);
+   }
+
+   bool DoStart() override
+   {
+      for (size_t ii = 0; ii < TotalQueueSize(); ++ii)
+         NthWindow(ii).mGain = gainFloor;
+      return TrackSpectrumTransformer::DoStart();
+   }
+};
+
+//! Bursts of a sine, between a quieter one that the gate closes on
+WaveTrack::Holder MakeTrack(size_t len)
+{
+   const auto track = WaveTrack::Create(
+      std::make_shared<MemorySampleBlockFactory>(), floatSample, 44100);
+   std::vector<float> samples(len);
+   constexpr size_t burst = 8192;
+   for (size_t ii = 0; ii < len; ++ii)
+   {
+      const auto loud = (ii / burst) % 3 == 0;
+      samples[ii] = (loud ? 0.5 : 0.0001) *
+                    std::sin(2 * M_PI * (loud ? 440 : 1000) * ii / 44100.0);
+   }
+   track->Append(
+      0, reinterpret_cast<constSamplePtr>(samples.data()), floatSample, len);
+   track->Flush();
+   return track;
+}
+
+//! Transform the track serially when warmupWindows is zero, else in segments
+std::vector<float>
+Transform(const WaveTrack& track, size_t len, size_t warmupWindows)
+{
+   const auto output = track.EmptyCopy();
+   const auto pOutputChannel = *output->Channels().begin();
+   const auto& channel = **track.Channels().begin();
+   GateTransformer transformer { pOutputChannel.get() };
+   if (warmupWindows == 0)
+      REQUIRE(transformer.Process(
+         GateTransformer::Processor, channel, queueLength, 0, len));
+   else
+   {
+      const auto factory = [] {
+         return std::make_unique<GateTransformer>(nullptr);
+      };
+      REQUIRE(transformer.ProcessSegmented(
+         factory, GateTransformer::Processor, channel, queueLength, 0, len,
+         warmupWindows, [](double) { return true; }));
+   }
+   TrackSpectrumTransformer::PostProcess(*output, len);
+
+   std::vector<float> samples(len);
+   REQUIRE(pOutputChannel->GetFloats(samples.data(), 0, len));
+   return samples;
+}
+} // namespace
+
+TEST_CASE("TrackSpectrumTransformer::ProcessSegmented")
+{
+   MockedPrefs mockedPrefs;
+
+   // Long enough for two segments on any number of threads, split at 2^18
+   // samples, in the quiet after a burst, where the gate is releasing
+   constexpr size_t len = 1 << 19;
+   const auto track = MakeTrack(len);
+   const auto serial = Transform(*track, len, 0);
+
+   SECTION("Segments warmed up by the memory of the processor give the same "
+           "samples as one pass")
+   {
+      const auto segmented =
+         Transform(*track, len, GateTransformer::WarmupWindows());
+      REQUIRE(std::equal(serial.begin(), serial.end(), segmented.begin()));
+   }
+
+   SECTION("Segments warmed up by fewer windows differ")
+   {
+      // Without workers, ProcessSegmented() falls back to Process()
+      if (Parallel::ThreadPool::Get().Workers() > 0)
+      {
+         const auto segmented =
+            Transform(*track, len, GateTransformer::WarmupWindows() / 4);
+         REQUIRE(
+            !std::equal(serial.begin(), serial.end(), segmented.begin()));
+      }
+   }
+}
@@ -53,6 +53,52 @@ bool IsKeyLess(
       return lhs.PixelsPerSecond < rhs.PixelsPerSecond;
 }
 
+//! The elements of the cache that cover a range of time
+struct ElementRange final
+{
+   //! First pixel of the range
+   int64_t Left;
+   //! Pixel past the end of the range
+   int64_t Right;
+   //! First pixel of the first element
+   int64_t FirstColumn;
+   //! Pixel past the end of the last element
+   int64_t LastColumn;
+   int64_t ElementsCount;
+   double PixelsPerSecond;
+   double SamplesPerPixel;
+
+   GraphicsDataCacheKey GetKey(int64_t elementIndex) const noexcept
+   {
+      const int64_t column =
+         FirstColumn + elementIndex * GraphicsDataCacheBase::CacheElementWidth;
+
+      return { PixelsPerSecond, static_cast<int64_t>(column * SamplesPerPixel) };
+   }
+};
+
+ElementRange GetElementRange(
+   const ZoomInfo& zoomInfo, double t0, double t1, double sampleRate) noexcept
+{
+   constexpr int64_t width = GraphicsDataCacheBase::CacheElementWidth;
+
+   const double pixelsPerSecond = zoomInfo.GetZoom();
+
+   const int64_t left  = zoomInfo.TimeToPosition(t0);
+   const int64_t right = zoomInfo.TimeToPosition(t1) + 1;
+
+   const int64_t cacheLeft  = left / width;
+   const int64_t cacheRight = right / width + 1;
+
+   return { left,
+            right,
+            cacheLeft * width,
+            cacheRight * width,
+            cacheRight - cacheLeft,
+            pixelsPerSecond,
+            sampleRate / pixelsPerSecond };
+}
+
 template<typename Container>
 auto GetPPSMatchRange(
    const Container& container, double pixelsPerSecond, double sampleRate)
@@ -71,12 +117,35 @@ auto GetPPSMatchRange(
 }
 } // namespace
 
+double GraphicsDataCacheBase::Statistics::GetHitRate() const noexcept
+{
+   const auto total = Hits + Misses;
+   return total == 0 ? 0.0 : double(Hits) / total;
+}
+
+std::chrono::nanoseconds
+GraphicsDataCacheBase::Statistics::GetMeanFillTime() const noexcept
+{
+   if (Misses == 0)
+      return std::chrono::nanoseconds { 0 };
+
+   return FillTime / static_cast<int64_t>(Misses);
+}
+
 void GraphicsDataCacheBase::Invalidate()
 {
    for (auto& item : mLookup)
       DisposeElement(item.Data);
 
    mLookup.clear();
+
+   OnInvalidated();
+}
+
+GraphicsDataCacheBase::Statistics
+GraphicsDataCacheBase::GetStatistics() const noexcept
+{
+   return mStatistics;
 }
 
 double GraphicsDataCacheBase::GetScaledSampleRate() const noexcept
@@ -110,6 +179,38 @@ void GraphicsDataCacheBase::SetScaledSampleRate(double scaledSampleRate)
    Invalidate();
 }
 
+void GraphicsDataCacheBase::OnInvalidated()
+{
+}
+
+bool GraphicsDataCacheBase::IsSameKey(
+   GraphicsDataCacheKey lhs, GraphicsDataCacheKey rhs) const noexcept
+{
+   return ::IsSameKey(mScaledSampleRate, lhs, rhs);
+}
+
+std::vector<GraphicsDataCacheKey> GraphicsDataCacheBase::GetMissingKeys(
+   const ZoomInfo& zoomInfo, double t0, double t1)
+{
+   std::vector<GraphicsDataCacheKey> keys;
+
+   if (bool(t0 > t1) || IsSameSample(mScaledSampleRate, t0, t1))
+      return keys;
+
+   const auto range = GetElementRange(zoomInfo, t0, t1, mScaledSampleRate);
+
+   for (int64_t itemIndex = 0; itemIndex < range.ElementsCount; ++itemIndex)
+   {
+      const auto key = range.GetKey(itemIndex);
+      const auto it  = FindKey(key);
+
+      if (it == mLookup.end() || !it->Data->IsComplete)
+         keys.push_back(key);
+   }
+
+   return keys;
+}
+
 void GraphicsDataCacheElementBase::Dispose()
 {
 }
@@ -126,21 +227,19 @@ GraphicsDataCacheBase::PerformBaseLookup(
    if (bool(t0 > t1) || IsSameSample(mScaledSampleRate, t0, t1))
       return {};
 
-   const double pixelsPerSecond = zoomInfo.GetZoom();
+   const auto range = GetElementRange(zoomInfo, t0, t1, mScaledSampleRate);
 
-   const int64_t left  = zoomInfo.TimeToPosition(t0);
-   const int64_t right = zoomInfo.TimeToPosition(t1) + 1;
+   const double pixelsPerSecond = range.PixelsPerSecond;
 
-   const int64_t width = right - left;
+   const int64_t left  = range.Left;
+   const int64_t right = range.Right;
 
-   const int64_t cacheLeft       = left / CacheElementWidth;
-   const int64_t cacheRight      = right / CacheElementWidth + 1;
-   const int64_t cacheItemsCount = cacheRight - cacheLeft;
+   const int64_t width = right - left;
 
-   const int64_t cacheLeftColumn  = cacheLeft * CacheElementWidth;
-   const int64_t cacheRightColumn = cacheRight * CacheElementWidth;
+   const int64_t cacheItemsCount = range.ElementsCount;
 
-   const double samplesPerPixel = mScaledSampleRate / pixelsPerSecond;
+   const int64_t cacheLeftColumn  = range.FirstColumn;
+   const int64_t cacheRightColumn = range.LastColumn;
 
    UpdateViewportWidth(width);
 
@@ -152,25 +251,27 @@ GraphicsDataCacheBase::PerformBaseLookup(
 
    for (int64_t itemIndex = 0; itemIndex < cacheItemsCount; ++itemIndex)
    {
-      const int64_t column = cacheLeftColumn + itemIndex * CacheElementWidth;
-
-      const int64_t firstSample =
-         static_cast<int64_t>(column * samplesPerPixel);
+      const auto key = range.GetKey(itemIndex);
 
       const auto it = std::find_if(
          ppsMatchRange.first, ppsMatchRange.second,
-         [firstSample](auto element)
+         [firstSample = key.FirstSample](auto element)
          { return element.Key.FirstSample == firstSample; });
 
       if (it == ppsMatchRange.second)
-         mNewLookupItems.push_back({ pixelsPerSecond, firstSample });
+         mNewLookupItems.push_back({ key });
    }
 
    bool needsSmoothing = !mNewLookupItems.empty();
 
    ++mCacheAccessIndex;
 
-   if (!CreateNewItems())
+   const auto fillStart = std::chrono::steady_clock::now();
+   const bool created = CreateNewItems();
+   mStatistics.FillTime += std::chrono::steady_clock::now() - fillStart;
+   mStatistics.Misses += mNewLookupItems.size();
+
+   if (!created)
    {
       DisposeNewItems();
       return {};
@@ -188,9 +289,7 @@ GraphicsDataCacheBase::PerformBaseLookup(
    mLookupHelper.clear();
 
    // Find the very first item satisfying the range
-   const GraphicsDataCacheKey firstItemKey {
-      pixelsPerSecond, int64_t(cacheLeftColumn * samplesPerPixel)
-   };
+   const GraphicsDataCacheKey firstItemKey = range.GetKey(0);
 
    auto it = FindKey(firstItemKey);
 
@@ -210,11 +309,13 @@ GraphicsDataCacheBase::PerformBaseLookup(
 
       if (!data->IsComplete && data->LastUpdate != mCacheAccessIndex)
       {
-         if (!UpdateElement(it->Key, *data))
+         if (!TimedUpdateElement(it->Key, *data))
             return {};
 
          needsSmoothing = true;
       }
+      else if (data->LastUpdate != mCacheAccessIndex)
+         ++mStatistics.Hits;
 
       if (needsSmoothing)
          data->Smooth(prevItem);
@@ -250,9 +351,11 @@ GraphicsDataCacheBase::PerformBaseLookup(GraphicsDataCacheKey key)
 
       if (!data->IsComplete && data->LastUpdate != mCacheAccessIndex)
       {
-         if (!UpdateElement(it->Key, *data))
+         if (!TimedUpdateElement(it->Key, *data))
             return {};
       }
+      else
+         ++mStatistics.Hits;
 
       data->Smooth(it == mLookup.begin() ? nullptr : (it - 1)->Data);
 
@@ -264,7 +367,10 @@ GraphicsDataCacheBase::PerformBaseLookup(GraphicsDataCacheKey key)
 
    mNewLookupItems.push_back({ key, nullptr });
 
+   const auto fillStart = std::chrono::steady_clock::now();
    LookupElement newElement { key, CreateElement(key) };
+   mStatistics.FillTime += std::chrono::steady_clock::now() - fillStart;
+   ++mStatistics.Misses;
 
    if (newElement.Data == nullptr)
       return nullptr;
@@ -295,6 +401,17 @@ GraphicsDataCacheBase::PerformBaseLookup(GraphicsDataCacheKey key)
    return newElement.Data;
 }
 
+bool GraphicsDataCacheBase::TimedUpdateElement(
+   const GraphicsDataCacheKey& key, GraphicsDataCacheElementBase& element)
+{
+   const auto fillStart = std::chrono::steady_clock::now();
+   const bool result = UpdateElement(key, element);
+   mStatistics.FillTime += std::chrono::steady_clock::now() - fillStart;
+   ++mStatistics.Misses;
+
+   return result;
+}
+
 bool GraphicsDataCacheBase::CreateNewItems()
 {
    for (auto& item : mNewLookupItems)
@@ -327,7 +444,7 @@ GraphicsDataCacheBase::FindKey(GraphicsDataCacheKey key)
    return std::find_if(
       mLookup.begin(), mLookup.end(),
       [sampleRate = mScaledSampleRate, key](auto lhs)
-      { return IsSameKey(sampleRate, lhs.Key, key); });
+      { return ::IsSameKey(sampleRate, lhs.Key, key); });
 }
 
 void GraphicsDataCacheBase::PerformCleanup()
@@ -10,6 +10,7 @@
 **********************************************************************/
 #pragma once
 
+#include <chrono>
 #include <cstdint>
 #include <deque>
 #include <functional>
@@ -59,9 +60,26 @@ public:
 
    virtual ~GraphicsDataCacheBase() = default;
 
+   //! Counters of the lookups since construction
+   struct WAVE_TRACK_PAINT_API Statistics final
+   {
+      //! Elements that were found complete
+      uint64_t Hits { 0 };
+      //! Elements that were created or updated
+      uint64_t Misses { 0 };
+      //! Time spent creating or updating elements
+      std::chrono::nanoseconds FillTime { 0 };
+
+      double GetHitRate() const noexcept;
+      //! Mean time to create or update an element
+      std::chrono::nanoseconds GetMeanFillTime() const noexcept;
+   };
+
    //! Invalidate the cache content
    void Invalidate();
 
+   Statistics GetStatistics() const noexcept;
+
    //! Returns the sample rate associated with cache
    double GetScaledSampleRate() const noexcept;
 
@@ -73,6 +91,17 @@ protected:
 
    void SetScaledSampleRate(double scaledSampleRate);
 
+   //! This method is called at the end of Invalidate(). Default implementation is empty
+   virtual void OnInvalidated();
+
+   //! Checks whether the keys refer to the same element
+   bool IsSameKey(
+      GraphicsDataCacheKey lhs, GraphicsDataCacheKey rhs) const noexcept;
+
+   //! Keys of the elements for the range that are absent or not complete
+   std::vector<GraphicsDataCacheKey>
+   GetMissingKeys(const ZoomInfo& zoomInfo, double t0, double t1);
+
    //! Element of the cache lookup
    struct WAVE_TRACK_PAINT_API LookupElement final
    {
@@ -110,6 +139,9 @@ protected:
    const GraphicsDataCacheElementBase* PerformBaseLookup(GraphicsDataCacheKey key);
 
 private:
+   // Called internally to update an element, counting the time spent
+   bool TimedUpdateElement(
+      const GraphicsDataCacheKey& key, GraphicsDataCacheElementBase& element);
    // Called internally to create a list of items in the mNewLookupItems
    bool CreateNewItems();
    // Called internally if the CreateNewItems has failed to dispose all the elements created
@@ -139,6 +171,8 @@ private:
    // A multiplier used to control the cache size
    int32_t mCacheSizeMultiplier { 4 };
 
+   Statistics mStatistics;
+
    template <typename CacheElementType>
    friend class GraphicsDataCacheIterator;
 };
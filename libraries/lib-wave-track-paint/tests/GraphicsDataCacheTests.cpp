@@ -117,3 +117,42 @@ TEST_CASE("graphics-data-cache", "")
       CheckCacheElementLookup(cache, info, t0, t1, itemsCount);
    }
 }
+
+TEST_CASE("graphics-data-cache-statistics", "")
+{
+   ZoomInfo info(0.0, ZoomInfo::GetDefaultZoom());
+
+   GraphicsDataCache<CacheElement> cache(44100, [](){ return std::make_unique<CacheElement>(); });
+
+   cache.setInitializer(
+      [](const GraphicsDataCacheKey& key, CacheElement& element)
+      {
+         element = key;
+         element.IsComplete = true;
+         return true;
+      });
+
+   REQUIRE(cache.GetStatistics().GetHitRate() == 0.0);
+
+   const auto count = cache.PerformLookup(info, 0.0, 3.0).size();
+   REQUIRE(count == 2);
+
+   auto statistics = cache.GetStatistics();
+   REQUIRE(statistics.Hits == 0);
+   REQUIRE(statistics.Misses == count);
+
+   // Complete elements are found again
+   REQUIRE(cache.PerformLookup(info, 0.0, 3.0).size() == count);
+
+   statistics = cache.GetStatistics();
+   REQUIRE(statistics.Hits == count);
+   REQUIRE(statistics.Misses == count);
+   REQUIRE(statistics.GetHitRate() == Approx(0.5));
+
+   // Extending the range fills only the new element
+   REQUIRE(cache.PerformLookup(info, 0.0, 6.0).size() == count + 1);
+
+   statistics = cache.GetStatistics();
+   REQUIRE(statistics.Hits == 2 * count);
+   REQUIRE(statistics.Misses == count + 1);
+}
@@ -0,0 +1,230 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+ Audacity: A Digital Audio Editor
+
+ WaveDataCacheTests.cpp
+
+ **********************************************************************/
+#include <catch2/catch.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "FakeSampleBlock.h"
+#include "MemoryX.h"
+#include "MockedPrefs.h"
+#include "WaveClip.h"
+#include "ZoomInfo.h"
+#include "waveform/WaveDataCache.h"
+
+namespace
+{
+constexpr int sampleRate = 44100;
+
+//! A thousand samples to a column, so that elements are filled from the
+//! 256-sample summaries of blocks, which may throw when read
+const ZoomInfo zoomInfo { 0, sampleRate / 1000.0 };
+
+//! Makes the reads of blocks fail, or wait, on whichever thread reads them
+class ReadControl final
+{
+public:
+   void OnRead()
+   {
+      if (mFailing)
+         throw std::runtime_error { "unreadable block" };
+
+      std::unique_lock<std::mutex> lock { mMutex };
+      if (!mArmed)
+         return;
+
+      mArmed   = false;
+      mEntered = true;
+      mCondition.notify_all();
+      mCondition.wait(lock, [this] { return mReleased; });
+   }
+
+   void SetFailing(bool failing)
+   {
+      mFailing = failing;
+   }
+
+   //! Make the next read wait until Release()
+   void Arm()
+   {
+      std::lock_guard<std::mutex> lock { mMutex };
+      mArmed    = true;
+      mEntered  = false;
+      mReleased = false;
+   }
+
+   //! @return whether a read waits
+   bool WaitEntered()
+   {
+      std::unique_lock<std::mutex> lock { mMutex };
+      return mCondition.wait_for(
+         lock, std::chrono::seconds { 10 }, [this] { return mEntered; });
+   }
+
+   void Release()
+   {
+      std::lock_guard<std::mutex> lock { mMutex };
+      mReleased = true;
+      mCondition.notify_all();
+   }
+
+private:
+   std::atomic<bool> mFailing { false };
+   std::mutex mMutex;
+   std::condition_variable mCondition;
+   bool mArmed { false };
+   bool mEntered { false };
+   bool mReleased { false };
+};
+
+std::unique_ptr<WaveClip> MakeClip(
+   const SampleBlockFactoryPtr& factory, double seconds, float value)
+{
+   auto clip =
+      std::make_unique<WaveClip>(1, factory, floatSample, sampleRate);
+   const std::vector<float> samples(seconds * sampleRate, value);
+   constSamplePtr buffers[] { reinterpret_cast<constSamplePtr>(
+      samples.data()) };
+   clip->Append(buffers, floatSample, samples.size(), 1, floatSample);
+   clip->Flush();
+   return clip;
+}
+
+//! Wait until the worker filled, or failed to fill, all it was asked for
+bool WaitForWorker(const WaveDataCache& cache)
+{
+   for (int ii = 0; ii < 10000; ++ii)
+   {
+      const auto statistics = cache.GetPrefetchStatistics();
+      if (statistics.Filled + statistics.Failed == statistics.Requested)
+         return true;
+      std::this_thread::sleep_for(std::chrono::milliseconds { 1 });
+   }
+   return false;
+}
+
+//! Prefetch and look up, as repainting does, until no element is a
+//! placeholder
+bool LookupUntilFilled(WaveDataCache& cache, double t0, double t1)
+{
+   for (int ii = 0; ii < 10000; ++ii)
+   {
+      cache.Prefetch(zoomInfo, t0, t1);
+      cache.PerformLookup(zoomInfo, t0, t1);
+      if (!cache.ShowsPlaceholders())
+         return true;
+      std::this_thread::sleep_for(std::chrono::milliseconds { 1 });
+   }
+   return false;
+}
+
+void CheckColumns(WaveDataCache& cache, double t0, double t1, float value)
+{
+   const auto range = cache.PerformLookup(zoomInfo, t0, t1);
+   REQUIRE(!range.empty());
+   for (const auto& element : range)
+   {
+      REQUIRE(element.IsComplete);
+      REQUIRE(element.AvailableColumns == WaveDataCache::CacheElementWidth);
+      for (size_t column = 0; column < element.AvailableColumns; ++column)
+      {
+         REQUIRE(element.Data[column].min == value);
+         REQUIRE(element.Data[column].max == value);
+      }
+   }
+}
+} // namespace
+
+TEST_CASE("WaveDataCache prefetch")
+{
+   MockedPrefs mockedPrefs;
+
+   ReadControl control;
+   const auto factory =
+      std::make_shared<FakeSampleBlockFactory>([&] { control.OnRead(); });
+   const auto clip = MakeClip(factory, 60, 0.5f);
+
+   WaveDataCache cache { *clip, 0 };
+   // Don't leave the worker waiting when a requirement fails
+   auto release = finally([&] { control.Release(); });
+
+   SECTION("Lookups take the elements that the worker filled")
+   {
+      cache.Prefetch(zoomInfo, 0, 10);
+      REQUIRE(WaitForWorker(cache));
+
+      const auto filled = cache.GetPrefetchStatistics();
+      REQUIRE(filled.Filled > 0);
+      REQUIRE(filled.Failed == 0);
+
+      // The neighbours of the prefetched range
+      CheckColumns(cache, 10, 20, 0.5f);
+      REQUIRE(!cache.ShowsPlaceholders());
+      REQUIRE(cache.GetPrefetchStatistics().Used > 0);
+   }
+
+   SECTION("Lookups return placeholders until the worker fills them")
+   {
+      control.Arm();
+      cache.Prefetch(zoomInfo, 0, 10);
+      REQUIRE(control.WaitEntered());
+
+      const auto range = cache.PerformLookup(zoomInfo, 0, 10);
+      REQUIRE(!range.empty());
+      for (const auto& element : range)
+      {
+         REQUIRE(!element.IsComplete);
+         REQUIRE(element.AvailableColumns == 0);
+      }
+      REQUIRE(cache.ShowsPlaceholders());
+
+      control.Release();
+      REQUIRE(LookupUntilFilled(cache, 0, 10));
+      CheckColumns(cache, 0, 10, 0.5f);
+   }
+
+   SECTION("Lookups fill what the worker could not, and meet the error")
+   {
+      control.SetFailing(true);
+      cache.Prefetch(zoomInfo, 0, 10);
+      cache.PerformLookup(zoomInfo, 0, 10);
+      REQUIRE(cache.ShowsPlaceholders());
+      REQUIRE(WaitForWorker(cache));
+      REQUIRE(cache.GetPrefetchStatistics().Failed > 0);
+
+      REQUIRE_THROWS_AS(
+         cache.PerformLookup(zoomInfo, 0, 10), std::runtime_error);
+
+      // Once the blocks can be read, the elements are filled again
+      control.SetFailing(false);
+      REQUIRE(LookupUntilFilled(cache, 0, 10));
+      CheckColumns(cache, 0, 10, 0.5f);
+   }
+
+   SECTION("Elements filled from replaced blocks are discarded")
+   {
+      control.Arm();
+      cache.Prefetch(zoomInfo, 0, 10);
+      REQUIRE(control.WaitEntered());
+
+      // The length of the clip changes, so the next Prefetch() replaces the
+      // blocks that the worker reads
+      clip->InsertSilence(0, 60);
+      cache.Prefetch(zoomInfo, 0, 10);
+      control.Release();
+
+      REQUIRE(LookupUntilFilled(cache, 10, 20));
+      CheckColumns(cache, 10, 20, 0.0f);
+   }
+}
@@ -0,0 +1,150 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+ Audacity: A Digital Audio Editor
+
+ WaveSummaryPyramidTests.cpp
+
+ **********************************************************************/
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+
+#include "FakeSampleBlock.h"
+#include "Sequence.h"
+#include "waveform/WaveSummaryPyramid.h"
+
+namespace
+{
+//! Blocks of the given lengths, with values their indices
+BlockArray MakeBlocks(const std::vector<size_t>& lengths)
+{
+   BlockArray blocks;
+   int64_t start = 0;
+   for (size_t ii = 0; ii < lengths.size(); ++ii)
+   {
+      blocks.emplace_back(
+         std::make_shared<FakeSampleBlock>(ii + 1, lengths[ii], float(ii)),
+         start);
+      start += lengths[ii];
+   }
+   return blocks;
+}
+
+//! Renumber the block starts after insertion or deletion
+void Restart(BlockArray& blocks)
+{
+   int64_t start = 0;
+   for (auto& block : blocks)
+   {
+      block.start = start;
+      start += block.sb->GetSampleCount();
+   }
+}
+
+//! The summary computed block by block
+WaveSummaryPyramid::Summary
+Reference(const BlockArray& blocks, size_t first, size_t last)
+{
+   WaveSummaryPyramid::Summary summary;
+   for (auto ii = first; ii < last; ++ii)
+   {
+      const auto minMaxRMS = blocks[ii].sb->GetMinMaxRMS();
+      const auto count     = blocks[ii].sb->GetSampleCount();
+      summary.Add({ minMaxRMS.min, minMaxRMS.max,
+                    double(minMaxRMS.RMS) * minMaxRMS.RMS * count,
+                    int64_t(count) });
+   }
+   return summary;
+}
+
+void CheckAllRanges(const WaveSummaryPyramid& pyramid, const BlockArray& blocks)
+{
+   for (size_t first = 0; first < blocks.size(); ++first)
+   {
+      const auto from = blocks[first].start.as_long_long();
+      for (auto last = first + 1; last <= blocks.size(); ++last)
+      {
+         const auto to = last < blocks.size() ?
+                            blocks[last].start.as_long_long() :
+                            from + Reference(blocks, first, last).SamplesCount;
+         // A range that ends within the next block takes no part of it
+         const auto summary  = pyramid.GetSummary(from, to - from + 1);
+         const auto expected = Reference(blocks, first, last);
+         REQUIRE(summary.SamplesCount == expected.SamplesCount);
+         REQUIRE(summary.Min == expected.Min);
+         REQUIRE(summary.Max == expected.Max);
+         REQUIRE(summary.SquaresSum == Approx(expected.SquaresSum));
+      }
+   }
+}
+} // namespace
+
+TEST_CASE("WaveSummaryPyramid", "")
+{
+   WaveSummaryPyramid pyramid;
+
+   // Enough blocks for four levels
+   std::vector<size_t> lengths(300);
+   for (size_t ii = 0; ii < lengths.size(); ++ii)
+      lengths[ii] = 1000 + 7 * (ii % 13);
+
+   auto blocks = MakeBlocks(lengths);
+   pyramid.Update(blocks);
+
+   REQUIRE(pyramid.GetLevelsCount() == 4);
+
+   SECTION("Summarizes any run of whole blocks")
+   {
+      CheckAllRanges(pyramid, blocks);
+   }
+
+   SECTION("Requires a block start and a whole block")
+   {
+      const auto from = blocks[5].start.as_long_long();
+      REQUIRE(pyramid.GetSummary(from + 1, 100000).SamplesCount == 0);
+      REQUIRE(pyramid.GetSummary(from, lengths[5] - 1).SamplesCount == 0);
+      REQUIRE(pyramid.GetSummary(-1, 100000).SamplesCount == 0);
+   }
+
+   SECTION("Follows appended blocks without notice")
+   {
+      const auto more = MakeBlocks({ 500, 600, 700 });
+      auto start = blocks.back().start + blocks.back().sb->GetSampleCount();
+      for (auto& block : more)
+      {
+         blocks.push_back(block.Plus(start));
+      }
+      pyramid.Update(blocks);
+      CheckAllRanges(pyramid, blocks);
+   }
+
+   SECTION("Follows deletion in the middle")
+   {
+      blocks.erase(blocks.begin() + 17, blocks.begin() + 40);
+      Restart(blocks);
+      pyramid.MarkChanged();
+      pyramid.Update(blocks);
+      CheckAllRanges(pyramid, blocks);
+   }
+
+   SECTION("Follows replacement of a block by one of the same length")
+   {
+      blocks[100].sb = std::make_shared<FakeSampleBlock>(
+         blocks.size() + 1, blocks[100].sb->GetSampleCount(), -5.0f);
+      pyramid.MarkChanged();
+      pyramid.Update(blocks);
+      CheckAllRanges(pyramid, blocks);
+   }
+
+   SECTION("Shrinks to nothing")
+   {
+      blocks.clear();
+      pyramid.MarkChanged();
+      pyramid.Update(blocks);
+      REQUIRE(pyramid.GetSummary(0, 100000).SamplesCount == 0);
+   }
+}
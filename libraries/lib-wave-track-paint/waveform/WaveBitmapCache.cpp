@@ -381,10 +381,30 @@ bool WaveBitmapCache::InitializeElement(
    auto sw = FrameStatistics::CreateStopwatch(
       FrameStatistics::SectionID::WaveBitmapCache);
 
-   const auto columnsCount = mLookupHelper->AvailableColumns;
-
    const auto defaultColor = Triplet(mPaintParamters.BlankColor);
 
+   // The data is still being filled on the worker thread: show a blank
+   // element until it lands
+   if (mLookupHelper->AvailableColumns == 0 && !mLookupHelper->IsComplete)
+   {
+      const auto height = static_cast<uint32_t>(mPaintParamters.Height);
+      auto rowData = element.Allocate(CacheElementWidth, height);
+
+      for (size_t pixel = 0; pixel < CacheElementWidth * height; ++pixel)
+      {
+         *rowData++ = defaultColor.r;
+         *rowData++ = defaultColor.g;
+         *rowData++ = defaultColor.b;
+      }
+
+      element.AvailableColumns = CacheElementWidth;
+      element.IsComplete = false;
+
+      return true;
+   }
+
+   const auto columnsCount = mLookupHelper->AvailableColumns;
+
    const auto height = static_cast<uint32_t>(mPaintParamters.Height);
 
    auto rowData = element.Allocate(columnsCount, height);
@@ -14,12 +14,18 @@
 #include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <condition_variable>
 #include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
 
 #include "SampleBlock.h"
 #include "SampleFormat.h"
 #include "Sequence.h"
 #include "WaveClip.h"
+#include "WaveSummaryPyramid.h"
+#include "ZoomInfo.h"
 
 #include "RoundUpUnsafe.h"
 
@@ -177,6 +183,53 @@ private:
    size_t mLastProcessedSample { 0 };
 };
 
+bool ReadBlock(
+   const SeqBlock& inputBlock, WaveCacheSampleBlock::Type dataType,
+   WaveCacheSampleBlock& outBlock)
+{
+   outBlock.FirstSample = inputBlock.start.as_long_long();
+   outBlock.NumSamples  = inputBlock.sb->GetSampleCount();
+
+   switch (dataType)
+   {
+   case WaveCacheSampleBlock::Type::Samples:
+   {
+      samplePtr ptr = static_cast<samplePtr>(
+         static_cast<void*>(outBlock.GetWritePointer(outBlock.NumSamples)));
+
+      inputBlock.sb->GetSamples(
+         ptr, floatSample, 0, outBlock.NumSamples, false);
+   }
+   break;
+   case WaveCacheSampleBlock::Type::MinMaxRMS256:
+   {
+      size_t framesCount = RoundUpUnsafe(outBlock.NumSamples, 256);
+
+      float* ptr =
+         static_cast<float*>(outBlock.GetWritePointer(framesCount * 3));
+
+      inputBlock.sb->GetSummary256(ptr, 0, framesCount);
+   }
+   break;
+   case WaveCacheSampleBlock::Type::MinMaxRMS64k:
+   {
+      size_t framesCount = RoundUpUnsafe(outBlock.NumSamples, 64 * 1024);
+
+      float* ptr =
+         static_cast<float*>(outBlock.GetWritePointer(framesCount * 3));
+
+      inputBlock.sb->GetSummary64k(ptr, 0, framesCount);
+   }
+   break;
+   default:
+      return false;
+   }
+
+   outBlock.DataType = dataType;
+
+   return true;
+}
+
 WaveDataCache::DataProvider
 MakeDefaultDataProvider(const WaveClip& clip, int channelIndex)
 {
@@ -205,51 +258,223 @@ MakeDefaultDataProvider(const WaveClip& clip, int channelIndex)
       const auto blockIndex  = sequence->FindBlock(requiredSample);
       const auto& inputBlock = sequence->GetBlockArray()[blockIndex];
 
-      outBlock.FirstSample = inputBlock.start.as_long_long();
-      outBlock.NumSamples  = inputBlock.sb->GetSampleCount();
+      return ReadBlock(inputBlock, dataType, outBlock);
+   };
+}
 
-      switch (dataType)
-      {
-      case WaveCacheSampleBlock::Type::Samples:
-      {
-         samplePtr ptr = static_cast<samplePtr>(
-            static_cast<void*>(outBlock.GetWritePointer(outBlock.NumSamples)));
+//! Reads only the sample blocks of a copied block array, so that it may be
+//! called on any thread
+WaveDataCache::DataProvider
+MakeBlockArrayDataProvider(const BlockArray& blocks, int64_t samplesCount)
+{
+   return [&blocks, samplesCount](
+             int64_t requiredSample, WaveCacheSampleBlock::Type dataType,
+             WaveCacheSampleBlock& outBlock)
+   {
+      if (requiredSample < 0 || requiredSample >= samplesCount)
+         return false;
 
-         inputBlock.sb->GetSamples(
-            ptr, floatSample, 0, outBlock.NumSamples, false);
-      }
-      break;
-      case WaveCacheSampleBlock::Type::MinMaxRMS256:
-      {
-         size_t framesCount = RoundUpUnsafe(outBlock.NumSamples, 256);
+      const auto it = std::upper_bound(
+         blocks.begin(), blocks.end(), requiredSample,
+         [](int64_t sample, const SeqBlock& block)
+         { return sample < block.start.as_long_long(); });
 
-         float* ptr =
-            static_cast<float*>(outBlock.GetWritePointer(framesCount * 3));
+      return ReadBlock(*(it - 1), dataType, outBlock);
+   };
+}
 
-         inputBlock.sb->GetSummary256(ptr, 0, framesCount);
+//! A thread that fills the elements of all the caches in turn
+class PrefetchWorker final
+{
+public:
+   //! Fills one element, and returns whether to be called again after the
+   //! other tasks
+   using Task = std::function<bool()>;
+
+   static PrefetchWorker& Get()
+   {
+      static PrefetchWorker instance;
+      return instance;
+   }
+
+   ~PrefetchWorker()
+   {
+      {
+         std::lock_guard<std::mutex> lock { mMutex };
+         mStop = true;
       }
-      break;
-      case WaveCacheSampleBlock::Type::MinMaxRMS64k:
+      mCondition.notify_one();
+      if (mThread.joinable())
+         mThread.join();
+   }
+
+   void Schedule(Task task)
+   {
+      std::lock_guard<std::mutex> lock { mMutex };
+      mTasks.push_back(std::move(task));
+      if (!mThread.joinable())
+         mThread = std::thread { [this] { Loop(); } };
+      mCondition.notify_one();
+   }
+
+private:
+   void Loop()
+   {
+      std::unique_lock<std::mutex> lock { mMutex };
+      while (true)
       {
-         size_t framesCount = RoundUpUnsafe(outBlock.NumSamples, 64 * 1024);
+         mCondition.wait(lock, [this] { return mStop || !mTasks.empty(); });
+         if (mStop)
+            return;
 
-         float* ptr =
-            static_cast<float*>(outBlock.GetWritePointer(framesCount * 3));
+         auto task = std::move(mTasks.front());
+         mTasks.pop_front();
 
-         inputBlock.sb->GetSummary64k(ptr, 0, framesCount);
+         lock.unlock();
+         bool again = false;
+         try
+         {
+            again = task();
+         }
+         catch (...)
+         {
+            // An exception must not end the thread; drop the task
+         }
+         lock.lock();
+
+         if (again)
+            mTasks.push_back(std::move(task));
       }
-      break;
-      default:
+   }
+
+   std::mutex mMutex;
+   std::condition_variable mCondition;
+   std::deque<Task> mTasks;
+   bool mStop { false };
+   std::thread mThread;
+};
+
+} // namespace
+
+//! What the cache shares with the worker thread
+struct WaveDataCache::PrefetchState final
+{
+   //! What the worker thread reads, unchanging
+   struct Snapshot final
+   {
+      BlockArray Blocks;
+      WaveSummaryPyramid Pyramid;
+      int64_t SamplesCount;
+      double ScaledSampleRate;
+   };
+
+   //! Fill the next queued element; called on the worker thread
+   //! @return whether more are queued
+   bool FillNext();
+
+   std::mutex Mutex;
+   //! Notified when the worker finishes an element
+   std::condition_variable Idle;
+
+   std::unique_ptr<const Snapshot> CurrentSnapshot;
+   //! Snapshots replaced while the worker was reading them
+   std::vector<std::unique_ptr<const Snapshot>> RetiredSnapshots;
+
+   //! Elements that lookups wait for, filled first
+   std::deque<GraphicsDataCacheKey> Urgent;
+   std::deque<GraphicsDataCacheKey> Pending;
+   //! The element the worker fills, if Busy
+   GraphicsDataCacheKey InProgress;
+   bool Busy { false };
+   //! Whether a task of the worker is queued for this
+   bool Scheduled { false };
+
+   //! Elements filled by the worker, not yet taken by lookups
+   std::vector<
+      std::pair<GraphicsDataCacheKey, std::unique_ptr<WaveCacheElement>>>
+      Landed;
+   //! Elements the worker could not fill, that lookups fill on their own
+   //! thread instead, so that errors reach the user
+   std::vector<GraphicsDataCacheKey> Failed;
+
+   PrefetchStatistics Counters;
+};
+
+bool WaveDataCache::PrefetchState::FillNext()
+{
+   const Snapshot* snapshot = nullptr;
+   GraphicsDataCacheKey key;
+
+   {
+      std::lock_guard<std::mutex> lock { Mutex };
+
+      auto& queue = Urgent.empty() ? Pending : Urgent;
+      if (queue.empty() || !CurrentSnapshot)
+      {
+         Scheduled = false;
          return false;
       }
 
-      outBlock.DataType = dataType;
+      key = queue.front();
+      queue.pop_front();
 
-      return true;
-   };
-}
+      snapshot   = CurrentSnapshot.get();
+      InProgress = key;
+      Busy       = true;
+   }
 
-} // namespace
+   // The snapshot is not destroyed while Busy
+   auto element = std::make_unique<WaveCacheElement>();
+
+   const auto start = std::chrono::steady_clock::now();
+
+   WaveCacheSampleBlock cachedBlock;
+   bool filled = false;
+   try
+   {
+      filled = FillElement(
+         key, *element, snapshot->ScaledSampleRate,
+         MakeBlockArrayDataProvider(snapshot->Blocks, snapshot->SamplesCount),
+         cachedBlock, snapshot->Pyramid);
+   }
+   catch (...)
+   {
+      // Reading blocks may throw, as for database errors.  The lookup of
+      // this element fills it on its own thread, and meets the error again
+   }
+
+   const auto elapsed = std::chrono::steady_clock::now() - start;
+
+   bool more = false;
+
+   {
+      std::lock_guard<std::mutex> lock { Mutex };
+
+      Busy = false;
+
+      if (snapshot == CurrentSnapshot.get())
+      {
+         if (filled)
+         {
+            Landed.emplace_back(key, std::move(element));
+            ++Counters.Filled;
+            Counters.FillTime += elapsed;
+         }
+         else
+         {
+            Failed.push_back(key);
+            ++Counters.Failed;
+         }
+      }
+
+      more      = CurrentSnapshot && !(Urgent.empty() && Pending.empty());
+      Scheduled = more;
+   }
+
+   Idle.notify_all();
+
+   return more;
+}
 
 WaveDataCache::WaveDataCache(const WaveClip& waveClip, int channelIndex)
     : GraphicsDataCache<WaveCacheElement>(
@@ -257,6 +482,7 @@ WaveDataCache::WaveDataCache(const WaveClip& waveClip, int channelIndex)
          [] { return std::make_unique<WaveCacheElement>(); })
     , mProvider { MakeDefaultDataProvider(waveClip, channelIndex) }
     , mWaveClip { waveClip }
+    , mChannelIndex { channelIndex }
     , mStretchChangedSubscription {
        const_cast<WaveClip&>(waveClip)
           .Observer::Publisher<StretchRatioChange>::Subscribe(
@@ -268,18 +494,305 @@ WaveDataCache::WaveDataCache(const WaveClip& waveClip, int channelIndex)
 {
 }
 
+WaveDataCache::~WaveDataCache()
+{
+   if (!mPrefetchState)
+      return;
+
+   auto& state = *mPrefetchState;
+
+   std::unique_lock<std::mutex> lock { state.Mutex };
+
+   state.Urgent.clear();
+   state.Pending.clear();
+   state.Idle.wait(lock, [&state] { return !state.Busy; });
+
+   // Release the sample blocks on this thread
+   state.CurrentSnapshot.reset();
+   state.RetiredSnapshots.clear();
+   state.Landed.clear();
+   state.Failed.clear();
+}
+
+void WaveDataCache::Prefetch(const ZoomInfo& zoomInfo, double t0, double t1)
+{
+   mShowsPlaceholders = false;
+
+   if (!(t0 < t1))
+      return;
+
+   const auto width = t1 - t0;
+
+   // The neighbours of the range, then the range at the next zoom out step
+   auto keys = GetMissingKeys(zoomInfo, t1, t1 + width);
+
+   for (auto&& more :
+        { GetMissingKeys(zoomInfo, std::max(0.0, t0 - width), t0),
+          GetMissingKeys(
+             ZoomInfo { zoomInfo.hpos, zoomInfo.GetZoom() / 2 },
+             std::max(0.0, t0 - width / 2), t1 + width / 2) })
+      keys.insert(keys.end(), more.begin(), more.end());
+
+   const auto sequence     = mWaveClip.GetSequence(mChannelIndex);
+   const auto samplesCount = sequence->GetNumSamples().as_long_long();
+   const auto sampleRate   = GetScaledSampleRate();
+
+   // The end of the clip may still be in the append buffer
+   keys.erase(
+      std::remove_if(
+         keys.begin(), keys.end(),
+         [&](const GraphicsDataCacheKey& key)
+         {
+            return key.FirstSample + sampleRate / key.PixelsPerSecond *
+                                        CacheElementWidth >
+                   samplesCount;
+         }),
+      keys.end());
+
+   if (!mPrefetchState)
+      mPrefetchState = std::make_shared<PrefetchState>();
+
+   auto& state = *mPrefetchState;
+
+   std::lock_guard<std::mutex> lock { state.Mutex };
+
+   const auto& blocks = sequence->GetBlockArray();
+   const auto sameBlock = [](const SeqBlock& lhs, const SeqBlock& rhs)
+   { return lhs.sb == rhs.sb && lhs.start == rhs.start; };
+
+   const auto* snapshot = state.CurrentSnapshot.get();
+   if (
+      snapshot == nullptr || snapshot->SamplesCount != samplesCount ||
+      snapshot->ScaledSampleRate != sampleRate ||
+      snapshot->Blocks.size() != blocks.size() ||
+      (!blocks.empty() &&
+       (!sameBlock(snapshot->Blocks.front(), blocks.front()) ||
+        !sameBlock(snapshot->Blocks.back(), blocks.back()))))
+   {
+      if (state.Busy)
+         state.RetiredSnapshots.push_back(std::move(state.CurrentSnapshot));
+
+      state.CurrentSnapshot = std::make_unique<const PrefetchState::Snapshot>(
+         PrefetchState::Snapshot {
+            blocks, WaveSummaryPyramid::Get(mWaveClip, mChannelIndex),
+            samplesCount, sampleRate });
+
+      // Elements of the old blocks are stale
+      state.Urgent.clear();
+      state.Landed.clear();
+      state.Failed.clear();
+   }
+
+   if (!state.Busy)
+      state.RetiredSnapshots.clear();
+
+   const auto contains = [this](const auto& container, const auto& key)
+   {
+      return std::any_of(
+         container.begin(), container.end(),
+         [&](const GraphicsDataCacheKey& other)
+         { return IsSameKey(key, other); });
+   };
+
+   // Keep what lookups of the range or of the neighbours may still take
+   const auto visibleKeys = GetMissingKeys(zoomInfo, t0, t1);
+
+   state.Landed.erase(
+      std::remove_if(
+         state.Landed.begin(), state.Landed.end(),
+         [&](const auto& landed)
+         {
+            return !contains(keys, landed.first) &&
+                   !contains(visibleKeys, landed.first);
+         }),
+      state.Landed.end());
+
+   state.Failed.erase(
+      std::remove_if(
+         state.Failed.begin(), state.Failed.end(),
+         [&](const GraphicsDataCacheKey& failed)
+         { return !contains(keys, failed) && !contains(visibleKeys, failed); }),
+      state.Failed.end());
+
+   std::vector<GraphicsDataCacheKey> landedKeys;
+   for (const auto& landed : state.Landed)
+      landedKeys.push_back(landed.first);
+
+   auto pending = std::move(state.Pending);
+   state.Pending.clear();
+
+   for (const auto& key : keys)
+   {
+      if (
+         contains(state.Urgent, key) || contains(landedKeys, key) ||
+         contains(state.Failed, key) || contains(state.Pending, key) ||
+         (state.Busy && IsSameKey(state.InProgress, key)))
+         continue;
+
+      if (!contains(pending, key))
+         ++state.Counters.Requested;
+
+      state.Pending.push_back(key);
+   }
+
+   Schedule();
+}
+
+bool WaveDataCache::ShowsPlaceholders() const noexcept
+{
+   return mShowsPlaceholders;
+}
+
+WaveDataCache::PrefetchStatistics WaveDataCache::GetPrefetchStatistics() const
+{
+   if (!mPrefetchState)
+      return {};
+
+   std::lock_guard<std::mutex> lock { mPrefetchState->Mutex };
+   return mPrefetchState->Counters;
+}
+
 bool WaveDataCache::InitializeElement(
    const GraphicsDataCacheKey& key, WaveCacheElement& element)
 {
    auto sw = FrameStatistics::CreateStopwatch(
       FrameStatistics::SectionID::WaveDataCache);
 
+   if (mPrefetchState && TakePrefetched(key, element))
+      return true;
+
+   return FillElement(
+      key, element, GetScaledSampleRate(), mProvider, mCachedBlock,
+      WaveSummaryPyramid::Get(mWaveClip, mChannelIndex));
+}
+
+void WaveDataCache::OnInvalidated()
+{
+   if (!mPrefetchState)
+      return;
+
+   auto& state = *mPrefetchState;
+
+   std::lock_guard<std::mutex> lock { state.Mutex };
+
+   state.Urgent.clear();
+   state.Pending.clear();
+   state.Landed.clear();
+   state.Failed.clear();
+
+   // The next Prefetch() takes a new snapshot
+   if (state.Busy)
+      state.RetiredSnapshots.push_back(std::move(state.CurrentSnapshot));
+   else
+      state.CurrentSnapshot.reset();
+}
+
+bool WaveDataCache::TakePrefetched(
+   const GraphicsDataCacheKey& key, WaveCacheElement& element)
+{
+   auto& state = *mPrefetchState;
+
+   std::lock_guard<std::mutex> lock { state.Mutex };
+
+   const auto landed = std::find_if(
+      state.Landed.begin(), state.Landed.end(),
+      [&](const auto& landed) { return IsSameKey(landed.first, key); });
+
+   if (landed != state.Landed.end())
+   {
+      const auto& filled = *landed->second;
+
+      element.Data             = filled.Data;
+      element.AvailableColumns = filled.AvailableColumns;
+      element.IsComplete       = filled.IsComplete;
+
+      state.Landed.erase(landed);
+      ++state.Counters.Used;
+
+      return true;
+   }
+
+   const auto sameKey = [&](const GraphicsDataCacheKey& other)
+   { return IsSameKey(key, other); };
+
+   // Fill it again on this thread, where an exception reaches the user,
+   // rather than queue it for the worker without end
+   const auto failed =
+      std::find_if(state.Failed.begin(), state.Failed.end(), sameKey);
+
+   if (failed != state.Failed.end())
+   {
+      state.Failed.erase(failed);
+      return false;
+   }
+
+   const auto* snapshot = state.CurrentSnapshot.get();
+
+   // Elements at the end of the clip are filled here, as the worker can't
+   // read the append buffer
+   if (
+      snapshot == nullptr ||
+      key.FirstSample + snapshot->ScaledSampleRate / key.PixelsPerSecond *
+                           CacheElementWidth >
+         snapshot->SamplesCount)
+      return false;
+
+   if (
+      !(state.Busy && sameKey(state.InProgress)) &&
+      std::none_of(state.Urgent.begin(), state.Urgent.end(), sameKey))
+   {
+      const auto pending =
+         std::find_if(state.Pending.begin(), state.Pending.end(), sameKey);
+
+      if (pending != state.Pending.end())
+         state.Pending.erase(pending);
+      else
+         ++state.Counters.Requested;
+
+      state.Urgent.push_back(key);
+   }
+
+   Schedule();
+
+   element.AvailableColumns = 0;
+   element.IsComplete       = false;
+
+   mShowsPlaceholders = true;
+
+   return true;
+}
+
+void WaveDataCache::Schedule()
+{
+   // Called with the mutex locked
+   auto& state = *mPrefetchState;
+
+   if (
+      state.Scheduled || !state.CurrentSnapshot ||
+      (state.Urgent.empty() && state.Pending.empty()))
+      return;
+
+   state.Scheduled = true;
+
+   PrefetchWorker::Get().Schedule(
+      [weakState = std::weak_ptr<PrefetchState>(mPrefetchState)]
+      {
+         const auto state = weakState.lock();
+         return state && state->FillNext();
+      });
+}
+
+bool WaveDataCache::FillElement(
+   const GraphicsDataCacheKey& key, WaveCacheElement& element,
+   double scaledSampleRate, const DataProvider& provider,
+   WaveCacheSampleBlock& cachedBlock, const WaveSummaryPyramid& pyramid)
+{
    element.AvailableColumns = 0;
 
    int64_t firstSample = key.FirstSample;
 
    const auto samplesPerColumn =
-      std::max(0.0, GetScaledSampleRate() / key.PixelsPerSecond);
+      std::max(0.0, scaledSampleRate / key.PixelsPerSecond);
 
    const size_t elementSamplesCount =
       samplesPerColumn * WaveDataCache::CacheElementWidth;
@@ -291,8 +804,13 @@ bool WaveDataCache::InitializeElement(
          (samplesPerColumn >= 256 ? WaveCacheSampleBlock::Type::MinMaxRMS256 :
                                     WaveCacheSampleBlock::Type::Samples);
 
-   if (blockType != mCachedBlock.DataType)
-      mCachedBlock.Reset();
+   if (blockType != cachedBlock.DataType)
+      cachedBlock.Reset();
+
+   // When zoomed out this far, columns may span many blocks, which are
+   // summarized without reading their 64k summaries
+   const bool usePyramid =
+      blockType == WaveCacheSampleBlock::Type::MinMaxRMS64k;
 
    size_t columnIndex = 0;
 
@@ -305,11 +823,35 @@ bool WaveDataCache::InitializeElement(
 
       while (samplesLeft != 0)
       {
-         if (!mCachedBlock.ContainsSample(firstSample))
-            if (!mProvider(firstSample, blockType, mCachedBlock))
+         if (usePyramid)
+         {
+            const auto wholeBlocks =
+               pyramid.GetSummary(firstSample, samplesLeft);
+
+            if (wholeBlocks.SamplesCount > 0)
+            {
+               const auto count =
+                  static_cast<size_t>(wholeBlocks.SamplesCount);
+
+               summary.SamplesCount = count;
+               summary.Min = std::min(summary.Min, wholeBlocks.Min);
+               summary.Max = std::max(summary.Max, wholeBlocks.Max);
+               summary.SquaresSum += wholeBlocks.SquaresSum;
+               summary.SumItemsCount += count;
+
+               samplesLeft -= count;
+               firstSample += count;
+               processedSamples += count;
+
+               continue;
+            }
+         }
+
+         if (!cachedBlock.ContainsSample(firstSample))
+            if (!provider(firstSample, blockType, cachedBlock))
                break;
 
-         summary = mCachedBlock.GetSummary(firstSample, samplesLeft, summary);
+         summary = cachedBlock.GetSummary(firstSample, samplesLeft, summary);
          if(summary.SamplesCount == 0)
             break;
 
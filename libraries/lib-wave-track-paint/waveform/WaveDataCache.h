@@ -11,7 +11,9 @@
 #pragma once
 
 #include <array>
+#include <chrono>
 #include <cstdint>
+#include <memory>
 #include <numeric>
 #include <vector>
 #include <functional>
@@ -21,6 +23,8 @@
 #include "Observer.h"
 
 class WaveClip;
+class WaveSummaryPyramid;
+class ZoomInfo;
 
 //! Helper structure used to transfer the data between the data and graphics layers
 struct WAVE_TRACK_PAINT_API WaveCacheSampleBlock final
@@ -96,15 +100,68 @@ public:
    using DataProvider = std::function<bool (int64_t requiredSample, WaveCacheSampleBlock::Type dataType, WaveCacheSampleBlock& block)>;
 
    WaveDataCache(const WaveClip& waveClip, int channelIndex);
+   ~WaveDataCache() override;
+
+   //! Counters of the background fills
+   struct PrefetchStatistics final
+   {
+      //! Elements queued for the worker thread
+      uint64_t Requested { 0 };
+      //! Elements the worker thread filled
+      uint64_t Filled { 0 };
+      //! Filled elements that lookups then took
+      uint64_t Used { 0 };
+      //! Elements the worker thread could not fill, as for read errors
+      uint64_t Failed { 0 };
+      //! Time the worker thread spent filling elements
+      std::chrono::nanoseconds FillTime { 0 };
+   };
+
+   //! Fill the elements next to the range, and for the next zoom step, on a
+   //! worker thread
+   /*!
+    After the first call, lookups no longer fill elements on the calling
+    thread, but queue them for the worker thread and return placeholders with
+    no columns.  The worker reads the sample blocks as they were at the
+    first call, or at the last change of the clip length.
+    */
+   void Prefetch(const ZoomInfo& zoomInfo, double t0, double t1);
+
+   //! Whether some element returned since the last Prefetch() was a
+   //! placeholder, so that another lookup will be needed
+   bool ShowsPlaceholders() const noexcept;
+
+   PrefetchStatistics GetPrefetchStatistics() const;
 
 private:
    bool InitializeElement(
       const GraphicsDataCacheKey& key, WaveCacheElement& element) override;
 
+   void OnInvalidated() override;
+
+   static bool FillElement(
+      const GraphicsDataCacheKey& key, WaveCacheElement& element,
+      double scaledSampleRate, const DataProvider& provider,
+      WaveCacheSampleBlock& cachedBlock, const WaveSummaryPyramid& pyramid);
+
+   //! Take an element filled by the worker, or queue it
+   //! @return whether the element is ready or is a placeholder; false if
+   //! the worker could not fill it, or can't read the end of the clip
+   bool TakePrefetched(
+      const GraphicsDataCacheKey& key, WaveCacheElement& element);
+
+   //! Queue a task for the worker thread, unless one is queued already
+   void Schedule();
+
+   struct PrefetchState;
+   std::shared_ptr<PrefetchState> mPrefetchState;
+   bool mShowsPlaceholders { false };
+
    DataProvider mProvider;
 
    WaveCacheSampleBlock mCachedBlock;
 
    const WaveClip& mWaveClip;
+   const int mChannelIndex;
    Observer::Subscription mStretchChangedSubscription;
 };
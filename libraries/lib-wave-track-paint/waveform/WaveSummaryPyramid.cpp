@@ -0,0 +1,222 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  WaveSummaryPyramid.cpp
+
+**********************************************************************/
+#include "WaveSummaryPyramid.h"
+
+#include <algorithm>
+
+#include "SampleBlock.h"
+#include "Sequence.h"
+#include "WaveClip.h"
+
+namespace
+{
+//! The pyramids of the channels of a clip, kept across changes of the clip so
+//! that they are updated rather than rebuilt
+struct WaveClipSummaryPyramids final : WaveClipListener
+{
+   void MarkChanged() noexcept override
+   {
+      for (auto& pyramid : Pyramids)
+         pyramid.MarkChanged();
+   }
+
+   void Invalidate() override
+   {
+      MarkChanged();
+   }
+
+   std::unique_ptr<WaveClipListener> Clone() const override
+   {
+      return std::make_unique<WaveClipSummaryPyramids>();
+   }
+
+   void MakeStereo(WaveClipListener&& other, bool) override
+   {
+      auto& otherPyramids = static_cast<WaveClipSummaryPyramids&>(other);
+      Pyramids.resize(1);
+      if (!otherPyramids.Pyramids.empty())
+         Pyramids.push_back(std::move(otherPyramids.Pyramids.front()));
+      MarkChanged();
+   }
+
+   void SwapChannels() override
+   {
+      if (Pyramids.size() > 1)
+         std::swap(Pyramids[0], Pyramids[1]);
+   }
+
+   void Erase(size_t index) override
+   {
+      if (index < Pyramids.size())
+         Pyramids.erase(Pyramids.begin() + index);
+   }
+
+   std::vector<WaveSummaryPyramid> Pyramids;
+};
+
+WaveClip::Attachments::RegisteredFactory sKeyP { [](WaveClip&) {
+   return std::make_unique<WaveClipSummaryPyramids>();
+} };
+} // namespace
+
+void WaveSummaryPyramid::Summary::Add(const Summary& other) noexcept
+{
+   Min = std::min(Min, other.Min);
+   Max = std::max(Max, other.Max);
+   SquaresSum += other.SquaresSum;
+   SamplesCount += other.SamplesCount;
+}
+
+const WaveSummaryPyramid&
+WaveSummaryPyramid::Get(const WaveClip& clip, size_t channel)
+{
+   auto& pyramids = const_cast<WaveClip&>(clip) // Consider it mutable data
+      .Attachments::Get<WaveClipSummaryPyramids>(sKeyP).Pyramids;
+
+   // Channels are made on demand
+   if (pyramids.size() <= channel)
+      pyramids.resize(channel + 1);
+
+   auto& pyramid = pyramids[channel];
+   if (const auto blocks = clip.GetSequenceBlockArray(channel))
+      pyramid.Update(*blocks);
+
+   return pyramid;
+}
+
+void WaveSummaryPyramid::MarkChanged() noexcept
+{
+   mChanged = true;
+}
+
+void WaveSummaryPyramid::Update(const BlockArray& blocks)
+{
+   const auto blocksCount = blocks.size();
+   const auto same = [&](size_t ii)
+   {
+      const auto& block = blocks[ii];
+      const auto& known = mBlocks[ii];
+      return !block.sb.owner_before(known) && !known.owner_before(block.sb) &&
+             mBoundaries[ii] == block.start.as_long_long();
+   };
+
+   // Appending is caught even without notice of the change
+   if (
+      !mChanged && blocksCount == mBlocks.size() &&
+      (blocksCount == 0 || same(blocksCount - 1)))
+      return;
+
+   mChanged = false;
+
+   size_t firstChanged = 0;
+   const auto keptCount = std::min(blocksCount, mBlocks.size());
+   while (firstChanged < keptCount && same(firstChanged))
+      ++firstChanged;
+
+   if (mLevels.empty())
+      mLevels.emplace_back();
+
+   mBlocks.resize(firstChanged);
+   mBoundaries.resize(firstChanged);
+
+   auto& leaves = mLevels[0];
+   leaves.resize(firstChanged);
+
+   for (auto ii = firstChanged; ii < blocksCount; ++ii)
+   {
+      const auto& block = blocks[ii];
+      const auto summary = block.sb->GetMinMaxRMS(false);
+      const auto count = block.sb->GetSampleCount();
+
+      mBlocks.push_back(block.sb);
+      mBoundaries.push_back(block.start.as_long_long());
+      leaves.push_back({ summary.min, summary.max,
+                         double(summary.RMS) * summary.RMS * count,
+                         static_cast<int64_t>(count) });
+   }
+
+   mBoundaries.push_back(
+      blocksCount == 0 ? 0 : mBoundaries.back() + leaves.back().SamplesCount);
+
+   // Recompute the entries above that cover any changed block
+   size_t level = 1;
+   for (; mLevels[level - 1].size() > 1; ++level)
+   {
+      if (mLevels.size() == level)
+         mLevels.emplace_back();
+
+      const auto& below = mLevels[level - 1];
+      auto& entries = mLevels[level];
+
+      firstChanged /= Fanout;
+
+      const auto entriesCount = (below.size() + Fanout - 1) / Fanout;
+      entries.resize(std::min(firstChanged, entriesCount));
+
+      for (auto ii = entries.size(); ii < entriesCount; ++ii)
+      {
+         Summary summary;
+
+         const auto end = std::min(below.size(), (ii + 1) * Fanout);
+         for (auto jj = ii * Fanout; jj < end; ++jj)
+            summary.Add(below[jj]);
+
+         entries.push_back(summary);
+      }
+   }
+
+   mLevels.resize(level);
+}
+
+WaveSummaryPyramid::Summary
+WaveSummaryPyramid::GetSummary(int64_t from, int64_t count) const noexcept
+{
+   Summary summary;
+
+   if (mBlocks.empty() || count <= 0)
+      return summary;
+
+   const auto begin = mBoundaries.begin();
+   const auto end   = mBoundaries.end();
+
+   // Search the block starts, not the end of the last block
+   const auto first = std::lower_bound(begin, end - 1, from);
+   if (first == end - 1 || *first != from)
+      return summary;
+
+   // The last boundary not after the end of the range
+   const auto last = std::upper_bound(first, end, from + count) - 1;
+
+   const auto blocksCount = mBlocks.size();
+   const auto lastIndex   = static_cast<size_t>(last - begin);
+
+   auto ii = static_cast<size_t>(first - begin);
+   while (ii < lastIndex)
+   {
+      // Take the highest entry that starts at ii and ends within the range
+      size_t level = 0;
+      size_t span  = 1;
+      while (level + 1 < mLevels.size() && ii % (span * Fanout) == 0 &&
+             std::min(ii + span * Fanout, blocksCount) <= lastIndex)
+      {
+         ++level;
+         span *= Fanout;
+      }
+
+      summary.Add(mLevels[level][ii / span]);
+      ii += span;
+   }
+
+   return summary;
+}
+
+size_t WaveSummaryPyramid::GetLevelsCount() const noexcept
+{
+   return mLevels.size();
+}
@@ -0,0 +1,75 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  WaveSummaryPyramid.h
+
+**********************************************************************/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+class BlockArray;
+class SampleBlock;
+class WaveClip;
+
+//! Hierarchical min/max/rms summaries of the sample blocks of a sequence
+/*!
+ The first level has one entry for each sample block, made from the whole
+ block summary that blocks keep in memory.  Each higher level has one entry for
+ every Fanout entries of the level below.  A range of whole blocks is then
+ summarized by combining O(Fanout * log(blocks)) entries, whatever its length.
+
+ Update() keeps the entries for the unchanged blocks at the start of the
+ sequence, so that appending or editing near the end costs little.
+ */
+class WAVE_TRACK_PAINT_API WaveSummaryPyramid final
+{
+public:
+   //! Entries of each level combine this many entries of the level below
+   static constexpr size_t Fanout = 16;
+
+   struct Summary final
+   {
+      float Min { std::numeric_limits<float>::infinity() };
+      float Max { -std::numeric_limits<float>::infinity() };
+      double SquaresSum { 0.0 };
+      int64_t SamplesCount { 0 };
+
+      void Add(const Summary& other) noexcept;
+   };
+
+   //! The pyramid of a channel of a clip, updated if the clip changed
+   static const WaveSummaryPyramid& Get(const WaveClip& clip, size_t channel);
+
+   //! Rebuild the entries from the first block that differs
+   void Update(const BlockArray& blocks);
+
+   //! Whether the next Update() must compare blocks
+   void MarkChanged() noexcept;
+
+   //! Summary of the longest run of whole blocks that starts with the block
+   //! beginning at `from` and ends at or before `from + count`
+   /*!
+    @return a summary of no samples if `from` is not the start of a block, or
+    that block is longer than count
+    */
+   Summary GetSummary(int64_t from, int64_t count) const noexcept;
+
+   size_t GetLevelsCount() const noexcept;
+
+private:
+   //! The blocks that mLevels[0] summarizes; weak, so that a block at the
+   //! address of a destroyed one is not mistaken for it
+   std::vector<std::weak_ptr<SampleBlock>> mBlocks;
+   //! Block starts, and then the end of the last block
+   std::vector<int64_t> mBoundaries;
+   //! mLevels[0] has an entry per block
+   std::vector<std::vector<Summary>> mLevels;
+   bool mChanged { true };
+};
@@ -23,6 +23,11 @@ SampleBlockFactoryPtr SampleBlockFactory::New( AudacityProject &project )
 
 SampleBlockFactory::~SampleBlockFactory() = default;
 
+SampleBlockCacheStatistics SampleBlockFactory::GetCacheStatistics() const
+{
+   return {};
+}
+
 SampleBlockPtr SampleBlockFactory::Create(constSamplePtr src,
    size_t numsamples,
    sampleFormat srcformat)
@@ -66,8 +71,40 @@ SampleBlockPtr SampleBlockFactory::CreateFromId(
    return result;
 }
 
+bool SampleBlockFactory::GetSamples(const SampleBlockReads &reads,
+   sampleFormat destformat, bool mayThrow)
+{
+   try{ return DoGetSamples(reads, destformat); }
+   catch( ... ) {
+      if( mayThrow )
+         throw;
+      // Salvage whatever can be read
+      bool result = true;
+      for (const auto &read : reads)
+         if (read.pBlock->GetSamples(read.dest, destformat,
+               read.sampleoffset, read.numsamples, false) != read.numsamples)
+            result = false;
+      return result;
+   }
+}
+
+bool SampleBlockFactory::DoGetSamples(
+   const SampleBlockReads &reads, sampleFormat destformat)
+{
+   bool result = true;
+   for (const auto &read : reads)
+      if (read.pBlock->GetSamples(read.dest, destformat,
+            read.sampleoffset, read.numsamples) != read.numsamples)
+         result = false;
+   return result;
+}
+
 SampleBlock::~SampleBlock() = default;
 
+void SampleBlock::SetImpliedSampleCount(size_t)
+{
+}
+
 size_t SampleBlock::GetSamples(samplePtr dest,
                    sampleFormat destformat,
                    size_t sampleoffset,
@@ -16,6 +16,7 @@ SampleBlock.h
 #include <functional>
 #include <memory>
 #include <unordered_set>
+#include <vector>
 
 #include "Observer.h"
 #include "XMLTagHandler.h"
@@ -89,6 +90,11 @@ public:
 
    virtual void SaveXML(XMLWriter &xmlFile) = 0;
 
+   //! Learn the count of samples implied by the sequence read from a project
+   //! document; a block created lazily from XML may then defer reading its
+   //! storage until its contents are needed.  Default does nothing.
+   virtual void SetImpliedSampleCount(size_t count);
+
 protected:
    virtual size_t DoGetSamples(samplePtr dest,
                      sampleFormat destformat,
@@ -111,6 +117,25 @@ BlockSpaceUsageAccumulator (unsigned long long &total)
 
 struct SampleBlockCreateMessage { };
 
+//! One piece of a batched read, see SampleBlockFactory::GetSamples
+struct SampleBlockRead
+{
+   SampleBlock *pBlock;
+   samplePtr dest;
+   size_t sampleoffset;
+   size_t numsamples;
+};
+using SampleBlockReads = std::vector<SampleBlockRead>;
+
+//! Counters describing a factory's cache of decoded samples
+struct SampleBlockCacheStatistics
+{
+   size_t hits = 0;
+   size_t misses = 0;
+   size_t bytes = 0; //!< Currently held by the cache
+   size_t budget = 0; //!< Upper limit for bytes
+};
+
 ///\brief abstract base class with methods to produce @ref SampleBlock objects
 class WAVE_TRACK_API SampleBlockFactory
    : public Observer::Publisher<SampleBlockCreateMessage>
@@ -148,6 +173,20 @@ public:
    /*! @return ids of all sample blocks created by this factory and still extant */
    virtual SampleBlockIDs GetActiveBlockIDs() = 0;
 
+   /*! @return counters of the cache of decoded samples, or zeroes if the
+    factory has no cache */
+   virtual SampleBlockCacheStatistics GetCacheStatistics() const;
+
+   //! Read from several blocks made by this factory, with fewer round trips
+   //! to storage than reading them one at a time, if the implementation can
+   /*!
+    If !mayThrow and there is an error, retries the blocks one at a time,
+    filling with zeroes where they fail.
+    @return whether all requested samples were read
+    */
+   bool GetSamples(const SampleBlockReads &reads,
+      sampleFormat destformat, bool mayThrow = true);
+
 protected:
    // The override should throw more informative exceptions on error than the
    // default InconsistencyException thrown by Create
@@ -169,6 +208,10 @@ protected:
 
    virtual SampleBlockPtr
    DoCreateFromId(sampleFormat srcformat, SampleBlockID id) = 0;
+
+   //! Default implementation reads the blocks one at a time
+   virtual bool DoGetSamples(
+      const SampleBlockReads &reads, sampleFormat destformat);
 };
 
 #endif
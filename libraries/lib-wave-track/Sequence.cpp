@@ -33,6 +33,7 @@
 
 #include <algorithm>
 #include <optional>
+#include <utility>
 #include <float.h>
 #include <math.h>
 
@@ -70,7 +71,13 @@ Sequence::Sequence(
    mMinSamples(orig.mMinSamples),
    mMaxSamples(orig.mMaxSamples)
 {
-   Paste(0, &orig);
+   if (pFactory == orig.mpFactory) {
+      // Share the blocks until either sequence changes them
+      mBlock = orig.mBlock;
+      mNumSamples = orig.mNumSamples;
+   }
+   else
+      Paste(0, &orig);
 }
 
 Sequence::~Sequence()
@@ -89,8 +96,9 @@ size_t Sequence::GetIdealBlockSize() const
 
 bool Sequence::CloseLock() noexcept
 {
-   for (unsigned int i = 0; i < mBlock.size(); i++)
-      mBlock[i].sb->CloseLock();
+   // Lock the blocks in place, without copying a shared array
+   for (auto &block : std::as_const(mBlock))
+      block.sb->CloseLock();
 
    return true;
 }
@@ -442,7 +450,7 @@ std::unique_ptr<Sequence> Sequence::Copy( const SampleBlockFactoryPtr &pFactory,
    // If there are blocks in the middle, use the blocks whole
    for (int bb = b0 + 1; bb < b1; ++bb)
       AppendBlock(pUseFactory, format,
-         dest->mBlock, dest->mNumSamples, mBlock[bb]);
+         dest->mBlock.Mutable(), dest->mNumSamples, mBlock[bb]);
       // Increase ref count or duplicate file
 
    // Do the last block
@@ -463,7 +471,7 @@ std::unique_ptr<Sequence> Sequence::Copy( const SampleBlockFactoryPtr &pFactory,
       else
          // Special case of a whole block
          AppendBlock(pUseFactory, format,
-            dest->mBlock, dest->mNumSamples, block);
+            dest->mBlock.Mutable(), dest->mNumSamples, block);
          // Increase ref count or duplicate file
    }
 
@@ -957,6 +965,16 @@ void Sequence::HandleXMLEndTag(const std::string_view& tag)
 
    // Make sure that the sequence is valid.
 
+   // Tell each block the length that the starts of the blocks imply, so
+   // that blocks need not read their storage yet
+   for (size_t b = 0, nn = mBlock.size(); b < nn; ++b)
+   {
+      const auto &block = mBlock[b];
+      const auto end = b + 1 < nn ? mBlock[b + 1].start : mNumSamples;
+      if (end > block.start && end - block.start <= mMaxSamples)
+         block.sb->SetImpliedSampleCount((end - block.start).as_size_t());
+   }
+
    // Make sure that start times and lengths are consistent
    sampleCount numSamples = 0;
    for (unsigned b = 0, nn = mBlock.size(); b < nn;  b++)
@@ -1185,7 +1203,16 @@ bool Sequence::Get(samplePtr buffer, sampleFormat format,
 bool Sequence::Get(int b, samplePtr buffer, sampleFormat format,
    sampleCount start, size_t len, bool mayThrow) const
 {
-   bool result = true;
+   {
+      const SeqBlock &block = mBlock[b];
+      const auto bstart = (start - block.start).as_size_t();
+      if (len <= block.sb->GetSampleCount() - bstart)
+         // Contained in one block
+         return Read(buffer, format, block, bstart, len, mayThrow);
+   }
+
+   // Let the factory fetch all the blocks at once
+   SampleBlockReads reads;
    while (len) {
       const SeqBlock &block = mBlock[b];
       // start is in block
@@ -1193,15 +1220,14 @@ bool Sequence::Get(int b, samplePtr buffer, sampleFormat format,
       // bstart is not more than block length
       const auto blen = std::min(len, block.sb->GetSampleCount() - bstart);
 
-      if (! Read(buffer, format, block, bstart, blen, mayThrow) )
-         result = false;
+      reads.push_back({ block.sb.get(), buffer, bstart, blen });
 
       len -= blen;
       buffer += (blen * SAMPLE_SIZE(format));
       b++;
       start += blen;
    }
-   return result;
+   return mpFactory->GetSamples(reads, format, mayThrow);
 }
 
 // Pass nullptr to set silence
@@ -1813,9 +1839,10 @@ void Sequence::CommitChangesIfConsistent
    ConsistencyCheck( newBlock, mMaxSamples, 0, numSamples, whereStr ); // may throw
 
    // now commit
-   // use No-fail-guarantee
+   // use No-fail-guarantee, except that a shared array may fail to be
+   // replaced, leaving this unchanged
 
-   mBlock.swap(newBlock);
+   mBlock.Replace(std::move(newBlock));
    mNumSamples = numSamples;
 }
 
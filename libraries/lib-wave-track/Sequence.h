@@ -12,8 +12,10 @@
 #define __AUDACITY_SEQUENCE__
 
 
+#include <atomic>
 #include <vector>
 #include <functional>
+#include <memory>
 
 #include "SampleFormat.h"
 #include "XMLTagHandler.h"
@@ -50,6 +52,76 @@ class SeqBlock {
 class BlockArray : public std::vector<SeqBlock> {};
 using BlockPtrArray = std::vector<SeqBlock*>; // non-owning pointers
 
+//! A BlockArray that copies of a Sequence share, until one of them changes it
+/*!
+ Const access reads the shared array.  Non-const access first copies the
+ array if it is shared, so that the other sequences never see the change.
+
+ Only the arrays are shared.  Copying a track, as for an undo state, still
+ copies each clip and sequence, so it costs in proportion to the clips but
+ no longer to the blocks.
+
+ Like the Sequence that owns it, each SharedBlockArray is used by one thread
+ at a time; but the copies sharing its array may be used, and destroyed, on
+ other threads meanwhile.
+ */
+class SharedBlockArray {
+public:
+   using value_type = SeqBlock;
+
+   SharedBlockArray() : mpBlocks{ std::make_shared<BlockArray>() } {}
+
+   operator const BlockArray &() const { return *mpBlocks; }
+
+   //! Copy the array first, if it is shared
+   BlockArray &Mutable()
+   {
+      if (!Unique())
+         mpBlocks = std::make_shared<BlockArray>(*mpBlocks);
+      return *mpBlocks;
+   }
+
+   //! Replace the contents, without copying the old ones if shared
+   void Replace(BlockArray &&blocks)
+   {
+      if (!Unique())
+         mpBlocks = std::make_shared<BlockArray>(std::move(blocks));
+      else
+         mpBlocks->swap(blocks);
+   }
+
+   size_t size() const { return mpBlocks->size(); }
+   bool empty() const { return mpBlocks->empty(); }
+
+   const SeqBlock &operator [](size_t ii) const { return (*mpBlocks)[ii]; }
+   SeqBlock &operator [](size_t ii) { return Mutable()[ii]; }
+   const SeqBlock &back() const { return mpBlocks->back(); }
+   SeqBlock &back() { return Mutable().back(); }
+
+   BlockArray::const_iterator begin() const { return mpBlocks->begin(); }
+   BlockArray::const_iterator end() const { return mpBlocks->end(); }
+
+   void push_back(const SeqBlock &block) { Mutable().push_back(block); }
+   void pop_back() { Mutable().pop_back(); }
+   void reserve(size_t size) { Mutable().reserve(size); }
+   void resize(size_t size) { Mutable().resize(size); }
+
+private:
+   //! Whether no copy shares the array
+   bool Unique() const
+   {
+      if (mpBlocks.use_count() > 1)
+         return false;
+      // use_count() is a relaxed load.  Synchronize with the release of the
+      // last copy on another thread, so that its reads of the array happen
+      // before any change that follows
+      std::atomic_thread_fence(std::memory_order_acquire);
+      return true;
+   }
+
+   std::shared_ptr<BlockArray> mpBlocks;
+};
+
 class WAVE_TRACK_API Sequence final : public XMLTagHandler{
  public:
 
@@ -73,6 +145,7 @@ class WAVE_TRACK_API Sequence final : public XMLTagHandler{
    Sequence(const SampleBlockFactoryPtr &pFactory, SampleFormats formats);
 
    //! Does not copy un-flushed append buffer data
+   /*! Shares the block array with orig, if the factory is the same */
    Sequence(const Sequence &orig, const SampleBlockFactoryPtr &pFactory);
 
    Sequence( const Sequence& ) = delete;
@@ -229,7 +302,7 @@ class WAVE_TRACK_API Sequence final : public XMLTagHandler{
    // you're doing!
    //
 
-   BlockArray &GetBlockArray() { return mBlock; }
+   BlockArray &GetBlockArray() { return mBlock.Mutable(); }
    const BlockArray &GetBlockArray() const { return mBlock; }
 
    size_t GetAppendBufferLen() const { return mAppendBufferLen; }
@@ -249,7 +322,7 @@ class WAVE_TRACK_API Sequence final : public XMLTagHandler{
 
    SampleBlockFactoryPtr mpFactory;
 
-   BlockArray    mBlock;
+   SharedBlockArray mBlock;
    SampleFormats  mSampleFormats;
 
    // Not size_t!  May need to be large:
@@ -35,6 +35,7 @@ from the project that will own the track.
 #include <wx/log.h>
 
 #include <algorithm>
+#include <atomic>
 #include <float.h>
 #include <math.h>
 #include <numeric>
@@ -60,10 +61,12 @@ from the project that will own the track.
 #include "Prefs.h"
 #include "QualitySettings.h"
 #include "SyncLock.h"
+#include "ThreadPool.h"
 #include "TimeWarper.h"
 
 
 #include "InconsistencyException.h"
+#include "UserException.h"
 
 #include "ProjectFormatExtensionsRegistry.h"
 
@@ -71,12 +74,36 @@ from the project that will own the track.
 
 using std::max;
 
+namespace {
 /*!
+ * @brief Widen the play region of a stretched clip by the margins that
+ * GetRenderedCopy needs
+ * @return the original play region
+ */
+TimeInterval WidenForRendering(WaveTrack::Interval& interval)
+{
+   const TimeInterval original { interval.GetPlayStartTime(),
+                                 interval.GetPlayEndTime() };
+   const auto stretchRatio = interval.GetStretchRatio();
+
+   // Leave 1 second of raw, unstretched audio before and after visible region
+   // to give the algorithm a chance to be in a steady state when reaching the
+   // play boundaries.
+   interval.TrimLeftTo(
+      std::max(interval.GetSequenceStartTime(), original.first - stretchRatio));
+   interval.TrimRightTo(
+      std::min(interval.GetSequenceEndTime(), original.second + stretchRatio));
+   return original;
+}
+
+/*!
+ * @pre `interval` was widened by WidenForRendering, which returned `original`
  * @post result: `result->GetStretchRatio() == 1`
+ *
+ * Only reads `interval`, so that intervals can be rendered concurrently.
  */
-namespace {
 WaveTrack::IntervalHolder GetRenderedCopy(
-   const WaveTrack::IntervalHolder &pInterval,
+   const WaveTrack::IntervalHolder &pInterval, const TimeInterval& original,
    const std::function<void(double)>& reportProgress,
    const SampleBlockFactoryPtr& factory, sampleFormat format)
 {
@@ -88,28 +115,9 @@ WaveTrack::IntervalHolder GetRenderedCopy(
    const auto dst = std::make_shared<Interval>(
       interval.NChannels(), factory, format, interval.GetRate());
 
-   const auto originalPlayStartTime = interval.GetPlayStartTime();
-   const auto originalPlayEndTime = interval.GetPlayEndTime();
+   const auto [originalPlayStartTime, originalPlayEndTime] = original;
    const auto stretchRatio = interval.GetStretchRatio();
-
-   auto success = false;
-   Finally Do { [&] {
-      if (!success)
-      {
-         interval.TrimLeftTo(originalPlayStartTime);
-         interval.TrimRightTo(originalPlayEndTime);
-      }
-   } };
-
-   // Leave 1 second of raw, unstretched audio before and after visible region
-   // to give the algorithm a chance to be in a steady state when reaching the
-   // play boundaries.
-   const auto tmpPlayStartTime =
-      std::max(interval.GetSequenceStartTime(), originalPlayStartTime - stretchRatio);
-   const auto tmpPlayEndTime =
-      std::min(interval.GetSequenceEndTime(), originalPlayEndTime + stretchRatio);
-   interval.TrimLeftTo(tmpPlayStartTime);
-   interval.TrimRightTo(tmpPlayEndTime);
+   const auto tmpPlayStartTime = interval.GetPlayStartTime();
 
    constexpr auto sourceDurationToDiscard = 0.;
    constexpr auto blockSize = 1024;
@@ -164,11 +172,63 @@ WaveTrack::IntervalHolder GetRenderedCopy(
    dstEnvelope->SetOffset(originalPlayStartTime);
    dst->SetEnvelope(move(dstEnvelope));
 
-   success = true;
-
    assert(!dst->HasPitchOrSpeed());
    return dst;
 }
+
+//! Render the intervals on the threads of the pool, while this thread
+//! reports their overall progress
+/*!
+ @param render called with each index and a reporter of its progress, which
+ throws once reportProgress has thrown
+ */
+void RenderConcurrently(
+   const WaveTrack::IntervalHolders& intervals,
+   const std::function<void(size_t, const ProgressReporter&)>& render,
+   const ProgressReporter& reportProgress)
+{
+   const auto numIntervals = intervals.size();
+   // Weigh progress by the numbers of samples to render
+   std::vector<double> weights(numIntervals);
+   std::transform(
+      intervals.begin(), intervals.end(), weights.begin(),
+      [](const WaveTrack::IntervalHolder& interval) {
+         return interval->HasPitchOrSpeed() ?
+                   interval->GetVisibleSampleCount().as_double() *
+                      interval->GetStretchRatio() :
+                   0.;
+      });
+   const auto totalWeight =
+      std::max(std::accumulate(weights.begin(), weights.end(), 0.), 1.);
+
+   std::vector<std::atomic<double>> fractions(numIntervals);
+   for (auto& fraction : fractions)
+      fraction.store(0., std::memory_order_relaxed);
+   std::atomic<bool> cancelled { false };
+
+   // reportProgress cancels by throwing, which is rethrown
+   Parallel::ThreadPool::Get().ParallelFor(
+      numIntervals,
+      [&](size_t i) {
+         render(i, [&, i](double fraction) {
+            fractions[i].store(fraction, std::memory_order_relaxed);
+            if (cancelled.load(std::memory_order_relaxed))
+               throw UserException {};
+         });
+      },
+      [&] {
+         if (reportProgress)
+         {
+            auto done = 0.;
+            for (size_t i = 0; i < numIntervals; ++i)
+               done +=
+                  weights[i] * fractions[i].load(std::memory_order_relaxed);
+            reportProgress(done / totalWeight);
+         }
+         return true;
+      },
+      cancelled);
+}
 }
 
 std::shared_ptr<const WaveTrack::Interval>
@@ -3181,14 +3241,41 @@ void WaveTrack::ApplyPitchAndSpeedOnIntervals(
    const IntervalHolders& srcIntervals,
    const ProgressReporter& reportProgress)
 {
-   IntervalHolders dstIntervals;
-   dstIntervals.reserve(srcIntervals.size());
-   std::transform(
+   const auto numIntervals = srcIntervals.size();
+
+   // Widen the intervals here, so that rendering only reads them
+   std::vector<TimeInterval> originals(numIntervals);
+   for (size_t i = 0; i < numIntervals; ++i)
+      if (srcIntervals[i]->HasPitchOrSpeed())
+         originals[i] = WidenForRendering(*srcIntervals[i]);
+   auto success = false;
+   Finally Do { [&] {
+      if (!success)
+         for (size_t i = 0; i < numIntervals; ++i)
+            if (srcIntervals[i]->HasPitchOrSpeed())
+            {
+               srcIntervals[i]->TrimLeftTo(originals[i].first);
+               srcIntervals[i]->TrimRightTo(originals[i].second);
+            }
+   } };
+
+   IntervalHolders dstIntervals(numIntervals);
+   const auto render = [&](size_t i, const ProgressReporter& report) {
+      dstIntervals[i] = GetRenderedCopy(
+         srcIntervals[i], originals[i], report, mpFactory, GetSampleFormat());
+   };
+
+   // Each interval has its own stretcher, and the sample blocks of a new
+   // interval may be made on any thread
+   const auto numToRender = std::count_if(
       srcIntervals.begin(), srcIntervals.end(),
-      std::back_inserter(dstIntervals), [&](const IntervalHolder& interval) {
-         return GetRenderedCopy(interval,
-            reportProgress, mpFactory, GetSampleFormat());
-      });
+      [](const IntervalHolder& interval) { return interval->HasPitchOrSpeed(); });
+   if (numToRender > 1 && Parallel::ThreadPool::Get().Workers() > 0)
+      RenderConcurrently(srcIntervals, render, reportProgress);
+   else
+      for (size_t i = 0; i < numIntervals; ++i)
+         render(i, reportProgress);
+   success = true;
 
    // If we reach this point it means that no error was thrown - we can replace
    // the source with the destination intervals.
@@ -0,0 +1,60 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+ Audacity: A Digital Audio Editor
+
+ SequenceXMLTests.cpp
+
+ **********************************************************************/
+#include <catch2/catch.hpp>
+
+#include <utility>
+#include <vector>
+
+#include "FakeSampleBlock.h"
+#include "MockedPrefs.h"
+#include "Sequence.h"
+
+namespace
+{
+//! Feed the tags of a sequence of blocks with the given starts
+bool ReadSequence(
+   Sequence& sequence, const std::vector<long long>& starts,
+   long long numSamples)
+{
+   const AttributesList sequenceAttrs {
+      { "maxsamples", XMLAttributeValueView { 262144LL } },
+      { "sampleformat", XMLAttributeValueView { long(floatSample) } },
+      { "numsamples", XMLAttributeValueView { numSamples } },
+   };
+   if (!sequence.HandleXMLTag(Sequence::Sequence_tag, sequenceAttrs))
+      return false;
+   for (const auto start : starts)
+   {
+      const AttributesList blockAttrs {
+         { "start", XMLAttributeValueView { start } },
+      };
+      if (!sequence.HandleXMLTag(Sequence::WaveBlock_tag, blockAttrs))
+         return false;
+   }
+   sequence.HandleXMLEndTag(Sequence::Sequence_tag);
+   return !sequence.GetErrorOpening();
+}
+} // namespace
+
+TEST_CASE("Sequence tells blocks the lengths that their starts imply")
+{
+   MockedPrefs mockedPrefs;
+
+   const auto factory = std::make_shared<FakeSampleBlockFactory>();
+   Sequence sequence { factory, SampleFormats { floatSample, floatSample } };
+
+   REQUIRE(ReadSequence(sequence, { 0, 1000, 3000 }, 3500));
+   REQUIRE(sequence.GetNumSamples() == 3500);
+
+   const auto& blocks = std::as_const(sequence).GetBlockArray();
+   REQUIRE(blocks.size() == 3);
+   CHECK(blocks[0].sb->GetSampleCount() == 1000);
+   CHECK(blocks[1].sb->GetSampleCount() == 2000);
+   CHECK(blocks[2].sb->GetSampleCount() == 500);
+}
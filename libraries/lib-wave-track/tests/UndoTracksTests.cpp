@@ -0,0 +1,160 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+ Audacity: A Digital Audio Editor
+
+ UndoTracksTests.cpp
+
+ **********************************************************************/
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "FakeSampleBlock.h"
+#include "MemoryX.h"
+#include "MockedPrefs.h"
+#include "Project.h"
+#include "Sequence.h"
+#include "UndoManager.h"
+#include "UndoTracks.h"
+#include "WaveClip.h"
+#include "WaveTrack.h"
+
+namespace
+{
+constexpr size_t blockSize = 256;
+
+void Append(WaveTrack& track, size_t nBlocks)
+{
+   const std::vector<float> samples(blockSize * nBlocks);
+   track.Append(
+      0, reinterpret_cast<constSamplePtr>(samples.data()), floatSample,
+      samples.size());
+   track.Flush();
+}
+
+//! Add tracks of one clip each, of many blocks
+void AddTracks(
+   TrackList& tracks, const SampleBlockFactoryPtr& factory, size_t nTracks,
+   size_t nBlocks)
+{
+   for (size_t ii = 0; ii < nTracks; ++ii)
+   {
+      const auto track = WaveTrack::Create(factory, floatSample, 44100);
+      Append(*track, nBlocks);
+      tracks.Add(track);
+   }
+}
+
+TrackList& PushState(AudacityProject& project)
+{
+   auto& manager = UndoManager::Get(project);
+   manager.PushState(XO("Test"), XO("Test"));
+   TrackList* pTracks {};
+   const auto current = manager.GetCurrentState();
+   manager.VisitStates(
+      [&](const UndoStackElem& elem) { pTracks = UndoTracks::Find(elem); },
+      current, current + 1);
+   REQUIRE(pTracks);
+   return *pTracks;
+}
+
+WaveTrack& FirstTrack(TrackList& tracks)
+{
+   return **tracks.Any<WaveTrack>().begin();
+}
+
+const BlockArray& Blocks(const WaveTrack& track)
+{
+   return *track.GetClip(0)->GetSequenceBlockArray(0);
+}
+} // namespace
+
+TEST_CASE("UndoTracks")
+{
+   MockedPrefs mockedPrefs;
+
+   // Small blocks, so that tracks of many blocks are quick to make
+   const auto maxDiskBlockSize = Sequence::GetMaxDiskBlockSize();
+   Sequence::SetMaxDiskBlockSize(blockSize * sizeof(float));
+   auto cleanup =
+      finally([&] { Sequence::SetMaxDiskBlockSize(maxDiskBlockSize); });
+
+   const auto project = AudacityProject::Create();
+   auto& tracks = TrackList::Get(*project);
+   const auto factory = std::make_shared<FakeSampleBlockFactory>();
+
+   SECTION("Undo states share the blocks of unchanged tracks")
+   {
+      AddTracks(tracks, factory, 3, 10);
+      auto& snapshot = PushState(*project);
+      REQUIRE(snapshot.Size() == 3);
+      auto snapshotTracks = snapshot.Any<WaveTrack>();
+      auto iter = snapshotTracks.begin();
+      for (auto track : tracks.Any<WaveTrack>())
+         REQUIRE(&Blocks(*track) == &Blocks(**iter++));
+   }
+
+   SECTION("Changes copy the blocks, leaving undo states alone")
+   {
+      AddTracks(tracks, factory, 1, 10);
+      auto& snapshot = PushState(*project);
+      auto& track = FirstTrack(tracks);
+      Append(track, 2);
+      REQUIRE(Blocks(track).size() == 12);
+      REQUIRE(Blocks(FirstTrack(snapshot)).size() == 10);
+
+      auto& snapshot2 = PushState(*project);
+      REQUIRE(&Blocks(FirstTrack(snapshot2)) == &Blocks(track));
+
+      // Undo restores tracks that share the blocks of the older state
+      UndoManager::Get(*project).Undo([&](const UndoStackElem& elem) {
+         for (auto& pExtension : elem.state.extensions)
+            if (pExtension)
+               pExtension->RestoreUndoRedoState(*project);
+      });
+      auto& restored = FirstTrack(TrackList::Get(*project));
+      REQUIRE(Blocks(restored).size() == 10);
+      REQUIRE(&Blocks(restored) == &Blocks(FirstTrack(snapshot)));
+      REQUIRE(Blocks(FirstTrack(snapshot2)).size() == 12);
+   }
+}
+
+TEST_CASE("UndoTracks benchmark", "[.][benchmark]")
+{
+   MockedPrefs mockedPrefs;
+
+   const auto maxDiskBlockSize = Sequence::GetMaxDiskBlockSize();
+   Sequence::SetMaxDiskBlockSize(blockSize * sizeof(float));
+   auto cleanup =
+      finally([&] { Sequence::SetMaxDiskBlockSize(maxDiskBlockSize); });
+
+   const auto factory = std::make_shared<FakeSampleBlockFactory>();
+
+   for (const size_t nTracks : { 10, 100, 1000 })
+   {
+      const auto project = AudacityProject::Create();
+      AddTracks(TrackList::Get(*project), factory, nTracks, 100);
+      auto& manager = UndoManager::Get(*project);
+      manager.PushState(XO("Test"), XO("Test"));
+      // Consolidate, so that the history does not grow while measuring;
+      // the whole project is still captured each time
+      BENCHMARK("PushState with " + std::to_string(nTracks) + " tracks")
+      {
+         manager.PushState(XO("Test"), XO("Test"), UndoPush::CONSOLIDATE);
+      };
+      // The baseline: PushState copied these too, before they were shared
+      BENCHMARK(
+         "Copies of the block arrays of " + std::to_string(nTracks) +
+         " tracks")
+      {
+         std::vector<BlockArray> copies;
+         copies.reserve(nTracks);
+         for (const auto track : TrackList::Get(*project).Any<WaveTrack>())
+            copies.push_back(Blocks(*track));
+         return copies.size();
+      };
+   }
+}
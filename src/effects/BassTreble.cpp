@@ -196,6 +196,11 @@ auto EffectBassTreble::RealtimeSupport() const -> RealtimeSince
    return RealtimeSince::After_3_1;
 }
 
+bool EffectBassTreble::CanProcessTracksConcurrently() const
+{
+   return true;
+}
+
 unsigned EffectBassTreble::Instance::GetAudioInCount() const
 {
    return 1;
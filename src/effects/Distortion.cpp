@@ -358,6 +358,11 @@ auto EffectDistortion::RealtimeSupport() const -> RealtimeSince
    return RealtimeSince::After_3_1;
 }
 
+bool EffectDistortion::CanProcessTracksConcurrently() const
+{
+   return true;
+}
+
 unsigned EffectDistortion::Instance::GetAudioInCount() const
 {
    return 1;
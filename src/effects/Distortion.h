@@ -107,6 +107,7 @@ public:
    struct Editor;
    struct Instance;
    std::shared_ptr<EffectInstance> MakeInstance() const override;
+   bool CanProcessTracksConcurrently() const override;
 
 private:
 
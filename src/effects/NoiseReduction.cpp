@@ -262,6 +262,7 @@ struct MyTransformer : TrackSpectrumTransformer {
          windowSize, stepsPerWindow, leadingPadding, trailingPadding
       }
       , mWorker{ worker }
+      , mFreqSmoothingScratch(windowSize / 2 + 1)
    {
    }
    struct MyWindow : public Window
@@ -283,6 +284,8 @@ struct MyTransformer : TrackSpectrumTransformer {
    bool DoFinish() override;
 
    EffectNoiseReduction::Worker &mWorker;
+   // One for each transformer, which may run on its own thread
+   FloatVector mFreqSmoothingScratch;
 };
 
 //----------------------------------------------------------------------------
@@ -308,8 +311,14 @@ public:
       TrackList &tracks, double mT0, double mT1);
 
    static bool Processor(SpectrumTransformer &transformer);
+   //! Processor without progress, for segments on other threads
+   static bool ProcessWindow(SpectrumTransformer &transformer);
+
+   //! How many windows back the reduction of a window can depend on
+   /*! @return 0 if unbounded */
+   size_t WarmupWindows() const;
 
-   void ApplyFreqSmoothing(FloatVector &gains);
+   void ApplyFreqSmoothing(FloatVector &gains, FloatVector &scratch) const;
    void GatherStatistics(MyTransformer &transformer);
    inline bool Classify(
       MyTransformer &transformer, unsigned nWindows, int band);
@@ -322,7 +331,6 @@ public:
    const Settings &mSettings;
    Statistics &mStatistics;
 
-   FloatVector mFreqSmoothingScratch;
    const size_t mFreqSmoothingBins;
    // When spectral selection limits the affected band:
    size_t mBinLow;  // inclusive lower bound
@@ -773,7 +781,22 @@ bool EffectNoiseReduction::Worker::Process(
                mSettings.WindowSize(), mSettings.StepsPerWindow(),
                !mSettings.mDoProfile, !mSettings.mDoProfile
             };
-            if (!transformer
+            if (const auto warmup = WarmupWindows(); warmup > 0) {
+               // Reduce segments of the channel on several threads
+               const auto factory = [&] {
+                  return std::make_unique<MyTransformer>(*this, nullptr,
+                     true, inWindowType, outWindowType,
+                     mSettings.WindowSize(), mSettings.StepsPerWindow(),
+                     true, true);
+               };
+               const auto progress = [this](double fraction) {
+                  return !mEffect.TrackProgress(mProgressTrackCount, fraction);
+               };
+               if (!transformer.ProcessSegmented(factory, ProcessWindow,
+                  *pChannel, mHistoryLen, start, len, warmup, progress))
+                  return false;
+            }
+            else if (!transformer
                .Process(Processor, *pChannel, mHistoryLen, start, len))
                return false;
             ++mProgressTrackCount;
@@ -799,7 +822,8 @@ bool EffectNoiseReduction::Worker::Process(
    return true;
 }
 
-void EffectNoiseReduction::Worker::ApplyFreqSmoothing(FloatVector &gains)
+void EffectNoiseReduction::Worker::ApplyFreqSmoothing(
+   FloatVector &gains, FloatVector &scratch) const
 {
    // Given an array of gain mutipliers, average them
    // GEOMETRICALLY.  Don't multiply and take nth root --
@@ -811,7 +835,7 @@ void EffectNoiseReduction::Worker::ApplyFreqSmoothing(FloatVector &gains)
    const auto spectrumSize = mSettings.SpectrumSize();
 
    {
-      auto pScratch = mFreqSmoothingScratch.data();
+      auto pScratch = scratch.data();
       std::fill(pScratch, pScratch + spectrumSize, 0.0f);
    }
 
@@ -823,13 +847,13 @@ void EffectNoiseReduction::Worker::ApplyFreqSmoothing(FloatVector &gains)
       const int j0 = std::max(0, ii - (int)mFreqSmoothingBins);
       const int j1 = std::min(spectrumSize - 1, ii + mFreqSmoothingBins);
       for(int jj = j0; jj <= j1; ++jj) {
-         mFreqSmoothingScratch[ii] += gains[jj];
+         scratch[ii] += gains[jj];
       }
-      mFreqSmoothingScratch[ii] /= (j1 - j0 + 1);
+      scratch[ii] /= (j1 - j0 + 1);
    }
 
    for (size_t ii = 0; ii < spectrumSize; ++ii)
-      gains[ii] = exp(mFreqSmoothingScratch[ii]);
+      gains[ii] = exp(scratch[ii]);
 }
 
 EffectNoiseReduction::Worker::Worker(EffectNoiseReduction &effect,
@@ -844,7 +868,6 @@ EffectNoiseReduction::Worker::Worker(EffectNoiseReduction &effect,
 , mSettings{ settings }
 , mStatistics{ statistics }
 
-, mFreqSmoothingScratch(mSettings.SpectrumSize())
 , mFreqSmoothingBins{ size_t(std::max(0.0, settings.mFreqSmoothingBands)) }
 , mBinLow{ 0 }
 , mBinHigh{ mSettings.SpectrumSize() }
@@ -916,6 +939,19 @@ bool MyTransformer::DoStart()
 }
 
 bool EffectNoiseReduction::Worker::Processor(SpectrumTransformer &trans)
+{
+   auto &transformer = static_cast<MyTransformer &>(trans);
+   auto &worker = transformer.mWorker;
+   ProcessWindow(trans);
+
+   // Update the Progress meter, let user cancel
+   return !worker.mEffect.TrackProgress(worker.mProgressTrackCount,
+      std::min(1.0,
+         ((++worker.mProgressWindowCount).as_double() *
+          worker.mSettings.StepSize()) / worker.mLen.as_double()));
+}
+
+bool EffectNoiseReduction::Worker::ProcessWindow(SpectrumTransformer &trans)
 {
    auto &transformer = static_cast<MyTransformer &>(trans);
    auto &worker = transformer.mWorker;
@@ -938,12 +974,29 @@ bool EffectNoiseReduction::Worker::Processor(SpectrumTransformer &trans)
       worker.GatherStatistics(transformer);
    else
       worker.ReduceNoise(transformer);
+   return true;
+}
 
-   // Update the Progress meter, let user cancel
-   return !worker.mEffect.TrackProgress(worker.mProgressTrackCount,
-      std::min(1.0,
-         ((++worker.mProgressWindowCount).as_double() *
-          worker.mSettings.StepSize()) / worker.mLen.as_double()));
+size_t EffectNoiseReduction::Worker::WarmupWindows() const
+{
+   if (mDoProfile)
+      return 0;
+
+   // A window raises the gains of later windows only through the release
+   // curve, and of earlier ones through the attack curve, both decaying from
+   // at most 1 to the floor, past which they change nothing.  Count the
+   // steps of the slower curve, computed as in ReduceNoise().
+   const auto factor = std::max(mOneBlockAttack, mOneBlockRelease);
+   constexpr size_t maxDecay = 10000;
+   size_t nDecay = 0;
+   for (float gain = 1.0f; gain > mNoiseAttenFactor; gain *= factor)
+      if (++nDecay > maxDecay)
+         // Too slow to be worth the warm-up
+         return 0;
+
+   // Besides the decay, allow for the classification of a window from its
+   // neighbors, and for the queue of windows awaiting output
+   return nDecay + mNWindowsToExamine + mHistoryLen;
 }
 
 void EffectNoiseReduction::Worker::FinishTrackStatistics()
@@ -1169,7 +1222,8 @@ void EffectNoiseReduction::Worker::ReduceNoise(MyTransformer &transformer)
       if (mNoiseReductionChoice != NRC_ISOLATE_NOISE)
          // Apply frequency smoothing to output gain
          // Gains are not less than mNoiseAttenFactor
-         ApplyFreqSmoothing(record.mGains);
+         ApplyFreqSmoothing(
+            record.mGains, transformer.mFreqSmoothingScratch);
 
       // Apply gain to FFT
       {
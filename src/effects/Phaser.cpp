@@ -218,6 +218,11 @@ auto EffectPhaser::RealtimeSupport() const -> RealtimeSince
    return RealtimeSince::After_3_1;
 }
 
+bool EffectPhaser::CanProcessTracksConcurrently() const
+{
+   return true;
+}
+
 unsigned EffectPhaser::Instance::GetAudioInCount() const
 {
    return 1;
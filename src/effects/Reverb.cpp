@@ -357,6 +357,11 @@ auto EffectReverb::RealtimeSupport() const -> RealtimeSince
    return RealtimeSince::After_3_1;
 }
 
+bool EffectReverb::CanProcessTracksConcurrently() const
+{
+   return true;
+}
+
 static size_t BLOCK = 16384;
 
 bool EffectReverb::Instance::ProcessInitialize(EffectSettings& settings,
@@ -87,6 +87,7 @@ public:
    struct Instance;
 
    std::shared_ptr<EffectInstance> MakeInstance() const override;
+   bool CanProcessTracksConcurrently() const override;
 
 private:
    // EffectReverb implementation
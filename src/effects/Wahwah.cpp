@@ -210,6 +210,11 @@ auto EffectWahwah::RealtimeSupport() const -> RealtimeSince
    return RealtimeSince::After_3_1;
 }
 
+bool EffectWahwah::CanProcessTracksConcurrently() const
+{
+   return true;
+}
+
 bool EffectWahwah::Instance::ProcessInitialize(EffectSettings & settings,
    double sampleRate, ChannelNames chanMap)
 {
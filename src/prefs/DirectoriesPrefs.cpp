@@ -34,6 +34,7 @@
 #include "AudacityMessageBox.h"
 #include "ReadOnlyText.h"
 #include "FileNames.h"
+#include "ProjectFileIO.h"
 
 using namespace FileNames;
 using namespace TempDirectory;
@@ -260,6 +261,13 @@ void DirectoriesPrefs::PopulateOrExchange(ShuttleGui &S)
    }
    S.EndStatic();
 
+   S.StartStatic(XO("Opening projects"));
+   {
+      S.TieCheckBox(
+         XXO("Rea&d audio only when first used"), LazyProjectOpen);
+   }
+   S.EndStatic();
+
    S.EndScroller();
 }
 
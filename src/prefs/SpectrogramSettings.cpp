@@ -22,6 +22,7 @@ Paul Licameli
 #include <algorithm>
 
 #include "FFT.h"
+#include "FFTEngine.h"
 #include "Prefs.h"
 #include "WaveTrack.h"
 
@@ -170,7 +171,7 @@ SpectrogramSettings::SpectrogramSettings(const SpectrogramSettings &other)
 #endif
 
    // Do not copy these!
-   , hFFT{}
+   , pEngine{}
    , window{}
    , tWindow{}
    , dWindow{}
@@ -527,7 +528,7 @@ auto SpectrogramSettings::Clone() const -> PointerType
 
 void SpectrogramSettings::DestroyWindows()
 {
-   hFFT.reset();
+   pEngine = nullptr;
    window.reset();
    dWindow.reset();
    tWindow.reset();
@@ -592,14 +593,14 @@ namespace
 
 void SpectrogramSettings::CacheWindows()
 {
-   if (hFFT == NULL || window == NULL) {
+   if (pEngine == nullptr || window == NULL) {
 
       double scale;
       auto factor = ZeroPaddingFactor();
       const auto fftLen = WindowSize() * factor;
       const auto padding = (WindowSize() * (factor - 1)) / 2;
 
-      hFFT = GetFFT(fftLen);
+      pEngine = &FFTEngine::Get(fftLen);
       RecreateWindow(window, WINDOW, fftLen, padding, windowType, windowSize, scale);
       if (algorithm == algReassignment) {
          RecreateWindow(tWindow, TWINDOW, fftLen, padding, windowType, windowSize, scale);
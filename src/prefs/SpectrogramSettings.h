@@ -14,12 +14,12 @@ Paul Licameli
 #include "ClientData.h" // to inherit
 #include "Prefs.h"
 #include "SampleFormat.h"
-#include "RealFFTf.h"
+#include "MemoryX.h"
 
 #undef SPECTRAL_SELECTION_GLOBAL_SWITCH
 
 class EnumValueSymbols;
-struct FFTParam;
+class FFTEngine;
 class NumberScale;
 class SpectrumPrefs;
 class wxArrayStringEx;
@@ -196,7 +196,7 @@ public:
    // Following fields are derived from preferences.
 
    // Variables used for computing the spectrum
-   HFFT           hFFT;
+   const FFTEngine *pEngine{}; //!< Shared, not owned
    Floats         window;
 
    // Two other windows for computing reassigned spectrogram
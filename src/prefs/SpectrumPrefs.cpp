@@ -28,6 +28,7 @@
 
 #include "../TrackPanel.h"
 #include "WaveTrack.h"
+#include "../tracks/playabletrack/wavetrack/ui/SpectrogramDiskCache.h"
 #include "../tracks/playabletrack/wavetrack/ui/WaveChannelView.h"
 
 #include <algorithm>
@@ -309,6 +310,12 @@ void SpectrumPrefs::PopulateOrExchange(ShuttleGui & S)
 #endif //EXPERIMENTAL_FIND_NOTES
    // S.EndStatic();
 
+   // Not a setting of tracks, so only in Preferences
+   if (!mWc)
+      S.TieCheckBox(
+         XXO("&Keep spectrograms beside the project between sessions"),
+         SpectrogramDiskCacheEnabled);
+
 #ifdef SPECTRAL_SELECTION_GLOBAL_SWITCH
    S.StartStatic(XO("Global settings"));
    {
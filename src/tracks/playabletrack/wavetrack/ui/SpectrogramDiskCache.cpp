@@ -0,0 +1,104 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file SpectrogramDiskCache.cpp
+
+**********************************************************************/
+#include "SpectrogramDiskCache.h"
+
+#include "Project.h"
+#include "ProjectFileIO.h"
+#include "../../../../ProjectWindow.h"
+#include "SampleCount.h"
+#include "SpectrogramFile.h"
+#include "SpectrumCache.h"
+#include "WaveClip.h"
+#include "WaveTrack.h"
+
+BoolSetting SpectrogramDiskCacheEnabled{ L"/Spectrum/DiskCache", false };
+
+namespace {
+const AudacityProject::AttachedObjects::RegisteredFactory sKey{
+   [](AudacityProject &project) {
+      return std::make_shared<SpectrogramDiskCache>(project);
+   }
+};
+}
+
+SpectrogramDiskCache &SpectrogramDiskCache::Get(AudacityProject &project)
+{
+   return project.AttachedObjects::Get<SpectrogramDiskCache>(sKey);
+}
+
+SpectrogramDiskCache::SpectrogramDiskCache(AudacityProject &project)
+   : mProject{ project }
+{
+}
+
+SpectrogramDiskCache::~SpectrogramDiskCache() = default;
+
+FilePath SpectrogramDiskCache::FileName(const FilePath &projectFileName)
+{
+   return projectFileName + wxT("-spectrogram");
+}
+
+SpectrogramFile *SpectrogramDiskCache::GetFile()
+{
+   auto &projectFileIO = ProjectFileIO::Get(mProject);
+   if (projectFileIO.IsTemporary())
+      return nullptr;
+   // Start another file after Save As
+   const auto fileName = FileName(projectFileIO.GetFileName());
+   if (!mpFile || mpFile->GetFileName() != fileName)
+      mpFile = std::make_unique<SpectrogramFile>(fileName);
+   return mpFile.get();
+}
+
+bool SpectrogramDiskCache::Load(uint64_t key, const sampleCount *where,
+   size_t nColumns, size_t nBins, float *freq)
+{
+   // Save while the tracks and their caches still exist.  Lookups happen in
+   // painting, so the window exists by now, unlike when the project made
+   // this object
+   if (!mSubscription)
+      if (const auto pWindow = ProjectWindow::Find(&mProject))
+         mSubscription = pWindow->Subscribe(
+            [this](ProjectWindowDestroyedMessage) {
+               if (SpectrogramDiskCacheEnabled.Read())
+                  Save();
+            });
+
+   const auto pFile = GetFile();
+   return pFile && pFile->Load(key, where, nColumns, nBins, freq);
+}
+
+void SpectrogramDiskCache::Save()
+{
+   const auto pFile = GetFile();
+   if (!pFile)
+      return;
+
+   // Gather the columns of the complete spectrograms of all clips, each once,
+   // in order of position so that they are read in order
+   SpectrogramFile::Columns columns;
+   for (const auto pTrack : TrackList::Get(mProject).Any<const WaveTrack>())
+      for (const auto pChannel : pTrack->Channels())
+         for (const auto pInterval : pChannel->Intervals()) {
+            const auto &caches =
+               WaveClipSpectrumCache::Get(*pInterval).mSpecCaches;
+            const auto iChannel = pInterval->GetChannelIndex();
+            if (iChannel >= caches.size() || !caches[iChannel])
+               continue;
+            const auto &cache = *caches[iChannel];
+            if (!cache.key || !cache.IsComplete() || cache.len == 0)
+               continue;
+            const auto nBins = cache.freq.size() / cache.len;
+            auto &keyColumns = columns[cache.key];
+            for (size_t xx = 0; xx < cache.len; ++xx)
+               keyColumns.emplace(cache.where[xx].as_long_long(),
+                  SpectrogramFile::Column{ &cache.freq[nBins * xx], nBins });
+         }
+   pFile->Save(columns);
+}
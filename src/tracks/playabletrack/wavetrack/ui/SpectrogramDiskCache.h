@@ -0,0 +1,65 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file SpectrogramDiskCache.h
+  @brief Keeps computed spectrograms between sessions of a project
+
+**********************************************************************/
+#ifndef __AUDACITY_SPECTROGRAM_DISK_CACHE__
+#define __AUDACITY_SPECTROGRAM_DISK_CACHE__
+
+#include "ClientData.h"
+#include "Observer.h"
+#include "Prefs.h"
+
+#include <cstdint>
+#include <memory>
+
+class AudacityProject;
+class sampleCount;
+class SpectrogramFile;
+
+//! Whether spectrograms are saved beside the project file; off by default
+extern AUDACITY_DLL_API BoolSetting SpectrogramDiskCacheEnabled;
+
+//! Stores the spectrograms of a project's clips in a SpectrogramFile beside
+//! the project file
+/*!
+ The file is read at the first lookup, and rewritten when the project window
+ closes, keeping the columns of the previous session that were not replaced,
+ up to a limit.  Temporary projects have no such file.
+ */
+class AUDACITY_DLL_API SpectrogramDiskCache final : public ClientData::Base
+{
+public:
+   static SpectrogramDiskCache &Get(AudacityProject &project);
+
+   explicit SpectrogramDiskCache(AudacityProject &project);
+   SpectrogramDiskCache(const SpectrogramDiskCache&) = delete;
+   SpectrogramDiskCache &operator=(const SpectrogramDiskCache&) = delete;
+   ~SpectrogramDiskCache() override;
+
+   //! @copydoc SpectrogramFile::Load
+   bool Load(uint64_t key, const sampleCount *where, size_t nColumns,
+      size_t nBins, float *freq);
+
+   //! Rewrite the file with the complete spectrograms now cached for the
+   //! project's clips
+   void Save();
+
+   //! The file beside the project file
+   static FilePath FileName(const FilePath &projectFileName);
+
+private:
+   //! @return the file beside the project file, or null if the project is
+   //! temporary
+   SpectrogramFile *GetFile();
+
+   AudacityProject &mProject;
+   Observer::Subscription mSubscription;
+   std::unique_ptr<SpectrogramFile> mpFile;
+};
+
+#endif
@@ -11,37 +11,43 @@
 #include "SpectrumCache.h"
 
 #include "../../../../prefs/SpectrogramSettings.h"
-#include "RealFFTf.h"
+#include "FFTEngine.h"
+#include "SampleBlock.h"
 #include "Sequence.h"
+#include "SpectrogramDiskCache.h"
+#include "SpectrogramFile.h"
 #include "Spectrum.h"
+#include "ThreadPool.h"
 #include "WaveClipUIUtilities.h"
 #include "WaveTrack.h"
 #include "WideSampleSequence.h"
+#include <algorithm>
 #include <cmath>
+#include <functional>
 
 namespace {
 
-static void ComputeSpectrumUsingRealFFTf
-   (float * __restrict buffer, const FFTParam *hFFT,
+static void ComputeSpectrumUsingFFTEngine
+   (float * __restrict buffer, const FFTEngine &engine,
     const float * __restrict window, size_t len, float * __restrict out)
 {
    size_t i;
-   if(len > hFFT->Points * 2)
-      len = hFFT->Points * 2;
+   const auto size = engine.Size();
+   if(len > size)
+      len = size;
    for(i = 0; i < len; i++)
       buffer[i] *= window[i];
-   for( ; i < (hFFT->Points * 2); i++)
+   for( ; i < size; i++)
       buffer[i] = 0; // zero pad as needed
-   RealFFTf(buffer, hFFT);
+   engine.Forward(buffer, buffer);
    // Handle the (real-only) DC
    float power = buffer[0] * buffer[0];
    if(power <= 0)
       out[0] = -160.0;
    else
       out[0] = 10.0 * log10f(power);
-   for(i = 1; i < hFFT->Points; i++) {
-      const int index = hFFT->BitReversed[i];
-      const float re = buffer[index], im = buffer[index + 1];
+   for(i = 1; i < size / 2; i++) {
+      const float re = buffer[2 * i], im = buffer[2 * i + 1];
       power = re * re + im * im;
       if(power <= 0)
          out[i] = -160.0;
@@ -70,8 +76,61 @@ void ComputeSpectrogramGainFactors
    }
 }
 
+//! How many columns one task of the thread pool computes
+constexpr size_t ColumnsPerTask = 16;
+
+//! Progressive population computes every this many columns first
+constexpr int CoarseStride = 8;
+
+//! How long a paint may spend refining progressive columns
+constexpr std::chrono::milliseconds RefinementBudget{ 30 };
+
+//! Call fn(ii, scratch) for each ii in [0, count), in parallel, with scratch
+//! storage of the given size for each task
+void ParallelColumns(size_t count, size_t scratchSize,
+   const std::function<void(size_t, float*)> &fn)
+{
+   const auto nTasks = (count + ColumnsPerTask - 1) / ColumnsPerTask;
+   Parallel::ThreadPool::Get().ParallelFor(nTasks, [&](size_t task) {
+      std::vector<float> scratch(scratchSize);
+      const auto end = std::min(count, (task + 1) * ColumnsPerTask);
+      for (auto ii = task * ColumnsPerTask; ii < end; ++ii)
+         fn(ii, scratch.data());
+   });
+}
+
 }
 
+//! Reassigned powers for the columns of one task, which it adds directly,
+//! and for other columns, which it sets aside
+struct SpecCache::ReassignmentAccumulator
+{
+   ReassignmentAccumulator(float *freq, size_t nBins, int beginX, int endX)
+      : freq{ freq }, nBins{ nBins }, beginX{ beginX }, endX{ endX }
+   {}
+
+   void Add(int xx, int bin, float power)
+   {
+      const auto index = nBins * xx + bin;
+      if (xx >= beginX && xx < endX)
+         freq[index] += power;
+      else
+         others.emplace_back(index, power);
+   }
+
+   //! Add the set-aside powers, after all tasks finish
+   void AddOthers()
+   {
+      for (const auto &[index, power] : others)
+         freq[index] += power;
+   }
+
+   float *const freq;
+   const size_t nBins;
+   const int beginX, endX;
+   std::vector<std::pair<size_t, float>> others;
+};
+
 bool SpecCache::Matches(
    int dirty_, double samplesPerPixel,
    const SpectrogramSettings& settings) const
@@ -91,11 +150,29 @@ bool SpecCache::Matches(
       algorithm == settings.algorithm;
 }
 
+uint64_t SpecCache::PersistentKey(const WaveChannelInterval &clip) const
+{
+   if (algorithm == SpectrogramSettings::algReassignment)
+      return 0;
+   return SpectrogramFile::Key(clip, { algorithm, windowType,
+      static_cast<int>(windowSize), static_cast<int>(zeroPaddingFactor),
+      frequencyGain });
+}
+
+bool SpecCache::Load(SpectrogramDiskCache &diskCache)
+{
+   if (!key || len == 0 ||
+       !diskCache.Load(key, where.data(), len, freq.size() / len, freq.data()))
+      return false;
+   mPending.clear();
+   return true;
+}
+
 bool SpecCache::CalculateOneSpectrum(
    const SpectrogramSettings& settings, const WaveChannelInterval& clip,
    const int xx, double pixelsPerSecond, int lowerBoundX, int upperBoundX,
    const std::vector<float>& gainFactors, float* __restrict scratch,
-   float* __restrict out) const
+   float* __restrict out, ReassignmentAccumulator *pAccumulator) const
 {
    bool result = false;
    const bool reassignment =
@@ -169,10 +246,9 @@ bool SpecCache::CalculateOneSpectrum(
          if (myLen > 0) {
             constexpr auto iChannel = 0u;
             constexpr auto mayThrow = false; // Don't throw just for display
-            mSampleCacheHolder.emplace(
-               clip.GetSampleView(from, myLen, mayThrow));
+            const auto view = clip.GetSampleView(from, myLen, mayThrow);
             floats.resize(myLen);
-            mSampleCacheHolder->Copy(floats.data(), myLen);
+            view.Copy(floats.data(), myLen);
             useBuffer = floats.data();
             if (copy) {
                if (useBuffer)
@@ -197,7 +273,8 @@ bool SpecCache::CalculateOneSpectrum(
       }
       else if (reassignment) {
          static const double epsilon = 1e-16;
-         const auto hFFT = settings.hFFT.get();
+         const auto &engine = *settings.pEngine;
+         const auto half = engine.Size() / 2;
 
          float *const scratch2 = scratch + fftLen;
          std::copy(scratch, scratch2, scratch2);
@@ -209,25 +286,26 @@ bool SpecCache::CalculateOneSpectrum(
             const float *const window = settings.window.get();
             for (size_t ii = 0; ii < fftLen; ++ii)
                scratch[ii] *= window[ii];
-            RealFFTf(scratch, hFFT);
+            engine.Forward(scratch, scratch);
          }
 
          {
             const float *const dWindow = settings.dWindow.get();
             for (size_t ii = 0; ii < fftLen; ++ii)
                scratch2[ii] *= dWindow[ii];
-            RealFFTf(scratch2, hFFT);
+            engine.Forward(scratch2, scratch2);
          }
 
          {
             const float *const tWindow = settings.tWindow.get();
             for (size_t ii = 0; ii < fftLen; ++ii)
                scratch3[ii] *= tWindow[ii];
-            RealFFTf(scratch3, hFFT);
+            engine.Forward(scratch3, scratch3);
          }
 
-         for (size_t ii = 0; ii < hFFT->Points; ++ii) {
-            const int index = hFFT->BitReversed[ii];
+         for (size_t ii = 0; ii < half; ++ii) {
+            // The imaginary part of the DC bin holds the Nyquist frequency
+            const auto index = 2 * ii;
             const float
                denomRe = scratch[index],
                denomIm = ii == 0 ? 0 : scratch[index + 1];
@@ -256,7 +334,7 @@ bool SpecCache::CalculateOneSpectrum(
             const int bin = (int)((int)ii + freqCorrection + 0.5f);
             // Must check if correction takes bin out of bounds, above or below!
             // bin is signed!
-            if (bin >= 0 && bin < (int)hFFT->Points) {
+            if (bin >= 0 && bin < (int)half) {
                double timeCorrection;
                {
                   const float
@@ -277,16 +355,7 @@ bool SpecCache::CalculateOneSpectrum(
                if (correctedX >= lowerBoundX && correctedX < upperBoundX)
                {
                   result = true;
-
-                  // This is non-negative, because bin and correctedX are
-                  auto ind = (int)nBins * correctedX + bin;
-#ifdef _OPENMP
-                  // This assignment can race if index reaches into another thread's bins.
-                  // The probability of a race very low, so this carries little overhead,
-                  // about 5% slower vs allowing it to race.
-                  #pragma omp atomic update
-#endif
-                  out[ind] += power;
+                  pAccumulator->Add(correctedX, bin, power);
                }
             }
          }
@@ -302,8 +371,8 @@ bool SpecCache::CalculateOneSpectrum(
          // the part of useBuffer in the padding zones.
 
          // This function mutates useBuffer
-         ComputeSpectrumUsingRealFFTf
-            (useBuffer, settings.hFFT.get(), settings.window.get(), fftLen, results);
+         ComputeSpectrumUsingFFTEngine
+            (useBuffer, *settings.pEngine, settings.window.get(), fftLen, results);
          if (!gainFactors.empty()) {
             // Apply a frequency-dependent gain factor
             for (size_t ii = 0; ii < nBins; ++ii)
@@ -341,7 +410,8 @@ void SpecCache::Grow(
 
 void SpecCache::Populate(
    const SpectrogramSettings& settings, const WaveChannelInterval& clip,
-   int copyBegin, int copyEnd, size_t numPixels, double pixelsPerSecond)
+   int copyBegin, int copyEnd, size_t numPixels, double pixelsPerSecond,
+   bool progressive)
 {
    const auto sampleRate = clip.GetRate();
    const int &frequencyGainSetting = settings.frequencyGain;
@@ -357,112 +427,189 @@ void SpecCache::Populate(
    const size_t fftLen = windowSizeSetting * zeroPaddingFactorSetting;
    const auto nBins = settings.NBins();
 
-   const size_t bufferSize = fftLen;
-   const size_t scratchSize = reassignment ? 3 * bufferSize : bufferSize;
-   std::vector<float> scratch(scratchSize);
-
    std::vector<float> gainFactors;
    if (!autocorrelation)
       ComputeSpectrogramGainFactors(
          fftLen, sampleRate, frequencyGainSetting, gainFactors);
 
+   mPending.clear();
+
    // Loop over the ranges before and after the copied portion and compute anew.
    // One of the ranges may be empty.
    for (int jj = 0; jj < 2; ++jj) {
       const int lowerBoundX = jj == 0 ? 0 : copyEnd;
       const int upperBoundX = jj == 0 ? copyBegin : numPixels;
 
-// todo(mhodgkinson): I don't find an option to define _OPENMP anywhere. Is this
-// still of interest?
-#ifdef _OPENMP
-      // Storage for mutable per-thread data.
-      // private clause ensures one copy per thread
-      struct ThreadLocalStorage {
-         ThreadLocalStorage()  { }
-         ~ThreadLocalStorage() { }
-
-         void init(SampleTrackCache &waveTrackCache, size_t scratchSize) {
-            if (!cache) {
-               cache = std::make_unique<SampleTrackCache>(waveTrackCache.GetTrack());
-               scratch.resize(scratchSize);
-            }
-         }
-         std::unique_ptr<SampleTrackCache> cache;
-         std::vector<float> scratch;
-      } tls;
+      if (reassignment) {
+         PopulateReassigned(settings, clip,
+            lowerBoundX, upperBoundX, pixelsPerSecond, gainFactors);
+         continue;
+      }
 
-      #pragma omp parallel for private(tls)
-#endif
-      for (auto xx = lowerBoundX; xx < upperBoundX; ++xx)
-      {
-#ifdef _OPENMP
-         tls.init(waveTrackCache, scratchSize);
-         SampleTrackCache& cache = *tls.cache;
-         float* buffer = &tls.scratch[0];
-#else
-         float* buffer = &scratch[0];
-#endif
+      const size_t nColumns = std::max(0, upperBoundX - lowerBoundX);
+      const auto calculate = [&](int xx, float *scratch) {
          CalculateOneSpectrum(
             settings, clip, xx, pixelsPerSecond, lowerBoundX, upperBoundX,
-            gainFactors, buffer, &freq[0]);
+            gainFactors, scratch, &freq[0], nullptr);
+      };
+
+      if (!progressive || nColumns <= CoarseStride * ColumnsPerTask) {
+         ParallelColumns(nColumns, fftLen, [&](size_t ii, float *scratch) {
+            calculate(lowerBoundX + ii, scratch);
+         });
+         continue;
       }
 
-      if (reassignment) {
-         // Need to look beyond the edges of the range to accumulate more
-         // time reassignments.
-         // I'm not sure what's a good stopping criterion?
-         auto xx = lowerBoundX;
-         const double pixelsPerSample =
-            pixelsPerSecond * clip.GetStretchRatio() / sampleRate;
-         const int limit = std::min((int)(0.5 + fftLen * pixelsPerSample), 100);
-         for (int ii = 0; ii < limit; ++ii)
-         {
-            const bool result = CalculateOneSpectrum(
-               settings, clip, --xx, pixelsPerSecond, lowerBoundX, upperBoundX,
-               gainFactors, &scratch[0], &freq[0]);
-            if (!result)
-               break;
-         }
+      // Compute the coarse columns, and copy each into the following ones
+      const auto nCoarse = (nColumns + CoarseStride - 1) / CoarseStride;
+      ParallelColumns(nCoarse, fftLen, [&](size_t ii, float *scratch) {
+         calculate(lowerBoundX + ii * CoarseStride, scratch);
+      });
+      for (auto xx = lowerBoundX; xx < upperBoundX; ++xx) {
+         const auto offset = (xx - lowerBoundX) % CoarseStride;
+         if (offset != 0)
+            std::copy_n(&freq[nBins * (xx - offset)], nBins, &freq[nBins * xx]);
+      }
 
-         xx = upperBoundX;
-         for (int ii = 0; ii < limit; ++ii)
-         {
-            const bool result = CalculateOneSpectrum(
-               settings, clip, xx++, pixelsPerSecond, lowerBoundX, upperBoundX,
-               gainFactors, &scratch[0], &freq[0]);
-            if (!result)
-               break;
-         }
+      // Leave the others for Refine(), halving the span at each level
+      for (int span = CoarseStride / 2; span > 0; span /= 2)
+         for (auto xx = lowerBoundX + span; xx < upperBoundX; xx += 2 * span)
+            mPending.push_back({ xx, std::min(span, upperBoundX - xx) - 1 });
+   }
 
-         // Now Convert to dB terms.  Do this only after accumulating
-         // power values, which may cross columns with the time correction.
-#ifdef _OPENMP
-         #pragma omp parallel for
-#endif
-         for (xx = lowerBoundX; xx < upperBoundX; ++xx) {
-            float *const results = &freq[nBins * xx];
-            for (size_t ii = 0; ii < nBins; ++ii) {
-               float &power = results[ii];
-               if (power <= 0)
-                  power = -160.0;
-               else
-                  power = 10.0*log10f(power);
-            }
-            if (!gainFactors.empty()) {
-               // Apply a frequency-dependent gain factor
-               for (size_t ii = 0; ii < nBins; ++ii)
-                  results[ii] += gainFactors[ii];
-            }
-         }
-      }
+   std::stable_sort(mPending.begin(), mPending.end(),
+      [](const PendingColumn &a, const PendingColumn &b){
+         return a.span > b.span; });
+}
+
+void SpecCache::PopulateReassigned(
+   const SpectrogramSettings& settings, const WaveChannelInterval& clip,
+   int lowerBoundX, int upperBoundX, double pixelsPerSecond,
+   const std::vector<float>& gainFactors)
+{
+   const auto sampleRate = clip.GetRate();
+   const size_t fftLen = settings.WindowSize() * settings.ZeroPaddingFactor();
+   const auto nBins = settings.NBins();
+   const size_t scratchSize = 3 * fftLen;
+   const size_t nColumns = std::max(0, upperBoundX - lowerBoundX);
+
+   // Each task owns a slice of columns, and sets aside the powers it
+   // reassigns outside of them
+   const auto nTasks = (nColumns + ColumnsPerTask - 1) / ColumnsPerTask;
+   std::vector<ReassignmentAccumulator> accumulators;
+   accumulators.reserve(nTasks);
+   for (size_t task = 0; task < nTasks; ++task) {
+      const int beginX = lowerBoundX + task * ColumnsPerTask;
+      accumulators.emplace_back(freq.data(), nBins,
+         beginX, std::min<int>(upperBoundX, beginX + ColumnsPerTask));
    }
+   Parallel::ThreadPool::Get().ParallelFor(nTasks, [&](size_t task) {
+      std::vector<float> scratch(scratchSize);
+      auto &accumulator = accumulators[task];
+      for (auto xx = accumulator.beginX; xx < accumulator.endX; ++xx)
+         CalculateOneSpectrum(
+            settings, clip, xx, pixelsPerSecond, lowerBoundX, upperBoundX,
+            gainFactors, scratch.data(), &freq[0], &accumulator);
+   });
+   // Add the set-aside powers in an order independent of the scheduling
+   for (auto &accumulator : accumulators)
+      accumulator.AddOthers();
+
+   // Need to look beyond the edges of the range to accumulate more
+   // time reassignments.
+   // I'm not sure what's a good stopping criterion?
+   ReassignmentAccumulator accumulator{
+      freq.data(), nBins, lowerBoundX, upperBoundX };
+   std::vector<float> scratch(scratchSize);
+   auto xx = lowerBoundX;
+   const double pixelsPerSample =
+      pixelsPerSecond * clip.GetStretchRatio() / sampleRate;
+   const int limit = std::min((int)(0.5 + fftLen * pixelsPerSample), 100);
+   for (int ii = 0; ii < limit; ++ii)
+   {
+      const bool result = CalculateOneSpectrum(
+         settings, clip, --xx, pixelsPerSecond, lowerBoundX, upperBoundX,
+         gainFactors, &scratch[0], &freq[0], &accumulator);
+      if (!result)
+         break;
+   }
+
+   xx = upperBoundX;
+   for (int ii = 0; ii < limit; ++ii)
+   {
+      const bool result = CalculateOneSpectrum(
+         settings, clip, xx++, pixelsPerSecond, lowerBoundX, upperBoundX,
+         gainFactors, &scratch[0], &freq[0], &accumulator);
+      if (!result)
+         break;
+   }
+
+   // Now Convert to dB terms.  Do this only after accumulating
+   // power values, which may cross columns with the time correction.
+   ParallelColumns(nColumns, 0, [&](size_t column, float *) {
+      float *const results = &freq[nBins * (lowerBoundX + column)];
+      for (size_t ii = 0; ii < nBins; ++ii) {
+         float &power = results[ii];
+         if (power <= 0)
+            power = -160.0;
+         else
+            power = 10.0*log10f(power);
+      }
+      if (!gainFactors.empty()) {
+         // Apply a frequency-dependent gain factor
+         for (size_t ii = 0; ii < nBins; ++ii)
+            results[ii] += gainFactors[ii];
+      }
+   });
+}
+
+bool SpecCache::Refine(
+   const SpectrogramSettings& settings, const WaveChannelInterval& clip,
+   double pixelsPerSecond, std::chrono::steady_clock::duration budget)
+{
+   if (mPending.empty())
+      return false;
+   const auto deadline = std::chrono::steady_clock::now() + budget;
+
+   const size_t fftLen = settings.WindowSize() * settings.ZeroPaddingFactor();
+   const auto nBins = settings.NBins();
+   std::vector<float> gainFactors;
+   if (settings.algorithm != SpectrogramSettings::algPitchEAC)
+      ComputeSpectrogramGainFactors(
+         fftLen, clip.GetRate(), settings.frequencyGain, gainFactors);
+
+   // Enough columns to occupy all threads
+   const size_t batchSize =
+      ColumnsPerTask * (Parallel::ThreadPool::Get().Workers() + 1);
+   auto begin = mPending.begin();
+   const auto end = mPending.end();
+   do {
+      // Take columns of one span only, so that none copies into another
+      // column of the batch
+      const auto span = begin->span;
+      const auto batchEnd = std::find_if(begin,
+         begin + std::min<size_t>(batchSize, end - begin),
+         [span](const PendingColumn &column){ return column.span != span; });
+      ParallelColumns(batchEnd - begin, fftLen,
+         [&](size_t ii, float *scratch) {
+            const auto xx = begin[ii].xx;
+            CalculateOneSpectrum(settings, clip, xx, pixelsPerSecond, 0, len,
+               gainFactors, scratch, &freq[0], nullptr);
+            const auto column = &freq[nBins * xx];
+            for (int jj = 1; jj <= span; ++jj)
+               std::copy_n(column, nBins, column + nBins * jj);
+         });
+      begin = batchEnd;
+   } while (begin != end && std::chrono::steady_clock::now() < deadline);
+   mPending.erase(mPending.begin(), begin);
+   return true;
 }
 
 bool WaveClipSpectrumCache::GetSpectrogram(
    const WaveChannelInterval &clip,
    const float*& spectrogram, SpectrogramSettings& settings,
    const sampleCount*& where, size_t numPixels, double t0,
-   double pixelsPerSecond)
+   double pixelsPerSecond, bool progressive, SpectrogramDiskCache *pDiskCache)
 
 {
    auto &mSpecCache = mSpecCaches[clip.GetChannelIndex()];
@@ -480,12 +627,20 @@ bool WaveClipSpectrumCache::GetSpectrogram(
 
    if (match && mSpecCache->start == t0 && mSpecCache->len >= numPixels)
    {
+      // Continue any progressive computation
+      const bool refined = mSpecCache->Refine(
+         settings, clip, pixelsPerSecond, RefinementBudget);
+
       spectrogram = &mSpecCache->freq[0];
       where = &mSpecCache->where[0];
 
-      return false;  //hit cache completely
+      return refined;  //hit cache completely
    }
 
+   // Columns not yet refined are not worth copying
+   if (!mSpecCache->IsComplete())
+      match = false;
+
    // Caching is not implemented for reassignment, unless for
    // a complete hit, because of the complications of time reassignment
    if (settings.algorithm == SpectrogramSettings::algReassignment)
@@ -562,8 +717,15 @@ bool WaveClipSpectrumCache::GetSpectrogram(
       mSpecCache->where, numPixels, addBias, correction, t0, sampleRate,
       stretchRatio, samplesPerPixel);
 
-   mSpecCache->Populate(
-      settings, clip, copyBegin, copyEnd, numPixels, pixelsPerSecond);
+   mSpecCache->key = pDiskCache ? mSpecCache->PersistentKey(clip) : 0;
+   // Read columns of an earlier session, or of another zoom or scroll
+   // position, if all are stored
+   const bool loaded = pDiskCache && mSpecCache->Load(*pDiskCache);
+   if (!loaded) {
+      mSpecCache->Populate(settings, clip,
+         copyBegin, copyEnd, numPixels, pixelsPerSecond, progressive);
+      mSpecCache->Refine(settings, clip, pixelsPerSecond, RefinementBudget);
+   }
 
    mSpecCache->dirty = mDirty;
    spectrogram = &mSpecCache->freq[0];
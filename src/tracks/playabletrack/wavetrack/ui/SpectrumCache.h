@@ -12,11 +12,14 @@
 #define __AUDACITY_WAVECLIP_SPECTRUM_CACHE__
 
 class sampleCount;
+class SpectrogramDiskCache;
 class SpectrogramSettings;
 class WaveClipChannel;
 using WaveChannelInterval = WaveClipChannel;
 class WideSampleSequence;
 
+#include <chrono>
+#include <cstdint>
 #include <vector>
 #include "MemoryX.h"
 #include "WaveClip.h" // to inherit WaveClipListener
@@ -51,9 +54,44 @@ public:
       double start /*relative to clip play start time*/);
 
    // Calculate the dirty columns at the begin and end of the cache
+   /*!
+    Columns are computed by the ThreadPool.
+    @param progressive if true, compute only every few columns, copy them
+    into the columns between, and leave those for Refine()
+    */
    void Populate(
       const SpectrogramSettings& settings, const WaveChannelInterval& clip,
-      int copyBegin, int copyEnd, size_t numPixels, double pixelsPerSecond);
+      int copyBegin, int copyEnd, size_t numPixels, double pixelsPerSecond,
+      bool progressive = false);
+
+   //! Compute columns that a progressive Populate() left approximate, coarse
+   //! ones first, until none are left or the time budget is spent
+   /*!
+    @pre the settings, clip and zoom are as for the last Populate()
+    @return whether any column changed
+    */
+   bool Refine(
+      const SpectrogramSettings& settings, const WaveChannelInterval& clip,
+      double pixelsPerSecond, std::chrono::steady_clock::duration budget);
+
+   //! Whether no columns are left for Refine()
+   bool IsComplete() const { return mPending.empty(); }
+
+   //! Identifies, after Grow(), what the columns of the cache are computed
+   //! from, across sessions
+   /*!
+    Hashes the sample blocks of the clip, its trims, stretch and rate, and
+    the spectrogram parameters, but not the zoom or scroll position:  a
+    column depends on those only through the sample in where[] that it is
+    centered at.
+    @return 0 if the clip has unsaved samples, or for reassignment, whose
+    columns also depend on their neighbours
+    */
+   uint64_t PersistentKey(const WaveChannelInterval &clip) const;
+
+   //! Fill all columns from the disk cache, using `key` and where[]
+   //! @return whether all were found
+   bool Load(SpectrogramDiskCache &diskCache);
 
    size_t       len { 0 }; // counts pixels, not samples
    int          algorithm;
@@ -67,18 +105,35 @@ public:
    int          frequencyGain;
    std::vector<float> freq;
    std::vector<sampleCount> where;
+   //! The PersistentKey() of the columns if they may be saved, or 0
+   uint64_t     key{ 0 };
 
    int          dirty;
 
 private:
+   struct ReassignmentAccumulator;
+
    // Calculate one column of the spectrum
+   // For reassignment, add powers to *pAccumulator instead of out
    bool CalculateOneSpectrum(
       const SpectrogramSettings& settings, const WaveChannelInterval &clip,
       const int xx, double pixelsPerSecond, int lowerBoundX, int upperBoundX,
       const std::vector<float>& gainFactors, float* __restrict scratch,
-      float* __restrict out) const;
+      float* __restrict out, ReassignmentAccumulator *pAccumulator) const;
 
-   mutable std::optional<AudioSegmentSampleView> mSampleCacheHolder;
+   void PopulateReassigned(
+      const SpectrogramSettings& settings, const WaveChannelInterval& clip,
+      int lowerBoundX, int upperBoundX, double pixelsPerSecond,
+      const std::vector<float>& gainFactors);
+
+   //! A column left approximate by Populate()
+   struct PendingColumn {
+      int xx;
+      //! How many following columns copy this one until they are refined
+      int span;
+   };
+   //! Sorted by decreasing span
+   std::vector<PendingColumn> mPending;
 };
 
 class SpecPxCache {
@@ -124,11 +179,16 @@ struct WaveClipSpectrumCache final : WaveClipListener
    // > only the 0th channel of sequence is really used
    // > In the interim, this still works correctly for WideSampleSequence backed
    // > by a right channel track, which always ignores its partner.
+   // If progressive, some columns may be approximate; then the cache for
+   // the channel is not complete, and later calls refine it
+   // If pDiskCache is not null, spectrograms computed afresh are first
+   // looked up there, and complete ones may later be saved there
    bool GetSpectrogram(const WaveChannelInterval &clip,
       const float *&spectrogram,
       SpectrogramSettings &spectrogramSettings,
       const sampleCount *&where, size_t numPixels,
-      double t0 /*absolute time*/, double pixelsPerSecond);
+      double t0 /*absolute time*/, double pixelsPerSecond,
+      bool progressive = false, SpectrogramDiskCache *pDiskCache = nullptr);
 
    void MakeStereo(WaveClipListener &&other, bool aligned) override;
    void SwapChannels() override;
@@ -12,6 +12,7 @@ Paul Licameli split from WaveChannelView.cpp
 #include "SpectrumView.h"
 
 #include "SpectralDataManager.h" // Cycle :-(
+#include "SpectrogramDiskCache.h"
 #include "SpectrumCache.h"
 
 #include "Sequence.h"
@@ -29,6 +30,7 @@ Paul Licameli split from WaveChannelView.cpp
 #include "NumberScale.h"
 #include "../../../../TrackArt.h"
 #include "../../../../TrackArtist.h"
+#include "../../../../TrackPanel.h"
 #include "../../../../TrackPanelDrawingContext.h"
 #include "ViewInfo.h"
 #include "WaveClip.h"
@@ -424,9 +426,19 @@ void DrawClipSpectrum(TrackPanelDrawingContext &context,
    const double binUnit = sampleRate / (2 * half);
    const float *freq = 0;
    const sampleCount *where = 0;
+   constexpr auto progressive = true;
+   const auto pProject = artist->parent ? artist->parent->GetProject() : nullptr;
+   const auto pDiskCache = pProject && SpectrogramDiskCacheEnabled.Read()
+      ? &SpectrogramDiskCache::Get(*pProject) : nullptr;
    bool updated = WaveClipSpectrumCache::Get(clip).GetSpectrogram(
       clip, freq, settings, where, (size_t)hiddenMid.width, t0,
-      averagePixelsPerSecond);
+      averagePixelsPerSecond, progressive, pDiskCache);
+   if (!WaveClipSpectrumCache::Get(clip)
+      .mSpecCaches[clip.GetChannelIndex()]->IsComplete()) {
+      // Paint again soon, to show refined columns
+      if (const auto panel = artist->parent)
+         panel->CallAfter([panel]{ panel->Refresh(false); });
+   }
    auto nBins = settings.NBins();
 
    float minFreq, maxFreq;
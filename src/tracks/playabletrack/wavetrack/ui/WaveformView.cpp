@@ -249,7 +249,9 @@ public:
          channelCache.BitmapCache->SetSelection(zoomInfo, t0, t1, selected);
    }
 
-   void Draw(
+   //! @return whether some of the waveform is not yet filled, and must be
+   //! painted again
+   bool Draw(
       int channelIndex, wxDC& dc, const WavePaintParameters& params,
       const ZoomInfo& zoomInfo, const wxRect& targetRect, int leftOffset,
       double from, double to)
@@ -282,6 +284,14 @@ public:
 
          left += width;
       }
+
+      const bool showsPlaceholders =
+         channelCache.DataCache->ShowsPlaceholders();
+
+      // Fill what scrolling or zooming out shows next on the worker thread
+      channelCache.DataCache->Prefetch(zoomInfo, from, to);
+
+      return showsPlaceholders;
    }
 
    void MarkChanged() noexcept override
@@ -360,9 +370,15 @@ void DrawWaveform(
       artist->pSelectedRegion->t1() - sequenceStartTime,
       SyncLock::IsSelectedOrSyncLockSelected(track));
 
-   clipPainter.Draw(
+   const bool incomplete = clipPainter.Draw(
       channelIndex, context.dc, paintParameters, zoomInfo, rect, leftOffset,
       t0 + trimLeft, t1 + trimLeft);
+
+   if (incomplete) {
+      // Paint again soon, to show the elements filled meanwhile
+      if (const auto panel = artist->parent)
+         panel->CallAfter([panel]{ panel->Refresh(false); });
+   }
 }
 
 
@@ -0,0 +1,185 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+ Audacity: A Digital Audio Editor
+
+ FakeSampleBlock.h
+
+ **********************************************************************/
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "Dither.h"
+#include "SampleBlock.h"
+
+//! A block of samples all of one value, that stores none of them, for tests
+//! that need only the lengths and summaries of many blocks
+class FakeSampleBlock final : public SampleBlock
+{
+public:
+   //! Called before each read of samples or of summaries, on the reading
+   //! thread; it may throw or wait, as a read of the database might
+   using ReadHook = std::function<void()>;
+
+   FakeSampleBlock(
+      SampleBlockID id, size_t count, float value = 0, ReadHook readHook = {})
+       : mID { id }
+       , mCount { count }
+       , mValue { value }
+       , mReadHook { std::move(readHook) }
+   {
+   }
+
+   void SetImpliedSampleCount(size_t count) override
+   {
+      mCount = count;
+   }
+
+   void CloseLock() noexcept override
+   {
+   }
+
+   SampleBlockID GetBlockID() const override
+   {
+      return mID;
+   }
+
+   BlockSampleView GetFloatSampleView(bool) override
+   {
+      return std::make_shared<std::vector<float>>(mCount, mValue);
+   }
+
+   sampleFormat GetSampleFormat() const override
+   {
+      return floatSample;
+   }
+
+   size_t GetSampleCount() const override
+   {
+      return mCount;
+   }
+
+   bool GetSummary256(float* dest, size_t, size_t numframes) override
+   {
+      return GetSummary(dest, numframes);
+   }
+
+   bool GetSummary64k(float* dest, size_t, size_t numframes) override
+   {
+      return GetSummary(dest, numframes);
+   }
+
+   size_t GetSpaceUsage() const override
+   {
+      return 0;
+   }
+
+   void SaveXML(XMLWriter&) override
+   {
+   }
+
+protected:
+   size_t DoGetSamples(
+      samplePtr dest, sampleFormat destformat, size_t sampleoffset,
+      size_t numsamples) override
+   {
+      if (mReadHook)
+         mReadHook();
+      if (sampleoffset >= mCount)
+         return 0;
+      numsamples = std::min(numsamples, mCount - sampleoffset);
+      const std::vector<float> values(numsamples, mValue);
+      CopySamples(
+         reinterpret_cast<constSamplePtr>(values.data()), floatSample, dest,
+         destformat, numsamples, DitherType::none);
+      return numsamples;
+   }
+
+   MinMaxRMS DoGetMinMaxRMS(size_t, size_t) override
+   {
+      return DoGetMinMaxRMS();
+   }
+
+   MinMaxRMS DoGetMinMaxRMS() const override
+   {
+      return { mValue, mValue, std::abs(mValue) };
+   }
+
+private:
+   bool GetSummary(float* dest, size_t numframes)
+   {
+      if (mReadHook)
+         mReadHook();
+      for (size_t ii = 0; ii < numframes; ++ii)
+      {
+         *dest++ = mValue;
+         *dest++ = mValue;
+         *dest++ = std::abs(mValue);
+      }
+      return true;
+   }
+
+   const SampleBlockID mID;
+   size_t mCount;
+   const float mValue;
+   const ReadHook mReadHook;
+};
+
+//! Makes FakeSampleBlocks, keeping only the first of the given samples, so
+//! that each appended block reads back as that value repeated; blocks read
+//! from XML have the lengths that their sequence implies
+class FakeSampleBlockFactory final : public SampleBlockFactory
+{
+public:
+   explicit FakeSampleBlockFactory(FakeSampleBlock::ReadHook readHook = {})
+       : mReadHook { std::move(readHook) }
+   {
+   }
+
+   SampleBlockIDs GetActiveBlockIDs() override
+   {
+      return {};
+   }
+
+protected:
+   SampleBlockPtr DoCreate(
+      constSamplePtr src, size_t numsamples, sampleFormat srcformat) override
+   {
+      float value = 0;
+      if (numsamples > 0)
+         CopySamples(
+            src, srcformat, reinterpret_cast<samplePtr>(&value), floatSample,
+            1, DitherType::none);
+      return Make(numsamples, value);
+   }
+
+   SampleBlockPtr DoCreateSilent(size_t numsamples, sampleFormat) override
+   {
+      return Make(numsamples, 0);
+   }
+
+   SampleBlockPtr DoCreateFromXML(sampleFormat, const AttributesList&) override
+   {
+      return Make(0, 0);
+   }
+
+   SampleBlockPtr DoCreateFromId(sampleFormat, SampleBlockID) override
+   {
+      return nullptr;
+   }
+
+private:
+   SampleBlockPtr Make(size_t numsamples, float value)
+   {
+      return std::make_shared<FakeSampleBlock>(
+         ++mLastID, numsamples, value, mReadHook);
+   }
+
+   const FakeSampleBlock::ReadHook mReadHook;
+   SampleBlockID mLastID = 0;
+};
@@ -0,0 +1,49 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+ Audacity: A Digital Audio Editor
+
+ TemporaryDirectory.h
+
+ **********************************************************************/
+#pragma once
+
+#include <filesystem>
+#include <random>
+#include <string>
+
+//! A new empty directory, removed with its contents on destruction
+class TemporaryDirectory final
+{
+public:
+   //! @param prefix begins the name; a suffix makes it unique, even among
+   //! test processes running at once
+   explicit TemporaryDirectory(const std::string& prefix)
+   {
+      std::random_device device;
+      std::mt19937_64 engine { device() };
+      // create_directory() is false if the name was taken, by another
+      // process or an earlier test, and then another is tried
+      do
+         mPath = std::filesystem::temp_directory_path() /
+                 (prefix + "-" + std::to_string(engine()));
+      while (!std::filesystem::create_directory(mPath));
+   }
+
+   ~TemporaryDirectory()
+   {
+      std::error_code ec;
+      std::filesystem::remove_all(mPath, ec);
+   }
+
+   TemporaryDirectory(const TemporaryDirectory&) = delete;
+   TemporaryDirectory& operator=(const TemporaryDirectory&) = delete;
+
+   std::string File(const std::string& name) const
+   {
+      return (mPath / name).string();
+   }
+
+private:
+   std::filesystem::path mPath;
+};